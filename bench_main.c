@@ -0,0 +1,51 @@
+/**
+ * @file bench_main.c
+ * @brief Entry point of the LoRa_bench on-target benchmark image
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This is the entry point of the benchmark firmware built next to the
+ * application when LORA_BENCH is enabled. It runs every benchmark once the
+ * console had time to connect, then again each time 'b' arrives on stdio,
+ * so results can be captured from several runs and compared by release.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "src/run.h"
+#include "src/log.h"
+#include "src/trace.h"
+
+// Time for the USB console to enumerate before the first run
+#define BENCH_STARTUP_DELAY_MS 2000
+
+/**
+ * @brief Main entry point of the benchmark image
+ *
+ * @return int Program exit status (never reached in normal operation)
+ */
+int main(void)
+{
+    // Initialize standard I/O
+    stdio_init_all();
+
+    // The code under test may log or trace, so prepare both as main.c does
+    log_init();
+    trace_init();
+
+    sleep_ms(BENCH_STARTUP_DELAY_MS);
+    run_bench();
+
+    while (true)
+    {
+        if (getchar_timeout_us(100000) == 'b')
+        {
+            run_bench();
+        }
+    }
+
+    return 0;
+}
@@ -16,6 +16,8 @@
 #include <stdio.h>
 #include "pico/stdlib.h"
 #include "src/run.h"
+#include "src/log.h"
+#include "src/trace.h"
 
 /**
  * @brief Main entry point of the application
@@ -31,6 +33,12 @@ int main(void)
     // Initialize standard I/O
     stdio_init_all();
 
+    // Prepare the deferred log ring before any interrupt can use it
+    log_init();
+
+    // Same for the latency trace histograms
+    trace_init();
+
     // Start the main application
     run();
 
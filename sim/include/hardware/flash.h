@@ -0,0 +1,34 @@
+/**
+ * @file flash.h
+ * @brief Host stand-in for the Pico SDK's hardware/flash.h
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * Part of the host simulation build (sim/). Flash is a RAM array that
+ * starts erased on every run, so each run is a first boot. Erasing and
+ * programming take as long as on the RP2040's flash. Declares only what
+ * the firmware sources use; see the Pico SDK for the API documentation.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef SIM_HARDWARE_FLASH_H
+#define SIM_HARDWARE_FLASH_H
+
+#include "pico/types.h"
+
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+
+#ifndef PICO_FLASH_SIZE_BYTES
+#define PICO_FLASH_SIZE_BYTES (64u * 1024u)
+#endif
+
+extern uint8_t sim_flash[PICO_FLASH_SIZE_BYTES];
+#define XIP_BASE ((uintptr_t)sim_flash)
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+
+#endif /* SIM_HARDWARE_FLASH_H */
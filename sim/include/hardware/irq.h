@@ -0,0 +1,46 @@
+/**
+ * @file irq.h
+ * @brief Host stand-in for the Pico SDK's hardware/irq.h
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * Part of the host simulation build (sim/). Handlers run between
+ * simulated SDK calls while interrupts are enabled, never inside another
+ * handler. Declares only what the firmware sources use; see the Pico SDK
+ * for the API documentation.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef SIM_HARDWARE_IRQ_H
+#define SIM_HARDWARE_IRQ_H
+
+#include "pico/types.h"
+
+enum irq_num_rp2040
+{
+    TIMER_IRQ_0 = 0,
+    TIMER_IRQ_1 = 1,
+    TIMER_IRQ_2 = 2,
+    TIMER_IRQ_3 = 3,
+    PIO0_IRQ_0 = 7,
+    PIO0_IRQ_1 = 8,
+    DMA_IRQ_0 = 11,
+    DMA_IRQ_1 = 12,
+    IO_IRQ_BANK0 = 13,
+    SIO_IRQ_PROC0 = 15,
+    SIO_IRQ_PROC1 = 16,
+    UART0_IRQ = 20,
+    UART1_IRQ = 21,
+    NUM_IRQS = 32
+};
+
+typedef void (*irq_handler_t)(void);
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_set_enabled(uint num, bool enabled);
+bool irq_is_enabled(uint num);
+void irq_set_priority(uint num, uint8_t hardware_priority);
+
+#endif /* SIM_HARDWARE_IRQ_H */
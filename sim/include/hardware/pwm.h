@@ -0,0 +1,34 @@
+/**
+ * @file pwm.h
+ * @brief Host stand-in for the Pico SDK's hardware/pwm.h
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * Part of the host simulation build (sim/). Levels are accepted and
+ * ignored. Declares only what the firmware sources use; see the Pico SDK
+ * for the API documentation.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef SIM_HARDWARE_PWM_H
+#define SIM_HARDWARE_PWM_H
+
+#include "pico/types.h"
+
+static inline uint pwm_gpio_to_slice_num(uint gpio)
+{
+    return (gpio >> 1u) & 7u;
+}
+
+static inline uint pwm_gpio_to_channel(uint gpio)
+{
+    return gpio & 1u;
+}
+
+void pwm_set_wrap(uint slice_num, uint16_t wrap);
+void pwm_set_gpio_level(uint gpio, uint16_t level);
+void pwm_set_enabled(uint slice_num, bool enabled);
+
+#endif /* SIM_HARDWARE_PWM_H */
@@ -0,0 +1,55 @@
+/**
+ * @file sync.h
+ * @brief Host stand-in for the Pico SDK's hardware/sync.h
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * Part of the host simulation build (sim/). There is one core, so a spin
+ * lock only holds off interrupts, and WFE sleeps until the simulator's
+ * next event. Declares only what the firmware sources use; see the Pico
+ * SDK for the API documentation.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef SIM_HARDWARE_SYNC_H
+#define SIM_HARDWARE_SYNC_H
+
+#include "pico/types.h"
+
+typedef volatile uint32_t spin_lock_t;
+
+static inline void __compiler_memory_barrier(void)
+{
+    __asm__ volatile("" : : : "memory");
+}
+
+static inline void __dmb(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void __mem_fence_acquire(void)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+}
+
+static inline void __mem_fence_release(void)
+{
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void __sev(void);
+void __wfe(void);
+void __wfi(void);
+
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+
+spin_lock_t *spin_lock_instance(uint lock_num);
+int spin_lock_claim_unused(bool required);
+uint32_t spin_lock_blocking(spin_lock_t *lock);
+void spin_unlock(spin_lock_t *lock, uint32_t saved_irq);
+
+#endif /* SIM_HARDWARE_SYNC_H */
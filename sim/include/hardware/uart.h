@@ -0,0 +1,84 @@
+/**
+ * @file uart.h
+ * @brief Host stand-in for the Pico SDK's hardware/uart.h
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * Part of the host simulation build (sim/). Each UART has PL011-sized
+ * FIFOs that fill and drain at its baud rate; the simulator sets the
+ * masked interrupt status (mis) before it calls the interrupt handler.
+ * Declares only what the firmware sources use; see the Pico SDK for the
+ * API documentation.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef SIM_HARDWARE_UART_H
+#define SIM_HARDWARE_UART_H
+
+#include "pico/types.h"
+
+#define NUM_UARTS 2
+
+#define UART_UARTMIS_RTMIS_BITS 0x00000040u
+#define UART_UARTMIS_TXMIS_BITS 0x00000020u
+#define UART_UARTMIS_RXMIS_BITS 0x00000010u
+
+typedef enum
+{
+    UART_PARITY_NONE,
+    UART_PARITY_EVEN,
+    UART_PARITY_ODD
+} uart_parity_t;
+
+// Register block; only the status registers read by interrupt handlers are kept up to date
+typedef struct
+{
+    volatile uint32_t dr;
+    volatile uint32_t rsr;
+    uint32_t _pad0[4];
+    volatile uint32_t fr;
+    uint32_t _pad1;
+    volatile uint32_t ilpr;
+    volatile uint32_t ibrd;
+    volatile uint32_t fbrd;
+    volatile uint32_t lcr_h;
+    volatile uint32_t cr;
+    volatile uint32_t ifls;
+    volatile uint32_t imsc;
+    volatile uint32_t ris;
+    volatile uint32_t mis;
+    volatile uint32_t icr;
+    volatile uint32_t dmacr;
+} uart_hw_t;
+
+typedef struct uart_inst uart_inst_t;
+
+extern uart_inst_t *const sim_uart_instances[NUM_UARTS];
+#define uart0 (sim_uart_instances[0])
+#define uart1 (sim_uart_instances[1])
+
+uint uart_init(uart_inst_t *uart, uint baudrate);
+void uart_deinit(uart_inst_t *uart);
+uint uart_set_baudrate(uart_inst_t *uart, uint baudrate);
+void uart_set_format(uart_inst_t *uart, uint data_bits, uint stop_bits, uart_parity_t parity);
+void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts);
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled);
+void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data, bool tx_needs_data);
+bool uart_is_enabled(uart_inst_t *uart);
+uint uart_get_index(uart_inst_t *uart);
+uart_hw_t *uart_get_hw(uart_inst_t *uart);
+
+bool uart_is_writable(uart_inst_t *uart);
+bool uart_is_readable(uart_inst_t *uart);
+bool uart_is_readable_within_us(uart_inst_t *uart, uint32_t us);
+void uart_tx_wait_blocking(uart_inst_t *uart);
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len);
+void uart_read_blocking(uart_inst_t *uart, uint8_t *dst, size_t len);
+void uart_putc_raw(uart_inst_t *uart, char c);
+void uart_putc(uart_inst_t *uart, char c);
+void uart_puts(uart_inst_t *uart, const char *s);
+char uart_getc(uart_inst_t *uart);
+
+#endif /* SIM_HARDWARE_UART_H */
@@ -0,0 +1,22 @@
+/**
+ * @file flash.h
+ * @brief Host stand-in for the Pico SDK's pico/flash.h
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * Part of the host simulation build (sim/). The function runs with
+ * interrupts held off; see the Pico SDK for the API documentation.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef SIM_PICO_FLASH_H
+#define SIM_PICO_FLASH_H
+
+#include "pico/platform.h"
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms);
+bool flash_safe_execute_core_init(void);
+
+#endif /* SIM_PICO_FLASH_H */
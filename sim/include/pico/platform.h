@@ -0,0 +1,39 @@
+/**
+ * @file platform.h
+ * @brief Host stand-in for the Pico SDK's pico/platform.h
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * Part of the host simulation build (sim/). Declares only what the
+ * firmware sources use; see the Pico SDK for the API documentation.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef SIM_PICO_PLATFORM_H
+#define SIM_PICO_PLATFORM_H
+
+#include "pico/types.h"
+
+#define __aligned(x) __attribute__((aligned(x)))
+#define __not_in_flash_func(func) func
+#define __time_critical_func(func) func
+
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+
+#ifndef MIN
+#define MIN(a, b) ((b) < (a) ? (b) : (a))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+#endif
+
+#define PICO_OK 0
+#define PICO_ERROR_TIMEOUT (-1)
+#define PICO_ERROR_GENERIC (-2)
+
+// Busy-wait loop bodies advance the simulated clock
+void tight_loop_contents(void);
+
+#endif /* SIM_PICO_PLATFORM_H */
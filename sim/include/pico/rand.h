@@ -0,0 +1,22 @@
+/**
+ * @file rand.h
+ * @brief Host stand-in for the Pico SDK's pico/rand.h
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * Part of the host simulation build (sim/). Numbers come from the
+ * simulator's seeded generator, so a run can be repeated exactly.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef SIM_PICO_RAND_H
+#define SIM_PICO_RAND_H
+
+#include "pico/types.h"
+
+uint32_t get_rand_32(void);
+uint64_t get_rand_64(void);
+
+#endif /* SIM_PICO_RAND_H */
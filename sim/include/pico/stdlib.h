@@ -0,0 +1,30 @@
+/**
+ * @file stdlib.h
+ * @brief Host stand-in for the Pico SDK's pico/stdlib.h
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * Part of the host simulation build (sim/). Pulls in the same headers as
+ * the SDK version. Console output goes to the host's stdout and the
+ * console never has input. See the Pico SDK for the API documentation.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef SIM_PICO_STDLIB_H
+#define SIM_PICO_STDLIB_H
+
+#include <stdio.h>
+#include "pico/types.h"
+#include "pico/platform.h"
+#include "pico/time.h"
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+
+#define PICO_DEFAULT_LED_PIN 25
+
+bool stdio_init_all(void);
+int getchar_timeout_us(uint32_t timeout_us);
+
+#endif /* SIM_PICO_STDLIB_H */
@@ -0,0 +1,26 @@
+/**
+ * @file types.h
+ * @brief Host stand-in for the Pico SDK's pico/types.h
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * Part of the host simulation build (sim/). Declares only what the
+ * firmware sources use; see the Pico SDK for the API documentation.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef SIM_PICO_TYPES_H
+#define SIM_PICO_TYPES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+
+// Microseconds since boot, as in SDK builds without PICO_OPAQUE_ABSOLUTE_TIME_T
+typedef uint64_t absolute_time_t;
+
+#endif /* SIM_PICO_TYPES_H */
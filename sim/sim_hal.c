@@ -0,0 +1,1499 @@
+/**
+ * @file sim_hal.c
+ * @brief Simulated RP2040 hardware implementation
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This source file implements the stand-in SDK functions on one virtual
+ * clock. Hardware activity (UART shifting, alarms, scenario callbacks) is a
+ * queue of timed events; a call that advances the clock first runs the
+ * events that fell due, then takes any interrupt whose line is high, in
+ * RP2040 priority order: timer alarms, GPIO, UART0, UART1.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "sim_hal.h"
+#include "pico/rand.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "hardware/uart.h"
+
+// Simulator sizing
+#define SIM_MAX_EVENTS 128
+#define SIM_UART_FIFO_DEPTH 32
+#define SIM_UART_FIFO_LEVEL 4   // PL011 1/8 trigger level the SDK selects
+#define SIM_UART_TIMEOUT_BITS 32 // Receive timeout after this many idle bit times
+#define SIM_WIRE_DEPTH 32
+#define SIM_POOL_ALARM 3 // Hardware alarm behind the alarm pool, as in the SDK
+#define SIM_POOL_SIZE 8
+#define SIM_SPIN_LOCK_FIRST 24 // First lock spin_lock_claim_unused() hands out, as in the SDK
+#define SIM_SPIN_LOCK_COUNT 32
+#define SIM_IDLE_WAKE_NS 1000000ull // WFE with nothing scheduled returns after this long
+
+// Flash timings (typical for the Pico's W25Q16JV)
+#define SIM_FLASH_ERASE_NS 45000000ull
+#define SIM_FLASH_PROGRAM_NS 400000ull
+
+typedef struct
+{
+    uint64_t at_ns;
+    sim_hal_event_fn_t fn;
+    void *arg;
+} sim_event_t;
+
+typedef struct
+{
+    uint8_t data[SIM_HAL_WIRE_MAX];
+    uint16_t length;
+    uint baud_rate;
+    bool faults;
+    bool damaged;
+    sim_hal_wire_done_fn_t done;
+    void *arg;
+} sim_wire_chunk_t;
+
+struct uart_inst
+{
+    uart_hw_t hw;
+    uint index;
+    bool enabled;
+    uint baud_rate;
+    bool rx_irq;
+    bool tx_irq;
+
+    // Receive FIFO
+    uint8_t rx_fifo[SIM_UART_FIFO_DEPTH];
+    uint rx_head;
+    uint rx_count;
+    bool rx_timeout;
+    uint64_t rx_last_ns;
+
+    // Transmit FIFO; the head byte is the one being shifted out
+    uint8_t tx_fifo[SIM_UART_FIFO_DEPTH];
+    uint tx_head;
+    uint tx_count;
+    bool tx_busy;
+    sim_hal_uart_peer_fn_t peer;
+    void *peer_data;
+
+    // Chunks queued on the RX line
+    sim_wire_chunk_t wire[SIM_WIRE_DEPTH];
+    uint wire_head;
+    uint wire_count;
+    uint16_t wire_pos;
+    bool wire_busy;
+    uint fault_left;
+    bool fault_drop;
+};
+
+typedef struct
+{
+    bool claimed;
+    bool armed;
+    bool pending;
+    uint64_t target_us;
+    hardware_alarm_callback_t callback;
+} sim_alarm_t;
+
+typedef struct
+{
+    alarm_id_t id; // 0 = slot free
+    bool pending;
+    uint64_t target_us;
+    alarm_callback_t callback;
+    void *user_data;
+} sim_pool_alarm_t;
+
+static struct
+{
+    uint64_t now_ns;
+    uint32_t call_ns;
+    uint64_t next_event_ns;
+    sim_event_t events[SIM_MAX_EVENTS];
+    uint event_count;
+
+    // Processor
+    bool irq_masked;
+    bool in_isr;
+    bool event_flag;
+    irq_handler_t handlers[NUM_IRQS];
+    bool irq_enabled[NUM_IRQS];
+
+    // GPIO
+    uint32_t gpio_out;
+    uint32_t gpio_oe;
+    uint32_t gpio_pull_up;
+    uint32_t gpio_fall_enabled;
+    uint32_t gpio_pending;
+    enum gpio_function gpio_func[NUM_BANK0_GPIOS];
+    gpio_irq_callback_t gpio_callback;
+    sim_hal_gpio_hook_t gpio_hook;
+    void *gpio_hook_data;
+
+    // Timer
+    sim_alarm_t alarms[NUM_TIMERS];
+    sim_pool_alarm_t pool[SIM_POOL_SIZE];
+    alarm_id_t pool_next_id;
+
+    // Spin locks
+    spin_lock_t locks[SIM_SPIN_LOCK_COUNT];
+    uint lock_next;
+
+    // Random numbers
+    uint64_t rand_state;
+    uint64_t scenario_rand_state;
+    sim_hal_faults_t faults;
+
+    sim_hal_stats_t stats;
+} sim;
+
+static struct uart_inst sim_uarts[NUM_UARTS];
+uart_inst_t *const sim_uart_instances[NUM_UARTS] = {&sim_uarts[0], &sim_uarts[1]};
+
+uint8_t sim_flash[PICO_FLASH_SIZE_BYTES];
+
+// Forward declarations
+static void sim_schedule(uint64_t at_ns, sim_hal_event_fn_t fn, void *arg);
+static void sim_tick(void);
+static void sim_run_due(void);
+static void sim_update_next_event(void);
+static void sim_dispatch(void);
+static bool sim_dispatch_one(void);
+static bool sim_irq_pending(void);
+static void sim_advance_to(uint64_t target_ns, bool sleeping);
+static void sim_wait_for_event(uint64_t until_ns);
+static void sim_stall(uint64_t duration_ns);
+static uint64_t sim_xorshift(uint64_t *state);
+static double sim_uniform(void);
+static void sim_gpio_write(uint32_t mask, uint32_t values);
+static uint64_t uart_bit_ns(uint baud_rate);
+static bool uart_irq_level(const struct uart_inst *u);
+static void uart_refresh_hw(struct uart_inst *u);
+static void uart_tx_event(void *arg);
+static bool uart_rx_land(struct uart_inst *u, uint8_t byte);
+static void uart_rx_timeout_event(void *arg);
+static void wire_start_byte(struct uart_inst *u);
+static void wire_byte_event(void *arg);
+static void alarm_event(void *arg);
+static void pool_event(void *arg);
+static void pool_fire(sim_pool_alarm_t *alarm);
+
+// Scenario interface
+
+void sim_hal_init(uint64_t seed, uint32_t call_ns)
+{
+    memset(&sim, 0, sizeof(sim));
+    memset(sim_uarts, 0, sizeof(sim_uarts));
+    sim.call_ns = call_ns ? call_ns : SIM_HAL_DEFAULT_CALL_NS;
+    sim.next_event_ns = UINT64_MAX;
+    sim.rand_state = seed * 2654435761u + 0x9E3779B97F4A7C15ull;
+    sim.scenario_rand_state = seed * 40503u + 0xD1B54A32D192ED03ull;
+    sim.pool_next_id = 1;
+    sim.lock_next = SIM_SPIN_LOCK_FIRST;
+    sim.alarms[SIM_POOL_ALARM].claimed = true;
+    for (uint i = 0; i < NUM_BANK0_GPIOS; i++)
+    {
+        sim.gpio_func[i] = GPIO_FUNC_NULL;
+    }
+    for (uint i = 0; i < NUM_UARTS; i++)
+    {
+        sim_uarts[i].index = i;
+    }
+
+    // Erased flash: every run is a first boot
+    memset(sim_flash, 0xFF, sizeof(sim_flash));
+}
+
+uint64_t sim_hal_now_ns(void)
+{
+    return sim.now_ns;
+}
+
+bool sim_hal_schedule(uint64_t at_ns, sim_hal_event_fn_t fn, void *arg)
+{
+    if (sim.event_count >= SIM_MAX_EVENTS || fn == NULL)
+    {
+        return false;
+    }
+
+    sim.events[sim.event_count++] = (sim_event_t){.at_ns = at_ns, .fn = fn, .arg = arg};
+    if (at_ns < sim.next_event_ns)
+    {
+        sim.next_event_ns = at_ns;
+    }
+    return true;
+}
+
+void sim_hal_set_uart_peer(uint index, sim_hal_uart_peer_fn_t peer, void *user_data)
+{
+    if (index < NUM_UARTS)
+    {
+        sim_uarts[index].peer = peer;
+        sim_uarts[index].peer_data = user_data;
+    }
+}
+
+bool sim_hal_uart_send(uint index, const uint8_t *data, size_t length, uint baud_rate, bool faults,
+                       sim_hal_wire_done_fn_t done, void *arg)
+{
+    if (index >= NUM_UARTS || data == NULL || length == 0 || length > SIM_HAL_WIRE_MAX || baud_rate == 0)
+    {
+        return false;
+    }
+
+    struct uart_inst *u = &sim_uarts[index];
+    if (u->wire_count >= SIM_WIRE_DEPTH)
+    {
+        sim.stats.wire_rejected++;
+        return false;
+    }
+
+    sim_wire_chunk_t *chunk = &u->wire[(u->wire_head + u->wire_count) % SIM_WIRE_DEPTH];
+    memcpy(chunk->data, data, length);
+    chunk->length = (uint16_t)length;
+    chunk->baud_rate = baud_rate;
+    chunk->faults = faults;
+    chunk->damaged = false;
+    chunk->done = done;
+    chunk->arg = arg;
+    u->wire_count++;
+
+    if (!u->wire_busy)
+    {
+        u->wire_busy = true;
+        u->wire_pos = 0;
+        u->fault_left = 0;
+        wire_start_byte(u);
+    }
+    return true;
+}
+
+bool sim_hal_uart_line_idle(uint index)
+{
+    return index >= NUM_UARTS || !sim_uarts[index].wire_busy;
+}
+
+void sim_hal_set_faults(const sim_hal_faults_t *faults)
+{
+    if (faults)
+    {
+        sim.faults = *faults;
+    }
+    else
+    {
+        memset(&sim.faults, 0, sizeof(sim.faults));
+    }
+}
+
+void sim_hal_set_gpio_hook(sim_hal_gpio_hook_t hook, void *user_data)
+{
+    sim.gpio_hook = hook;
+    sim.gpio_hook_data = user_data;
+}
+
+uint32_t sim_hal_rand(void)
+{
+    return (uint32_t)(sim_xorshift(&sim.scenario_rand_state) >> 32);
+}
+
+void sim_hal_get_stats(sim_hal_stats_t *stats)
+{
+    if (stats)
+    {
+        *stats = sim.stats;
+    }
+}
+
+// pico/time.h
+
+uint64_t time_us_64(void)
+{
+    sim_tick();
+    return sim.now_ns / 1000;
+}
+
+uint32_t time_us_32(void)
+{
+    return (uint32_t)time_us_64();
+}
+
+absolute_time_t get_absolute_time(void)
+{
+    return time_us_64();
+}
+
+absolute_time_t make_timeout_time_us(uint64_t us)
+{
+    return time_us_64() + us;
+}
+
+absolute_time_t make_timeout_time_ms(uint32_t ms)
+{
+    return time_us_64() + (uint64_t)ms * 1000;
+}
+
+bool time_reached(absolute_time_t t)
+{
+    return time_us_64() >= t;
+}
+
+void sleep_us(uint64_t us)
+{
+    sim_tick();
+    sim_advance_to(sim.now_ns + us * 1000, true);
+}
+
+void sleep_ms(uint32_t ms)
+{
+    sleep_us((uint64_t)ms * 1000);
+}
+
+void busy_wait_us(uint64_t us)
+{
+    sim_tick();
+    sim_advance_to(sim.now_ns + us * 1000, false);
+}
+
+void busy_wait_ms(uint32_t ms)
+{
+    busy_wait_us((uint64_t)ms * 1000);
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp)
+{
+    if (time_reached(timeout_timestamp))
+    {
+        return true;
+    }
+
+    sim_wait_for_event(timeout_timestamp * 1000);
+    return sim.now_ns / 1000 >= timeout_timestamp;
+}
+
+alarm_id_t add_alarm_at(absolute_time_t time, alarm_callback_t callback, void *user_data, bool fire_if_past)
+{
+    if (callback == NULL)
+    {
+        return PICO_ERROR_GENERIC;
+    }
+
+    if (time_us_64() >= time)
+    {
+        if (fire_if_past)
+        {
+            callback(0, user_data);
+        }
+        return 0;
+    }
+
+    for (uint i = 0; i < SIM_POOL_SIZE; i++)
+    {
+        sim_pool_alarm_t *alarm = &sim.pool[i];
+        if (alarm->id != 0)
+        {
+            continue;
+        }
+
+        *alarm = (sim_pool_alarm_t){.id = sim.pool_next_id++, .target_us = time, .callback = callback, .user_data = user_data};
+        if (sim.pool_next_id <= 0)
+        {
+            sim.pool_next_id = 1;
+        }
+        sim_schedule(time * 1000, pool_event, alarm);
+        return alarm->id;
+    }
+    return PICO_ERROR_GENERIC; // No slot
+}
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past)
+{
+    return add_alarm_at(make_timeout_time_us(us), callback, user_data, fire_if_past);
+}
+
+alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback, void *user_data, bool fire_if_past)
+{
+    return add_alarm_at(make_timeout_time_ms(ms), callback, user_data, fire_if_past);
+}
+
+bool cancel_alarm(alarm_id_t alarm_id)
+{
+    for (uint i = 0; i < SIM_POOL_SIZE; i++)
+    {
+        if (alarm_id > 0 && sim.pool[i].id == alarm_id)
+        {
+            sim.pool[i].id = 0;
+            sim.pool[i].pending = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+// pico/stdlib.h, pico/platform.h, pico/rand.h
+
+bool stdio_init_all(void)
+{
+    return true;
+}
+
+int getchar_timeout_us(uint32_t timeout_us)
+{
+    // Nobody types into the simulation
+    sleep_us(timeout_us);
+    return PICO_ERROR_TIMEOUT;
+}
+
+void tight_loop_contents(void)
+{
+    sim_tick();
+}
+
+uint32_t get_rand_32(void)
+{
+    sim_tick();
+    return (uint32_t)(sim_xorshift(&sim.rand_state) >> 32);
+}
+
+uint64_t get_rand_64(void)
+{
+    sim_tick();
+    return sim_xorshift(&sim.rand_state);
+}
+
+// pico/flash.h, hardware/flash.h
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms)
+{
+    uint32_t save = save_and_disable_interrupts();
+    func(param);
+    restore_interrupts(save);
+    return PICO_OK;
+}
+
+bool flash_safe_execute_core_init(void)
+{
+    return true;
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count)
+{
+    if (flash_offs % FLASH_SECTOR_SIZE != 0 || count % FLASH_SECTOR_SIZE != 0 || flash_offs + count > PICO_FLASH_SIZE_BYTES)
+    {
+        fprintf(stderr, "sim: bad flash erase 0x%x+%zu\n", (unsigned)flash_offs, count);
+        abort();
+    }
+
+    memset(&sim_flash[flash_offs], 0xFF, count);
+    sim_stall((count / FLASH_SECTOR_SIZE) * SIM_FLASH_ERASE_NS);
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count)
+{
+    if (flash_offs % FLASH_PAGE_SIZE != 0 || count % FLASH_PAGE_SIZE != 0 || flash_offs + count > PICO_FLASH_SIZE_BYTES)
+    {
+        fprintf(stderr, "sim: bad flash program 0x%x+%zu\n", (unsigned)flash_offs, count);
+        abort();
+    }
+
+    // Programming can only clear bits
+    for (size_t i = 0; i < count; i++)
+    {
+        sim_flash[flash_offs + i] &= data[i];
+    }
+    sim_stall((count / FLASH_PAGE_SIZE) * SIM_FLASH_PROGRAM_NS);
+}
+
+// hardware/gpio.h
+
+void gpio_init(uint gpio)
+{
+    gpio_set_dir(gpio, false);
+    gpio_put(gpio, false);
+    gpio_set_function(gpio, GPIO_FUNC_SIO);
+}
+
+void gpio_init_mask(uint gpio_mask)
+{
+    for (uint i = 0; i < NUM_BANK0_GPIOS; i++)
+    {
+        if (gpio_mask & (1u << i))
+        {
+            gpio_init(i);
+        }
+    }
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn)
+{
+    sim_tick();
+    if (gpio < NUM_BANK0_GPIOS)
+    {
+        sim.gpio_func[gpio] = fn;
+    }
+}
+
+enum gpio_function gpio_get_function(uint gpio)
+{
+    return (gpio < NUM_BANK0_GPIOS) ? sim.gpio_func[gpio] : GPIO_FUNC_NULL;
+}
+
+void gpio_set_dir(uint gpio, bool out)
+{
+    sim_tick();
+    if (out)
+    {
+        sim.gpio_oe |= 1u << gpio;
+    }
+    else
+    {
+        sim.gpio_oe &= ~(1u << gpio);
+    }
+}
+
+void gpio_set_dir_out_masked(uint32_t mask)
+{
+    sim_tick();
+    sim.gpio_oe |= mask;
+}
+
+void gpio_set_pulls(uint gpio, bool up, bool down)
+{
+    sim_tick();
+    if (up)
+    {
+        sim.gpio_pull_up |= 1u << gpio;
+    }
+    else
+    {
+        sim.gpio_pull_up &= ~(1u << gpio);
+    }
+}
+
+void gpio_pull_up(uint gpio)
+{
+    gpio_set_pulls(gpio, true, false);
+}
+
+void gpio_pull_down(uint gpio)
+{
+    gpio_set_pulls(gpio, false, true);
+}
+
+void gpio_disable_pulls(uint gpio)
+{
+    gpio_set_pulls(gpio, false, false);
+}
+
+void gpio_put(uint gpio, bool value)
+{
+    sim_gpio_write(1u << gpio, value ? (1u << gpio) : 0);
+}
+
+void gpio_put_masked(uint32_t mask, uint32_t value)
+{
+    sim_gpio_write(mask, value);
+}
+
+void gpio_put_all(uint32_t value)
+{
+    sim_gpio_write(UINT32_MAX, value);
+}
+
+void gpio_set_mask(uint32_t mask)
+{
+    sim_gpio_write(mask, mask);
+}
+
+void gpio_clr_mask(uint32_t mask)
+{
+    sim_gpio_write(mask, 0);
+}
+
+void gpio_xor_mask(uint32_t mask)
+{
+    sim_gpio_write(mask, ~sim.gpio_out);
+}
+
+bool gpio_get(uint gpio)
+{
+    sim_tick();
+
+    // Inputs read their pull; a UART RX line idles high
+    uint32_t bit = 1u << gpio;
+    uint32_t inputs = sim.gpio_pull_up | ((gpio < NUM_BANK0_GPIOS && sim.gpio_func[gpio] == GPIO_FUNC_UART) ? bit : 0);
+    return ((sim.gpio_oe & bit) ? sim.gpio_out : inputs) & bit;
+}
+
+uint32_t gpio_get_all(void)
+{
+    sim_tick();
+    return (sim.gpio_out & sim.gpio_oe) | (sim.gpio_pull_up & ~sim.gpio_oe);
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled)
+{
+    sim_tick();
+
+    // Only falling edges are modelled: the firmware uses nothing else
+    if ((event_mask & GPIO_IRQ_EDGE_FALL) == 0 || gpio >= NUM_BANK0_GPIOS)
+    {
+        return;
+    }
+    if (enabled)
+    {
+        sim.gpio_fall_enabled |= 1u << gpio;
+    }
+    else
+    {
+        sim.gpio_fall_enabled &= ~(1u << gpio);
+        sim.gpio_pending &= ~(1u << gpio);
+    }
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled, gpio_irq_callback_t callback)
+{
+    sim.gpio_callback = callback;
+    sim.irq_enabled[IO_IRQ_BANK0] = true;
+    gpio_set_irq_enabled(gpio, event_mask, enabled);
+}
+
+void gpio_acknowledge_irq(uint gpio, uint32_t event_mask)
+{
+    sim.gpio_pending &= ~(1u << gpio);
+}
+
+// hardware/uart.h
+
+uint uart_init(uart_inst_t *uart, uint baudrate)
+{
+    sim_tick();
+    uart->enabled = true;
+    uart->baud_rate = baudrate;
+    uart->rx_irq = false;
+    uart->tx_irq = false;
+    uart->rx_count = 0;
+    uart->rx_timeout = false;
+    return baudrate;
+}
+
+void uart_deinit(uart_inst_t *uart)
+{
+    sim_tick();
+    uart->enabled = false;
+    uart->rx_irq = false;
+    uart->tx_irq = false;
+}
+
+uint uart_set_baudrate(uart_inst_t *uart, uint baudrate)
+{
+    sim_tick();
+    uart->baud_rate = baudrate;
+    return baudrate;
+}
+
+void uart_set_format(uart_inst_t *uart, uint data_bits, uint stop_bits, uart_parity_t parity)
+{
+    // 8N1 is assumed throughout
+    sim_tick();
+}
+
+void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts)
+{
+    sim_tick();
+}
+
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled)
+{
+    sim_tick();
+}
+
+void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data, bool tx_needs_data)
+{
+    sim_tick();
+    uart->rx_irq = rx_has_data;
+    uart->tx_irq = tx_needs_data;
+    sim_dispatch();
+}
+
+bool uart_is_enabled(uart_inst_t *uart)
+{
+    sim_tick();
+    return uart->enabled;
+}
+
+uint uart_get_index(uart_inst_t *uart)
+{
+    return uart->index;
+}
+
+uart_hw_t *uart_get_hw(uart_inst_t *uart)
+{
+    uart_refresh_hw(uart);
+    return &uart->hw;
+}
+
+bool uart_is_writable(uart_inst_t *uart)
+{
+    sim_tick();
+    return uart->tx_count < SIM_UART_FIFO_DEPTH;
+}
+
+bool uart_is_readable(uart_inst_t *uart)
+{
+    sim_tick();
+    return uart->rx_count > 0;
+}
+
+bool uart_is_readable_within_us(uart_inst_t *uart, uint32_t us)
+{
+    absolute_time_t deadline = make_timeout_time_us(us);
+    while (!uart_is_readable(uart))
+    {
+        if (time_reached(deadline))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void uart_tx_wait_blocking(uart_inst_t *uart)
+{
+    sim_tick();
+    while (uart->tx_busy)
+    {
+        sim_tick();
+    }
+}
+
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        uart_putc_raw(uart, (char)src[i]);
+    }
+}
+
+void uart_read_blocking(uart_inst_t *uart, uint8_t *dst, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        dst[i] = (uint8_t)uart_getc(uart);
+    }
+}
+
+void uart_putc_raw(uart_inst_t *uart, char c)
+{
+    while (!uart_is_writable(uart))
+    {
+        // The SDK spins on the FIFO-full flag
+    }
+    if (!uart->enabled)
+    {
+        return;
+    }
+
+    uart->tx_fifo[(uart->tx_head + uart->tx_count) % SIM_UART_FIFO_DEPTH] = (uint8_t)c;
+    uart->tx_count++;
+    if (!uart->tx_busy)
+    {
+        uart->tx_busy = true;
+        sim_schedule(sim.now_ns + 10 * uart_bit_ns(uart->baud_rate), uart_tx_event, uart);
+    }
+}
+
+void uart_putc(uart_inst_t *uart, char c)
+{
+    // The SDK translates no CR/LF by default
+    uart_putc_raw(uart, c);
+}
+
+void uart_puts(uart_inst_t *uart, const char *s)
+{
+    while (*s)
+    {
+        uart_putc(uart, *s++);
+    }
+}
+
+char uart_getc(uart_inst_t *uart)
+{
+    while (!uart_is_readable(uart))
+    {
+        // The SDK spins on the FIFO-empty flag
+    }
+
+    char c = (char)uart->rx_fifo[uart->rx_head];
+    uart->rx_head = (uart->rx_head + 1) % SIM_UART_FIFO_DEPTH;
+    uart->rx_count--;
+    if (uart->rx_count == 0)
+    {
+        uart->rx_timeout = false;
+    }
+    return c;
+}
+
+// hardware/irq.h
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler)
+{
+    if (num < NUM_IRQS)
+    {
+        sim.handlers[num] = handler;
+    }
+}
+
+void irq_set_enabled(uint num, bool enabled)
+{
+    sim_tick();
+    if (num < NUM_IRQS)
+    {
+        sim.irq_enabled[num] = enabled;
+    }
+}
+
+bool irq_is_enabled(uint num)
+{
+    return num < NUM_IRQS && sim.irq_enabled[num];
+}
+
+void irq_set_priority(uint num, uint8_t hardware_priority)
+{
+    // Handlers never nest in the simulation, so priorities only order pending lines
+}
+
+// hardware/sync.h
+
+void __sev(void)
+{
+    sim.event_flag = true;
+}
+
+void __wfe(void)
+{
+    if (sim.event_flag)
+    {
+        sim.event_flag = false;
+        return;
+    }
+    sim_wait_for_event(UINT64_MAX);
+}
+
+void __wfi(void)
+{
+    sim.event_flag = false; // Only an interrupt ends WFI
+    __wfe();
+}
+
+uint32_t save_and_disable_interrupts(void)
+{
+    uint32_t status = sim.irq_masked ? 1u : 0u;
+    sim.irq_masked = true;
+    return status;
+}
+
+void restore_interrupts(uint32_t status)
+{
+    sim.irq_masked = (status != 0);
+    sim_dispatch();
+}
+
+spin_lock_t *spin_lock_instance(uint lock_num)
+{
+    return &sim.locks[lock_num % SIM_SPIN_LOCK_COUNT];
+}
+
+int spin_lock_claim_unused(bool required)
+{
+    if (sim.lock_next >= SIM_SPIN_LOCK_COUNT)
+    {
+        if (required)
+        {
+            fprintf(stderr, "sim: no spin locks left\n");
+            abort();
+        }
+        return PICO_ERROR_GENERIC;
+    }
+    return (int)sim.lock_next++;
+}
+
+uint32_t spin_lock_blocking(spin_lock_t *lock)
+{
+    // One core: holding off interrupts is all the lock has to do
+    uint32_t save = save_and_disable_interrupts();
+    *lock = 1;
+    return save;
+}
+
+void spin_unlock(spin_lock_t *lock, uint32_t saved_irq)
+{
+    *lock = 0;
+    restore_interrupts(saved_irq);
+}
+
+// hardware/timer.h
+
+int hardware_alarm_claim_unused(bool required)
+{
+    for (uint i = 0; i < NUM_TIMERS; i++)
+    {
+        if (!sim.alarms[i].claimed)
+        {
+            sim.alarms[i].claimed = true;
+            return (int)i;
+        }
+    }
+
+    if (required)
+    {
+        fprintf(stderr, "sim: no hardware alarms left\n");
+        abort();
+    }
+    return PICO_ERROR_GENERIC;
+}
+
+void hardware_alarm_unclaim(uint alarm_num)
+{
+    if (alarm_num < NUM_TIMERS && alarm_num != SIM_POOL_ALARM)
+    {
+        hardware_alarm_cancel(alarm_num);
+        sim.alarms[alarm_num].claimed = false;
+    }
+}
+
+void hardware_alarm_set_callback(uint alarm_num, hardware_alarm_callback_t callback)
+{
+    if (alarm_num >= NUM_TIMERS)
+    {
+        return;
+    }
+    if (callback == NULL)
+    {
+        hardware_alarm_cancel(alarm_num);
+    }
+    sim.alarms[alarm_num].callback = callback;
+}
+
+bool hardware_alarm_set_target(uint alarm_num, absolute_time_t t)
+{
+    sim_alarm_t *alarm = &sim.alarms[alarm_num % NUM_TIMERS];
+    if (time_us_64() >= t)
+    {
+        alarm->armed = false;
+        return true; // Missed; the SDK does not fire it
+    }
+
+    alarm->armed = true;
+    alarm->target_us = t;
+    sim_schedule(t * 1000, alarm_event, alarm);
+    return false;
+}
+
+void hardware_alarm_cancel(uint alarm_num)
+{
+    if (alarm_num < NUM_TIMERS)
+    {
+        sim.alarms[alarm_num].armed = false;
+        sim.alarms[alarm_num].pending = false;
+    }
+}
+
+void hardware_alarm_force_irq(uint alarm_num)
+{
+    if (alarm_num < NUM_TIMERS)
+    {
+        sim.alarms[alarm_num].armed = false;
+        sim.alarms[alarm_num].pending = true;
+        sim_tick();
+    }
+}
+
+// hardware/pwm.h
+
+void pwm_set_wrap(uint slice_num, uint16_t wrap)
+{
+    sim_tick();
+}
+
+void pwm_set_gpio_level(uint gpio, uint16_t level)
+{
+    sim_tick();
+}
+
+void pwm_set_enabled(uint slice_num, bool enabled)
+{
+    sim_tick();
+}
+
+// Internal helper functions
+
+static void sim_schedule(uint64_t at_ns, sim_hal_event_fn_t fn, void *arg)
+{
+    // Losing a hardware event would silently stall the model
+    if (!sim_hal_schedule(at_ns, fn, arg))
+    {
+        fprintf(stderr, "sim: event queue full\n");
+        abort();
+    }
+}
+
+static void sim_tick(void)
+{
+    sim.now_ns += sim.call_ns;
+    if (sim.next_event_ns <= sim.now_ns)
+    {
+        sim_run_due();
+    }
+    sim_dispatch();
+}
+
+static void sim_run_due(void)
+{
+    while (sim.next_event_ns <= sim.now_ns)
+    {
+        uint first = 0;
+        for (uint i = 1; i < sim.event_count; i++)
+        {
+            if (sim.events[i].at_ns < sim.events[first].at_ns)
+            {
+                first = i;
+            }
+        }
+
+        sim_event_t event = sim.events[first];
+        sim.events[first] = sim.events[--sim.event_count];
+        sim_update_next_event();
+        event.fn(event.arg);
+    }
+}
+
+static void sim_update_next_event(void)
+{
+    sim.next_event_ns = UINT64_MAX;
+    for (uint i = 0; i < sim.event_count; i++)
+    {
+        if (sim.events[i].at_ns < sim.next_event_ns)
+        {
+            sim.next_event_ns = sim.events[i].at_ns;
+        }
+    }
+}
+
+static void sim_dispatch(void)
+{
+    if (sim.irq_masked || sim.in_isr)
+    {
+        return;
+    }
+
+    sim.in_isr = true;
+    while (sim_dispatch_one())
+    {
+        sim.stats.interrupts++;
+    }
+    sim.in_isr = false;
+}
+
+static bool sim_dispatch_one(void)
+{
+    for (uint i = 0; i < NUM_TIMERS; i++)
+    {
+        if (i == SIM_POOL_ALARM)
+        {
+            for (uint j = 0; j < SIM_POOL_SIZE; j++)
+            {
+                if (sim.pool[j].id != 0 && sim.pool[j].pending)
+                {
+                    pool_fire(&sim.pool[j]);
+                    return true;
+                }
+            }
+        }
+        else if (sim.alarms[i].pending)
+        {
+            sim.alarms[i].pending = false;
+            if (sim.alarms[i].callback)
+            {
+                sim.alarms[i].callback(i);
+            }
+            return true;
+        }
+    }
+
+    uint32_t edges = sim.gpio_pending & sim.gpio_fall_enabled;
+    if (edges != 0 && sim.gpio_callback != NULL && sim.irq_enabled[IO_IRQ_BANK0])
+    {
+        uint gpio = (uint)__builtin_ctz(edges);
+        sim.gpio_pending &= ~(1u << gpio);
+        sim.gpio_callback(gpio, GPIO_IRQ_EDGE_FALL);
+        return true;
+    }
+
+    for (uint i = 0; i < NUM_UARTS; i++)
+    {
+        uint irq = UART0_IRQ + i;
+        if (sim.irq_enabled[irq] && sim.handlers[irq] != NULL && uart_irq_level(&sim_uarts[i]))
+        {
+            uart_refresh_hw(&sim_uarts[i]);
+            sim.handlers[irq]();
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool sim_irq_pending(void)
+{
+    for (uint i = 0; i < NUM_TIMERS; i++)
+    {
+        if (sim.alarms[i].pending)
+        {
+            return true;
+        }
+    }
+    for (uint j = 0; j < SIM_POOL_SIZE; j++)
+    {
+        if (sim.pool[j].id != 0 && sim.pool[j].pending)
+        {
+            return true;
+        }
+    }
+    if ((sim.gpio_pending & sim.gpio_fall_enabled) != 0 && sim.irq_enabled[IO_IRQ_BANK0])
+    {
+        return true;
+    }
+    for (uint i = 0; i < NUM_UARTS; i++)
+    {
+        if (sim.irq_enabled[UART0_IRQ + i] && uart_irq_level(&sim_uarts[i]))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void sim_advance_to(uint64_t target_ns, bool sleeping)
+{
+    uint64_t start_ns = sim.now_ns;
+    while (sim.next_event_ns <= target_ns)
+    {
+        if (sim.next_event_ns > sim.now_ns)
+        {
+            sim.now_ns = sim.next_event_ns;
+        }
+        sim_run_due();
+        sim_dispatch();
+    }
+    if (target_ns > sim.now_ns)
+    {
+        sim.now_ns = target_ns;
+    }
+    sim_dispatch();
+
+    if (sleeping)
+    {
+        sim.stats.sleep_ns += sim.now_ns - start_ns;
+    }
+}
+
+static void sim_wait_for_event(uint64_t until_ns)
+{
+    uint64_t start_ns = sim.now_ns;
+    uint64_t taken = sim.stats.interrupts;
+
+    // An interrupt wakes the core even while masked; it is then taken once unmasked
+    while (!sim.event_flag && sim.stats.interrupts == taken && !sim_irq_pending() && sim.now_ns < until_ns)
+    {
+        uint64_t next_ns = MIN(sim.next_event_ns, until_ns);
+        if (next_ns == UINT64_MAX)
+        {
+            sim.now_ns += SIM_IDLE_WAKE_NS; // Nothing will ever happen: a spurious wake
+            break;
+        }
+        if (next_ns > sim.now_ns)
+        {
+            sim.now_ns = next_ns;
+        }
+        sim_run_due();
+        sim_dispatch();
+    }
+
+    sim.event_flag = false;
+    sim.stats.sleep_ns += sim.now_ns - start_ns;
+}
+
+static void sim_stall(uint64_t duration_ns)
+{
+    // Flash is unreadable meanwhile, so nothing else runs
+    uint32_t save = save_and_disable_interrupts();
+    sim_advance_to(sim.now_ns + duration_ns, false);
+    restore_interrupts(save);
+}
+
+static uint64_t sim_xorshift(uint64_t *state)
+{
+    // xorshift64*
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+static double sim_uniform(void)
+{
+    return (double)(sim_hal_rand() >> 8) / (double)(1u << 24);
+}
+
+static void sim_gpio_write(uint32_t mask, uint32_t values)
+{
+    sim_tick();
+
+    uint32_t old = sim.gpio_out;
+    sim.gpio_out = (old & ~mask) | (values & mask);
+    uint32_t changed = old ^ sim.gpio_out;
+
+    sim.stats.gpio_writes++;
+    sim.stats.gpio_transitions += (uint64_t)__builtin_popcount(changed);
+    if (sim.gpio_hook)
+    {
+        sim.gpio_hook(changed, sim.gpio_out, sim.gpio_hook_data);
+    }
+}
+
+static uint64_t uart_bit_ns(uint baud_rate)
+{
+    return 1000000000ull / (baud_rate ? baud_rate : 1);
+}
+
+static bool uart_irq_level(const struct uart_inst *u)
+{
+    return (u->rx_irq && (u->rx_count >= SIM_UART_FIFO_LEVEL || u->rx_timeout)) ||
+           (u->tx_irq && u->tx_count <= SIM_UART_FIFO_LEVEL);
+}
+
+static void uart_refresh_hw(struct uart_inst *u)
+{
+    uint32_t ris = 0;
+    if (u->rx_count >= SIM_UART_FIFO_LEVEL)
+    {
+        ris |= UART_UARTMIS_RXMIS_BITS;
+    }
+    if (u->rx_timeout)
+    {
+        ris |= UART_UARTMIS_RTMIS_BITS;
+    }
+    if (u->tx_count <= SIM_UART_FIFO_LEVEL)
+    {
+        ris |= UART_UARTMIS_TXMIS_BITS;
+    }
+
+    uint32_t imsc = (u->rx_irq ? (UART_UARTMIS_RXMIS_BITS | UART_UARTMIS_RTMIS_BITS) : 0) |
+                    (u->tx_irq ? UART_UARTMIS_TXMIS_BITS : 0);
+    u->hw.ris = ris;
+    u->hw.imsc = imsc;
+    u->hw.mis = ris & imsc;
+
+    // UARTFR: BUSY, RXFE, TXFF, RXFF, TXFE
+    u->hw.fr = (u->tx_busy ? 0x08u : 0) | (u->rx_count == 0 ? 0x10u : 0) |
+               (u->tx_count == SIM_UART_FIFO_DEPTH ? 0x20u : 0) |
+               (u->rx_count == SIM_UART_FIFO_DEPTH ? 0x40u : 0) | (u->tx_count == 0 ? 0x80u : 0);
+}
+
+static void uart_tx_event(void *arg)
+{
+    struct uart_inst *u = arg;
+    if (u->tx_count == 0)
+    {
+        u->tx_busy = false;
+        return;
+    }
+
+    uint8_t byte = u->tx_fifo[u->tx_head];
+    u->tx_head = (u->tx_head + 1) % SIM_UART_FIFO_DEPTH;
+    u->tx_count--;
+    if (u->tx_count > 0)
+    {
+        sim_schedule(sim.now_ns + 10 * uart_bit_ns(u->baud_rate), uart_tx_event, u);
+    }
+    else
+    {
+        u->tx_busy = false;
+    }
+
+    if (u->peer)
+    {
+        u->peer(byte, u->baud_rate, u->peer_data);
+    }
+}
+
+static bool uart_rx_land(struct uart_inst *u, uint8_t byte)
+{
+    if (!u->enabled)
+    {
+        return true; // Nobody listening
+    }
+    if (u->rx_count >= SIM_UART_FIFO_DEPTH)
+    {
+        sim.stats.uart_overruns++;
+        return false;
+    }
+
+    u->rx_fifo[(u->rx_head + u->rx_count) % SIM_UART_FIFO_DEPTH] = byte;
+    u->rx_count++;
+    u->rx_timeout = false;
+    u->rx_last_ns = sim.now_ns;
+    sim_schedule(sim.now_ns + SIM_UART_TIMEOUT_BITS * uart_bit_ns(u->baud_rate), uart_rx_timeout_event, u);
+    return true;
+}
+
+static void uart_rx_timeout_event(void *arg)
+{
+    struct uart_inst *u = arg;
+    if (u->rx_count > 0 && sim.now_ns - u->rx_last_ns >= SIM_UART_TIMEOUT_BITS * uart_bit_ns(u->baud_rate))
+    {
+        u->rx_timeout = true;
+    }
+}
+
+static void wire_start_byte(struct uart_inst *u)
+{
+    // The start bit is a falling edge on every pin muxed as this UART's RX
+    for (uint gpio = 1; gpio < NUM_BANK0_GPIOS; gpio += 4)
+    {
+        if (sim.gpio_func[gpio] == GPIO_FUNC_UART && ((gpio + 4) / 8) % 2 == u->index)
+        {
+            sim.gpio_pending |= (1u << gpio) & sim.gpio_fall_enabled;
+        }
+    }
+
+    const sim_wire_chunk_t *chunk = &u->wire[u->wire_head];
+    sim_schedule(sim.now_ns + 10 * uart_bit_ns(chunk->baud_rate), wire_byte_event, u);
+}
+
+static void wire_byte_event(void *arg)
+{
+    struct uart_inst *u = arg;
+    sim_wire_chunk_t *chunk = &u->wire[u->wire_head];
+    uint8_t byte = chunk->data[u->wire_pos++];
+    bool lost = false;
+
+    if (chunk->faults && u->fault_left == 0)
+    {
+        double r = sim_uniform();
+        if (r < sim.faults.flip_rate || r < sim.faults.flip_rate + sim.faults.drop_rate)
+        {
+            u->fault_left = MAX(sim.faults.burst, 1u);
+            u->fault_drop = (r >= sim.faults.flip_rate);
+        }
+    }
+    if (u->fault_left > 0)
+    {
+        u->fault_left--;
+        chunk->damaged = true;
+        if (u->fault_drop)
+        {
+            sim.stats.wire_drops++;
+            lost = true;
+        }
+        else
+        {
+            sim.stats.wire_flips++;
+            byte ^= (uint8_t)(1u << (sim_hal_rand() % 8));
+        }
+    }
+
+    // A byte framed at the wrong rate comes out as some non-ASCII value
+    if (u->enabled && chunk->baud_rate != u->baud_rate)
+    {
+        sim.stats.wire_garbled++;
+        chunk->damaged = true;
+        byte = (uint8_t)(0x80u | ((byte ^ 0x5Au) * 7u));
+    }
+
+    if (!lost && !uart_rx_land(u, byte))
+    {
+        chunk->damaged = true;
+    }
+
+    if (u->wire_pos < chunk->length)
+    {
+        wire_start_byte(u);
+        return;
+    }
+
+    // Chunk finished: start the next one before telling the sender
+    sim_hal_wire_done_fn_t done = chunk->done;
+    void *done_arg = chunk->arg;
+    bool damaged = chunk->damaged;
+    u->wire_head = (u->wire_head + 1) % SIM_WIRE_DEPTH;
+    u->wire_count--;
+    u->wire_pos = 0;
+    u->fault_left = 0;
+    if (u->wire_count > 0)
+    {
+        wire_start_byte(u);
+    }
+    else
+    {
+        u->wire_busy = false;
+    }
+
+    if (done)
+    {
+        done(damaged, done_arg);
+    }
+}
+
+static void alarm_event(void *arg)
+{
+    sim_alarm_t *alarm = arg;
+
+    // Stale once the alarm was cancelled or moved later
+    if (alarm->armed && alarm->target_us * 1000 <= sim.now_ns)
+    {
+        alarm->armed = false;
+        alarm->pending = true;
+    }
+}
+
+static void pool_event(void *arg)
+{
+    sim_pool_alarm_t *alarm = arg;
+    if (alarm->id != 0 && alarm->target_us * 1000 <= sim.now_ns)
+    {
+        alarm->pending = true;
+    }
+}
+
+static void pool_fire(sim_pool_alarm_t *alarm)
+{
+    alarm->pending = false;
+    alarm_id_t id = alarm->id;
+    int64_t next_us = alarm->callback(id, alarm->user_data);
+
+    // The callback may have cancelled itself
+    if (alarm->id != id)
+    {
+        return;
+    }
+    if (next_us == 0)
+    {
+        alarm->id = 0;
+        return;
+    }
+
+    // SDK rule: > 0 counts from the previous target, < 0 from now
+    alarm->target_us = (next_us > 0) ? alarm->target_us + (uint64_t)next_us : sim.now_ns / 1000 + (uint64_t)(-next_us);
+    sim_schedule(alarm->target_us * 1000, pool_event, alarm);
+}
@@ -0,0 +1,200 @@
+/**
+ * @file sim_hal.h
+ * @brief Simulated RP2040 hardware behind the host stand-ins of the Pico SDK
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This header file provides the scenario side of the host simulation. The
+ * firmware sources are compiled unchanged against the stand-in SDK headers
+ * in sim/include; their functions are implemented here on a virtual clock.
+ *
+ * Time model:
+ * - Every simulated SDK call (time reads, UART, GPIO, busy-wait bodies)
+ *   advances the clock by a fixed cost, SIM_HAL_DEFAULT_CALL_NS by default
+ * - WFE and the SDK sleeps jump straight to the next hardware event
+ * - Interrupt handlers run between calls while interrupts are enabled and
+ *   never inside another handler
+ *
+ * Hardware modelled:
+ * - UARTs with 32-byte FIFOs that fill and drain at the configured baud rate,
+ *   the PL011 1/8 FIFO interrupt levels and the 32-bit receive timeout; a byte
+ *   that finds the receive FIFO full is lost and counted
+ * - A falling edge on the RX pin at every start bit, for wake-on-RX
+ * - Four hardware alarms and a small alarm pool on alarm 3
+ * - GPIO outputs, counted and reported to a hook
+ * - Flash as a RAM array with realistic erase and program stalls
+ *
+ * The scenario schedules its own events on the same clock, feeds bytes into
+ * a UART receive line and receives whatever the firmware transmits.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef SIM_HAL_H
+#define SIM_HAL_H
+
+#include "pico/stdlib.h"
+
+/**
+ * @brief Default cost of one simulated SDK call
+ */
+#define SIM_HAL_DEFAULT_CALL_NS 1000u
+
+/**
+ * @brief Largest chunk accepted by sim_hal_uart_send()
+ */
+#define SIM_HAL_WIRE_MAX 320
+
+/**
+ * @brief Scenario event callback
+ *
+ * Runs in hardware context: it may change simulated hardware and schedule
+ * events, but must not call the simulated SDK functions.
+ *
+ * @param arg User-defined argument
+ */
+typedef void (*sim_hal_event_fn_t)(void *arg);
+
+/**
+ * @brief Receives every byte a UART transmits, when its stop bit ends
+ *
+ * @param byte Transmitted byte
+ * @param baud_rate UART rate it was sent at
+ * @param user_data User-defined data pointer
+ */
+typedef void (*sim_hal_uart_peer_fn_t)(uint8_t byte, uint baud_rate, void *user_data);
+
+/**
+ * @brief Called when the last byte of a chunk has reached the receive FIFO (or was lost)
+ *
+ * @param damaged true if a line fault or a FIFO overrun hit the chunk
+ * @param arg User-defined argument
+ */
+typedef void (*sim_hal_wire_done_fn_t)(bool damaged, void *arg);
+
+/**
+ * @brief Called after every GPIO output write
+ *
+ * @param changed Output bits the write changed
+ * @param values Output levels after the write
+ * @param user_data User-defined data pointer
+ */
+typedef void (*sim_hal_gpio_hook_t)(uint32_t changed, uint32_t values, void *user_data);
+
+/**
+ * @brief Line faults applied to chunks sent with faults enabled
+ */
+typedef struct
+{
+    double flip_rate; ///< Probability that a byte starts a burst of single-bit flips
+    double drop_rate; ///< Probability that a byte starts a burst of lost bytes
+    uint burst;       ///< Bytes hit by one fault (0 or 1 = the byte alone)
+} sim_hal_faults_t;
+
+/**
+ * @brief Counters since sim_hal_init()
+ */
+typedef struct
+{
+    uint64_t gpio_writes;      ///< GPIO output write calls
+    uint64_t gpio_transitions; ///< Output bits that changed level
+    uint32_t uart_overruns;    ///< Received bytes lost to a full FIFO
+    uint32_t wire_flips;       ///< Bytes damaged by an injected bit flip
+    uint32_t wire_drops;       ///< Bytes removed by an injected drop
+    uint32_t wire_garbled;     ///< Bytes received at the wrong baud rate
+    uint32_t wire_rejected;    ///< Chunks refused because the line queue was full
+    uint64_t sleep_ns;         ///< Time spent in WFE or the SDK sleeps
+    uint64_t interrupts;       ///< Interrupt handler calls
+} sim_hal_stats_t;
+
+/**
+ * @brief Reset the simulated hardware and the clock
+ *
+ * @param seed Seed for get_rand_32() and the line faults
+ * @param call_ns Cost of one simulated SDK call (0 = SIM_HAL_DEFAULT_CALL_NS)
+ */
+void sim_hal_init(uint64_t seed, uint32_t call_ns);
+
+/**
+ * @brief Current simulated time
+ *
+ * @return uint64_t Nanoseconds since sim_hal_init()
+ */
+uint64_t sim_hal_now_ns(void);
+
+/**
+ * @brief Run a callback when the clock reaches a time
+ *
+ * @param at_ns Simulated time (in the past = at the next call)
+ * @param fn Callback
+ * @param arg Passed to the callback
+ * @return true if scheduled, false if the event queue is full
+ */
+bool sim_hal_schedule(uint64_t at_ns, sim_hal_event_fn_t fn, void *arg);
+
+/**
+ * @brief Connect the device on the other end of a UART's TX line
+ *
+ * @param index UART number
+ * @param peer Called for every transmitted byte (NULL = disconnect)
+ * @param user_data Passed to peer
+ */
+void sim_hal_set_uart_peer(uint index, sim_hal_uart_peer_fn_t peer, void *user_data);
+
+/**
+ * @brief Queue bytes on a UART's RX line
+ *
+ * Chunks go out back to back in order. Bytes sent at a rate the UART is not
+ * set to arrive garbled.
+ *
+ * @param index UART number
+ * @param data Bytes to send (copied)
+ * @param length Number of bytes (at most SIM_HAL_WIRE_MAX)
+ * @param baud_rate Sender's rate
+ * @param faults true to apply the sim_hal_set_faults() line faults to this chunk
+ * @param done Called after the last byte (NULL = none)
+ * @param arg Passed to done
+ * @return true if queued, false if the line queue is full
+ */
+bool sim_hal_uart_send(uint index, const uint8_t *data, size_t length, uint baud_rate, bool faults,
+                       sim_hal_wire_done_fn_t done, void *arg);
+
+/**
+ * @brief Check whether a UART's RX line is idle
+ *
+ * @param index UART number
+ * @return true if no chunk is queued or being sent, false otherwise
+ */
+bool sim_hal_uart_line_idle(uint index);
+
+/**
+ * @brief Set the line faults for chunks sent with faults enabled
+ *
+ * @param faults Fault rates (NULL = none)
+ */
+void sim_hal_set_faults(const sim_hal_faults_t *faults);
+
+/**
+ * @brief Watch GPIO output writes
+ *
+ * @param hook Called after every write (NULL = none)
+ * @param user_data Passed to hook
+ */
+void sim_hal_set_gpio_hook(sim_hal_gpio_hook_t hook, void *user_data);
+
+/**
+ * @brief Random number for the scenario, independent of the firmware's get_rand_32()
+ *
+ * @return uint32_t Next value of the scenario generator
+ */
+uint32_t sim_hal_rand(void);
+
+/**
+ * @brief Copy the counters
+ *
+ * @param stats Pointer to store the counters
+ */
+void sim_hal_get_stats(sim_hal_stats_t *stats);
+
+#endif /* SIM_HAL_H */
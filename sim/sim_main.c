@@ -0,0 +1,738 @@
+/**
+ * @file sim_main.c
+ * @brief Host simulation of the receiver firmware under LoRa traffic
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This file boots the unchanged receiver firmware against the simulated
+ * RP2040 and RYLR998, waits for its READY broadcast, then injects +RCV
+ * traffic at a fixed rate and reports what got through. Every run is forked
+ * so the firmware, which never returns from run(), can be restarted for the
+ * next rate of a sweep.
+ *
+ * Traffic mixes (all from address 200):
+ * - quiet: PROTO_OP_GROUP frames for a group this node has not joined, which
+ *   the firmware parses and drops without a reply
+ * - acked: PROTO_OP_SPEED frames, each acknowledged over the air
+ * - ascii: SPEED=<ms> text commands, each acknowledged over the air
+ *
+ * Every Nth message is a probe instead: a PROTO_OP_MOVE for motor 1, sent
+ * once motor 1 has stood still for a while. Its latency runs from the last
+ * byte of the +RCV line reaching the UART FIFO to the first coil change on
+ * motor 1.
+ *
+ * With --check no traffic is injected. The run sends one BATCH of STOP then
+ * START, the frame the remote builds when OFF and ON are pressed together,
+ * and passes if motor 1 is still rotating well after one queued ramp. A lone
+ * STOP then has to bring it to rest.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "sim_hal.h"
+#include "sim_radio.h"
+#include "run.h"
+#include "log.h"
+#include "trace.h"
+
+// Profile name for the report, normally provided by CMake
+#ifndef SIM_PROFILE_NAME
+#define SIM_PROFILE_NAME "BALANCED"
+#endif
+
+// Wiring and addressing, as in run.c
+#define SIM_LORA_UART 1
+#define SIM_SENDER 200
+#define SIM_RSSI -48
+#define SIM_SNR 10
+
+// Motor 1 coils: GPIO 2, 3, 6, 7
+#define SIM_PROBE_COIL_MASK ((1u << 2) | (1u << 3) | (1u << 6) | (1u << 7))
+#define SIM_PROBE_MOTOR_MASK 0x01
+#define SIM_PROBE_STEPS 16
+#define SIM_PROBE_SPEED_MS 1
+#define SIM_PROBE_IDLE_NS 20000000ull    // Motor 1 still for this long before the next probe
+#define SIM_PROBE_TIMEOUT_NS 1000000000ull // A probe without a step by then is lost
+#define SIM_MAX_PROBES 4096
+
+// Quiet traffic targets a group the receiver never joins
+#define SIM_QUIET_GROUP 3
+#define SIM_TRAFFIC_SPEED_MS 1
+
+// Timeline
+#define SIM_READY_DELAY_NS 200000000ull  // READY broadcast to the first message
+#define SIM_BOOT_TIMEOUT_NS 30000000000ull
+#define SIM_DRAIN_NS 1500000000ull // Last message to the report
+
+// Stop/start check: rotation must outlast one queued ramp (256 steps)
+#define SIM_CHECK_WAIT_NS 3000000000ull // Batch to the verdict
+#define SIM_CHECK_STILL_NS 100000000ull // Motor 1 still for this long = rotation stopped
+#define SIM_CHECK_STOP_NS 1000000000ull // Lone STOP to its verdict
+
+typedef enum
+{
+    SIM_MIX_QUIET,
+    SIM_MIX_ACKED,
+    SIM_MIX_ASCII
+} sim_mix_t;
+
+typedef struct
+{
+    double rate;
+    uint count;
+    sim_mix_t mix;
+    uint probe_every;
+    uint baud_rate;
+    sim_hal_faults_t faults;
+    uint64_t seed;
+    uint32_t cost_ns;
+    bool sweep;
+    double max_rate;
+    bool check;
+    bool verbose;
+} sim_options_t;
+
+typedef struct
+{
+    bool valid;
+    double rate;
+    uint32_t injected;
+    uint32_t sent;
+    uint32_t air_lost;
+    uint32_t delivered;
+    uint32_t malformed;
+    uint32_t damaged;
+    uint32_t uart_overruns;
+    uint32_t ring_overflows;
+    uint32_t inbound_dropped;
+    uint32_t at_timeouts;
+    uint32_t replies;
+    uint32_t probes;
+    uint32_t probes_lost;
+    double traffic_s;
+    double lat_min_us;
+    double lat_avg_us;
+    double lat_p99_us;
+    double lat_max_us;
+    uint64_t gpio_writes;
+    uint64_t gpio_transitions;
+    double sleep_pct;
+    double boot_ms;
+    double host_ns_per_msg;
+    bool check_passed;
+    double check_still_ms;
+    bool stop_passed;
+    double stop_still_ms;
+} sim_result_t;
+
+// State of the run in this process
+static struct
+{
+    sim_options_t options;
+    double rate;
+    sim_result_t *result;
+    uint64_t interval_ns;
+    uint8_t sequence;
+    bool booted;
+    uint64_t traffic_start_ns;
+    uint64_t last_inject_ns;
+    struct timespec host_start;
+    sim_hal_stats_t hal_start;
+
+    // Probe in flight
+    bool probe_due;
+    bool probe_pending;
+    bool probe_landed;
+    bool probe_reverse;
+    uint64_t probe_sent_ns;
+    uint64_t probe_landed_ns;
+    uint64_t motor_changed_ns;
+    uint32_t latencies_ns[SIM_MAX_PROBES];
+    uint32_t latency_count;
+} scenario;
+
+// Forward declarations
+static bool parse_options(int argc, char **argv, sim_options_t *options);
+static void print_usage(const char *program);
+static bool run_forked(const sim_options_t *options, double rate, sim_result_t *result);
+static void run_scenario(const sim_options_t *options, double rate, sim_result_t *result);
+static void on_radio_send(uint16_t destination, const char *payload, uint8_t length, void *user_data);
+static void on_gpio(uint32_t changed, uint32_t values, void *user_data);
+static void inject_event(void *arg);
+static void check_inject_event(void *arg);
+static void check_stop_event(void *arg);
+static void check_finish_event(void *arg);
+static bool check_send(const proto_batch_t *batch);
+static void check_inject_event(void *arg)
+{
+    // OFF then ON inside the remote's aggregation window: one batch, stop first
+    proto_batch_t batch = {.sequence = scenario.sequence++, .count = 2};
+    batch.commands[0] = (proto_frame_t){.opcode = PROTO_OP_STOP};
+    batch.commands[1] = (proto_frame_t){.opcode = PROTO_OP_START};
+
+    if (!check_send(&batch))
+    {
+        _exit(1);
+    }
+    sim_hal_schedule(sim_hal_now_ns() + SIM_CHECK_WAIT_NS, check_stop_event, NULL);
+}
+
+static void check_stop_event(void *arg)
+{
+    sim_result_t *result = scenario.result;
+    uint64_t still_ns = sim_hal_now_ns() - scenario.motor_changed_ns;
+    result->check_still_ms = still_ns / 1e6;
+    result->check_passed = scenario.motor_changed_ns > scenario.traffic_start_ns && still_ns < SIM_CHECK_STILL_NS;
+
+    // A STOP on its own still has to end rotation
+    proto_batch_t batch = {.sequence = scenario.sequence++, .count = 1};
+    batch.commands[0] = (proto_frame_t){.opcode = PROTO_OP_STOP};
+    if (!check_send(&batch))
+    {
+        _exit(1);
+    }
+    sim_hal_schedule(sim_hal_now_ns() + SIM_CHECK_STOP_NS, check_finish_event, NULL);
+}
+
+static void check_finish_event(void *arg)
+{
+    sim_result_t *result = scenario.result;
+    uint64_t still_ns = sim_hal_now_ns() - scenario.motor_changed_ns;
+    result->stop_still_ms = still_ns / 1e6;
+    result->stop_passed = still_ns >= SIM_CHECK_STILL_NS;
+    result->valid = true;
+
+    fflush(stdout);
+    _exit(0);
+}
+
+static bool check_send(const proto_batch_t *batch)
+{
+    char payload[PROTO_GROUP_ENCODED_MAX];
+    uint8_t length = proto_encode_batch(batch, payload, sizeof(payload));
+    return length > 0 && sim_radio_receive(SIM_SENDER, payload, length, SIM_RSSI, SIM_SNR, NULL, NULL);
+}
+
+static uint8_t build_traffic(char *payload, size_t size);
+static uint8_t build_probe(char *payload, size_t size);
+static void probe_landed(bool damaged, void *arg);
+static void probe_expire(void);
+static void boot_watchdog(void *arg);
+static void finish_event(void *arg);
+static void collect_latency(sim_result_t *result);
+static int compare_u32(const void *a, const void *b);
+static void print_meta(const sim_options_t *options);
+static void print_result(const sim_result_t *result);
+static const char *mix_name(sim_mix_t mix);
+
+int main(int argc, char **argv)
+{
+    sim_options_t options;
+    if (!parse_options(argc, argv, &options))
+    {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    // One result slot per run, shared with the forked children
+    uint max_runs = 1;
+    if (options.sweep)
+    {
+        for (double rate = options.rate; rate <= options.max_rate; rate *= 2)
+        {
+            max_runs++;
+        }
+    }
+    sim_result_t *results = mmap(NULL, max_runs * sizeof(sim_result_t), PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (results == MAP_FAILED)
+    {
+        perror("mmap");
+        return 1;
+    }
+
+    if (options.check)
+    {
+        if (!run_forked(&options, options.rate, &results[0]))
+        {
+            printf("SIM_FAIL,check=stop_start,reason=%s\n", results[0].boot_ms < 0 ? "no_ready" : "crashed");
+            return 1;
+        }
+        printf("SIM_CHECK,stop_start,%s,still_ms=%.1f\n", results[0].check_passed ? "PASS" : "FAIL",
+               results[0].check_still_ms);
+        printf("SIM_CHECK,stop,%s,still_ms=%.1f\n", results[0].stop_passed ? "PASS" : "FAIL",
+               results[0].stop_still_ms);
+        return (results[0].check_passed && results[0].stop_passed) ? 0 : 1;
+    }
+
+    print_meta(&options);
+    uint runs = 0;
+    int sustained = -1;
+    double rate = options.rate;
+    do
+    {
+        sim_result_t *result = &results[runs];
+        if (!run_forked(&options, rate, result))
+        {
+            printf("SIM_FAIL,rate=%.1f,reason=%s\n", rate, result->boot_ms < 0 ? "no_ready" : "crashed");
+            break;
+        }
+        print_result(result);
+        fflush(stdout);
+
+        double drop = result->sent ? 1.0 - (double)result->delivered / result->sent : 0.0;
+        if (drop < 0.01)
+        {
+            sustained = (int)runs;
+        }
+        runs++;
+        rate *= 2;
+    } while (options.sweep && rate <= options.max_rate && runs < max_runs);
+
+    if (options.sweep && sustained >= 0)
+    {
+        printf("SIM_SUSTAINED,rate=%.1f,delivered_per_s=%.1f\n", results[sustained].rate,
+               results[sustained].delivered / results[sustained].traffic_s);
+    }
+    printf("SIM_DONE,runs=%u\n", runs);
+    return 0;
+}
+
+// Internal helper functions
+
+static bool parse_options(int argc, char **argv, sim_options_t *options)
+{
+    *options = (sim_options_t){.rate = 20,
+                               .count = 500,
+                               .mix = SIM_MIX_QUIET,
+                               .probe_every = 10,
+                               .baud_rate = 115200,
+                               .seed = 1,
+                               .max_rate = 1280};
+
+    static const struct option long_options[] = {
+        {"rate", required_argument, NULL, 'r'},  {"count", required_argument, NULL, 'n'},
+        {"mix", required_argument, NULL, 'm'},   {"probe", required_argument, NULL, 'p'},
+        {"baud", required_argument, NULL, 'b'},  {"flip", required_argument, NULL, 'f'},
+        {"drop", required_argument, NULL, 'd'},  {"burst", required_argument, NULL, 'u'},
+        {"seed", required_argument, NULL, 's'},  {"cost-ns", required_argument, NULL, 'c'},
+        {"sweep", no_argument, NULL, 'w'},       {"max-rate", required_argument, NULL, 'x'},
+        {"check", no_argument, NULL, 'k'},       {"verbose", no_argument, NULL, 'v'},
+        {"help", no_argument, NULL, 'h'},        {NULL, 0, NULL, 0}};
+
+    int option;
+    while ((option = getopt_long(argc, argv, "", long_options, NULL)) != -1)
+    {
+        switch (option)
+        {
+        case 'r':
+            options->rate = strtod(optarg, NULL);
+            break;
+        case 'n':
+            options->count = (uint)strtoul(optarg, NULL, 10);
+            break;
+        case 'm':
+            if (strcmp(optarg, "quiet") == 0)
+            {
+                options->mix = SIM_MIX_QUIET;
+            }
+            else if (strcmp(optarg, "acked") == 0)
+            {
+                options->mix = SIM_MIX_ACKED;
+            }
+            else if (strcmp(optarg, "ascii") == 0)
+            {
+                options->mix = SIM_MIX_ASCII;
+            }
+            else
+            {
+                return false;
+            }
+            break;
+        case 'p':
+            options->probe_every = (uint)strtoul(optarg, NULL, 10);
+            break;
+        case 'b':
+            options->baud_rate = (uint)strtoul(optarg, NULL, 10);
+            break;
+        case 'f':
+            options->faults.flip_rate = strtod(optarg, NULL);
+            break;
+        case 'd':
+            options->faults.drop_rate = strtod(optarg, NULL);
+            break;
+        case 'u':
+            options->faults.burst = (uint)strtoul(optarg, NULL, 10);
+            break;
+        case 's':
+            options->seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'c':
+            options->cost_ns = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'w':
+            options->sweep = true;
+            break;
+        case 'x':
+            options->max_rate = strtod(optarg, NULL);
+            break;
+        case 'k':
+            options->check = true;
+            break;
+        case 'v':
+            options->verbose = true;
+            break;
+        default:
+            return false;
+        }
+    }
+
+    return optind == argc && options->rate > 0 && options->count > 0 && options->baud_rate > 0;
+}
+
+static void print_usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --rate N       messages per second (default 20; first rate of a sweep)\n"
+            "  --count N      messages per run (default 500)\n"
+            "  --mix M        quiet | acked | ascii (default quiet)\n"
+            "  --probe N      every Nth message is a motor 1 MOVE probe (0 = none, default 10)\n"
+            "  --baud N       module UART rate at power-up (default 115200)\n"
+            "  --flip P       probability a received byte starts a bit-flip burst\n"
+            "  --drop P       probability a received byte starts a lost-byte burst\n"
+            "  --burst N      bytes hit by one fault (default 1)\n"
+            "  --seed N       random seed (default 1)\n"
+            "  --cost-ns N    simulated cost of one SDK call (default %u)\n"
+            "  --sweep        double the rate after each run up to --max-rate (default 1280)\n"
+            "  --check        send one STOP+START batch instead of traffic; fail unless rotation continues\n"
+            "  --verbose      let the firmware's console output through\n",
+            program, SIM_HAL_DEFAULT_CALL_NS);
+}
+
+static bool run_forked(const sim_options_t *options, double rate, sim_result_t *result)
+{
+    memset(result, 0, sizeof(*result));
+    fflush(stdout);
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        return false;
+    }
+    if (pid == 0)
+    {
+        run_scenario(options, rate, result); // Never returns
+    }
+
+    int status;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        return false;
+    }
+    return result->valid;
+}
+
+static void run_scenario(const sim_options_t *options, double rate, sim_result_t *result)
+{
+    memset(&scenario, 0, sizeof(scenario));
+    scenario.options = *options;
+    scenario.rate = rate;
+    scenario.result = result;
+    scenario.interval_ns = (uint64_t)(1e9 / rate);
+
+    // The report goes out from the parent; the firmware's console is dropped
+    if (!options->verbose && freopen("/dev/null", "w", stdout) == NULL)
+    {
+        _exit(1);
+    }
+
+    sim_hal_init(options->seed, options->cost_ns);
+    sim_hal_set_faults(&options->faults);
+    sim_hal_set_gpio_hook(on_gpio, NULL);
+    sim_radio_init(SIM_LORA_UART, options->baud_rate);
+    sim_radio_set_send_hook(on_radio_send, NULL);
+    sim_hal_schedule(SIM_BOOT_TIMEOUT_NS, boot_watchdog, NULL);
+
+    // Same start-up as main.c
+    stdio_init_all();
+    log_init();
+    trace_init();
+    run();
+    _exit(1);
+}
+
+static void on_radio_send(uint16_t destination, const char *payload, uint8_t length, void *user_data)
+{
+    proto_frame_t frame;
+    if (scenario.booted || destination != LORA_BROADCAST_ADDRESS || !proto_decode(payload, length, &frame) ||
+        frame.opcode != PROTO_OP_READY)
+    {
+        return;
+    }
+
+    // READY: setup is over, traffic starts shortly
+    scenario.booted = true;
+    scenario.result->boot_ms = sim_hal_now_ns() / 1e6;
+    scenario.traffic_start_ns = sim_hal_now_ns() + SIM_READY_DELAY_NS;
+    sim_hal_schedule(scenario.traffic_start_ns, scenario.options.check ? check_inject_event : inject_event, NULL);
+}
+
+static void on_gpio(uint32_t changed, uint32_t values, void *user_data)
+{
+    if ((changed & SIM_PROBE_COIL_MASK) == 0)
+    {
+        return;
+    }
+
+    uint64_t now_ns = sim_hal_now_ns();
+    scenario.motor_changed_ns = now_ns;
+    if (scenario.probe_pending && scenario.probe_landed)
+    {
+        if (scenario.latency_count < SIM_MAX_PROBES)
+        {
+            scenario.latencies_ns[scenario.latency_count++] = (uint32_t)(now_ns - scenario.probe_landed_ns);
+        }
+        scenario.probe_pending = false;
+    }
+}
+
+static void inject_event(void *arg)
+{
+    sim_result_t *result = scenario.result;
+    uint64_t now_ns = sim_hal_now_ns();
+
+    if (result->injected == 0)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &scenario.host_start);
+        sim_hal_get_stats(&scenario.hal_start);
+    }
+    probe_expire();
+
+    // A probe stays due until one goes out; it needs motor 1 at rest and no other probe in flight
+    uint probe_every = scenario.options.probe_every;
+    if (probe_every > 0 && (result->injected % probe_every) == probe_every - 1)
+    {
+        scenario.probe_due = true;
+    }
+    bool probe = scenario.probe_due && !scenario.probe_pending && now_ns - scenario.motor_changed_ns > SIM_PROBE_IDLE_NS;
+
+    char payload[PROTO_GROUP_ENCODED_MAX];
+    uint8_t length = probe ? build_probe(payload, sizeof(payload)) : build_traffic(payload, sizeof(payload));
+    bool sent = sim_radio_receive(SIM_SENDER, payload, length, SIM_RSSI, SIM_SNR, probe ? probe_landed : NULL, NULL);
+
+    result->injected++;
+    if (sent)
+    {
+        result->sent++;
+        if (probe)
+        {
+            result->probes++;
+            scenario.probe_due = false;
+            scenario.probe_pending = true;
+            scenario.probe_landed = false;
+            scenario.probe_sent_ns = now_ns;
+        }
+    }
+    scenario.last_inject_ns = now_ns;
+
+    if (result->injected < scenario.options.count)
+    {
+        sim_hal_schedule(now_ns + scenario.interval_ns, inject_event, NULL);
+    }
+    else
+    {
+        sim_hal_schedule(now_ns + SIM_DRAIN_NS, finish_event, NULL);
+    }
+}
+
+static uint8_t build_traffic(char *payload, size_t size)
+{
+    switch (scenario.options.mix)
+    {
+    case SIM_MIX_ACKED:
+    {
+        proto_frame_t frame = {.opcode = PROTO_OP_SPEED,
+                               .sequence = scenario.sequence++,
+                               .motor_mask = PROTO_MOTOR_ALL,
+                               .speed_ms = SIM_TRAFFIC_SPEED_MS};
+        return proto_encode(&frame, payload, size);
+    }
+    case SIM_MIX_ASCII:
+        return (uint8_t)snprintf(payload, size, "SPEED=%d", SIM_TRAFFIC_SPEED_MS);
+    case SIM_MIX_QUIET:
+    default:
+    {
+        proto_batch_t batch = {.sequence = scenario.sequence++, .group = SIM_QUIET_GROUP, .count = 1};
+        batch.commands[0] = (proto_frame_t){.opcode = PROTO_OP_SPEED,
+                                            .motor_mask = PROTO_MOTOR_ALL,
+                                            .speed_ms = SIM_TRAFFIC_SPEED_MS};
+        return proto_encode_group(&batch, payload, size);
+    }
+    }
+}
+
+static uint8_t build_probe(char *payload, size_t size)
+{
+    // Alternate directions so motor 1 stays near home
+    proto_frame_t frame = {.opcode = PROTO_OP_MOVE,
+                           .sequence = scenario.sequence++,
+                           .motor_mask = SIM_PROBE_MOTOR_MASK,
+                           .reverse = scenario.probe_reverse,
+                           .steps = SIM_PROBE_STEPS,
+                           .speed_ms = SIM_PROBE_SPEED_MS};
+    scenario.probe_reverse = !scenario.probe_reverse;
+    return proto_encode(&frame, payload, size);
+}
+
+static void probe_landed(bool damaged, void *arg)
+{
+    if (!scenario.probe_pending)
+    {
+        return;
+    }
+
+    // A damaged probe measures nothing; its step, if any, is ignored
+    if (damaged)
+    {
+        scenario.probe_pending = false;
+        return;
+    }
+    scenario.probe_landed = true;
+    scenario.probe_landed_ns = sim_hal_now_ns();
+}
+
+static void probe_expire(void)
+{
+    if (scenario.probe_pending && sim_hal_now_ns() - scenario.probe_sent_ns > SIM_PROBE_TIMEOUT_NS)
+    {
+        scenario.result->probes_lost++;
+        scenario.probe_pending = false;
+    }
+}
+
+static void boot_watchdog(void *arg)
+{
+    if (!scenario.booted)
+    {
+        scenario.result->boot_ms = -1;
+        fflush(stdout);
+        _exit(3);
+    }
+}
+
+static void finish_event(void *arg)
+{
+    sim_result_t *result = scenario.result;
+    struct timespec host_end;
+    clock_gettime(CLOCK_MONOTONIC, &host_end);
+    probe_expire();
+    if (scenario.probe_pending)
+    {
+        result->probes_lost++; // Still nothing after the drain
+    }
+
+    lora_stats_t lora;
+    lora_get_stats(&lora);
+    sim_radio_stats_t radio;
+    sim_radio_get_stats(&radio);
+    sim_hal_stats_t hal;
+    sim_hal_get_stats(&hal);
+
+    uint64_t window_ns = sim_hal_now_ns() - scenario.traffic_start_ns;
+    result->rate = scenario.rate;
+    result->traffic_s = (scenario.last_inject_ns - scenario.traffic_start_ns + scenario.interval_ns) / 1e9;
+    result->air_lost = radio.air_lost;
+    result->delivered = lora.frames;
+    result->malformed = lora.malformed;
+    result->damaged = (hal.wire_flips - scenario.hal_start.wire_flips) + (hal.wire_drops - scenario.hal_start.wire_drops);
+    result->uart_overruns = hal.uart_overruns - scenario.hal_start.uart_overruns;
+    result->ring_overflows = lora.rx_overflows;
+    result->inbound_dropped = lora.inbound_dropped;
+    result->at_timeouts = lora.at_timeouts;
+    result->replies = radio.sends - 1; // Less the READY broadcast
+    result->gpio_writes = hal.gpio_writes - scenario.hal_start.gpio_writes;
+    result->gpio_transitions = hal.gpio_transitions - scenario.hal_start.gpio_transitions;
+    result->sleep_pct = 100.0 * (double)(hal.sleep_ns - scenario.hal_start.sleep_ns) / (double)window_ns;
+    result->host_ns_per_msg = ((host_end.tv_sec - scenario.host_start.tv_sec) * 1e9 +
+                               (host_end.tv_nsec - scenario.host_start.tv_nsec)) /
+                              result->injected;
+    collect_latency(result);
+    result->valid = true;
+
+    fflush(stdout);
+    _exit(0);
+}
+
+static void collect_latency(sim_result_t *result)
+{
+    uint n = scenario.latency_count;
+    if (n == 0)
+    {
+        return;
+    }
+
+    qsort(scenario.latencies_ns, n, sizeof(uint32_t), compare_u32);
+    uint64_t total = 0;
+    for (uint i = 0; i < n; i++)
+    {
+        total += scenario.latencies_ns[i];
+    }
+    result->lat_min_us = scenario.latencies_ns[0] / 1e3;
+    result->lat_avg_us = (double)total / n / 1e3;
+    result->lat_p99_us = scenario.latencies_ns[(n * 99 + 99) / 100 - 1] / 1e3;
+    result->lat_max_us = scenario.latencies_ns[n - 1] / 1e3;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void print_meta(const sim_options_t *options)
+{
+    printf("SIM_META,mix=%s,profile=%s,baud=%u,count=%u,probe_every=%u,flip=%g,drop=%g,burst=%u,seed=%llu,"
+           "cost_ns=%u\n",
+           mix_name(options->mix), SIM_PROFILE_NAME, options->baud_rate, options->count, options->probe_every,
+           options->faults.flip_rate, options->faults.drop_rate, MAX(options->faults.burst, 1u),
+           (unsigned long long)options->seed, options->cost_ns ? options->cost_ns : SIM_HAL_DEFAULT_CALL_NS);
+    printf("SIM_COLUMNS,rate,injected,sent,air_lost,delivered,drop_pct,malformed,damaged_bytes,uart_overruns,"
+           "ring_overflows,inbound_dropped,at_timeouts,delivered_per_s,replies,probes,probes_lost,lat_min_us,"
+           "lat_avg_us,lat_p99_us,lat_max_us,gpio_writes,gpio_transitions,sleep_pct,boot_ms,host_ns_per_msg\n");
+}
+
+static void print_result(const sim_result_t *result)
+{
+    double drop_pct = result->sent ? 100.0 * (1.0 - (double)result->delivered / result->sent) : 0.0;
+    printf("SIM,%.1f,%u,%u,%u,%u,%.2f,%u,%u,%u,%u,%u,%u,%.1f,%u,%u,%u,%.1f,%.1f,%.1f,%.1f,%llu,%llu,%.1f,%.1f,%.0f\n",
+           result->rate, result->injected, result->sent, result->air_lost, result->delivered, drop_pct,
+           result->malformed, result->damaged, result->uart_overruns, result->ring_overflows, result->inbound_dropped,
+           result->at_timeouts, result->delivered / result->traffic_s, result->replies, result->probes,
+           result->probes_lost, result->lat_min_us, result->lat_avg_us, result->lat_p99_us, result->lat_max_us,
+           (unsigned long long)result->gpio_writes, (unsigned long long)result->gpio_transitions, result->sleep_pct,
+           result->boot_ms, result->host_ns_per_msg);
+}
+
+static const char *mix_name(sim_mix_t mix)
+{
+    switch (mix)
+    {
+    case SIM_MIX_ACKED:
+        return "acked";
+    case SIM_MIX_ASCII:
+        return "ascii";
+    default:
+        return "quiet";
+    }
+}
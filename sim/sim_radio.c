@@ -0,0 +1,453 @@
+/**
+ * @file sim_radio.c
+ * @brief Simulated RYLR998 LoRa module implementation
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This source file implements the module model. Bytes from the firmware are
+ * collected into lines; each finished line is answered after the module's
+ * turnaround through a small queue of pending replies. Airtime comes from
+ * lora_time_on_air_us() with the parameters the firmware last set, so the
+ * simulated channel is as busy as the driver expects it to be.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "sim_radio.h"
+#include "lora.h"
+
+// Module limits
+#define SIM_RADIO_LINE_MAX 300
+#define SIM_RADIO_REPLY_DEPTH 16
+#define SIM_RADIO_REPLY_MAX 64
+#define SIM_RADIO_PAYLOAD_MAX 240
+#define SIM_RADIO_RESET_MS 100 // AT+RESET to +READY
+
+typedef struct
+{
+    bool used;
+    char text[SIM_RADIO_REPLY_MAX];
+    uint16_t length;
+    uint switch_baud; // Rate to move to once the reply is out (0 = none)
+} sim_radio_reply_t;
+
+static struct
+{
+    uint uart;
+    uint baud_rate;
+
+    // Line from the firmware
+    char line[SIM_RADIO_LINE_MAX];
+    uint line_length;
+    bool line_bad;
+
+    // Stored settings
+    uint address;
+    uint network_id;
+    unsigned long band;
+    uint crfop;
+    uint sf;
+    uint bandwidth;
+    uint coding_rate;
+    uint preamble;
+    char mode[24];
+
+    uint64_t tx_end_ns; // Transmitting until then
+    sim_radio_reply_t replies[SIM_RADIO_REPLY_DEPTH];
+    sim_radio_send_hook_t send_hook;
+    void *send_hook_data;
+    sim_radio_stats_t stats;
+} radio;
+
+// Forward declarations
+static void radio_uart_byte(uint8_t byte, uint baud_rate, void *user_data);
+static void radio_handle_line(const char *line, uint length);
+static void radio_handle_send(const char *args);
+static bool radio_handle_setting(const char *name, const char *value);
+static bool radio_handle_query(const char *name);
+static void radio_reply(const char *text, uint64_t at_ns, uint switch_baud);
+static void radio_reply_event(void *arg);
+static void radio_reply_sent(bool damaged, void *arg);
+static void radio_ready_event(void *arg);
+static bool radio_valid_baud(unsigned long baud_rate);
+static uint64_t radio_turnaround_ns(void);
+
+void sim_radio_init(uint uart_index, uint baud_rate)
+{
+    memset(&radio, 0, sizeof(radio));
+    radio.uart = uart_index;
+    radio.baud_rate = baud_rate;
+
+    // Factory settings
+    radio.network_id = 18;
+    radio.band = 915000000ul;
+    radio.crfop = 22;
+    radio.sf = 9;
+    radio.bandwidth = 7;
+    radio.coding_rate = 1;
+    radio.preamble = 12;
+    strcpy(radio.mode, "0");
+
+    sim_hal_set_uart_peer(uart_index, radio_uart_byte, NULL);
+}
+
+void sim_radio_set_send_hook(sim_radio_send_hook_t hook, void *user_data)
+{
+    radio.send_hook = hook;
+    radio.send_hook_data = user_data;
+}
+
+bool sim_radio_receive(uint16_t sender, const char *payload, uint8_t length, int16_t rssi, int8_t snr,
+                       sim_hal_wire_done_fn_t done, void *arg)
+{
+    // Half duplex: nothing is heard while transmitting
+    if (sim_hal_now_ns() < radio.tx_end_ns)
+    {
+        radio.stats.air_lost++;
+        return false;
+    }
+
+    char line[SIM_HAL_WIRE_MAX];
+    int n = snprintf(line, sizeof(line), "+RCV=%u,%u,%.*s,%d,%d\r\n", sender, length, (int)length, payload, rssi, snr);
+    if (n <= 0 || n >= (int)sizeof(line) ||
+        !sim_hal_uart_send(radio.uart, (const uint8_t *)line, (size_t)n, radio.baud_rate, true, done, arg))
+    {
+        radio.stats.line_full++;
+        return false;
+    }
+
+    radio.stats.received++;
+    return true;
+}
+
+uint sim_radio_baud_rate(void)
+{
+    return radio.baud_rate;
+}
+
+void sim_radio_get_stats(sim_radio_stats_t *stats)
+{
+    if (stats)
+    {
+        *stats = radio.stats;
+    }
+}
+
+// Internal helper functions
+
+static void radio_uart_byte(uint8_t byte, uint baud_rate, void *user_data)
+{
+    // The module frames bytes at its own rate only
+    if (baud_rate != radio.baud_rate || byte >= 0x80)
+    {
+        radio.line_bad = true;
+        return;
+    }
+
+    if (byte != '\n')
+    {
+        if (radio.line_length < SIM_RADIO_LINE_MAX - 1)
+        {
+            radio.line[radio.line_length++] = (char)byte;
+        }
+        else
+        {
+            radio.line_bad = true;
+        }
+        return;
+    }
+
+    radio.line[radio.line_length] = '\0';
+    radio.stats.at_commands++;
+    if (radio.line_bad)
+    {
+        radio.stats.at_errors++;
+        radio_reply("+ERR=2", sim_hal_now_ns() + radio_turnaround_ns(), 0);
+    }
+    else
+    {
+        radio_handle_line(radio.line, radio.line_length);
+    }
+    radio.line_length = 0;
+    radio.line_bad = false;
+}
+
+static void radio_handle_line(const char *line, uint length)
+{
+    uint64_t at_ns = sim_hal_now_ns() + radio_turnaround_ns();
+
+    if (length == 0 || line[length - 1] != '\r')
+    {
+        radio.stats.at_errors++;
+        radio_reply("+ERR=1", at_ns, 0); // No CR LF at the end
+        return;
+    }
+
+    char command[SIM_RADIO_LINE_MAX];
+    memcpy(command, line, length - 1);
+    command[length - 1] = '\0';
+
+    if (strncmp(command, "AT", 2) != 0)
+    {
+        radio.stats.at_errors++;
+        radio_reply("+ERR=2", at_ns, 0); // Head is not AT
+        return;
+    }
+    if (command[2] == '\0')
+    {
+        radio_reply("+OK", at_ns, 0);
+        return;
+    }
+    if (command[2] != '+')
+    {
+        radio.stats.at_errors++;
+        radio_reply("+ERR=4", at_ns, 0);
+        return;
+    }
+
+    char *name = command + 3;
+    if (strncmp(name, "SEND=", 5) == 0)
+    {
+        radio_handle_send(name + 5);
+        return;
+    }
+    if (strcmp(name, "RESET") == 0)
+    {
+        radio_reply("+RESET", at_ns, 0);
+        sim_hal_schedule(at_ns + SIM_RADIO_RESET_MS * 1000000ull, radio_ready_event, NULL);
+        return;
+    }
+
+    size_t name_length = strlen(name);
+    char *equals = strchr(name, '=');
+    bool handled;
+    if (name_length > 0 && name[name_length - 1] == '?')
+    {
+        name[name_length - 1] = '\0';
+        handled = radio_handle_query(name);
+    }
+    else if (equals != NULL)
+    {
+        *equals = '\0';
+        handled = radio_handle_setting(name, equals + 1);
+    }
+    else
+    {
+        handled = false;
+    }
+
+    if (!handled)
+    {
+        radio.stats.at_errors++;
+        radio_reply("+ERR=4", at_ns, 0);
+    }
+}
+
+static void radio_handle_send(const char *args)
+{
+    uint64_t now_ns = sim_hal_now_ns();
+    char *end;
+
+    // AT+SEND=<address>,<length>,<data>
+    unsigned long destination = strtoul(args, &end, 10);
+    if (*end != ',' || destination > 65535)
+    {
+        radio.stats.at_errors++;
+        radio_reply("+ERR=4", now_ns + radio_turnaround_ns(), 0);
+        return;
+    }
+    unsigned long length = strtoul(end + 1, &end, 10);
+    const char *data = end + 1;
+    if (*end != ',' || length == 0 || length > SIM_RADIO_PAYLOAD_MAX || strlen(data) != length)
+    {
+        radio.stats.at_errors++;
+        radio_reply("+ERR=5", now_ns + radio_turnaround_ns(), 0); // Length does not match the data
+        return;
+    }
+
+    // Airtime by the firmware's own formula, from the parameters it set
+    lora_config_t air = {.sf = (lora_spreading_factor_t)radio.sf,
+                         .bandwidth = (lora_bandwidth_t)radio.bandwidth,
+                         .coding_rate = (lora_coding_rate_t)radio.coding_rate};
+    uint32_t airtime_us = lora_time_on_air_us(&air, (uint8_t)length);
+
+    uint64_t start_ns = MAX(now_ns + radio_turnaround_ns(), radio.tx_end_ns);
+    radio.tx_end_ns = start_ns + (uint64_t)airtime_us * 1000;
+    radio.stats.sends++;
+    radio.stats.airtime_us += airtime_us;
+
+    if (radio.send_hook)
+    {
+        radio.send_hook((uint16_t)destination, data, (uint8_t)length, radio.send_hook_data);
+    }
+    radio_reply("+OK", radio.tx_end_ns, 0);
+}
+
+static bool radio_handle_setting(const char *name, const char *value)
+{
+    uint64_t at_ns = sim_hal_now_ns() + radio_turnaround_ns();
+    char *end;
+    unsigned long number = strtoul(value, &end, 10);
+    bool numeric = (end != value && *end == '\0');
+
+    if (strcmp(name, "ADDRESS") == 0 && numeric && number <= 65535)
+    {
+        radio.address = (uint)number;
+    }
+    else if (strcmp(name, "NETWORKID") == 0 && numeric && ((number >= 3 && number <= 15) || number == 18))
+    {
+        radio.network_id = (uint)number;
+    }
+    else if (strcmp(name, "BAND") == 0 && numeric)
+    {
+        radio.band = number;
+    }
+    else if (strcmp(name, "CRFOP") == 0 && numeric && number <= 22)
+    {
+        radio.crfop = (uint)number;
+    }
+    else if (strcmp(name, "PARAMETER") == 0)
+    {
+        uint sf, bandwidth, coding_rate, preamble;
+        if (sscanf(value, "%u,%u,%u,%u", &sf, &bandwidth, &coding_rate, &preamble) != 4 || sf < 5 || sf > 11 ||
+            bandwidth < 7 || bandwidth > 9 || coding_rate < 1 || coding_rate > 4 || preamble < 4 || preamble > 25)
+        {
+            return false;
+        }
+        radio.sf = sf;
+        radio.bandwidth = bandwidth;
+        radio.coding_rate = coding_rate;
+        radio.preamble = preamble;
+    }
+    else if (strcmp(name, "MODE") == 0 && strlen(value) < sizeof(radio.mode))
+    {
+        strcpy(radio.mode, value);
+    }
+    else if (strcmp(name, "IPR") == 0 && numeric && radio_valid_baud(number))
+    {
+        // Answered at the old rate, then the module switches
+        radio_reply("+OK", at_ns, (uint)number);
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+
+    radio_reply("+OK", at_ns, 0);
+    return true;
+}
+
+static bool radio_handle_query(const char *name)
+{
+    char reply[SIM_RADIO_REPLY_MAX];
+
+    if (strcmp(name, "ADDRESS") == 0)
+    {
+        snprintf(reply, sizeof(reply), "+ADDRESS=%u", radio.address);
+    }
+    else if (strcmp(name, "NETWORKID") == 0)
+    {
+        snprintf(reply, sizeof(reply), "+NETWORKID=%u", radio.network_id);
+    }
+    else if (strcmp(name, "BAND") == 0)
+    {
+        snprintf(reply, sizeof(reply), "+BAND=%lu", radio.band);
+    }
+    else if (strcmp(name, "CRFOP") == 0)
+    {
+        snprintf(reply, sizeof(reply), "+CRFOP=%u", radio.crfop);
+    }
+    else if (strcmp(name, "PARAMETER") == 0)
+    {
+        snprintf(reply, sizeof(reply), "+PARAMETER=%u,%u,%u,%u", radio.sf, radio.bandwidth, radio.coding_rate,
+                 radio.preamble);
+    }
+    else if (strcmp(name, "MODE") == 0)
+    {
+        snprintf(reply, sizeof(reply), "+MODE=%s", radio.mode);
+    }
+    else if (strcmp(name, "IPR") == 0)
+    {
+        snprintf(reply, sizeof(reply), "+IPR=%u", radio.baud_rate);
+    }
+    else if (strcmp(name, "VER") == 0)
+    {
+        snprintf(reply, sizeof(reply), "+VER=RYLR998_SIM");
+    }
+    else
+    {
+        return false;
+    }
+
+    radio_reply(reply, sim_hal_now_ns() + radio_turnaround_ns(), 0);
+    return true;
+}
+
+static void radio_reply(const char *text, uint64_t at_ns, uint switch_baud)
+{
+    for (uint i = 0; i < SIM_RADIO_REPLY_DEPTH; i++)
+    {
+        sim_radio_reply_t *reply = &radio.replies[i];
+        if (reply->used)
+        {
+            continue;
+        }
+
+        int n = snprintf(reply->text, sizeof(reply->text), "%s\r\n", text);
+        reply->length = (uint16_t)MIN((size_t)n, sizeof(reply->text) - 1);
+        reply->switch_baud = switch_baud;
+        reply->used = sim_hal_schedule(at_ns, radio_reply_event, reply);
+        return;
+    }
+
+    // The firmware never has this many commands in flight
+    radio.stats.line_full++;
+}
+
+static void radio_reply_event(void *arg)
+{
+    sim_radio_reply_t *reply = arg;
+    if (!sim_hal_uart_send(radio.uart, (const uint8_t *)reply->text, reply->length, radio.baud_rate, false,
+                           radio_reply_sent, reply))
+    {
+        radio.stats.line_full++;
+        reply->used = false;
+    }
+}
+
+static void radio_reply_sent(bool damaged, void *arg)
+{
+    sim_radio_reply_t *reply = arg;
+    if (reply->switch_baud != 0)
+    {
+        radio.baud_rate = reply->switch_baud;
+    }
+    reply->used = false;
+}
+
+static void radio_ready_event(void *arg)
+{
+    radio_reply("+READY", sim_hal_now_ns(), 0);
+}
+
+static bool radio_valid_baud(unsigned long baud_rate)
+{
+    static const unsigned long rates[] = {300, 1200, 4800, 9600, 19200, 28800, 38400, 57600, 115200};
+    for (uint i = 0; i < count_of(rates); i++)
+    {
+        if (rates[i] == baud_rate)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint64_t radio_turnaround_ns(void)
+{
+    return SIM_RADIO_TURNAROUND_US * 1000ull;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file sim_radio.h
+ * @brief Simulated RYLR998 LoRa module on a simulated UART
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This header file provides a model of the RYLR998 as the firmware sees it
+ * over the UART. It answers the AT commands the driver sends, after a short
+ * turnaround, at its own baud rate:
+ * - Settings (ADDRESS, NETWORKID, BAND, CRFOP, PARAMETER, MODE) are stored
+ *   and reported back by the matching query
+ * - AT+IPR answers +OK at the old rate, then switches
+ * - AT+SEND keeps the module transmitting for the packet's airtime before it
+ *   answers +OK; packets arriving from the air meanwhile are lost
+ * - Lines that do not start with AT, or arrive garbled, get +ERR
+ *
+ * Packets from other nodes are injected with sim_radio_receive() and reach
+ * the firmware as +RCV lines, subject to the simulated line faults.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef SIM_RADIO_H
+#define SIM_RADIO_H
+
+#include "sim_hal.h"
+
+/**
+ * @brief Module reply turnaround
+ */
+#define SIM_RADIO_TURNAROUND_US 2000
+
+/**
+ * @brief Called when the module starts sending a packet
+ *
+ * @param destination Address from AT+SEND
+ * @param payload Payload (not NUL-terminated)
+ * @param length Payload length
+ * @param user_data User-defined data pointer
+ */
+typedef void (*sim_radio_send_hook_t)(uint16_t destination, const char *payload, uint8_t length, void *user_data);
+
+/**
+ * @brief Module counters since sim_radio_init()
+ */
+typedef struct
+{
+    uint32_t at_commands; ///< Lines received from the firmware
+    uint32_t at_errors;   ///< Lines answered with +ERR
+    uint32_t sends;       ///< Packets transmitted
+    uint64_t airtime_us;  ///< Total transmit time
+    uint32_t received;    ///< Packets passed on as +RCV lines
+    uint32_t air_lost;    ///< Packets missed while transmitting
+    uint32_t line_full;   ///< +RCV lines refused by a full UART line queue
+} sim_radio_stats_t;
+
+/**
+ * @brief Power up the module on a UART
+ *
+ * @param uart_index UART the module is wired to
+ * @param baud_rate Module's configured rate (the RYLR998 ships at 115200)
+ */
+void sim_radio_init(uint uart_index, uint baud_rate);
+
+/**
+ * @brief Watch the packets the module transmits
+ *
+ * @param hook Called at the start of each transmission (NULL = none)
+ * @param user_data Passed to hook
+ */
+void sim_radio_set_send_hook(sim_radio_send_hook_t hook, void *user_data);
+
+/**
+ * @brief Deliver a packet from another node
+ *
+ * @param sender Sender address
+ * @param payload Payload
+ * @param length Payload length
+ * @param rssi Reported RSSI in dBm
+ * @param snr Reported SNR in dB
+ * @param done Called when the +RCV line has reached the MCU (NULL = none)
+ * @param arg Passed to done
+ * @return true if the line was queued, false if the module was transmitting or the line is full
+ */
+bool sim_radio_receive(uint16_t sender, const char *payload, uint8_t length, int16_t rssi, int8_t snr,
+                       sim_hal_wire_done_fn_t done, void *arg);
+
+/**
+ * @brief Module's current UART rate
+ *
+ * @return uint Baud rate
+ */
+uint sim_radio_baud_rate(void);
+
+/**
+ * @brief Copy the counters
+ *
+ * @param stats Pointer to store the counters
+ */
+void sim_radio_get_stats(sim_radio_stats_t *stats);
+
+#endif /* SIM_RADIO_H */
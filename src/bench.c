@@ -0,0 +1,443 @@
+/**
+ * @file bench.c
+ * @brief On-target cycle-count benchmark implementation
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This source file implements the SysTick cycle counter and the benchmark
+ * cases (UART receive ring, +RCV parser, stepper coil writes, command
+ * dispatch). Each sample runs with interrupts disabled, and the cost of
+ * reading the counter itself is measured once and subtracted. Parser, ring
+ * and dispatch cases share one corpus of recorded command payloads.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "bench.h"
+#include "lora.h"
+#include "protocol.h"
+#include "run.h"
+#include "stepper.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "hardware/clocks.h"
+#include "hardware/structs/systick.h"
+#include "hardware/regs/m0plus.h"
+
+#define BENCH_SYSTICK_MASK 0x00FFFFFFu
+
+// Sender, RSSI and SNR of the recorded +RCV lines
+#define BENCH_SENDER 200
+#define BENCH_RSSI -52
+#define BENCH_SNR 11
+
+// Longest +RCV line: prefix, payload and suffix
+#define BENCH_LINE_MAX (LORA_MAX_MESSAGE_LENGTH + 32)
+_Static_assert(LORA_RX_LINE_SIZE <= BENCH_LINE_MAX + 2, "Line assembly must fit the driver's line buffer");
+
+// Boolean phase table of the per-pin write path, kept only as the baseline
+static const bool bench_step_sequence[8][4] = {
+    {1, 0, 0, 0}, {1, 1, 0, 0}, {0, 1, 0, 0}, {0, 1, 1, 0},
+    {0, 0, 1, 0}, {0, 0, 1, 1}, {0, 0, 0, 1}, {1, 0, 0, 1},
+};
+
+// Coil write strategies under test
+typedef enum
+{
+    BENCH_WRITE_PER_PIN,   // Four gpio_put() per motor
+    BENCH_WRITE_PER_MOTOR, // One gpio_put_masked() per motor
+    BENCH_WRITE_ALL        // One gpio_put_masked() for every motor
+} bench_write_t;
+
+// Cycle statistics of one case
+typedef struct
+{
+    uint32_t overhead; // Cost of an empty measurement, subtracted from every sample
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t samples;
+} bench_result_t;
+
+// One recorded command payload
+typedef struct
+{
+    const char *name;
+    char payload[LORA_MAX_MESSAGE_LENGTH + 1];
+    uint8_t length;
+} bench_payload_t;
+
+// Commands as the remote and a serial terminal send them
+typedef enum
+{
+    BENCH_ASCII_ON,
+    BENCH_ASCII_SPEED,
+    BENCH_ASCII_STATS,
+    BENCH_FRAME_START,
+    BENCH_FRAME_MOVE,
+    BENCH_FRAME_BATCH,
+    BENCH_MAX_PAYLOAD,
+    BENCH_CORPUS_SIZE
+} bench_corpus_id_t;
+
+static bench_payload_t corpus[BENCH_CORPUS_SIZE];
+static bool corpus_ready = false;
+static uint bench_cases = 0;
+
+// Forward declarations
+static uint32_t bench_overhead(void);
+static void bench_result_init(bench_result_t *result);
+static void bench_result_add(bench_result_t *result, uint32_t cycles);
+static void bench_report(const char *group, const char *name, const bench_result_t *result, uint32_t units);
+static void bench_corpus_set(bench_corpus_id_t id, const char *name, const char *payload, size_t length);
+static void bench_build_corpus(void);
+static uint16_t bench_format_line(const bench_payload_t *entry, char *line, size_t size);
+static void bench_write_step(bench_write_t mode, const stepper_motor_t *motors, uint num_motors, int step);
+
+void bench_init(void)
+{
+    systick_hw->csr = 0;
+    systick_hw->rvr = BENCH_SYSTICK_MASK;
+    systick_hw->cvr = 0; // Any write reloads from RVR
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+}
+
+uint32_t bench_cycles_now(void)
+{
+    return systick_hw->cvr;
+}
+
+uint32_t bench_cycles_since(uint32_t start)
+{
+    return (start - systick_hw->cvr) & BENCH_SYSTICK_MASK;
+}
+
+void bench_run_all(const uint pins[][4], uint num_motors)
+{
+#ifdef PICO_PROGRAM_VERSION_STRING
+    const char *version = PICO_PROGRAM_VERSION_STRING;
+#else
+    const char *version = "unknown";
+#endif
+
+    bench_cases = 0;
+    printf("BENCH_META,clk_hz=%lu,iterations=%d,version=%s\n",
+           (unsigned long)clock_get_hz(clk_sys), BENCH_ITERATIONS, version);
+
+    bench_uart_ring();
+    bench_lora_parser();
+    bench_stepper_writes(pins, num_motors);
+    bench_dispatch();
+
+    printf("BENCH_DONE,cases=%u\n", bench_cases);
+}
+
+void bench_uart_ring(void)
+{
+#if defined(LORA_BENCH) && !defined(LORA_UART_DMA)
+    static char line[BENCH_LINE_MAX + 2];
+    static char out[BENCH_LINE_MAX + 2];
+    bench_build_corpus();
+
+    // Byte throughput over the longest recorded line
+    uint16_t length = bench_format_line(&corpus[BENCH_MAX_PAYLOAD], line, sizeof(line));
+    bench_result_t put;
+    bench_result_t get;
+    bench_result_init(&put);
+    bench_result_init(&get);
+
+    for (int n = 0; n < BENCH_ITERATIONS; n++)
+    {
+        lora_bench_ring_reset();
+
+        uint32_t save = save_and_disable_interrupts();
+        uint32_t start = bench_cycles_now();
+        lora_bench_ring_fill(line, length);
+        uint32_t cycles = bench_cycles_since(start);
+        restore_interrupts(save);
+        bench_result_add(&put, cycles);
+
+        save = save_and_disable_interrupts();
+        start = bench_cycles_now();
+        lora_bench_ring_drain(out, sizeof(out));
+        cycles = bench_cycles_since(start);
+        restore_interrupts(save);
+        bench_result_add(&get, cycles);
+    }
+    bench_report("uart_ring", "put", &put, length);
+    bench_report("uart_ring", "get", &get, length);
+
+    // Line assembly, one terminated line per sample
+    for (uint i = 0; i < BENCH_CORPUS_SIZE; i++)
+    {
+        length = bench_format_line(&corpus[i], line, sizeof(line) - 2);
+        line[length++] = '\r';
+        line[length++] = '\n';
+
+        bench_result_t result;
+        bench_result_init(&result);
+        bool ok = true;
+
+        for (int n = 0; n < BENCH_ITERATIONS; n++)
+        {
+            lora_bench_ring_reset();
+            lora_bench_ring_fill(line, length);
+
+            uint32_t save = save_and_disable_interrupts();
+            uint32_t start = bench_cycles_now();
+            // The driver's own line size, so the longest +RCV line is assembled as the receiver sees it
+            ok &= lora_bench_ring_get_line(out, LORA_RX_LINE_SIZE);
+            uint32_t cycles = bench_cycles_since(start);
+            restore_interrupts(save);
+            bench_result_add(&result, cycles);
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "get_line_%s%s", corpus[i].name, ok ? "" : "_FAILED");
+        bench_report("uart_ring", name, &result, length);
+    }
+    lora_bench_ring_reset();
+#endif
+}
+
+void bench_lora_parser(void)
+{
+    static char line[BENCH_LINE_MAX];
+    bench_build_corpus();
+
+    for (uint i = 0; i < BENCH_CORPUS_SIZE; i++)
+    {
+        uint16_t length = bench_format_line(&corpus[i], line, sizeof(line));
+        lora_frame_view_t view;
+        bench_result_t result;
+        bench_result_init(&result);
+        bool ok = lora_parse_rcv(line, length, &view); // Warm-up, also checks the frame
+
+        for (int n = 0; n < BENCH_ITERATIONS; n++)
+        {
+            uint32_t save = save_and_disable_interrupts();
+            uint32_t start = bench_cycles_now();
+            lora_parse_rcv(line, length, &view);
+            uint32_t cycles = bench_cycles_since(start);
+            restore_interrupts(save);
+            bench_result_add(&result, cycles);
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "%s%s", corpus[i].name, ok ? "" : "_FAILED");
+        bench_report("parse_rcv", name, &result, 1);
+    }
+}
+
+void bench_stepper_writes(const uint pins[][4], uint num_motors)
+{
+    static const char *names[] = {"per_pin", "per_motor", "all_motors"};
+    stepper_motor_t motors[MAX_STEPPERS];
+
+    num_motors = MIN(num_motors, MAX_STEPPERS);
+    for (uint i = 0; i < num_motors; i++)
+    {
+        motors[i].pin1 = pins[i][0];
+        motors[i].pin2 = pins[i][1];
+        motors[i].pin3 = pins[i][2];
+        motors[i].pin4 = pins[i][3];
+        stepper_build_phase_masks(&motors[i]);
+    }
+
+    for (uint mode = BENCH_WRITE_PER_PIN; mode <= BENCH_WRITE_ALL; mode++)
+    {
+        bench_result_t result;
+        bench_result_init(&result);
+
+        for (int n = 0; n < BENCH_ITERATIONS; n++)
+        {
+            uint32_t save = save_and_disable_interrupts();
+            uint32_t start = bench_cycles_now();
+            bench_write_step((bench_write_t)mode, motors, num_motors, n & 7);
+            uint32_t cycles = bench_cycles_since(start);
+            restore_interrupts(save);
+            bench_result_add(&result, cycles);
+        }
+
+        // One unit is one motor stepped
+        bench_report("coil_write", names[mode], &result, num_motors);
+    }
+
+    // Leave the output latches low for stepper_init()
+    for (uint i = 0; i < num_motors; i++)
+    {
+        gpio_clr_mask(motors[i].coil_mask);
+    }
+}
+
+void bench_dispatch(void)
+{
+    // Handlers see pool buffers on the target, so measure with one too
+    lora_message_t *message = lora_message_acquire();
+    bench_build_corpus();
+
+    for (uint i = 0; i < BENCH_CORPUS_SIZE; i++)
+    {
+        message->sender_address = BENCH_SENDER;
+        message->rssi = (uint8_t)(-BENCH_RSSI);
+        message->snr = BENCH_SNR;
+        message->payload_length = corpus[i].length;
+        memcpy(message->payload, corpus[i].payload, corpus[i].length + 1u);
+
+        bench_result_t result;
+        bench_result_init(&result);
+
+        for (int n = 0; n < BENCH_ITERATIONS; n++)
+        {
+            uint32_t save = save_and_disable_interrupts();
+            uint32_t start = bench_cycles_now();
+            lora_message_handler(message, NULL);
+            uint32_t cycles = bench_cycles_since(start);
+            restore_interrupts(save);
+            bench_result_add(&result, cycles);
+        }
+
+        bench_report("dispatch", corpus[i].name, &result, 1);
+    }
+    lora_message_release(message);
+}
+
+// Internal helper functions
+
+static void bench_write_step(bench_write_t mode, const stepper_motor_t *motors, uint num_motors, int step)
+{
+    uint32_t mask = 0;
+    uint32_t value = 0;
+
+    for (uint i = 0; i < num_motors; i++)
+    {
+        const stepper_motor_t *motor = &motors[i];
+        switch (mode)
+        {
+        case BENCH_WRITE_PER_PIN:
+            gpio_put(motor->pin1, bench_step_sequence[step][0]);
+            gpio_put(motor->pin2, bench_step_sequence[step][1]);
+            gpio_put(motor->pin3, bench_step_sequence[step][2]);
+            gpio_put(motor->pin4, bench_step_sequence[step][3]);
+            break;
+        case BENCH_WRITE_PER_MOTOR:
+            gpio_put_masked(motor->coil_mask, motor->phase_masks[step]);
+            break;
+        case BENCH_WRITE_ALL:
+            mask |= motor->coil_mask;
+            value |= motor->phase_masks[step];
+            break;
+        }
+    }
+
+    if (mode == BENCH_WRITE_ALL)
+    {
+        gpio_put_masked(mask, value);
+    }
+}
+
+static uint32_t bench_overhead(void)
+{
+    uint32_t min = UINT32_MAX;
+
+    // Cost of an empty measurement, subtracted from every sample
+    for (int n = 0; n < 16; n++)
+    {
+        uint32_t save = save_and_disable_interrupts();
+        uint32_t start = bench_cycles_now();
+        uint32_t cycles = bench_cycles_since(start);
+        restore_interrupts(save);
+        min = MIN(min, cycles);
+    }
+    return min;
+}
+
+static void bench_result_init(bench_result_t *result)
+{
+    result->overhead = bench_overhead();
+    result->min = UINT32_MAX;
+    result->max = 0;
+    result->total = 0;
+    result->samples = 0;
+}
+
+static void bench_result_add(bench_result_t *result, uint32_t cycles)
+{
+    cycles = (cycles > result->overhead) ? cycles - result->overhead : 0;
+    result->min = MIN(result->min, cycles);
+    result->max = MAX(result->max, cycles);
+    result->total += cycles;
+    result->samples++;
+}
+
+static void bench_report(const char *group, const char *name, const bench_result_t *result, uint32_t units)
+{
+    uint32_t samples = MAX(result->samples, 1u);
+
+    printf("BENCH,%s,%s,%lu,%lu,%lu,%lu,%lu\n", group, name, (unsigned long)result->samples,
+           (unsigned long)units, (unsigned long)(result->samples ? result->min : 0),
+           (unsigned long)(result->total / samples), (unsigned long)result->max);
+    bench_cases++;
+}
+
+static void bench_corpus_set(bench_corpus_id_t id, const char *name, const char *payload, size_t length)
+{
+    bench_payload_t *entry = &corpus[id];
+
+    length = MIN(length, (size_t)LORA_MAX_MESSAGE_LENGTH);
+    entry->name = name;
+    memcpy(entry->payload, payload, length);
+    entry->payload[length] = '\0';
+    entry->length = (uint8_t)length;
+}
+
+static void bench_build_corpus(void)
+{
+    if (corpus_ready)
+    {
+        return;
+    }
+
+    char payload[LORA_MAX_MESSAGE_LENGTH + 1];
+    uint8_t length;
+
+    bench_corpus_set(BENCH_ASCII_ON, "ascii_on", "ON", 2);
+    bench_corpus_set(BENCH_ASCII_SPEED, "ascii_speed", "SPEED=3", 7);
+    bench_corpus_set(BENCH_ASCII_STATS, "ascii_stats", "STATS", 5);
+
+    // Binary frames exactly as the remote encodes them
+    proto_frame_t start = {.opcode = PROTO_OP_START, .sequence = 1, .motor_mask = PROTO_MOTOR_ALL};
+    length = proto_encode(&start, payload, sizeof(payload));
+    bench_corpus_set(BENCH_FRAME_START, "frame_start", payload, length);
+
+    proto_frame_t move = {.opcode = PROTO_OP_MOVE, .sequence = 2, .motor_mask = 0x03, .steps = 2048, .speed_ms = 2};
+    length = proto_encode(&move, payload, sizeof(payload));
+    bench_corpus_set(BENCH_FRAME_MOVE, "frame_move", payload, length);
+
+    proto_batch_t batch = {.sequence = 3, .count = 4};
+    batch.commands[0] = (proto_frame_t){.opcode = PROTO_OP_SPEED, .speed_ms = 2};
+    batch.commands[1] = (proto_frame_t){.opcode = PROTO_OP_MOVE, .motor_mask = 0x01, .steps = 512};
+    batch.commands[2] = (proto_frame_t){.opcode = PROTO_OP_MOVE, .motor_mask = 0x02, .reverse = true, .steps = 512};
+    batch.commands[3] = (proto_frame_t){.opcode = PROTO_OP_MOVE_TO, .motor_mask = 0x0C, .target = -4096};
+    length = proto_encode_batch(&batch, payload, sizeof(payload));
+    bench_corpus_set(BENCH_FRAME_BATCH, "frame_batch_4", payload, length);
+
+    // Largest payload the module can deliver, commas included
+    for (int i = 0; i < LORA_MAX_MESSAGE_LENGTH; i++)
+    {
+        payload[i] = (i % 8 == 7) ? ',' : 'A' + (i % 26);
+    }
+    bench_corpus_set(BENCH_MAX_PAYLOAD, "max_payload", payload, LORA_MAX_MESSAGE_LENGTH);
+
+    corpus_ready = true;
+}
+
+static uint16_t bench_format_line(const bench_payload_t *entry, char *line, size_t size)
+{
+    int length = snprintf(line, size, "+RCV=%d,%u,%.*s,%d,%d", BENCH_SENDER, entry->length, entry->length,
+                          entry->payload, BENCH_RSSI, BENCH_SNR);
+    return (length < 0) ? 0 : (uint16_t)MIN((size_t)length, size - 1);
+}
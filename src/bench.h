@@ -0,0 +1,99 @@
+/**
+ * @file bench.h
+ * @brief On-target cycle-count benchmark interface
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This header file provides cycle counting on the Cortex-M0+, which has no
+ * DWT cycle counter, by running SysTick as a free-running 24-bit down-counter
+ * clocked by the processor. Intervals up to 2^24 cycles (~134 ms at 125 MHz)
+ * are measured exactly.
+ *
+ * The benchmarks are built into the separate LoRa_bench image (CMake option
+ * LORA_BENCH). Every case prints one comma-separated line, so two runs can
+ * be diffed or compared by a script:
+ *
+ *   BENCH,<group>,<case>,<samples>,<units>,<min>,<avg>,<max>
+ *
+ * min, avg and max are processor cycles per sample, with the cost of reading
+ * the counter removed; units is the work done per sample (bytes, lines,
+ * frames or steps), so cycles per unit is min / units. A BENCH_META line
+ * opens each run and BENCH_DONE closes it.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "pico/stdlib.h"
+
+/**
+ * @brief Number of measured iterations per benchmark case
+ */
+#define BENCH_ITERATIONS 1000
+
+/**
+ * @brief Start SysTick as a free-running processor-clock counter
+ */
+void bench_init(void);
+
+/**
+ * @brief Read the current cycle counter value
+ *
+ * @return uint32_t Counter value (counts down)
+ */
+uint32_t bench_cycles_now(void);
+
+/**
+ * @brief Cycles elapsed since a value returned by bench_cycles_now()
+ *
+ * @param start Counter value at the start of the interval
+ * @return uint32_t Elapsed processor cycles (modulo 2^24)
+ */
+uint32_t bench_cycles_since(uint32_t start);
+
+/**
+ * @brief Run every benchmark group and print one line per case
+ *
+ * Call before the radio and the steppers are initialized.
+ *
+ * @param pins Coil pins of each motor (IN1-IN4)
+ * @param num_motors Number of motors (at most MAX_STEPPERS)
+ */
+void bench_run_all(const uint pins[][4], uint num_motors);
+
+/**
+ * @brief Measure the UART receive ring: bulk put, bulk get and line assembly
+ */
+void bench_uart_ring(void);
+
+/**
+ * @brief Measure lora_parse_rcv() cycles per frame over the recorded +RCV corpus
+ */
+void bench_lora_parser(void);
+
+/**
+ * @brief Measure coil update cycles per step and print the results
+ *
+ * Compares four gpio_put() calls per motor from the boolean phase table
+ * against one gpio_put_masked() per motor and one for all motors from the
+ * precomputed phase masks. Run before the steppers are initialized: the
+ * pins are not outputs yet, so nothing moves.
+ *
+ * @param pins Coil pins of each motor (IN1-IN4)
+ * @param num_motors Number of motors (at most MAX_STEPPERS)
+ */
+void bench_stepper_writes(const uint pins[][4], uint num_motors);
+
+/**
+ * @brief Measure lora_message_handler() cycles per command over the corpus
+ *
+ * Covers protocol decode, table dispatch and the motion hand-off. No motor
+ * is attached and the radio is not initialized, so nothing moves and the
+ * acknowledgment is refused before it is formatted for the AT queue.
+ */
+void bench_dispatch(void);
+
+#endif /* BENCH_H */
@@ -0,0 +1,113 @@
+/**
+ * @file config_store.c
+ * @brief Persistent device settings implementation
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This source file implements the settings record in the last flash sector.
+ * The record carries a magic number, a layout version and a checksum; a
+ * record that fails any check is treated as absent. Reads go straight
+ * through the XIP window; writes run from RAM under flash_safe_execute(),
+ * which parks the other core while the flash is busy.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#include <string.h>
+#include "config_store.h"
+#include "log.h"
+#include "hardware/flash.h"
+#include "pico/flash.h"
+
+#define CONFIG_STORE_MAGIC 0x4C43464Eu // "NFCL"
+#define CONFIG_STORE_VERSION 1
+#define CONFIG_STORE_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#define CONFIG_STORE_LOCK_TIMEOUT_MS 100
+
+// Record as laid out in flash
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    config_store_t settings;
+    uint32_t checksum; // FNV-1a over everything above
+} config_record_t;
+
+// Forward declarations
+static uint32_t config_store_checksum(const config_record_t *record);
+static void config_store_write(void *param);
+
+bool config_store_load(config_store_t *settings)
+{
+    if (!settings)
+    {
+        return false;
+    }
+
+    const config_record_t *record = (const config_record_t *)(XIP_BASE + CONFIG_STORE_OFFSET);
+    if (record->magic != CONFIG_STORE_MAGIC || record->version != CONFIG_STORE_VERSION ||
+        record->checksum != config_store_checksum(record))
+    {
+        memset(settings, 0, sizeof(config_store_t));
+        return false;
+    }
+
+    *settings = record->settings;
+    return true;
+}
+
+bool config_store_save(const config_store_t *settings)
+{
+    if (!settings)
+    {
+        return false;
+    }
+
+    config_store_t stored;
+    if (config_store_load(&stored) && memcmp(&stored, settings, sizeof(config_store_t)) == 0)
+    {
+        return true; // Already there - spare the flash an erase cycle
+    }
+
+    // Programming works in whole pages; the unused tail stays erased
+    static uint8_t page[FLASH_PAGE_SIZE];
+    config_record_t record = {.magic = CONFIG_STORE_MAGIC, .version = CONFIG_STORE_VERSION};
+    record.settings = *settings;
+    record.checksum = config_store_checksum(&record);
+    memset(page, 0xFF, sizeof(page));
+    memcpy(page, &record, sizeof(record));
+
+    int result = flash_safe_execute(config_store_write, page, CONFIG_STORE_LOCK_TIMEOUT_MS);
+    if (result != PICO_OK)
+    {
+        LOG(RUN, ERROR, "Config: ❌ Settings not saved (flash error %d)\n", result);
+        return false;
+    }
+
+    LOG(RUN, INFO, "Config: Settings saved (baud %lu, radio hash 0x%08lX, node %u, groups 0x%04X)\n",
+        (unsigned long)settings->baud_rate, (unsigned long)settings->radio_hash,
+        settings->node_id, settings->groups);
+    return true;
+}
+
+// Internal helper functions
+
+static uint32_t config_store_checksum(const config_record_t *record)
+{
+    const uint8_t *bytes = (const uint8_t *)record;
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < offsetof(config_record_t, checksum); i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Runs with interrupts off and the other core parked, so it must not touch flash-resident data
+static void config_store_write(void *param)
+{
+    flash_range_erase(CONFIG_STORE_OFFSET, FLASH_SECTOR_SIZE);
+    flash_range_program(CONFIG_STORE_OFFSET, (const uint8_t *)param, FLASH_PAGE_SIZE);
+}
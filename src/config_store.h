@@ -0,0 +1,59 @@
+/**
+ * @file config_store.h
+ * @brief Persistent device settings interface
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This header file provides a small settings record kept in the last sector
+ * of flash, outside the firmware image. It remembers what the device learned
+ * at runtime - the radio UART baud rate, a hash of the settings last written
+ * to the module, and the fleet identity - so the next boot can skip baud
+ * detection and module setup.
+ *
+ * Usage:
+ * - config_store_load() at startup; false means no valid record (first boot
+ *   or a new record layout), so start from the compile-time defaults
+ * - config_store_save() whenever a setting changes; unchanged records are
+ *   not rewritten, so flash wears only on real changes
+ *
+ * A save erases one sector, so interrupts on both cores are held off for
+ * tens of milliseconds. Core 1 must call flash_safe_execute_core_init()
+ * before core 0 saves.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include "pico/stdlib.h"
+
+/**
+ * @brief Settings kept across resets
+ */
+typedef struct
+{
+    uint32_t baud_rate;   ///< UART baud rate the module last answered on (0 = unknown)
+    uint32_t radio_hash;  ///< lora_config_hash() of the settings the module holds (0 = unknown)
+    uint16_t node_id;     ///< Receiver node ID (0 = compile-time default)
+    uint16_t groups;      ///< Receiver group membership mask
+} config_store_t;
+
+/**
+ * @brief Read the stored settings
+ *
+ * @param settings Pointer to the settings to fill (zeroed if none are stored)
+ * @return true if a valid record was found, false otherwise
+ */
+bool config_store_load(config_store_t *settings);
+
+/**
+ * @brief Write the settings to flash if they differ from the stored record
+ *
+ * @param settings Settings to store
+ * @return true if the record now holds the settings, false if the write failed
+ */
+bool config_store_save(const config_store_t *settings);
+
+#endif /* CONFIG_STORE_H */
@@ -0,0 +1,48 @@
+/**
+ * @file intercore.c
+ * @brief Lock-free inter-core command channel implementation
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This source file implements the command channel shared by both cores on
+ * top of the SPSC ring, whose barriers order each slot write before the
+ * index update that publishes it to the other core.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#include "intercore.h"
+#include "spsc_ring.h"
+#include "hardware/sync.h"
+
+// Shared queue state
+static uint32_t queue[INTERCORE_QUEUE_SIZE];
+static spsc_ring_t channel = SPSC_RING_INIT(queue);
+
+bool intercore_push(uint32_t word)
+{
+    return intercore_push_many(&word, 1);
+}
+
+bool intercore_push_many(const uint32_t *words, uint32_t count)
+{
+    if (!spsc_ring_push_all(&channel, words, count))
+    {
+        return false; // Not enough room for the whole group
+    }
+
+    // Wake the consumer core if it is parked in WFE
+    __sev();
+    return true;
+}
+
+bool intercore_pop(uint32_t *word)
+{
+    return spsc_ring_pop(&channel, word);
+}
+
+bool intercore_is_empty(void)
+{
+    return spsc_ring_is_empty(&channel);
+}
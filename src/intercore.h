@@ -0,0 +1,67 @@
+/**
+ * @file intercore.h
+ * @brief Lock-free inter-core command channel interface
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This header file provides a single-producer/single-consumer queue of 32-bit
+ * command words for passing work from core 0 (radio) to core 1 (motion).
+ * It lives in shared SRAM instead of the SIO FIFO so the hardware FIFO stays
+ * free for the SDK's multicore lockout used by flash writes.
+ *
+ * Usage:
+ * - Core 0 is the only caller of intercore_push() and intercore_push_many()
+ * - Core 1 is the only caller of intercore_pop()
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef INTERCORE_H
+#define INTERCORE_H
+
+#include "pico/stdlib.h"
+
+/**
+ * @brief Number of command words the channel can hold (power of two)
+ */
+#define INTERCORE_QUEUE_SIZE 32
+
+/**
+ * @brief Queue a command word for the other core
+ *
+ * Wakes the consumer if it is waiting in WFE.
+ *
+ * @param word Command word to send
+ * @return true if queued, false if the channel is full
+ */
+bool intercore_push(uint32_t word);
+
+/**
+ * @brief Queue a group of command words with a single publish
+ *
+ * The consumer sees either none or all of the words, so a group it starts
+ * draining is never split by a later push. Wakes the consumer once.
+ *
+ * @param words Command words to send, in order
+ * @param count Number of words
+ * @return true if all were queued, false if the channel lacks room (nothing queued)
+ */
+bool intercore_push_many(const uint32_t *words, uint32_t count);
+
+/**
+ * @brief Take the next command word, if any
+ *
+ * @param word Pointer to store the command word
+ * @return true if a word was returned, false if the channel is empty
+ */
+bool intercore_pop(uint32_t *word);
+
+/**
+ * @brief Check if the channel has no pending command words
+ *
+ * @return true if empty, false otherwise
+ */
+bool intercore_is_empty(void);
+
+#endif /* INTERCORE_H */
@@ -0,0 +1,100 @@
+/**
+ * @file log.c
+ * @brief Deferred ring-buffer logging implementation
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This source file implements the deferred half of the logging subsystem.
+ * Interrupt handlers on either core append fixed-size records under a
+ * hardware spin lock; log_flush() formats them later from the main loop.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#include "log.h"
+#include "hardware/sync.h"
+
+#define LOG_DEFERRED_MASK (LOG_DEFERRED_DEPTH - 1)
+
+// One deferred record - formatting happens at flush time
+typedef struct
+{
+    const char *fmt;
+    uint32_t a;
+    uint32_t b;
+} log_record_t;
+
+// Deferred log ring state
+static log_record_t records[LOG_DEFERRED_DEPTH];
+static uint32_t record_head = 0;
+static uint32_t record_tail = 0;
+static uint32_t records_dropped = 0;
+static spin_lock_t *log_lock = NULL;
+
+void log_init(void)
+{
+    if (log_lock == NULL)
+    {
+        log_lock = spin_lock_instance((uint)spin_lock_claim_unused(true));
+    }
+}
+
+void log_defer(const char *fmt, uint32_t a, uint32_t b)
+{
+    spin_lock_t *lock = log_lock;
+    if (lock == NULL)
+    {
+        return; // log_init() not called yet
+    }
+
+    uint32_t save = spin_lock_blocking(lock);
+
+    if (record_head - record_tail >= LOG_DEFERRED_DEPTH)
+    {
+        records_dropped++;
+    }
+    else
+    {
+        log_record_t *record = &records[record_head & LOG_DEFERRED_MASK];
+        record->fmt = fmt;
+        record->a = a;
+        record->b = b;
+        record_head++;
+    }
+
+    spin_unlock(lock, save);
+}
+
+void log_flush(void)
+{
+    spin_lock_t *lock = log_lock;
+    if (lock == NULL)
+    {
+        return;
+    }
+
+    while (true)
+    {
+        uint32_t save = spin_lock_blocking(lock);
+        if (record_head == record_tail)
+        {
+            uint32_t dropped = records_dropped;
+            records_dropped = 0;
+            spin_unlock(lock, save);
+
+            if (dropped > 0)
+            {
+                printf("Log: %lu deferred records dropped\n", (unsigned long)dropped);
+            }
+            return;
+        }
+
+        // Copy out under the lock, format outside it
+        log_record_t record = records[record_tail & LOG_DEFERRED_MASK];
+        record_tail++;
+        spin_unlock(lock, save);
+
+        printf(record.fmt, record.a, record.b);
+    }
+}
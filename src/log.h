@@ -0,0 +1,131 @@
+/**
+ * @file log.h
+ * @brief Compile-time leveled logging interface
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This header file provides per-module log macros whose level is fixed at
+ * compile time. A statement above its module's level compiles to nothing,
+ * including its arguments, so release builds carry no formatting cost.
+ *
+ * Compile-time Configuration (set from CMake cache options):
+ * - LOG_LEVEL_LORA, LOG_LEVEL_STEPPER, LOG_LEVEL_RUN: 0=none .. 5=trace
+ * - LOG_DEFERRED: enable the ISR-safe deferred ring buffer
+ *
+ * Usage:
+ * - LOG(LORA, INFO, "LoRa: Module ready\n")
+ * - if (LOG_ENABLED(LORA, TRACE)) { ...expensive dump... }
+ * - LOG_DEFER(LORA, WARN, "LoRa: overflow #%lu\n", count, 0) from an ISR
+ *
+ * Deferred records store only the format pointer and two integer arguments;
+ * the text is formatted later by log_flush() from idle time, so no interrupt
+ * handler ever calls printf.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+
+/**
+ * @brief Log levels (higher = more verbose)
+ */
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+#define LOG_LEVEL_TRACE 5
+
+// Per-module levels, normally provided by CMake
+#ifndef LOG_LEVEL_LORA
+#define LOG_LEVEL_LORA LOG_LEVEL_INFO
+#endif
+
+#ifndef LOG_LEVEL_STEPPER
+#define LOG_LEVEL_STEPPER LOG_LEVEL_INFO
+#endif
+
+#ifndef LOG_LEVEL_RUN
+#define LOG_LEVEL_RUN LOG_LEVEL_INFO
+#endif
+
+/**
+ * @brief True if any module logs at all, so startup output is worth waiting for
+ */
+#define LOG_ANY_ENABLED (LOG_LEVEL_LORA > LOG_LEVEL_NONE || LOG_LEVEL_STEPPER > LOG_LEVEL_NONE || \
+                         LOG_LEVEL_RUN > LOG_LEVEL_NONE)
+
+/**
+ * @brief Depth of the deferred log ring (power of two)
+ */
+#define LOG_DEFERRED_DEPTH 32
+
+/**
+ * @brief Compile-time check whether a module logs at a level
+ */
+#define LOG_ENABLED(module, level) (LOG_LEVEL_##module >= LOG_LEVEL_##level)
+
+/**
+ * @brief Format and print immediately if the module's level allows it
+ */
+#define LOG(module, level, ...)          \
+    do                                   \
+    {                                    \
+        if (LOG_ENABLED(module, level))  \
+        {                                \
+            printf(__VA_ARGS__);         \
+        }                                \
+    } while (0)
+
+/**
+ * @brief Record a log entry for later formatting (safe in interrupt handlers)
+ *
+ * The format string must be a literal and may consume at most two integer
+ * arguments. Compiles to nothing unless LOG_DEFERRED is defined.
+ */
+#ifdef LOG_DEFERRED
+#define LOG_DEFER(module, level, fmt, a, b)                     \
+    do                                                          \
+    {                                                           \
+        if (LOG_ENABLED(module, level))                         \
+        {                                                       \
+            log_defer((fmt), (uint32_t)(a), (uint32_t)(b));     \
+        }                                                       \
+    } while (0)
+#else
+#define LOG_DEFER(module, level, fmt, a, b) \
+    do                                      \
+    {                                       \
+    } while (0)
+#endif
+
+/**
+ * @brief Claim the spin lock guarding the deferred log ring
+ *
+ * Call once at startup, before any interrupt that uses LOG_DEFER is enabled.
+ */
+void log_init(void);
+
+/**
+ * @brief Append a record to the deferred log ring
+ *
+ * Never formats text and never blocks beyond a short spin lock; drops the
+ * record (and counts the drop) if the ring is full.
+ *
+ * @param fmt Format string literal
+ * @param a First integer argument
+ * @param b Second integer argument
+ */
+void log_defer(const char *fmt, uint32_t a, uint32_t b);
+
+/**
+ * @brief Print all pending deferred records (call from idle time only)
+ */
+void log_flush(void);
+
+#endif /* LOG_H */
@@ -11,9 +11,16 @@
  *
  * The implementation supports:
  * - AT command communication with timeout handling
+ * - Asynchronous AT command queue with callbacks or pollable handles
  * - Message transmission and reception
- * - Configuration of LoRa parameters
+ * - Response demultiplexing so +RCV frames are never lost to command replies
+ * - Optional DMA receive ring with lines parsed in place (LORA_UART_DMA)
+ * - Non-blocking transmit ring drained by the UART TX interrupt or by DMA
+ * - Switching the module and the UART to a faster baud rate (AT+IPR)
+ * - Configuration of LoRa parameters, named profiles and time-on-air estimates
  * - Asynchronous message processing with callbacks
+ * - Sleeping between radio events, woken by the UART RX pin or a button
+ * - Interrupt-driven, timer-debounced buttons with a press event queue
  * - Command parsing for stepper motor control
  *
  * @copyright Copyright (c) 2025 Kevin Thomas
@@ -23,51 +30,302 @@
 #include <string.h>
 #include <stdlib.h>
 #include "lora.h"
+#include "log.h"
+#include "trace.h"
+#include "spsc_ring.h"
 #include "pico/stdlib.h"
 #include "hardware/uart.h"
 #include "hardware/irq.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#ifdef LORA_UART_DMA
+#include "hardware/dma.h"
+#endif
+#ifdef LORA_RELIABLE
+#include "pico/rand.h"
+#endif
 
 // Internal constants
 #define AT_COMMAND_BUFFER_SIZE 128
-#define RESPONSE_BUFFER_SIZE 256
 #define MAX_RETRY_COUNT 3
 #define UART_RX_BUFFER_SIZE 512
+#define UART_RX_BUFFER_MASK (UART_RX_BUFFER_SIZE - 1)
+#define UART_DMA_RING_BITS 9 // log2(UART_RX_BUFFER_SIZE), for the DMA address wrap
+#define UART_DMA_TRANSFER_COUNT 0xFFFFFFFFu
+#define UART_IDLE_LINE_MS 5 // Unterminated data idle this long is treated as a whole line
+#define UART_TX_BUFFER_SIZE 512 // Room for the longest AT+SEND with the previous one still draining
+#define UART_TX_RING_BITS 9 // log2(UART_TX_BUFFER_SIZE), for the DMA read wrap
+#define AT_ASYNC_COMMAND_SIZE (LORA_MAX_MESSAGE_LENGTH + 32)
+#define AT_ASYNC_RESPONSE_SIZE 64
+#define SMART_RX_MIN_MS 30 // AT+MODE=2 window limits
+#define SMART_RX_MAX_MS 60000
+#define WAKE_SUMMARY_INTERVAL 32 // Measured wakes between latency summaries
+
+// Transmit ring: commands are copied in whole and drained in the background
+typedef struct
+{
+    spsc_ring_t ring; // Tail advances as the UART takes bytes
+#ifdef LORA_UART_DMA
+    uint32_t in_flight; // Bytes covered by the running DMA transfer
+#endif
+} uart_tx_ring_t;
 
-// Circular buffer for UART interrupt handling
+#ifdef LORA_UART_DMA
+_Static_assert((1u << UART_DMA_RING_BITS) == UART_RX_BUFFER_SIZE, "DMA ring bits must match the ring size");
+_Static_assert((1u << UART_TX_RING_BITS) == UART_TX_BUFFER_SIZE, "DMA ring bits must match the ring size");
+
+// DMA receive ring: the channel writes, the parser reads lines in place
+typedef struct
+{
+    uint32_t armed_total;  // Bytes covered by DMA runs that already completed
+    uint32_t consumed;     // Bytes handed to the parser (free-running)
+    uint32_t scanned;      // Bytes already searched for a line terminator
+    uint32_t last_written; // Write position seen by the previous poll
+    absolute_time_t last_rx;
+    uint32_t overruns;
+    char scratch[LORA_RX_LINE_SIZE]; // Only for lines that wrap the ring end or end on the idle timeout
+} uart_dma_rx_t;
+
+// The DMA ring wrap needs the buffer aligned to its own size
+static char uart_dma_ring[UART_RX_BUFFER_SIZE] __aligned(UART_RX_BUFFER_SIZE);
+static int uart_dma_channel = -1; // Claimed once, survives re-initialization
+static char uart_tx_buffer[UART_TX_BUFFER_SIZE] __aligned(UART_TX_BUFFER_SIZE);
+static int uart_tx_dma_channel = -1;
+#else
+// Receive ring filled by the UART interrupt, emptied a line at a time by the main loop
 typedef struct
 {
-    char buffer[UART_RX_BUFFER_SIZE];
-    volatile uint16_t head;
-    volatile uint16_t tail;
+    spsc_ring_t ring;
+    uint32_t scanned; // Bytes already searched for a line terminator
     volatile bool overflow;
 } uart_rx_buffer_t;
 
+static char uart_rx_storage[UART_RX_BUFFER_SIZE];
+static char uart_tx_buffer[UART_TX_BUFFER_SIZE];
+#endif
+
+// Radio profile parameters
+typedef struct
+{
+    const char *name;
+    lora_spreading_factor_t sf;
+    lora_bandwidth_t bandwidth;
+    lora_coding_rate_t coding_rate;
+} lora_profile_params_t;
+
+// The RYLR998 only accepts SF7-SF9 at 125 kHz, SF7-SF10 at 250 kHz and SF7-SF11 at 500 kHz
+static const lora_profile_params_t profiles[LORA_PROFILE_COUNT] = {
+    [LORA_PROFILE_LOW_LATENCY] = {"LOW_LATENCY", LORA_SF_7, LORA_BW_500, LORA_CR_4_5},
+    [LORA_PROFILE_BALANCED] = {"BALANCED", LORA_SF_9, LORA_BW_125, LORA_CR_4_5},
+    [LORA_PROFILE_LONG_RANGE] = {"LONG_RANGE", LORA_SF_9, LORA_BW_125, LORA_CR_4_8},
+};
+
+// Bandwidth in Hz, indexed by lora_bandwidth_t
+static const uint32_t bandwidth_hz[] = {7812, 10417, 15625, 20833, 31250, 41667, 62500, 125000, 250000, 500000};
+
+// Asynchronous AT command slot states
+typedef enum
+{
+    AT_SLOT_FREE = 0, // Available
+    AT_SLOT_QUEUED,   // Waiting for its turn on the UART
+    AT_SLOT_ACTIVE,   // Sent, waiting for the module's reply
+    AT_SLOT_DONE      // Finished, result waiting for lora_at_poll()
+} at_slot_state_t;
+
+// One asynchronous AT command
+typedef struct
+{
+    at_slot_state_t state;
+    uint8_t generation; // Bumped on every reuse so stale handles are rejected
+    lora_status_t status;
+    lora_at_callback_t callback;
+    void *user_data;
+    uint32_t timeout_ms; // Reply deadline, counted from when the command is written
+    absolute_time_t deadline;
+    char command[AT_ASYNC_COMMAND_SIZE];
+    char response[AT_ASYNC_RESPONSE_SIZE];
+} at_slot_t;
+
+// Asynchronous AT command engine - one command in flight, the rest queued in order
+typedef struct
+{
+    at_slot_t slots[LORA_AT_QUEUE_DEPTH];
+    uint8_t order[LORA_AT_QUEUE_DEPTH]; // Slot indices in submission order
+    uint8_t order_head;
+    uint8_t order_count;
+    int8_t active; // Slot in flight, -1 if none
+} at_engine_t;
+
+_Static_assert((LORA_MESSAGE_POOL_DEPTH & (LORA_MESSAGE_POOL_DEPTH - 1)) == 0 && LORA_MESSAGE_POOL_DEPTH <= 256,
+               "Message pool depth must be a power of two of at most 256");
+
+// Received-message pool: frames are parsed straight into a buffer and passed on by pointer
+typedef struct
+{
+    lora_message_t messages[LORA_MESSAGE_POOL_DEPTH];
+    uint8_t free_indices[LORA_MESSAGE_POOL_DEPTH];
+    spsc_ring_t free;            // Released under the lock, acquired on core 0 only
+    spin_lock_t *lock;           // Serializes releases from either core
+    lora_message_t *dispatching; // Buffer the message handler is looking at
+    bool kept;                   // Handler took the dispatching buffer over
+} message_pool_t;
+
+static message_pool_t message_pool = {0};
+
+// Received frames waiting for the application, as pool buffers
+typedef struct
+{
+    spsc_ring_t ring;
+    uint32_t dropped;
+} rx_message_queue_t;
+
+static lora_message_t *inbound_messages[LORA_RX_QUEUE_DEPTH];
+
 // Internal state structure
 typedef struct
 {
     lora_message_handler_t message_handler;
     void *user_data;
-    char rx_buffer[RESPONSE_BUFFER_SIZE];
-    uint8_t rx_index;
     bool command_pending;
+#ifdef LORA_UART_DMA
+    uart_dma_rx_t uart_dma;
+#else
     uart_rx_buffer_t uart_buffer;
+#endif
+    uart_tx_ring_t uart_tx;
+    at_engine_t at;
+    rx_message_queue_t inbound;
+    lora_stats_t stats;
     lora_config_t *config; // Store config for interrupt handler
 } lora_internal_state_t;
 
 static lora_internal_state_t internal_state = {0};
 
+// Low-power receive state - the RX edge interrupt stamps the wake time
+typedef struct
+{
+    volatile bool pending;     // Woken by the RX pin, frame not handled yet
+    volatile uint32_t edge_us; // time_us_32() at the waking edge
+    lora_wake_stats_t stats;
+} lora_wake_state_t;
+
+static lora_wake_state_t wake_state = {0};
+
+// Buttons reporting presses by interrupt, and their press queue
+typedef struct
+{
+    button_t *buttons[LORA_BUTTON_MAX_IRQ];
+    uint count;
+    spsc_ring_t events; // Pushed by the edge interrupt, popped by lora_button_get_event()
+    volatile uint32_t dropped;
+} button_irq_state_t;
+
+static lora_button_event_t button_events[LORA_BUTTON_EVENT_DEPTH];
+static button_irq_state_t button_irq = {.events = SPSC_RING_INIT(button_events)};
+static bool gpio_callback_set = false; // The SDK keeps one GPIO callback per core
+
+#ifdef LORA_RELIABLE
+// Reliable frame slot states
+typedef enum
+{
+    REL_SLOT_FREE = 0, // Available
+    REL_SLOT_SENDING,  // AT+SEND queued or in flight
+    REL_SLOT_WAITING   // On air, waiting for the acknowledgment
+} rel_slot_state_t;
+
+// One frame waiting for its acknowledgment
+typedef struct
+{
+    rel_slot_state_t state;
+    uint8_t generation; // Bumped on every reuse so a stale send callback is ignored
+    uint16_t address;
+    uint8_t sequence;
+    uint8_t attempts;
+    absolute_time_t deadline; // Retransmit time while waiting
+    lora_reliable_callback_t callback;
+    void *user_data;
+    uint8_t length;
+    char payload[LORA_MAX_MESSAGE_LENGTH + 1];
+} rel_slot_t;
+
+// Reply kept for answering a duplicate
+typedef struct
+{
+    bool valid;
+    uint8_t sequence;
+    uint8_t length;
+    char payload[LORA_RELIABLE_REPLY_MAX];
+} rel_reply_t;
+
+// Sequence numbers, duplicate window and kept replies of one peer
+typedef struct
+{
+    bool in_use;
+    uint16_t address;
+    uint32_t last_used_us; // The least recently used peer is replaced when the table is full
+    uint8_t next_sequence; // Next sequence number sent to this peer
+    bool seen_any;
+    uint8_t highest; // Highest sequence number received from this peer
+    uint32_t window; // Bit n set: sequence highest - n was received
+    rel_reply_t replies[LORA_RELIABLE_DEPTH];
+    uint8_t next_reply;
+} rel_peer_t;
+
+typedef struct
+{
+    rel_slot_t slots[LORA_RELIABLE_DEPTH];
+    rel_peer_t peers[LORA_RELIABLE_PEERS];
+} rel_state_t;
+
+static rel_state_t reliable = {0};
+#endif
+
 // Forward declarations
 static lora_status_t send_at_command(lora_config_t *config, const char *command, char *response, uint8_t max_response_len);
-static bool wait_for_response(lora_config_t *config, char *response, uint8_t max_len, uint32_t timeout_ms);
-static void parse_received_message(const char *response, lora_message_t *message);
+static lora_status_t send_at_command_within(lora_config_t *config, const char *command, char *response,
+                                            uint8_t max_response_len, uint32_t timeout_ms);
+static uint32_t send_timeout_ms(const lora_config_t *config, uint8_t length);
+static bool parse_int(const char **ptr, const char *end, int32_t *value);
 static bool is_response_ok(const char *response);
-static void uart_rx_interrupt_handler();
-static void uart_buffer_init(uart_rx_buffer_t *buffer);
-static bool uart_buffer_put(uart_rx_buffer_t *buffer, char c);
-static bool uart_buffer_get(uart_rx_buffer_t *buffer, char *c);
-static uint16_t uart_buffer_available(uart_rx_buffer_t *buffer);
+#ifdef LORA_UART_DMA
+static void uart_dma_start(lora_config_t *config);
+static uint32_t uart_dma_written(void);
+static const char *uart_dma_get_line(uint16_t *line_length);
+static const char *uart_dma_take_line(uint32_t length, uint16_t *line_length);
+#else
+static void uart_interrupt_handler();
+static void uart_buffer_init(uart_rx_buffer_t *buffer, char *storage, uint32_t size);
 static bool uart_buffer_get_line(uart_rx_buffer_t *buffer, char *line, uint16_t max_len);
-static void clear_uart_buffer(lora_config_t *config);
+#endif
+static void uart_tx_write(lora_config_t *config, const char *text);
+static void uart_tx_kick(lora_config_t *config);
+static void uart_tx_drain(lora_config_t *config);
+static void demux_lines(void);
+static void route_line(const char *line, uint16_t length);
+static bool inbound_push(const lora_frame_view_t *frame);
+static bool inbound_pop(lora_message_t **message);
+static void message_pool_init(void);
+static void stats_record_frame(const lora_frame_view_t *frame);
+static void at_engine_reset(void);
+static lora_at_handle_t at_engine_queue(lora_config_t *config, const char *command, uint32_t timeout_ms,
+                                        lora_at_callback_t callback, void *user_data);
+static void at_engine_service(lora_config_t *config);
+static void at_engine_complete(lora_status_t status, const char *response);
+static at_slot_t *at_engine_slot(lora_at_handle_t handle);
+static void gpio_edge_arm(uint pin);
+static void gpio_edge_callback(uint gpio, uint32_t events);
+static void wake_record_latency(void);
+static void button_press(button_t *button);
+static int64_t button_debounce_callback(alarm_id_t id, void *user_data);
+#ifdef LORA_RELIABLE
+static rel_peer_t *rel_peer(uint16_t address, bool create);
+static void rel_transmit(lora_config_t *config, uint8_t index);
+static void rel_sent_callback(lora_status_t status, const char *response, void *user_data);
+static void rel_reply_sent_callback(lora_status_t status, const char *response, void *user_data);
+static uint32_t rel_retransmit_timeout_us(const lora_config_t *config, uint8_t attempts);
+static void rel_service(lora_config_t *config);
+static int64_t rel_next_deadline_us(void);
+#endif
 
 lora_status_t lora_init(lora_config_t *config, uart_inst_t *uart_inst, uint tx_pin, uint rx_pin)
 {
@@ -79,7 +337,16 @@ lora_status_t lora_init_custom(lora_config_t *config, uart_inst_t *uart_inst,
                                uint16_t device_address, uint32_t frequency,
                                lora_power_t power)
 {
-    if (!config || !uart_inst)
+    return lora_init_cached(config, uart_inst, tx_pin, rx_pin, network_id, device_address,
+                            frequency, power, LORA_DEFAULT_BAUD_RATE, 0);
+}
+
+lora_status_t lora_init_cached(lora_config_t *config, uart_inst_t *uart_inst,
+                               uint tx_pin, uint rx_pin, uint16_t network_id,
+                               uint16_t device_address, uint32_t frequency,
+                               lora_power_t power, uint baud_rate, uint32_t module_hash)
+{
+    if (!config || !uart_inst || baud_rate == 0)
     {
         return LORA_STATUS_INVALID_PARAM;
     }
@@ -89,14 +356,14 @@ lora_status_t lora_init_custom(lora_config_t *config, uart_inst_t *uart_inst,
     config->uart = uart_inst;
     config->tx_pin = tx_pin;
     config->rx_pin = rx_pin;
-    config->baud_rate = LORA_DEFAULT_BAUD_RATE;
+    config->baud_rate = baud_rate;
     config->network_id = network_id;
     config->device_address = device_address;
     config->frequency = frequency;
     config->power = power;
-    config->sf = LORA_SF_9; // Default spreading factor (valid range: 5-11)
-    config->bandwidth = LORA_BW_125;
-    config->coding_rate = LORA_CR_4_5;
+    config->sf = profiles[LORA_DEFAULT_PROFILE].sf;
+    config->bandwidth = profiles[LORA_DEFAULT_PROFILE].bandwidth;
+    config->coding_rate = profiles[LORA_DEFAULT_PROFILE].coding_rate;
     config->initialized = false;
 
     // Initialize UART
@@ -111,35 +378,80 @@ lora_status_t lora_init_custom(lora_config_t *config, uart_inst_t *uart_inst,
     uart_set_format(config->uart, 8, 1, UART_PARITY_NONE);
     uart_set_fifo_enabled(config->uart, true);
 
+    // Frames still queued from an earlier initialization go back to the pool
+    lora_message_t *pending;
+    while (inbound_pop(&pending))
+    {
+        lora_message_release(pending);
+    }
+
     // Clear internal state and initialize interrupt buffer
     memset(&internal_state, 0, sizeof(lora_internal_state_t));
     internal_state.config = config; // Store config for interrupt handler
-    uart_buffer_init(&internal_state.uart_buffer);
+    spsc_ring_init(&internal_state.uart_tx.ring, uart_tx_buffer, UART_TX_BUFFER_SIZE, 1);
+    spsc_ring_init(&internal_state.inbound.ring, inbound_messages, LORA_RX_QUEUE_DEPTH, sizeof(lora_message_t *));
+    at_engine_reset();
+
+#ifdef LORA_UART_DMA
+    // DMA drains the RX FIFO into the ring and feeds TX from its own; no per-byte interrupt at all
+    uart_set_irq_enables(config->uart, false, false);
+    uart_dma_start(config);
+    if (uart_tx_dma_channel < 0)
+    {
+        uart_tx_dma_channel = dma_claim_unused_channel(true);
+    }
+    else
+    {
+        dma_channel_abort((uint)uart_tx_dma_channel);
+    }
 
-    // Set up UART interrupt for RX
+    LOG(LORA, INFO, "LoRa: UART DMA rings enabled (RX channel %d, TX channel %d)\n",
+        uart_dma_channel, uart_tx_dma_channel);
+#else
+    uart_buffer_init(&internal_state.uart_buffer, uart_rx_storage, UART_RX_BUFFER_SIZE);
+
+    // Set up UART interrupt for RX, and for TX while the transmit ring holds data
     int uart_irq = (config->uart == uart0) ? UART0_IRQ : UART1_IRQ;
-    irq_set_exclusive_handler(uart_irq, uart_rx_interrupt_handler);
+    irq_set_exclusive_handler(uart_irq, uart_interrupt_handler);
     irq_set_enabled(uart_irq, true);
 
-    // Enable UART RX interrupt
-    uart_set_irq_enables(config->uart, true, false); // RX interrupt enabled, TX disabled
+    // Enable UART RX interrupt; TX is enabled by uart_tx_write()
+    uart_set_irq_enables(config->uart, true, false);
 
-    printf("LoRa: UART interrupt enabled for reliable message reception\n");
+    LOG(LORA, INFO, "LoRa: UART interrupt enabled for reliable message reception\n");
+#endif
 
-    // Wait for module to stabilize
-    sleep_ms(1000);
+    // Probe until the module answers instead of waiting out its worst-case boot time
+    LOG(LORA, INFO, "LoRa: Testing communication with AT command...\n");
+    char probe[64];
+    lora_status_t status = LORA_STATUS_TIMEOUT;
+    absolute_time_t boot_deadline = make_timeout_time_ms(LORA_BOOT_WAIT_MS);
+    do
+    {
+        if (send_at_command_within(config, "AT", probe, sizeof(probe), LORA_PROBE_TIMEOUT_MS) == LORA_STATUS_OK &&
+            is_response_ok(probe))
+        {
+            status = LORA_STATUS_OK;
+        }
+    } while (status != LORA_STATUS_OK && !time_reached(boot_deadline));
 
-    // Test communication
-    printf("LoRa: Testing communication with AT command...\n");
-    lora_status_t status = lora_test(config);
     if (status != LORA_STATUS_OK)
     {
-        printf("LoRa: ❌ CRITICAL ERROR - Module not responding to AT commands!\n");
-        printf("LoRa: Check: 1) 3.3V power, 2) Wiring, 3) Baud rate (9600)\n");
-        printf("LoRa: Expected response: +OK, but got no response or error\n");
+        LOG(LORA, ERROR, "LoRa: ❌ CRITICAL ERROR - Module not responding to AT commands at %u baud!\n", baud_rate);
+        LOG(LORA, ERROR, "LoRa: Check: 1) 3.3V power, 2) Wiring, 3) Baud rate\n");
+        LOG(LORA, ERROR, "LoRa: Expected response: +OK, but got no response or error\n");
         return status;
     }
-    printf("LoRa: ✅ AT communication working\n");
+    LOG(LORA, INFO, "LoRa: ✅ AT communication working\n");
+
+    // The module keeps its settings across power cycles; resend them only if they changed
+    if (module_hash != 0 && module_hash == lora_config_hash(config))
+    {
+        config->initialized = true;
+        LOG(LORA, INFO, "LoRa: ✅ Module already configured (hash 0x%08lX), skipping setup\n",
+            (unsigned long)module_hash);
+        return LORA_STATUS_OK;
+    }
 
     // Configure network parameters
     if (network_id != 0)
@@ -150,20 +462,20 @@ lora_status_t lora_init_custom(lora_config_t *config, uart_inst_t *uart_inst,
         // Validate Network ID range (3-15, 18 according to datasheet)
         if (network_id != 18 && (network_id < 3 || network_id > 15))
         {
-            printf("LoRa: ❌ INVALID Network ID: %d\n", network_id);
-            printf("LoRa: 📖 Valid Network IDs: 3-15, 18 (default: 18)\n");
+            LOG(LORA, ERROR, "LoRa: ❌ INVALID Network ID: %d\n", network_id);
+            LOG(LORA, ERROR, "LoRa: 📖 Valid Network IDs: 3-15, 18 (default: 18)\n");
             return LORA_STATUS_ERROR;
         }
 
-        printf("LoRa: Setting Network ID to %d...\n", network_id);
+        LOG(LORA, INFO, "LoRa: Setting Network ID to %d...\n", network_id);
         snprintf(command, sizeof(command), "AT+NETWORKID=%d", network_id);
         status = send_at_command(config, command, response, sizeof(response));
         if (status != LORA_STATUS_OK || !is_response_ok(response))
         {
-            printf("LoRa: ❌ Failed to set network ID - Response: %s\n", response);
+            LOG(LORA, ERROR, "LoRa: ❌ Failed to set network ID - Response: %s\n", response);
             return LORA_STATUS_ERROR;
         }
-        printf("LoRa: ✅ Network ID set successfully to %d\n", network_id);
+        LOG(LORA, INFO, "LoRa: ✅ Network ID set successfully to %d\n", network_id);
     }
 
     if (device_address != 0)
@@ -171,36 +483,62 @@ lora_status_t lora_init_custom(lora_config_t *config, uart_inst_t *uart_inst,
         char command[32];
         char response[64];
 
-        printf("LoRa: Setting Device Address to %d...\n", device_address);
+        LOG(LORA, INFO, "LoRa: Setting Device Address to %d...\n", device_address);
         snprintf(command, sizeof(command), "AT+ADDRESS=%d", device_address);
         status = send_at_command(config, command, response, sizeof(response));
         if (status != LORA_STATUS_OK || !is_response_ok(response))
         {
-            printf("LoRa: ❌ Failed to set device address - Response: %s\n", response);
+            LOG(LORA, ERROR, "LoRa: ❌ Failed to set device address - Response: %s\n", response);
             return LORA_STATUS_ERROR;
         }
-        printf("LoRa: ✅ Device address set successfully\n");
+        LOG(LORA, INFO, "LoRa: ✅ Device address set successfully\n");
     }
 
     // Configure frequency and power
-    printf("LoRa: Setting frequency to %ld Hz and power to %d...\n", frequency, power);
+    LOG(LORA, INFO, "LoRa: Setting frequency to %ld Hz and power to %d...\n", frequency, power);
     status = lora_configure(config, frequency, power, config->sf, config->bandwidth, config->coding_rate);
     if (status != LORA_STATUS_OK)
     {
-        printf("LoRa: ❌ Failed to configure frequency/power - check settings!\n");
-        printf("LoRa: Ensure frequency is 915000000 Hz for US operation\n");
+        LOG(LORA, ERROR, "LoRa: ❌ Failed to configure frequency/power - check settings!\n");
+        LOG(LORA, ERROR, "LoRa: Ensure frequency is 915000000 Hz for US operation\n");
         return status;
     }
-    printf("LoRa: ✅ Frequency and power configured successfully\n");
+    LOG(LORA, INFO, "LoRa: ✅ Frequency and power configured successfully\n");
 
     config->initialized = true;
-    printf("LoRa: Module initialized successfully\n");
-    printf("LoRa: Network ID: %d, Address: %d, Freq: %ld Hz\n",
-           network_id, device_address, frequency);
+    LOG(LORA, INFO, "LoRa: Module initialized successfully\n");
+    LOG(LORA, INFO, "LoRa: Network ID: %d, Address: %d, Freq: %ld Hz\n",
+        network_id, device_address, frequency);
+    LOG(LORA, INFO, "LoRa: Profile %s, airtime %lu us for a 16-byte payload\n",
+        lora_profile_name(LORA_DEFAULT_PROFILE), (unsigned long)lora_time_on_air_us(config, 16));
 
     return LORA_STATUS_OK;
 }
 
+uint32_t lora_config_hash(const lora_config_t *config)
+{
+    if (!config)
+    {
+        return 0;
+    }
+
+    // FNV-1a over the fields in a fixed order, so padding never enters the hash
+    const uint32_t fields[] = {config->network_id, config->device_address, config->frequency,
+                               (uint32_t)config->power, (uint32_t)config->sf,
+                               (uint32_t)config->bandwidth, (uint32_t)config->coding_rate};
+    uint32_t hash = 2166136261u;
+    for (uint i = 0; i < count_of(fields); i++)
+    {
+        for (uint shift = 0; shift < 32; shift += 8)
+        {
+            hash = (hash ^ ((fields[i] >> shift) & 0xFFu)) * 16777619u;
+        }
+    }
+
+    // Zero is reserved for "unknown"
+    return hash != 0 ? hash : 1;
+}
+
 lora_status_t lora_test(lora_config_t *config)
 {
     if (!config)
@@ -213,11 +551,11 @@ lora_status_t lora_test(lora_config_t *config)
 
     if (status == LORA_STATUS_OK && is_response_ok(response))
     {
-        printf("LoRa: Module responding to AT commands\n");
+        LOG(LORA, INFO, "LoRa: Module responding to AT commands\n");
         return LORA_STATUS_OK;
     }
 
-    printf("LoRa: Module not responding (status: %d, response: %s)\n", status, response);
+    LOG(LORA, ERROR, "LoRa: Module not responding (status: %d, response: %s)\n", status, response);
     return LORA_STATUS_ERROR;
 }
 
@@ -240,72 +578,129 @@ lora_status_t lora_send_message(lora_config_t *config, uint16_t address,
     // Format: AT+SEND=<address>,<length>,<message>
     snprintf(command, sizeof(command), "AT+SEND=%d,%d,%s", address, length, message);
 
-    lora_status_t status = send_at_command(config, command, response, sizeof(response));
+    // The module answers once the packet is on air, so wait for the real airtime
+    lora_status_t status = send_at_command_within(config, command, response, sizeof(response),
+                                                  send_timeout_ms(config, length));
 
     if (status == LORA_STATUS_OK && is_response_ok(response))
     {
-        printf("LoRa: Message sent to address %d: %s\n", address, message);
+        LOG(LORA, INFO, "LoRa: Message sent to address %d: %s\n", address, message);
         return LORA_STATUS_OK;
     }
 
-    printf("LoRa: Failed to send message (status: %d)\n", status);
+    LOG(LORA, ERROR, "LoRa: Failed to send message (status: %d)\n", status);
     return status;
 }
 
 lora_status_t lora_broadcast_message(lora_config_t *config, const char *message, uint8_t length)
 {
-    // Use broadcast address 65535
-    return lora_send_message(config, 65535, message, length);
+    return lora_send_message(config, LORA_BROADCAST_ADDRESS, message, length);
 }
 
-lora_status_t lora_receive_message(lora_config_t *config, lora_message_t *message)
+lora_status_t lora_receive_message(lora_config_t *config, lora_message_t **message)
 {
     if (!config || !config->initialized || !message)
     {
         return LORA_STATUS_INVALID_PARAM;
     }
 
-    char response[RESPONSE_BUFFER_SIZE];
+    demux_lines();
+    return inbound_pop(message) ? LORA_STATUS_OK : LORA_STATUS_ERROR;
+}
+
+lora_message_t *lora_message_acquire(void)
+{
+    uint8_t index;
 
-    // Check if there's a complete line in the interrupt buffer
-    if (!uart_buffer_get_line(&internal_state.uart_buffer, response, sizeof(response)))
+    if (message_pool.lock == NULL)
     {
-        return LORA_STATUS_ERROR; // No complete message available
+        message_pool_init();
     }
 
-    printf("LoRa: 🔍 RAW UART DATA: '%s' (len=%d)\n", response, strlen(response));
+    if (!spsc_ring_pop(&message_pool.free, &index))
+    {
+        return NULL; // Every buffer is queued or kept by a handler
+    }
+    return &message_pool.messages[index];
+}
 
-    // Print hex dump of the data for detailed analysis
-    printf("LoRa: HEX: ");
-    for (int i = 0; response[i] != '\0'; i++)
+void lora_message_release(lora_message_t *message)
+{
+    if (message < &message_pool.messages[0] || message >= &message_pool.messages[LORA_MESSAGE_POOL_DEPTH])
     {
-        printf("%02X ", (unsigned char)response[i]);
+        return; // NULL, or not a pool buffer
     }
-    printf("\n");
 
-    // Check if this is a received message (format: +RCV=<address>,<length>,<data>,<rssi>)
-    if (strncmp(response, "+RCV=", 5) == 0)
+    // Either core may release, so the producer side of the free ring is locked
+    uint8_t index = (uint8_t)(message - message_pool.messages);
+    uint32_t save = spin_lock_blocking(message_pool.lock);
+    spsc_ring_push(&message_pool.free, &index);
+    spin_unlock(message_pool.lock, save);
+}
+
+lora_message_t *lora_message_keep(const lora_message_t *message)
+{
+    if (message == NULL || message != message_pool.dispatching)
     {
-        printf("LoRa: 📨 INCOMING LORA MESSAGE DETECTED!\n");
-        parse_received_message(response, message);
-        printf("LoRa: ✅ LoRa message received from %d: '%s' (RSSI: %d)\n",
-               message->sender_address, message->payload, message->rssi);
-        return LORA_STATUS_OK;
+        return NULL;
+    }
+
+    message_pool.kept = true;
+    return message_pool.dispatching;
+}
+
+bool lora_parse_rcv(const char *line, uint16_t line_length, lora_frame_view_t *view)
+{
+    // Format: +RCV=<address>,<length>,<data>,<rssi>,<snr>
+    // Example: +RCV=123,5,HELLO,-45,12
+
+    if (!line || !view || line_length < 5 || memcmp(line, "+RCV=", 5) != 0)
+    {
+        return false;
     }
-    else if (strncmp(response, "+OK", 3) == 0)
+
+    const char *ptr = line + 5; // Skip "+RCV="
+    const char *end = line + line_length;
+    int32_t address;
+    int32_t length;
+    int32_t rssi;
+    int32_t snr = 0;
+
+    // Parse sender address and declared payload length
+    if (!parse_int(&ptr, end, &address) || address < 0 || address > 0xFFFF ||
+        ptr == end || *ptr++ != ',')
     {
-        printf("LoRa: 📤 AT command response: '%s' (ignoring)\n", response);
+        return false;
     }
-    else if (strncmp(response, "+ERR", 4) == 0)
+    if (!parse_int(&ptr, end, &length) || length < 0 || length > LORA_MAX_MESSAGE_LENGTH ||
+        ptr == end || *ptr++ != ',')
     {
-        printf("LoRa: ❌ AT command error: '%s'\n", response);
+        return false;
     }
-    else
+
+    // The payload is exactly <length> bytes, commas included - never search for its end
+    if (end - ptr < length + 2)
     {
-        printf("LoRa: ❓ Unknown response: '%s' (not +RCV, +OK, or +ERR)\n", response);
+        return false;
     }
+    view->payload = ptr;
+    ptr += length;
 
-    return LORA_STATUS_ERROR;
+    // Parse RSSI, then the optional SNR
+    if (*ptr++ != ',' || !parse_int(&ptr, end, &rssi))
+    {
+        return false;
+    }
+    if (ptr != end && (*ptr++ != ',' || !parse_int(&ptr, end, &snr)))
+    {
+        return false;
+    }
+
+    view->payload_length = (uint8_t)length;
+    view->sender_address = (uint16_t)address;
+    view->rssi = (int16_t)rssi;
+    view->snr = (int8_t)snr;
+    return true;
 }
 
 lora_status_t lora_set_message_handler(lora_config_t *config, lora_message_handler_t handler, void *user_data)
@@ -328,414 +723,1720 @@ lora_status_t lora_process_messages(lora_config_t *config)
         return LORA_STATUS_INVALID_PARAM;
     }
 
-    lora_message_t message;
-    lora_status_t status = lora_receive_message(config, &message);
+    // Route replies to the command in flight and frames to the inbound queue
+    demux_lines();
 
-    if (status == LORA_STATUS_OK)
+    // Time out the command in flight and put the next queued one on the wire
+    at_engine_service(config);
+
+#ifdef LORA_RELIABLE
+    // Retransmit frames whose acknowledgment is overdue
+    rel_service(config);
+#endif
+
+    if (internal_state.inbound.dropped > 0)
+    {
+        LOG(LORA, WARN, "LoRa: ⚠️ %lu received messages dropped (inbound queue full)\n",
+            (unsigned long)internal_state.inbound.dropped);
+        internal_state.stats.inbound_dropped += internal_state.inbound.dropped;
+        internal_state.inbound.dropped = 0;
+    }
+
+    // Deliver every queued frame so back-to-back commands are all handled
+    lora_status_t status = LORA_STATUS_ERROR;
+    lora_message_t *message;
+    while (inbound_pop(&message))
     {
+        status = LORA_STATUS_OK;
+        wake_record_latency();
+
+        // Handlers may re-enter through the blocking AT calls, so nest the dispatch record
+        lora_message_t *outer = message_pool.dispatching;
+        bool outer_kept = message_pool.kept;
+        message_pool.dispatching = message;
+        message_pool.kept = false;
+
         if (internal_state.message_handler)
         {
-            printf("LoRa: 🔧 Calling message handler...\n");
-            internal_state.message_handler(&message, internal_state.user_data);
+            TRACE_MARK(TRACE_DISPATCH);
+            LOG(LORA, DEBUG, "LoRa: 🔧 Calling message handler...\n");
+            internal_state.message_handler(message, internal_state.user_data);
         }
         else
         {
-            printf("LoRa: ❌ No message handler set!\n");
+            LOG(LORA, ERROR, "LoRa: ❌ No message handler set!\n");
+        }
+
+        // The buffer goes back to the pool unless the handler kept it
+        if (!message_pool.kept)
+        {
+            lora_message_release(message);
         }
+        message_pool.dispatching = outer;
+        message_pool.kept = outer_kept;
     }
 
     return status;
 }
 
-lora_status_t lora_configure(lora_config_t *config, uint32_t frequency,
-                             lora_power_t power, lora_spreading_factor_t sf,
-                             lora_bandwidth_t bandwidth, lora_coding_rate_t coding_rate)
+lora_at_handle_t lora_send_at_command_async(lora_config_t *config, const char *command,
+                                            lora_at_callback_t callback, void *user_data)
 {
-    if (!config)
-    {
-        return LORA_STATUS_INVALID_PARAM;
-    }
-
-    char command[64];
-    char response[64];
-    lora_status_t status;
+    return at_engine_queue(config, command, LORA_COMMAND_TIMEOUT_MS, callback, user_data);
+}
 
-    // Set frequency (in Hz, not MHz)
-    snprintf(command, sizeof(command), "AT+BAND=%ld", frequency);
-    status = send_at_command(config, command, response, sizeof(response));
-    if (status != LORA_STATUS_OK || !is_response_ok(response))
+static lora_at_handle_t at_engine_queue(lora_config_t *config, const char *command, uint32_t timeout_ms,
+                                        lora_at_callback_t callback, void *user_data)
+{
+    if (!config || !command || strlen(command) >= AT_ASYNC_COMMAND_SIZE)
     {
-        printf("LoRa: ❌ Failed to set frequency - Response: %s\n", response);
-        return LORA_STATUS_ERROR;
+        return LORA_AT_INVALID_HANDLE;
     }
 
-    // Set transmission power (correct command is AT+CRFOP)
-    snprintf(command, sizeof(command), "AT+CRFOP=%d", (int)power);
-    status = send_at_command(config, command, response, sizeof(response));
-    if (status != LORA_STATUS_OK || !is_response_ok(response))
+    at_engine_t *at = &internal_state.at;
+    if (at->order_count >= LORA_AT_QUEUE_DEPTH)
     {
-        printf("LoRa: ❌ Failed to set power - Response: %s\n", response);
-        return LORA_STATUS_ERROR;
+        LOG(LORA, WARN, "LoRa: ⚠️ AT queue full, dropping '%s'\n", command);
+        return LORA_AT_INVALID_HANDLE;
     }
 
-    // Set spreading factor
-    snprintf(command, sizeof(command), "AT+PARAMETER=%d,%d,%d,%d",
-             (int)sf, (int)bandwidth, (int)coding_rate, 8); // 8 = preamble length
-    status = send_at_command(config, command, response, sizeof(response));
-    if (status != LORA_STATUS_OK || !is_response_ok(response))
+    // Find a free slot (DONE slots stay reserved until polled)
+    for (uint8_t i = 0; i < LORA_AT_QUEUE_DEPTH; i++)
     {
-        printf("LoRa: ❌ Failed to set parameters - Response: %s\n", response);
-        return LORA_STATUS_ERROR;
-    }
+        at_slot_t *slot = &at->slots[i];
+        if (slot->state != AT_SLOT_FREE)
+        {
+            continue;
+        }
 
-    // Update configuration
-    config->frequency = frequency;
-    config->power = power;
-    config->sf = sf;
-    config->bandwidth = bandwidth;
-    config->coding_rate = coding_rate;
+        slot->generation = (slot->generation + 1) & 0x7F;
+        slot->state = AT_SLOT_QUEUED;
+        slot->status = LORA_STATUS_PENDING;
+        slot->callback = callback;
+        slot->user_data = user_data;
+        slot->timeout_ms = timeout_ms;
+        slot->response[0] = '\0';
+        strcpy(slot->command, command);
 
-    printf("LoRa: Configuration updated - Freq: %ld Hz, Power: %d, SF: %d\n",
-           frequency, power, sf);
+        at->order[(at->order_head + at->order_count) % LORA_AT_QUEUE_DEPTH] = i;
+        at->order_count++;
 
-    return LORA_STATUS_OK;
+        // Start right away if the UART is idle
+        at_engine_service(config);
+
+        return (lora_at_handle_t)((slot->generation << 8) | i);
+    }
+
+    LOG(LORA, WARN, "LoRa: ⚠️ No free AT slot (unpolled results?), dropping '%s'\n", command);
+    return LORA_AT_INVALID_HANDLE;
 }
 
-lora_status_t lora_reset(lora_config_t *config)
+lora_at_handle_t lora_send_message_async(lora_config_t *config, uint16_t address,
+                                         const char *message, uint8_t length,
+                                         lora_at_callback_t callback, void *user_data)
 {
-    if (!config)
+    if (!config || !config->initialized || !message || length == 0 || length > LORA_MAX_MESSAGE_LENGTH)
     {
-        return LORA_STATUS_INVALID_PARAM;
+        return LORA_AT_INVALID_HANDLE;
     }
 
-    char response[64];
-    lora_status_t status = send_at_command(config, "AT+RESET", response, sizeof(response));
+    char command[AT_ASYNC_COMMAND_SIZE];
 
-    if (status == LORA_STATUS_OK && is_response_ok(response))
-    {
-        sleep_ms(2000); // Wait for reset to complete
-        config->initialized = false;
-        printf("LoRa: Module reset successfully\n");
-        return LORA_STATUS_OK;
-    }
-    else
-    {
-        printf("LoRa: ❌ Failed to reset module - Response: %s\n", response);
-        return LORA_STATUS_ERROR;
-    }
+    // Format: AT+SEND=<address>,<length>,<message>
+    snprintf(command, sizeof(command), "AT+SEND=%d,%d,%.*s", address, length, length, message);
+
+    return at_engine_queue(config, command, send_timeout_ms(config, length), callback, user_data);
 }
 
-lora_status_t lora_get_version(lora_config_t *config, char *version, uint8_t max_length)
+#ifdef LORA_RELIABLE
+uint8_t lora_reliable_next_sequence(uint16_t address)
 {
-    if (!config || !version || max_length == 0)
+    rel_peer_t *peer = rel_peer(address, true);
+    return peer->next_sequence++;
+}
+
+lora_status_t lora_reliable_send(lora_config_t *config, uint16_t address, uint8_t sequence,
+                                 const char *payload, uint8_t length,
+                                 lora_reliable_callback_t callback, void *user_data)
+{
+    if (!config || !config->initialized || !payload || length == 0 || length > LORA_MAX_MESSAGE_LENGTH ||
+        address == LORA_BROADCAST_ADDRESS)
     {
         return LORA_STATUS_INVALID_PARAM;
     }
 
-    char response[128];
-    lora_status_t status = send_at_command(config, "AT+VER?", response, sizeof(response));
-
-    if (status == LORA_STATUS_OK)
+    for (uint8_t i = 0; i < LORA_RELIABLE_DEPTH; i++)
     {
-        strncpy(version, response, max_length - 1);
-        version[max_length - 1] = '\0';
+        rel_slot_t *slot = &reliable.slots[i];
+        if (slot->state != REL_SLOT_FREE)
+        {
+            continue;
+        }
+
+        slot->generation++;
+        slot->address = address;
+        slot->sequence = sequence;
+        slot->attempts = 0;
+        slot->callback = callback;
+        slot->user_data = user_data;
+        slot->length = length;
+        memcpy(slot->payload, payload, length);
+        slot->payload[length] = '\0';
+
+        rel_transmit(config, i);
+        return LORA_STATUS_OK;
     }
 
-    return status;
+    LOG(LORA, WARN, "LoRa: ⚠️ %d reliable frames already waiting, refusing seq %d\n", LORA_RELIABLE_DEPTH, sequence);
+    return LORA_STATUS_BUSY;
 }
 
-lora_status_t lora_sleep(lora_config_t *config)
+bool lora_reliable_ack(uint16_t address, uint8_t sequence)
 {
-    if (!config)
+    for (uint8_t i = 0; i < LORA_RELIABLE_DEPTH; i++)
     {
-        return LORA_STATUS_INVALID_PARAM;
-    }
+        rel_slot_t *slot = &reliable.slots[i];
+        if (slot->state == REL_SLOT_FREE || slot->address != address || slot->sequence != sequence)
+        {
+            continue;
+        }
 
-    char response[64];
-    lora_status_t status = send_at_command(config, "AT+MODE=1", response, sizeof(response));
-    if (status != LORA_STATUS_OK || !is_response_ok(response))
-    {
-        printf("LoRa: ❌ Failed to set sleep mode - Response: %s\n", response);
-        return LORA_STATUS_ERROR;
+        // Free the slot first so the callback may send the next frame
+        lora_reliable_callback_t callback = slot->callback;
+        void *user_data = slot->user_data;
+        uint8_t attempts = slot->attempts;
+        slot->state = REL_SLOT_FREE;
+
+        LOG(LORA, DEBUG, "LoRa: ✅ Seq %d acknowledged by %d after %d attempts\n", sequence, address, attempts);
+        if (callback)
+        {
+            callback(LORA_STATUS_OK, sequence, attempts, user_data);
+        }
+        return true;
     }
-    return LORA_STATUS_OK;
+    return false;
 }
 
-lora_status_t lora_wake(lora_config_t *config)
+bool lora_reliable_accept(uint16_t address, uint8_t sequence)
 {
-    if (!config)
+    rel_peer_t *peer = rel_peer(address, true);
+    int8_t ahead = (int8_t)(sequence - peer->highest);
+
+    if (!peer->seen_any || ahead <= -32)
     {
-        return LORA_STATUS_INVALID_PARAM;
+        // First frame, or so far behind that the peer must have restarted
+        peer->seen_any = true;
+        peer->highest = sequence;
+        peer->window = 1;
+        return true;
     }
 
-    char response[64];
-    lora_status_t status = send_at_command(config, "AT+MODE=0", response, sizeof(response));
-    if (status != LORA_STATUS_OK || !is_response_ok(response))
+    if (ahead > 0)
     {
-        printf("LoRa: ❌ Failed to set wake mode - Response: %s\n", response);
-        return LORA_STATUS_ERROR;
+        peer->window = (ahead >= 32) ? 1 : (peer->window << ahead) | 1;
+        peer->highest = sequence;
+        return true;
     }
-    return LORA_STATUS_OK;
-}
 
-bool lora_is_on_command(const char *message)
-{
-    if (!message)
+    uint32_t bit = 1u << (uint8_t)(-ahead);
+    if (peer->window & bit)
     {
+        internal_state.stats.duplicates++;
         return false;
     }
 
-    // Check for various "ON" command variations (case insensitive)
-    return (strcasecmp(message, "ON") == 0 ||
-            strcasecmp(message, "START") == 0 ||
-            strcasecmp(message, "MOVE") == 0 ||
-            strcasecmp(message, "1") == 0);
+    // Late but new: an earlier frame overtaken by a retransmission
+    peer->window |= bit;
+    return true;
 }
 
-bool lora_is_off_command(const char *message)
+void lora_reliable_reset_peer(uint16_t address)
 {
-    if (!message)
+    rel_peer_t *peer = rel_peer(address, false);
+    if (peer)
     {
-        return false;
+        uint8_t next_sequence = peer->next_sequence;
+        memset(peer, 0, sizeof(*peer));
+        peer->in_use = true;
+        peer->address = address;
+        peer->last_used_us = time_us_32();
+        peer->next_sequence = next_sequence;
     }
-
-    // Check for various "OFF" command variations (case insensitive)
-    return (strcasecmp(message, "OFF") == 0 ||
-            strcasecmp(message, "STOP") == 0 ||
-            strcasecmp(message, "HALT") == 0 ||
-            strcasecmp(message, "0") == 0);
 }
 
-// Internal helper functions
-
-static lora_status_t send_at_command(lora_config_t *config, const char *command, char *response, uint8_t max_response_len)
+lora_at_handle_t lora_reliable_reply(lora_config_t *config, uint16_t address, uint8_t sequence,
+                                     const char *payload, uint8_t length,
+                                     lora_at_callback_t callback, void *user_data)
 {
-    if (!config || !command || !response)
+    rel_peer_t *peer = rel_peer(address, true);
+
+    if (payload && length <= LORA_RELIABLE_REPLY_MAX)
     {
-        return LORA_STATUS_INVALID_PARAM;
+        rel_reply_t *reply = &peer->replies[peer->next_reply];
+        peer->next_reply = (peer->next_reply + 1) % LORA_RELIABLE_DEPTH;
+        reply->valid = true;
+        reply->sequence = sequence;
+        reply->length = length;
+        memcpy(reply->payload, payload, length);
     }
 
-    // Clear any pending data
-    clear_uart_buffer(config);
+    return lora_send_message_async(config, address, payload, length, callback, user_data);
+}
+
+bool lora_reliable_repeat_reply(lora_config_t *config, uint16_t address, uint8_t sequence)
+{
+    rel_peer_t *peer = rel_peer(address, false);
+    if (!peer)
+    {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < LORA_RELIABLE_DEPTH; i++)
+    {
+        rel_reply_t *reply = &peer->replies[i];
+        if (reply->valid && reply->sequence == sequence)
+        {
+            return lora_send_message_async(config, address, reply->payload, reply->length,
+                                           rel_reply_sent_callback, NULL) != LORA_AT_INVALID_HANDLE;
+        }
+    }
+    return false;
+}
+
+static rel_peer_t *rel_peer(uint16_t address, bool create)
+{
+    rel_peer_t *oldest = &reliable.peers[0];
+    uint32_t now_us = time_us_32();
+
+    for (uint i = 0; i < LORA_RELIABLE_PEERS; i++)
+    {
+        rel_peer_t *peer = &reliable.peers[i];
+        if (peer->in_use && peer->address == address)
+        {
+            peer->last_used_us = now_us;
+            return peer;
+        }
+
+        // Free entries first, then the one unused for longest
+        if (oldest->in_use && (!peer->in_use || now_us - peer->last_used_us > now_us - oldest->last_used_us))
+        {
+            oldest = peer;
+        }
+    }
+
+    if (!create)
+    {
+        return NULL;
+    }
+
+    memset(oldest, 0, sizeof(*oldest));
+    oldest->in_use = true;
+    oldest->address = address;
+    oldest->last_used_us = now_us;
+    oldest->next_sequence = (uint8_t)get_rand_32();
+    return oldest;
+}
+
+static void rel_transmit(lora_config_t *config, uint8_t index)
+{
+    rel_slot_t *slot = &reliable.slots[index];
+
+    slot->state = REL_SLOT_SENDING;
+    slot->attempts++;
+
+    // The handle carries the slot generation, so a late +OK for an earlier use is ignored
+    void *tag = (void *)(uintptr_t)(((uint32_t)slot->generation << 8) | index);
+    if (lora_send_message_async(config, slot->address, slot->payload, slot->length, rel_sent_callback, tag) ==
+        LORA_AT_INVALID_HANDLE)
+    {
+        // The AT queue is full: count it as a lost transmission and try again later
+        rel_sent_callback(LORA_STATUS_BUSY, "", tag);
+    }
+}
+
+static void rel_sent_callback(lora_status_t status, const char *response, void *user_data)
+{
+    uint32_t tag = (uint32_t)(uintptr_t)user_data;
+    uint8_t index = tag & 0xFF;
+    if (index >= LORA_RELIABLE_DEPTH)
+    {
+        return;
+    }
+
+    rel_slot_t *slot = &reliable.slots[index];
+    if (slot->state != REL_SLOT_SENDING || slot->generation != (uint8_t)(tag >> 8))
+    {
+        return; // Acknowledged meanwhile, or the slot was reused
+    }
+
+    if (status != LORA_STATUS_OK)
+    {
+        LOG(LORA, WARN, "LoRa: ⚠️ Seq %d not sent (status: %d)\n", slot->sequence, status);
+    }
+
+    // On air (or lost): the acknowledgment window starts now
+    slot->state = REL_SLOT_WAITING;
+    slot->deadline = make_timeout_time_us(rel_retransmit_timeout_us(internal_state.config, slot->attempts));
+}
+
+static void rel_reply_sent_callback(lora_status_t status, const char *response, void *user_data)
+{
+    if (status != LORA_STATUS_OK)
+    {
+        LOG(LORA, WARN, "LoRa: ⚠️ Repeated reply not sent (status: %d)\n", status);
+    }
+}
+
+static uint32_t rel_retransmit_timeout_us(const lora_config_t *config, uint8_t attempts)
+{
+    // One acknowledgment round trip, doubled per attempt, plus up to half of it at random
+    uint32_t base_us = lora_time_on_air_us(config, LORA_RELIABLE_ACK_LENGTH) + LORA_RELIABLE_TURNAROUND_MS * 1000u;
+    uint32_t timeout_us = base_us << MIN(attempts - 1u, (uint32_t)MAX_RETRY_COUNT);
+    return timeout_us + get_rand_32() % (timeout_us / 2u + 1u);
+}
+
+static void rel_service(lora_config_t *config)
+{
+    for (uint8_t i = 0; i < LORA_RELIABLE_DEPTH; i++)
+    {
+        rel_slot_t *slot = &reliable.slots[i];
+        if (slot->state != REL_SLOT_WAITING || !time_reached(slot->deadline))
+        {
+            continue;
+        }
+
+        if (slot->attempts > MAX_RETRY_COUNT)
+        {
+            lora_reliable_callback_t callback = slot->callback;
+            void *user_data = slot->user_data;
+            slot->state = REL_SLOT_FREE;
+
+            LOG(LORA, ERROR, "LoRa: ❌ Seq %d to %d not acknowledged after %d attempts\n",
+                slot->sequence, slot->address, slot->attempts);
+            if (callback)
+            {
+                callback(LORA_STATUS_TIMEOUT, slot->sequence, slot->attempts, user_data);
+            }
+            continue;
+        }
+
+        LOG(LORA, DEBUG, "LoRa: 🔁 Retransmitting seq %d to %d (attempt %d)\n",
+            slot->sequence, slot->address, slot->attempts + 1);
+        internal_state.stats.retransmits++;
+        rel_transmit(config, i);
+    }
+}
+
+static int64_t rel_next_deadline_us(void)
+{
+    int64_t next_us = -1;
+    absolute_time_t now = get_absolute_time();
+
+    for (uint8_t i = 0; i < LORA_RELIABLE_DEPTH; i++)
+    {
+        const rel_slot_t *slot = &reliable.slots[i];
+        if (slot->state != REL_SLOT_WAITING)
+        {
+            continue;
+        }
+
+        int64_t remaining_us = MAX(absolute_time_diff_us(now, slot->deadline), 0);
+        if (next_us < 0 || remaining_us < next_us)
+        {
+            next_us = remaining_us;
+        }
+    }
+    return next_us;
+}
+#endif
+
+lora_status_t lora_at_poll(lora_at_handle_t handle, char *response, uint8_t max_response_len)
+{
+    at_slot_t *slot = at_engine_slot(handle);
+    if (!slot || slot->callback)
+    {
+        return LORA_STATUS_INVALID_PARAM;
+    }
+
+    if (slot->state != AT_SLOT_DONE)
+    {
+        return LORA_STATUS_PENDING;
+    }
+
+    if (response && max_response_len > 0)
+    {
+        strncpy(response, slot->response, max_response_len - 1);
+        response[max_response_len - 1] = '\0';
+    }
+
+    lora_status_t status = slot->status;
+    slot->state = AT_SLOT_FREE;
+    return status;
+}
+
+lora_status_t lora_at_flush(lora_config_t *config)
+{
+    if (!config)
+    {
+        return LORA_STATUS_INVALID_PARAM;
+    }
+
+    // Every command is bounded by its own timeout, so this terminates;
+    // frames received meanwhile stay on the inbound queue
+    while (internal_state.at.active >= 0 || internal_state.at.order_count > 0)
+    {
+        demux_lines();
+        at_engine_service(config);
+    }
+
+    return LORA_STATUS_OK;
+}
+
+lora_status_t lora_configure(lora_config_t *config, uint32_t frequency,
+                             lora_power_t power, lora_spreading_factor_t sf,
+                             lora_bandwidth_t bandwidth, lora_coding_rate_t coding_rate)
+{
+    if (!config)
+    {
+        return LORA_STATUS_INVALID_PARAM;
+    }
+
+    char command[64];
+    char response[64];
+    lora_at_handle_t handles[3];
+    static const char *const names[3] = {"frequency", "power", "parameters"};
+
+    // Queue all three settings so they go out back-to-back without per-command overhead
+    // Set frequency (in Hz, not MHz)
+    snprintf(command, sizeof(command), "AT+BAND=%ld", frequency);
+    handles[0] = lora_send_at_command_async(config, command, NULL, NULL);
+
+    // Set transmission power (correct command is AT+CRFOP)
+    snprintf(command, sizeof(command), "AT+CRFOP=%d", (int)power);
+    handles[1] = lora_send_at_command_async(config, command, NULL, NULL);
+
+    // Set spreading factor
+    snprintf(command, sizeof(command), "AT+PARAMETER=%d,%d,%d,%d",
+             (int)sf, (int)bandwidth, (int)coding_rate, LORA_PREAMBLE_LENGTH);
+    handles[2] = lora_send_at_command_async(config, command, NULL, NULL);
+
+    lora_at_flush(config);
+
+    // Collect every result first so no slot is left unpolled
+    bool ok = true;
+    for (int i = 0; i < 3; i++)
+    {
+        response[0] = '\0';
+        lora_status_t status = lora_at_poll(handles[i], response, sizeof(response));
+        if (status != LORA_STATUS_OK || !is_response_ok(response))
+        {
+            LOG(LORA, ERROR, "LoRa: ❌ Failed to set %s - Response: %s\n", names[i], response);
+            ok = false;
+        }
+    }
+
+    if (!ok)
+    {
+        return LORA_STATUS_ERROR;
+    }
+
+    // Update configuration
+    config->frequency = frequency;
+    config->power = power;
+    config->sf = sf;
+    config->bandwidth = bandwidth;
+    config->coding_rate = coding_rate;
+
+    LOG(LORA, INFO, "LoRa: Configuration updated - Freq: %ld Hz, Power: %d, SF: %d\n",
+        frequency, power, sf);
+
+    return LORA_STATUS_OK;
+}
+
+lora_status_t lora_set_address(lora_config_t *config, uint16_t address)
+{
+    if (!config || !config->initialized || address == LORA_BROADCAST_ADDRESS)
+    {
+        return LORA_STATUS_INVALID_PARAM;
+    }
+
+    char command[32];
+    char response[64] = "";
+    snprintf(command, sizeof(command), "AT+ADDRESS=%u", address);
+    lora_at_handle_t handle = lora_send_at_command_async(config, command, NULL, NULL);
+
+    // Sends queued earlier still leave from the old address
+    lora_at_flush(config);
+
+    lora_status_t status = lora_at_poll(handle, response, sizeof(response));
+    if (status != LORA_STATUS_OK || !is_response_ok(response))
+    {
+        LOG(LORA, ERROR, "LoRa: ❌ Failed to set address %u - Response: %s\n", address, response);
+        return LORA_STATUS_ERROR;
+    }
+
+    config->device_address = address;
+    LOG(LORA, INFO, "LoRa: ✅ Device address is now %u\n", address);
+    return LORA_STATUS_OK;
+}
+
+lora_status_t lora_set_baud_rate(lora_config_t *config, uint baud_rate)
+{
+    if (!config || !config->initialized || !lora_is_valid_baud_rate(baud_rate))
+    {
+        return LORA_STATUS_INVALID_PARAM;
+    }
+
+    if (baud_rate == config->baud_rate)
+    {
+        return LORA_STATUS_OK;
+    }
+
+    char command[32];
+    char response[64] = "";
+    snprintf(command, sizeof(command), "AT+IPR=%u", baud_rate);
+    lora_status_t status = send_at_command(config, command, response, sizeof(response));
+
+    // The module answers at the old rate, then switches
+    if (status != LORA_STATUS_OK || (!is_response_ok(response) && strncmp(response, "+IPR=", 5) != 0))
+    {
+        LOG(LORA, ERROR, "LoRa: ❌ Failed to set baud rate %u - Response: %s\n", baud_rate, response);
+        return LORA_STATUS_ERROR;
+    }
+
+    uint old_rate = config->baud_rate;
+    uart_tx_drain(config);
+    uart_set_baudrate(config->uart, baud_rate);
+    config->baud_rate = baud_rate;
+
+    // A few probes give the module time to finish switching
+    status = LORA_STATUS_TIMEOUT;
+    for (int attempt = 0; attempt < 3 && status != LORA_STATUS_OK; attempt++)
+    {
+        if (send_at_command_within(config, "AT", response, sizeof(response), LORA_PROBE_TIMEOUT_MS) == LORA_STATUS_OK &&
+            is_response_ok(response))
+        {
+            status = LORA_STATUS_OK;
+        }
+    }
+
+    if (status != LORA_STATUS_OK)
+    {
+        LOG(LORA, ERROR, "LoRa: ❌ No answer at %u baud, back to %u\n", baud_rate, old_rate);
+        uart_set_baudrate(config->uart, old_rate);
+        config->baud_rate = old_rate;
+        return LORA_STATUS_ERROR;
+    }
+
+    LOG(LORA, INFO, "LoRa: ✅ UART now at %u baud\n", baud_rate);
+    return LORA_STATUS_OK;
+}
+
+bool lora_is_valid_baud_rate(uint baud_rate)
+{
+    // Rates listed for AT+IPR in the RYLR998 datasheet
+    static const uint rates[] = {300, 1200, 4800, 9600, 19200, 28800, 38400, 57600, 115200};
+
+    for (uint i = 0; i < count_of(rates); i++)
+    {
+        if (rates[i] == baud_rate)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+lora_status_t lora_apply_profile(lora_config_t *config, lora_profile_t profile)
+{
+    if (!config || profile >= LORA_PROFILE_COUNT)
+    {
+        return LORA_STATUS_INVALID_PARAM;
+    }
+
+    const lora_profile_params_t *params = &profiles[profile];
+    lora_status_t status = lora_configure(config, config->frequency, config->power,
+                                          params->sf, params->bandwidth, params->coding_rate);
+    if (status == LORA_STATUS_OK)
+    {
+        LOG(LORA, INFO, "LoRa: ✅ Profile %s active, airtime %lu us for a 16-byte payload\n",
+            params->name, (unsigned long)lora_time_on_air_us(config, 16));
+    }
+    return status;
+}
+
+const char *lora_profile_name(lora_profile_t profile)
+{
+    return (profile < LORA_PROFILE_COUNT) ? profiles[profile].name : "UNKNOWN";
+}
+
+bool lora_profile_from_name(const char *name, lora_profile_t *profile)
+{
+    if (!name || !profile)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < LORA_PROFILE_COUNT; i++)
+    {
+        if (strcasecmp(name, profiles[i].name) == 0)
+        {
+            *profile = (lora_profile_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t lora_time_on_air_us(const lora_config_t *config, uint8_t payload_len)
+{
+    if (!config || (uint)config->bandwidth >= count_of(bandwidth_hz))
+    {
+        return 0;
+    }
+
+    int32_t sf = (int32_t)config->sf;
+    uint32_t bw = bandwidth_hz[config->bandwidth];
+    int32_t cr = (int32_t)config->coding_rate; // 1..4 for 4/5..4/8
+
+    // Low data rate optimization is mandated once a symbol lasts longer than 16 ms
+    int32_t de = ((1000u << sf) > 16u * bw) ? 1 : 0;
+
+    // Payload symbols: 8 + max(ceil((8PL - 4SF + 28 + 16CRC - 20IH) / (4(SF - 2DE))) * (CR + 4), 0)
+    int32_t numerator = 8 * (int32_t)payload_len - 4 * sf + 28 + 16;
+    int32_t denominator = 4 * (sf - 2 * de);
+    int32_t payload_symbols = 8;
+    if (numerator > 0)
+    {
+        payload_symbols += ((numerator + denominator - 1) / denominator) * (cr + 4);
+    }
+
+    // Preamble adds 4.25 symbols, so count in quarter symbols to stay in integers
+    uint64_t quarter_symbols = (uint64_t)(LORA_PREAMBLE_LENGTH * 4 + 17) + (uint64_t)payload_symbols * 4;
+    return (uint32_t)((quarter_symbols * (1000000ull << sf)) / (4ull * bw));
+}
+
+lora_status_t lora_reset(lora_config_t *config)
+{
+    if (!config)
+    {
+        return LORA_STATUS_INVALID_PARAM;
+    }
+
+    char response[64];
+    lora_status_t status = send_at_command(config, "AT+RESET", response, sizeof(response));
+
+    if (status == LORA_STATUS_OK && is_response_ok(response))
+    {
+        sleep_ms(2000); // Wait for reset to complete
+        config->initialized = false;
+        LOG(LORA, INFO, "LoRa: Module reset successfully\n");
+        return LORA_STATUS_OK;
+    }
+    else
+    {
+        LOG(LORA, ERROR, "LoRa: ❌ Failed to reset module - Response: %s\n", response);
+        return LORA_STATUS_ERROR;
+    }
+}
+
+lora_status_t lora_get_version(lora_config_t *config, char *version, uint8_t max_length)
+{
+    if (!config || !version || max_length == 0)
+    {
+        return LORA_STATUS_INVALID_PARAM;
+    }
+
+    char response[128];
+    lora_status_t status = send_at_command(config, "AT+VER?", response, sizeof(response));
+
+    if (status == LORA_STATUS_OK)
+    {
+        strncpy(version, response, max_length - 1);
+        version[max_length - 1] = '\0';
+    }
+
+    return status;
+}
+
+lora_status_t lora_sleep(lora_config_t *config)
+{
+    if (!config)
+    {
+        return LORA_STATUS_INVALID_PARAM;
+    }
+
+    char response[64];
+    lora_status_t status = send_at_command(config, "AT+MODE=1", response, sizeof(response));
+    if (status != LORA_STATUS_OK || !is_response_ok(response))
+    {
+        LOG(LORA, ERROR, "LoRa: ❌ Failed to set sleep mode - Response: %s\n", response);
+        return LORA_STATUS_ERROR;
+    }
+    return LORA_STATUS_OK;
+}
+
+lora_status_t lora_wake(lora_config_t *config)
+{
+    if (!config)
+    {
+        return LORA_STATUS_INVALID_PARAM;
+    }
+
+    char response[64];
+    lora_status_t status = send_at_command(config, "AT+MODE=0", response, sizeof(response));
+    if (status != LORA_STATUS_OK || !is_response_ok(response))
+    {
+        LOG(LORA, ERROR, "LoRa: ❌ Failed to set wake mode - Response: %s\n", response);
+        return LORA_STATUS_ERROR;
+    }
+    return LORA_STATUS_OK;
+}
+
+lora_status_t lora_set_smart_receive(lora_config_t *config, uint16_t rx_ms, uint16_t sleep_ms)
+{
+    if (!config || rx_ms < SMART_RX_MIN_MS || rx_ms > SMART_RX_MAX_MS ||
+        sleep_ms < SMART_RX_MIN_MS || sleep_ms > SMART_RX_MAX_MS)
+    {
+        return LORA_STATUS_INVALID_PARAM;
+    }
+
+    char command[32];
+    char response[64];
+    snprintf(command, sizeof(command), "AT+MODE=2,%u,%u", rx_ms, sleep_ms);
+    lora_status_t status = send_at_command(config, command, response, sizeof(response));
+    if (status != LORA_STATUS_OK || !is_response_ok(response))
+    {
+        LOG(LORA, ERROR, "LoRa: ❌ Failed to set smart receive mode - Response: %s\n", response);
+        return LORA_STATUS_ERROR;
+    }
+
+    LOG(LORA, INFO, "LoRa: 😴 Smart receive: %u ms listening, %u ms asleep\n", rx_ms, sleep_ms);
+    return LORA_STATUS_OK;
+}
+
+bool lora_is_idle(const lora_config_t *config)
+{
+    if (!config || !config->initialized)
+    {
+        return false;
+    }
+
+    if (internal_state.at.active >= 0 || internal_state.at.order_count > 0 || !spsc_ring_is_empty(&internal_state.inbound.ring))
+    {
+        return false;
+    }
+
+#ifdef LORA_UART_DMA
+    return uart_dma_written() == internal_state.uart_dma.consumed;
+#else
+    return spsc_ring_is_empty(&internal_state.uart_buffer.ring);
+#endif
+}
+
+bool lora_wait_for_rx(lora_config_t *config, uint32_t timeout_us)
+{
+    if (!lora_is_idle(config) || !spsc_ring_is_empty(&button_irq.events))
+    {
+        return false;
+    }
+
+#ifdef LORA_RELIABLE
+    // A retransmission falling due ends the sleep too
+    int64_t retransmit_us = rel_next_deadline_us();
+    if (retransmit_us == 0)
+    {
+        return false;
+    }
+    if (retransmit_us > 0 && (timeout_us == 0 || (uint64_t)retransmit_us < timeout_us))
+    {
+        timeout_us = (uint32_t)retransmit_us;
+    }
+#endif
+
+    // A start bit on the RX pin ends the sleep; the UART itself keeps receiving
+    wake_state.pending = false;
+    gpio_edge_arm(config->rx_pin);
+
+    // A byte that landed before the edge interrupt was armed would wake nothing
+    if (lora_is_idle(config) && spsc_ring_is_empty(&button_irq.events))
+    {
+        wake_state.stats.sleeps++;
+        if (timeout_us > 0)
+        {
+            best_effort_wfe_or_timeout(make_timeout_time_us(timeout_us));
+        }
+        else
+        {
+            __wfe();
+        }
+    }
+
+    // Awake: no edge interrupt per received byte
+    gpio_set_irq_enabled(config->rx_pin, GPIO_IRQ_EDGE_FALL, false);
+
+    if (wake_state.pending)
+    {
+        wake_state.stats.rx_wakes++;
+        return true;
+    }
+    return false;
+}
+
+void lora_get_wake_stats(lora_wake_stats_t *stats)
+{
+    if (stats)
+    {
+        *stats = wake_state.stats;
+    }
+}
+
+void lora_get_stats(lora_stats_t *stats)
+{
+    if (!stats)
+    {
+        return;
+    }
+
+    *stats = internal_state.stats;
+#ifdef LORA_UART_DMA
+    // The DMA write count is the byte count
+    if (internal_state.config && uart_dma_channel >= 0)
+    {
+        stats->rx_bytes = uart_dma_written();
+    }
+#endif
+}
+
+bool lora_is_on_command(const char *message)
+{
+    if (!message)
+    {
+        return false;
+    }
+
+    // Check for various "ON" command variations (case insensitive)
+    return (strcasecmp(message, "ON") == 0 ||
+            strcasecmp(message, "START") == 0 ||
+            strcasecmp(message, "MOVE") == 0 ||
+            strcasecmp(message, "1") == 0);
+}
+
+bool lora_is_off_command(const char *message)
+{
+    if (!message)
+    {
+        return false;
+    }
+
+    // Check for various "OFF" command variations (case insensitive)
+    return (strcasecmp(message, "OFF") == 0 ||
+            strcasecmp(message, "STOP") == 0 ||
+            strcasecmp(message, "HALT") == 0 ||
+            strcasecmp(message, "0") == 0);
+}
+
+// Internal helper functions
+
+static lora_status_t send_at_command(lora_config_t *config, const char *command, char *response, uint8_t max_response_len)
+{
+    return send_at_command_within(config, command, response, max_response_len, LORA_COMMAND_TIMEOUT_MS);
+}
+
+static lora_status_t send_at_command_within(lora_config_t *config, const char *command, char *response,
+                                            uint8_t max_response_len, uint32_t timeout_ms)
+{
+    if (!config || !command || !response)
+    {
+        return LORA_STATUS_INVALID_PARAM;
+    }
+    response[0] = '\0';
+
+    // Queue behind any asynchronous commands so replies stay matched in order
+    lora_at_handle_t handle = at_engine_queue(config, command, timeout_ms, NULL, NULL);
+    if (handle == LORA_AT_INVALID_HANDLE)
+    {
+        lora_at_flush(config);
+        internal_state.stats.at_retries++;
+        handle = at_engine_queue(config, command, timeout_ms, NULL, NULL);
+        if (handle == LORA_AT_INVALID_HANDLE)
+        {
+            return LORA_STATUS_BUSY;
+        }
+    }
+
+    // Wait for the reply; +RCV frames arriving meanwhile go to the inbound queue
+    lora_status_t status;
+    while ((status = lora_at_poll(handle, response, max_response_len)) == LORA_STATUS_PENDING)
+    {
+        demux_lines();
+        at_engine_service(config);
+    }
+
+    if (status == LORA_STATUS_TIMEOUT)
+    {
+        LOG(LORA, ERROR, "LoRa: ❌ Command TIMEOUT - No response from module!\n");
+        LOG(LORA, ERROR, "LoRa: Check: 1) Module power, 2) Wiring, 3) Baud rate (9600)\n");
+        return LORA_STATUS_TIMEOUT;
+    }
+
+    // +ERR replies are reported through the response text, as callers expect
+    LOG(LORA, DEBUG, "LoRa: ✅ Got response: %s\n", response);
+    return LORA_STATUS_OK;
+}
+
+static bool parse_int(const char **ptr, const char *end, int32_t *value)
+{
+    const char *p = *ptr;
+    bool negative = false;
+
+    if (p != end && *p == '-')
+    {
+        negative = true;
+        p++;
+    }
+
+    // At least one digit; five digits cover every field the module reports
+    const char *digits = p;
+    int32_t result = 0;
+    while (p != end && *p >= '0' && *p <= '9' && p - digits < 5)
+    {
+        result = result * 10 + (*p - '0');
+        p++;
+    }
+    if (p == digits)
+    {
+        return false;
+    }
+
+    *value = negative ? -result : result;
+    *ptr = p;
+    return true;
+}
+
+static uint32_t send_timeout_ms(const lora_config_t *config, uint8_t length)
+{
+    // Airtime of the packet plus the usual margin for the module to answer
+    return (lora_time_on_air_us(config, length) + 999) / 1000 + LORA_RESPONSE_TIMEOUT_MS;
+}
+
+static bool is_response_ok(const char *response)
+{
+    if (!response)
+    {
+        return false;
+    }
+
+    // Check for error responses first
+    if (strstr(response, "+ERR") != NULL || strstr(response, "ERROR") != NULL)
+    {
+        return false;
+    }
+
+    // Check for success responses
+    return (strstr(response, "OK") != NULL || strstr(response, "+OK") != NULL);
+}
 
-    // Send command
-    uart_puts(config->uart, command);
-    uart_puts(config->uart, "\r\n");
+// Response demultiplexer
 
-    printf("LoRa: Sent command: %s\n", command);
+static void demux_lines(void)
+{
+#ifdef LORA_UART_DMA
+    // Lines point straight into the DMA ring (or the wrap scratch buffer)
+    const char *line;
+    uint16_t length;
+    while ((line = uart_dma_get_line(&length)) != NULL)
+    {
+        route_line(line, length);
+    }
 
-    // Wait for response
-    bool got_response = wait_for_response(config, response, max_response_len, LORA_COMMAND_TIMEOUT_MS);
+    if (internal_state.uart_dma.overruns > 0)
+    {
+        LOG(LORA, WARN, "LoRa: ⚠️ UART DMA ring overrun %lu times - data lost\n",
+            (unsigned long)internal_state.uart_dma.overruns);
+        internal_state.stats.rx_overflows += internal_state.uart_dma.overruns;
+        internal_state.uart_dma.overruns = 0;
+    }
+#else
+    char line[LORA_RX_LINE_SIZE];
 
-    if (!got_response)
+    while (uart_buffer_get_line(&internal_state.uart_buffer, line, sizeof(line)))
     {
-        printf("LoRa: ❌ Command TIMEOUT - No response from module!\n");
-        printf("LoRa: Check: 1) Module power, 2) Wiring, 3) Baud rate (9600)\n");
-        return LORA_STATUS_TIMEOUT;
+        route_line(line, (uint16_t)strlen(line));
     }
 
-    printf("LoRa: ✅ Got response: %s\n", response);
-    return LORA_STATUS_OK;
+    // Set by the receive interrupt when the ring was full
+    if (internal_state.uart_buffer.overflow)
+    {
+        internal_state.uart_buffer.overflow = false;
+        internal_state.stats.rx_overflows++;
+        LOG(LORA, WARN, "LoRa: ⚠️ UART receive ring overflow - data lost\n");
+    }
+#endif
 }
 
-static bool wait_for_response(lora_config_t *config, char *response, uint8_t max_len, uint32_t timeout_ms)
+static void route_line(const char *line, uint16_t length)
 {
-    absolute_time_t timeout = make_timeout_time_ms(timeout_ms);
+    internal_state.stats.lines++;
+    LOG(LORA, TRACE, "LoRa: 🔍 RAW UART DATA: '%s' (len=%d)\n", line, length);
 
-    while (absolute_time_diff_us(get_absolute_time(), timeout) > 0)
+    // Print hex dump of the data for detailed analysis (trace builds only)
+    if (LOG_ENABLED(LORA, TRACE))
     {
-        // Try to get a complete line from the interrupt buffer
-        if (uart_buffer_get_line(&internal_state.uart_buffer, response, max_len))
+        printf("LoRa: HEX: ");
+        for (int i = 0; line[i] != '\0'; i++)
         {
-            return true;
+            printf("%02X ", (unsigned char)line[i]);
+        }
+        printf("\n");
+    }
+
+    // Received frames (format: +RCV=<address>,<length>,<data>,<rssi>) never answer a command
+    if (strncmp(line, "+RCV=", 5) == 0)
+    {
+        TRACE_MARK(TRACE_RCV_LINE);
+        LOG(LORA, DEBUG, "LoRa: 📨 INCOMING LORA MESSAGE DETECTED!\n");
+        lora_frame_view_t frame;
+        if (!lora_parse_rcv(line, length, &frame))
+        {
+            LOG(LORA, WARN, "LoRa: ❌ Malformed +RCV frame: '%s'\n", line);
+            internal_state.stats.malformed++;
+        }
+        else if (!inbound_push(&frame))
+        {
+            internal_state.inbound.dropped++;
+        }
+        else
+        {
+            TRACE_MARK(TRACE_PARSE);
+            stats_record_frame(&frame);
+        }
+    }
+    else if (internal_state.at.active >= 0)
+    {
+        // +OK, +ERR or a query reply for the command in flight
+        LOG(LORA, DEBUG, "LoRa: 📤 AT response: '%s'\n", line);
+        if (strncmp(line, "+OK", 3) == 0 &&
+            strncmp(internal_state.at.slots[internal_state.at.active].command, "AT+SEND=", 8) == 0)
+        {
+            TRACE_MARK(TRACE_SEND_OK);
         }
-        // Remove sleep for maximum speed - busy wait for immediate response
+        at_engine_complete(strncmp(line, "+ERR", 4) == 0 ? LORA_STATUS_ERROR : LORA_STATUS_OK, line);
+    }
+    else if (strncmp(line, "+OK", 3) == 0)
+    {
+        LOG(LORA, DEBUG, "LoRa: 📤 AT command response: '%s' (ignoring)\n", line);
+    }
+    else if (strncmp(line, "+ERR", 4) == 0)
+    {
+        LOG(LORA, WARN, "LoRa: ❌ AT command error: '%s'\n", line);
+    }
+    else
+    {
+        LOG(LORA, WARN, "LoRa: ❓ Unknown response: '%s' (not +RCV, +OK, or +ERR)\n", line);
+    }
+}
+
+static bool inbound_push(const lora_frame_view_t *frame)
+{
+    spsc_ring_t *ring = &internal_state.inbound.ring;
+    if (spsc_ring_space(ring) == 0)
+    {
+        return false; // Application is not keeping up
+    }
+
+    lora_message_t *message = lora_message_acquire();
+    if (message == NULL)
+    {
+        return false; // Every buffer is queued or kept by a handler
+    }
+
+    // Copy only the payload bytes out of the transient line, straight into the pool buffer
+    message->sender_address = frame->sender_address;
+    message->rssi = (uint8_t)(frame->rssi < 0 ? -frame->rssi : frame->rssi);
+    message->snr = frame->snr;
+    message->payload_length = frame->payload_length;
+    memcpy(message->payload, frame->payload, frame->payload_length);
+    message->payload[frame->payload_length] = '\0';
+
+    LOG(LORA, INFO, "LoRa: ✅ LoRa message received from %d: '%s' (RSSI: %d, SNR: %d)\n",
+        message->sender_address, message->payload, message->rssi, message->snr);
+    spsc_ring_push(ring, &message);
+    return true;
+}
+
+static bool inbound_pop(lora_message_t **message)
+{
+    return spsc_ring_pop(&internal_state.inbound.ring, message);
+}
+
+static void message_pool_init(void)
+{
+    message_pool.lock = spin_lock_instance((uint)spin_lock_claim_unused(true));
+    spsc_ring_init(&message_pool.free, message_pool.free_indices, LORA_MESSAGE_POOL_DEPTH, 1);
+
+    for (uint i = 0; i < LORA_MESSAGE_POOL_DEPTH; i++)
+    {
+        uint8_t index = (uint8_t)i;
+        spsc_ring_push(&message_pool.free, &index);
+    }
+}
+
+// Asynchronous AT command engine
+
+static void stats_record_frame(const lora_frame_view_t *frame)
+{
+    lora_stats_t *stats = &internal_state.stats;
+
+    if (stats->frames == 0 || frame->rssi < stats->rssi_min)
+    {
+        stats->rssi_min = frame->rssi;
+    }
+    if (stats->frames == 0 || frame->rssi > stats->rssi_max)
+    {
+        stats->rssi_max = frame->rssi;
+    }
+    if (stats->frames == 0 || frame->snr < stats->snr_min)
+    {
+        stats->snr_min = frame->snr;
+    }
+    if (stats->frames == 0 || frame->snr > stats->snr_max)
+    {
+        stats->snr_max = frame->snr;
     }
 
-    return false; // Timeout
+    stats->rssi_total += frame->rssi;
+    stats->snr_total += frame->snr;
+    stats->frames++;
+}
+
+static void at_engine_reset(void)
+{
+    memset(&internal_state.at, 0, sizeof(at_engine_t));
+    internal_state.at.active = -1;
 }
 
-static void parse_received_message(const char *response, lora_message_t *message)
+static void at_engine_service(lora_config_t *config)
 {
-    // Format: +RCV=<address>,<length>,<data>,<rssi>
-    // Example: +RCV=123,5,HELLO,-45
+    at_engine_t *at = &internal_state.at;
+
+    // Chain the transmit DMA onto bytes queued while it was busy
+    uart_tx_kick(config);
+
+    // Fail the command in flight if the module never answered
+    if (at->active >= 0 && time_reached(at->slots[at->active].deadline))
+    {
+        LOG(LORA, ERROR, "LoRa: ❌ Async command TIMEOUT: %s\n", at->slots[at->active].command);
+        internal_state.stats.at_timeouts++;
+        at_engine_complete(LORA_STATUS_TIMEOUT, "");
+    }
 
-    if (!response || !message)
+    if (at->active >= 0 || at->order_count == 0)
     {
         return;
     }
 
-    memset(message, 0, sizeof(lora_message_t));
+    // Put the next queued command on the wire straight away
+    uint8_t index = at->order[at->order_head];
+    at->order_head = (at->order_head + 1) % LORA_AT_QUEUE_DEPTH;
+    at->order_count--;
+
+    at_slot_t *slot = &at->slots[index];
+    slot->state = AT_SLOT_ACTIVE;
+    slot->deadline = make_timeout_time_ms(slot->timeout_ms);
+    at->active = (int8_t)index;
+
+    // Returns at once; the ring drains while the caller gets on with its work
+    uart_tx_write(config, slot->command);
+    uart_tx_write(config, "\r\n");
+    if (strncmp(slot->command, "AT+SEND=", 8) == 0)
+    {
+        TRACE_MARK(TRACE_AT_SEND);
+    }
+
+    LOG(LORA, DEBUG, "LoRa: Sent async command: %s\n", slot->command);
+}
 
-    const char *ptr = response + 5; // Skip "+RCV="
+static void at_engine_complete(lora_status_t status, const char *response)
+{
+    at_engine_t *at = &internal_state.at;
+    at_slot_t *slot = &at->slots[at->active];
+    at->active = -1;
 
-    // Parse sender address
-    message->sender_address = (uint16_t)strtoul(ptr, (char **)&ptr, 10);
-    if (*ptr == ',')
-        ptr++;
+    slot->status = status;
+    strncpy(slot->response, response, AT_ASYNC_RESPONSE_SIZE - 1);
+    slot->response[AT_ASYNC_RESPONSE_SIZE - 1] = '\0';
 
-    // Parse length
-    message->payload_length = (uint8_t)strtoul(ptr, (char **)&ptr, 10);
-    if (*ptr == ',')
-        ptr++;
+    if (slot->callback)
+    {
+        // Release first so the callback may queue a follow-up command into this slot
+        char reply[AT_ASYNC_RESPONSE_SIZE];
+        lora_at_callback_t callback = slot->callback;
+        void *user_data = slot->user_data;
+        memcpy(reply, slot->response, sizeof(reply));
+        slot->state = AT_SLOT_FREE;
+        callback(status, reply, user_data);
+    }
+    else
+    {
+        slot->state = AT_SLOT_DONE;
+    }
+}
 
-    // Parse payload
-    const char *payload_start = ptr;
-    const char *payload_end = strchr(ptr, ',');
-    if (payload_end)
+static at_slot_t *at_engine_slot(lora_at_handle_t handle)
+{
+    if (handle < 0 || (handle & 0xFF) >= LORA_AT_QUEUE_DEPTH)
     {
-        uint8_t payload_len = payload_end - payload_start;
-        if (payload_len > LORA_MAX_MESSAGE_LENGTH - 1)
-        {
-            payload_len = LORA_MAX_MESSAGE_LENGTH - 1;
-        }
-        memcpy(message->payload, payload_start, payload_len);
-        message->payload[payload_len] = '\0';
-        message->payload_length = payload_len;
+        return NULL;
+    }
+
+    at_slot_t *slot = &internal_state.at.slots[handle & 0xFF];
+    if (slot->state == AT_SLOT_FREE || slot->generation != ((handle >> 8) & 0x7F))
+    {
+        return NULL;
+    }
+    return slot;
+}
+
+// Edge interrupt and low-power receive helpers
 
-        // Parse RSSI
-        ptr = payload_end + 1;
-        message->rssi = (uint8_t)abs((int)strtol(ptr, NULL, 10));
+static void gpio_edge_arm(uint pin)
+{
+    // Enabling also clears edges latched while the pin was disarmed
+    if (!gpio_callback_set)
+    {
+        gpio_set_irq_enabled_with_callback(pin, GPIO_IRQ_EDGE_FALL, true, gpio_edge_callback);
+        gpio_callback_set = true;
+    }
+    else
+    {
+        gpio_set_irq_enabled(pin, GPIO_IRQ_EDGE_FALL, true);
     }
 }
 
-static bool is_response_ok(const char *response)
+// Falling edge on the RX pin (armed only while lora_wait_for_rx() sleeps) or a button
+static void gpio_edge_callback(uint gpio, uint32_t events)
 {
-    if (!response)
+    gpio_set_irq_enabled(gpio, GPIO_IRQ_EDGE_FALL, false);
+
+    button_t *button = NULL;
+    for (uint i = 0; i < button_irq.count; i++)
     {
-        return false;
+        if (button_irq.buttons[i]->pin == gpio)
+        {
+            button = button_irq.buttons[i];
+            break;
+        }
     }
 
-    // Check for error responses first
-    if (strstr(response, "+ERR") != NULL || strstr(response, "ERROR") != NULL)
+    if (button)
     {
-        return false;
+        button_press(button);
+    }
+    else if (!wake_state.pending)
+    {
+        wake_state.edge_us = time_us_32();
+        wake_state.pending = true;
     }
 
-    // Check for success responses
-    return (strstr(response, "OK") != NULL || strstr(response, "+OK") != NULL);
+    // Make sure a WFE entered just after this interrupt still returns
+    __sev();
 }
 
-static void clear_uart_buffer(lora_config_t *config)
+static void wake_record_latency(void)
 {
-    // Clear hardware UART FIFO
-    while (uart_is_readable(config->uart))
+    if (!wake_state.pending)
+    {
+        return;
+    }
+
+    // Covers the rest of the line on the UART, parsing and queueing
+    lora_wake_stats_t *stats = &wake_state.stats;
+    uint32_t latency_us = time_us_32() - wake_state.edge_us;
+    wake_state.pending = false;
+
+    stats->measured++;
+    stats->last_latency_us = latency_us;
+    stats->total_latency_us += latency_us;
+    if (latency_us > stats->max_latency_us)
     {
-        uart_getc(config->uart);
+        stats->max_latency_us = latency_us;
     }
 
-    // Clear interrupt buffer
-    uart_buffer_init(&internal_state.uart_buffer);
+    LOG(LORA, DEBUG, "LoRa: ⏱️ Wake to handler %lu us\n", (unsigned long)latency_us);
+    if ((stats->measured % WAKE_SUMMARY_INTERVAL) == 0)
+    {
+        LOG(LORA, INFO, "LoRa: ⏱️ Wake to handler avg %lu us, max %lu us over %lu wakes\n",
+            (unsigned long)(stats->total_latency_us / stats->measured),
+            (unsigned long)stats->max_latency_us, (unsigned long)stats->measured);
+    }
 }
 
-// UART Interrupt Handler and Buffer Management Functions
+// UART transmit ring
 
-static void uart_buffer_init(uart_rx_buffer_t *buffer)
+static void uart_tx_write(lora_config_t *config, const char *text)
 {
-    buffer->head = 0;
-    buffer->tail = 0;
-    buffer->overflow = false;
+    spsc_ring_t *ring = &internal_state.uart_tx.ring;
+    uint32_t length = (uint32_t)strlen(text);
+    uint32_t stored = spsc_ring_write(ring, text, length);
+
+    // Only full if a timed-out command is still on the wire; wait for it rather than drop
+    while (stored < length)
+    {
+        uart_tx_kick(config);
+        tight_loop_contents();
+        stored += spsc_ring_write(ring, text + stored, length - stored);
+    }
+
+    uart_tx_kick(config);
 }
 
-static bool uart_buffer_put(uart_rx_buffer_t *buffer, char c)
+#ifdef LORA_UART_DMA
+static void uart_tx_kick(lora_config_t *config)
 {
-    uint16_t next_head = (buffer->head + 1) % UART_RX_BUFFER_SIZE;
+    uart_tx_ring_t *tx = &internal_state.uart_tx;
+    uint channel = (uint)uart_tx_dma_channel;
 
-    if (next_head == buffer->tail)
+    if (uart_tx_dma_channel < 0 || dma_channel_is_busy(channel))
     {
-        buffer->overflow = true;
-        return false; // Buffer full
+        return;
     }
 
-    buffer->buffer[buffer->head] = c;
-    buffer->head = next_head;
-    return true;
+    // The finished transfer frees its bytes; start on whatever was queued since
+    spsc_ring_consume(&tx->ring, tx->in_flight);
+    tx->in_flight = spsc_ring_count(&tx->ring);
+    if (tx->in_flight == 0)
+    {
+        return;
+    }
+
+    // Read address wraps on the aligned ring, so one transfer covers the seam
+    dma_channel_config cfg = dma_channel_get_default_config(channel);
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_8);
+    channel_config_set_read_increment(&cfg, true);
+    channel_config_set_write_increment(&cfg, false);
+    channel_config_set_ring(&cfg, false, UART_TX_RING_BITS);
+    channel_config_set_dreq(&cfg, uart_get_dreq(config->uart, true));
+    dma_channel_configure(channel, &cfg, &uart_get_hw(config->uart)->dr,
+                          spsc_ring_peek(&tx->ring), tx->in_flight, true);
+}
+#else
+static void uart_tx_kick(lora_config_t *config)
+{
+    spsc_ring_t *ring = &internal_state.uart_tx.ring;
+    uart_inst_t *uart = config->uart;
+    uint8_t c;
+
+    // Shared with the interrupt handler, which refills the FIFO as it empties
+    uint32_t save = save_and_disable_interrupts();
+    while (uart_is_writable(uart) && spsc_ring_pop(ring, &c))
+    {
+        // Same register write as uart_get_hw(uart)->dr = c, but through the SDK so the host simulation sees it
+        uart_putc_raw(uart, (char)c);
+    }
+
+    // The TX interrupt fires as the FIFO drains; mask it once nothing is left
+    uart_set_irq_enables(uart, true, !spsc_ring_is_empty(ring));
+    restore_interrupts(save);
 }
+#endif
 
-static bool uart_buffer_get(uart_rx_buffer_t *buffer, char *c)
+static void uart_tx_drain(lora_config_t *config)
 {
-    if (buffer->head == buffer->tail)
+    // Under DMA the bytes of the last transfer stay counted until the next kick retires them
+    while (!spsc_ring_is_empty(&internal_state.uart_tx.ring))
     {
-        return false; // Buffer empty
+        uart_tx_kick(config);
+        tight_loop_contents();
     }
+    uart_tx_wait_blocking(config->uart);
+}
 
-    *c = buffer->buffer[buffer->tail];
-    buffer->tail = (buffer->tail + 1) % UART_RX_BUFFER_SIZE;
-    return true;
+#ifdef LORA_UART_DMA
+// UART DMA receive ring
+
+static void uart_dma_start(lora_config_t *config)
+{
+    if (uart_dma_channel < 0)
+    {
+        uart_dma_channel = dma_claim_unused_channel(true);
+    }
+    else
+    {
+        dma_channel_abort((uint)uart_dma_channel);
+    }
+
+    // Byte transfers paced by the UART RX DREQ, write address wrapping on the ring
+    dma_channel_config cfg = dma_channel_get_default_config((uint)uart_dma_channel);
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_8);
+    channel_config_set_read_increment(&cfg, false);
+    channel_config_set_write_increment(&cfg, true);
+    channel_config_set_ring(&cfg, true, UART_DMA_RING_BITS);
+    channel_config_set_dreq(&cfg, uart_get_dreq(config->uart, false));
+
+    internal_state.uart_dma.last_rx = get_absolute_time();
+    dma_channel_configure((uint)uart_dma_channel, &cfg, uart_dma_ring,
+                          &uart_get_hw(config->uart)->dr, UART_DMA_TRANSFER_COUNT, true);
 }
 
-static uint16_t uart_buffer_available(uart_rx_buffer_t *buffer)
+static uint32_t uart_dma_written(void)
 {
-    return (buffer->head - buffer->tail + UART_RX_BUFFER_SIZE) % UART_RX_BUFFER_SIZE;
+    uart_dma_rx_t *rx = &internal_state.uart_dma;
+    uint channel = (uint)uart_dma_channel;
+
+    // A run lasts 2^32 bytes (days at 115200); re-arm it seamlessly when it ends
+    if (!dma_channel_is_busy(channel))
+    {
+        rx->armed_total += UART_DMA_TRANSFER_COUNT;
+        dma_channel_set_trans_count(channel, UART_DMA_TRANSFER_COUNT, true);
+    }
+
+    uint32_t written = rx->armed_total + (UART_DMA_TRANSFER_COUNT - dma_channel_hw_addr(channel)->transfer_count);
+
+    // Read ring bytes only after the count that covers them
+    __mem_fence_acquire();
+    return written;
 }
 
-static bool uart_buffer_get_line(uart_rx_buffer_t *buffer, char *line, uint16_t max_len)
+static const char *uart_dma_get_line(uint16_t *line_length)
 {
-    uint16_t index = 0;
-    char c;
+    uart_dma_rx_t *rx = &internal_state.uart_dma;
+    uint32_t written = uart_dma_written();
 
-    printf("LoRa: 🔍 uart_buffer_get_line: Trying to read line from %d chars...\n", uart_buffer_available(buffer));
+    if (written != rx->last_written)
+    {
+        rx->last_written = written;
+        rx->last_rx = get_absolute_time();
+    }
+
+    // The parser fell a whole ring behind - the unread bytes are already overwritten
+    if (written - rx->consumed > UART_RX_BUFFER_SIZE)
+    {
+        rx->overruns++;
+        rx->consumed = written;
+        rx->scanned = written;
+        return NULL;
+    }
 
-    while (index < max_len - 1 && uart_buffer_get(buffer, &c))
+    // Only bytes not yet searched are looked at, so a slow line costs nothing per poll
+    while (rx->scanned != written)
     {
-        printf("LoRa: Read char: 0x%02X (%c)\n", (unsigned char)c, (c >= 32 && c <= 126) ? c : '.');
+        char c = uart_dma_ring[rx->scanned & UART_RX_BUFFER_MASK];
+        rx->scanned++;
 
         if (c == '\r' || c == '\n')
         {
-            if (index > 0)
+            uint32_t length = rx->scanned - 1 - rx->consumed;
+            if (length == 0)
             {
-                line[index] = '\0';
-                printf("LoRa: 📝 Complete line found: '%s' (len=%d)\n", line, index);
-                return true; // Complete line found
+                rx->consumed = rx->scanned; // Skip empty lines (consecutive \r\n)
+                continue;
             }
-            // Skip empty lines (consecutive \r\n)
-            printf("LoRa: Skipping empty line character\n");
-            continue;
+            const char *line = uart_dma_take_line(length, line_length);
+            rx->consumed = rx->scanned;
+            return line;
+        }
+    }
+
+    // Idle-line timeout: unterminated data that stopped arriving is a whole line
+    uint32_t pending = written - rx->consumed;
+    if (pending > 0 && absolute_time_diff_us(rx->last_rx, get_absolute_time()) > UART_IDLE_LINE_MS * 1000)
+    {
+        // The byte after the data is not written yet, so copy rather than terminate in place
+        uint32_t length = MIN(pending, sizeof(rx->scratch) - 1);
+        for (uint32_t i = 0; i < length; i++)
+        {
+            rx->scratch[i] = uart_dma_ring[(rx->consumed + i) & UART_RX_BUFFER_MASK];
         }
-        line[index++] = c;
+        rx->scratch[length] = '\0';
+        rx->consumed = written;
+        *line_length = (uint16_t)length;
+        return rx->scratch;
+    }
+
+    return NULL;
+}
+
+static const char *uart_dma_take_line(uint32_t length, uint16_t *line_length)
+{
+    uart_dma_rx_t *rx = &internal_state.uart_dma;
+    uint32_t offset = rx->consumed & UART_RX_BUFFER_MASK;
+
+    // Contiguous line: overwrite its terminator with NUL and hand out the ring itself
+    if (offset + length < UART_RX_BUFFER_SIZE)
+    {
+        uart_dma_ring[offset + length] = '\0';
+        *line_length = (uint16_t)length;
+        return &uart_dma_ring[offset];
     }
 
-    if (index > 0)
+    // The line wraps the ring end - join the two pieces in the scratch buffer
+    length = MIN(length, sizeof(rx->scratch) - 1);
+    uint32_t first = MIN(length, UART_RX_BUFFER_SIZE - offset);
+    memcpy(rx->scratch, &uart_dma_ring[offset], first);
+    memcpy(rx->scratch + first, uart_dma_ring, length - first);
+    rx->scratch[length] = '\0';
+    *line_length = (uint16_t)length;
+    return rx->scratch;
+}
+#else
+// UART Interrupt Handler and Buffer Management Functions
+
+static void uart_buffer_init(uart_rx_buffer_t *buffer, char *storage, uint32_t size)
+{
+    spsc_ring_init(&buffer->ring, storage, size, 1);
+    buffer->scanned = 0;
+    buffer->overflow = false;
+}
+
+static bool uart_buffer_get_line(uart_rx_buffer_t *buffer, char *line, uint16_t max_len)
+{
+    spsc_ring_t *ring = &buffer->ring;
+
+    LOG(LORA, TRACE, "LoRa: 🔍 uart_buffer_get_line: Trying to read line from %lu chars...\n",
+        (unsigned long)spsc_ring_count(ring));
+
+    while (true)
     {
-        line[index] = '\0';
-        printf("LoRa: 📝 Partial line returned: '%s' (len=%d)\n", line, index);
-        return true; // Return partial line if buffer runs out
+        // Bytes stay in the ring until their terminator arrives, and are searched only once
+        uint32_t length = spsc_ring_peek_until(ring, '\n', &buffer->scanned);
+        if (length == 0)
+        {
+            if (buffer->scanned < (uint32_t)(max_len - 1))
+            {
+                LOG(LORA, TRACE, "LoRa: ❌ No complete line available\n");
+                return false; // No complete line available
+            }
+
+            // An unterminated run as long as the caller's buffer is handed out as it stands
+            length = max_len - 1;
+            buffer->scanned = 0;
+        }
+
+        // Over-long lines are truncated; the rest is dropped up to the terminator
+        uint32_t taken = spsc_ring_read(ring, line, MIN(length, (uint32_t)(max_len - 1)));
+        spsc_ring_consume(ring, length - taken);
+
+        while (taken > 0 && (line[taken - 1] == '\n' || line[taken - 1] == '\r'))
+        {
+            taken--;
+        }
+        line[taken] = '\0';
+
+        if (taken > 0)
+        {
+            LOG(LORA, TRACE, "LoRa: 📝 Complete line found: '%s' (len=%lu)\n", line, (unsigned long)taken);
+            return true; // Complete line found
+        }
+
+        // Skip empty lines (consecutive \r\n)
+        LOG(LORA, TRACE, "LoRa: Skipping empty line\n");
     }
+}
+
+#ifdef LORA_BENCH
+// Private ring for the benchmark image, so the live ring is never touched
+static char bench_storage[UART_RX_BUFFER_SIZE];
+static uart_rx_buffer_t bench_ring;
+
+void lora_bench_ring_reset(void)
+{
+    uart_buffer_init(&bench_ring, bench_storage, UART_RX_BUFFER_SIZE);
+}
+
+uint16_t lora_bench_ring_fill(const char *data, uint16_t length)
+{
+    return (uint16_t)spsc_ring_write(&bench_ring.ring, data, length);
+}
+
+uint16_t lora_bench_ring_drain(char *out, uint16_t max_len)
+{
+    return (uint16_t)spsc_ring_read(&bench_ring.ring, out, max_len);
+}
 
-    printf("LoRa: ❌ No complete line available\n");
-    return false; // No complete line available
+bool lora_bench_ring_get_line(char *line, uint16_t max_len)
+{
+    return uart_buffer_get_line(&bench_ring, line, max_len);
 }
+#endif
 
 // UART interrupt handler
-static void uart_rx_interrupt_handler()
+static void uart_interrupt_handler()
 {
     uart_inst_t *uart = internal_state.config->uart;
-    static uint32_t interrupt_count = 0;
+    volatile uint32_t *rx_bytes = &internal_state.stats.rx_bytes;
+
+    // Refill the TX FIFO from the transmit ring
+    if (uart_get_hw(uart)->mis & UART_UARTMIS_TXMIS_BITS)
+    {
+        uart_tx_kick(internal_state.config);
+    }
 
-    // Read all available characters
+    // Read all available characters - never format text in here
     while (uart_is_readable(uart))
     {
         char c = uart_getc(uart);
-        interrupt_count++;
+        uint32_t count = ++*rx_bytes;
 
-        // Debug: Print first few interrupts to confirm they're working
-        if (interrupt_count <= 10 || (interrupt_count % 100) == 0)
+        // Debug: Record first few interrupts to confirm they're working
+        if (count <= 10 || (count % 100) == 0)
         {
-            printf("LoRa: UART interrupt #%lu received char: 0x%02X (%c)\n",
-                   interrupt_count, (unsigned char)c, (c >= 32 && c <= 126) ? c : '.');
+            LOG_DEFER(LORA, TRACE, "LoRa: UART interrupt #%lu received char: 0x%02lX\n",
+                      count, (unsigned char)c);
         }
 
-        // Store in circular buffer
-        if (!uart_buffer_put(&internal_state.uart_buffer, c))
+        // Keep emptying the FIFO when the ring is full, or the interrupt would fire forever;
+        // demux_lines() counts and reports the overflow
+        if (!spsc_ring_push(&internal_state.uart_buffer.ring, &c) && !internal_state.uart_buffer.overflow)
         {
-            printf("LoRa: UART buffer overflow at interrupt #%lu!\n", interrupt_count);
-            break;
+            internal_state.uart_buffer.overflow = true;
+            LOG_DEFER(LORA, WARN, "LoRa: UART buffer overflow at byte #%lu!\n", count, 0);
         }
     }
 }
+#endif
 
 // Button control functions for transmitter mode
 
+static void button_press(button_t *button)
+{
+    TRACE_MARK(TRACE_BUTTON);
+
+    lora_button_event_t event = {button->pin, time_us_32()};
+    if (!spsc_ring_push(&button_irq.events, &event))
+    {
+        button_irq.dropped++;
+    }
+
+    // The pin stays disarmed until the button has been released long enough
+    button->released_for = 0;
+    if (add_alarm_in_ms(LORA_BUTTON_SAMPLE_MS, button_debounce_callback, button, true) < 0)
+    {
+        gpio_set_irq_enabled(button->pin, GPIO_IRQ_EDGE_FALL, true); // No alarm slot - never lose the button
+    }
+}
+
+// Debounce timer - samples a pressed button until it has read released for long enough
+static int64_t button_debounce_callback(alarm_id_t id, void *user_data)
+{
+    button_t *button = (button_t *)user_data;
+
+    if (!gpio_get(button->pin))
+    {
+        button->released_for = 0; // Still held, or bouncing
+        return LORA_BUTTON_SAMPLE_MS * 1000;
+    }
+
+    button->released_for++;
+    if (button->released_for * LORA_BUTTON_SAMPLE_MS < LORA_BUTTON_DEBOUNCE_MS)
+    {
+        return LORA_BUTTON_SAMPLE_MS * 1000;
+    }
+
+    gpio_edge_arm(button->pin);
+    return 0;
+}
+
 void lora_button_init(button_t *button, uint pin)
 {
     if (!button)
@@ -744,13 +2445,14 @@ void lora_button_init(button_t *button, uint pin)
     button->pin = pin;
     button->last_state = true; // Released state (pulled high)
     button->last_time = 0;
+    button->released_for = 0;
 
     // Initialize GPIO with internal pull-up
     gpio_init(pin);
     gpio_set_dir(pin, GPIO_IN);
     gpio_pull_up(pin); // Enable internal pull-up resistor
 
-    printf("Button: Initialized pin %d with internal pull-up\n", pin);
+    LOG(LORA, INFO, "Button: Initialized pin %d with internal pull-up\n", pin);
 }
 
 bool lora_button_pressed(button_t *button)
@@ -784,7 +2486,37 @@ void lora_buttons_init_all(button_t buttons[2])
     lora_button_init(&buttons[0], 2); // Button 1 - ON
     lora_button_init(&buttons[1], 3); // Button 2 - OFF
 
-    printf("Button: 2 buttons initialized with internal pull-ups\n");
+    LOG(LORA, INFO, "Button: 2 buttons initialized with internal pull-ups\n");
+}
+
+bool lora_button_enable_irq(button_t *button)
+{
+    if (!button || button_irq.count >= LORA_BUTTON_MAX_IRQ)
+    {
+        return false;
+    }
+
+    button_irq.buttons[button_irq.count++] = button;
+    gpio_edge_arm(button->pin);
+
+    LOG(LORA, INFO, "Button: Pin %d reports presses by interrupt\n", button->pin);
+    return true;
+}
+
+bool lora_button_get_event(lora_button_event_t *event)
+{
+    if (!event)
+    {
+        return false;
+    }
+
+    if (button_irq.dropped > 0)
+    {
+        LOG(LORA, WARN, "Button: ⚠️ %lu presses dropped (event queue full)\n", (unsigned long)button_irq.dropped);
+        button_irq.dropped = 0;
+    }
+
+    return spsc_ring_pop(&button_irq.events, event);
 }
 
 // Public wrapper for AT command sending (for diagnostics)
@@ -17,6 +17,8 @@
  * Compile-time Configuration:
  * - Define LORA_TRANSMITTER_MODE for button-controlled transmitter
  * - Define LORA_RECEIVER_MODE for stepper motor controller (default)
+ * - Define LORA_UART_DMA to receive by DMA into a ring instead of per-byte interrupts
+ * - Define LORA_DEFAULT_PROFILE to pick the radio profile applied at init
  *
  * Hardware Requirements:
  * - RYLR998 LoRa module
@@ -54,6 +56,18 @@
  */
 #define LORA_MAX_MESSAGE_LENGTH 240
 
+/**
+ * @brief Receive line buffer size: the longest +RCV line, its CR LF and the NUL
+ *
+ * The payload is framed by at most "+RCV=65535,240," and ",-164,-20".
+ */
+#define LORA_RX_LINE_SIZE (LORA_MAX_MESSAGE_LENGTH + 24 + 3)
+
+/**
+ * @brief Destination address every module receives
+ */
+#define LORA_BROADCAST_ADDRESS 65535
+
 /**
  * @brief Maximum length for AT command responses
  */
@@ -74,6 +88,70 @@
  */
 #define LORA_RESPONSE_TIMEOUT_MS 1000
 
+/**
+ * @brief Longest wait for the module to answer AT after power-up, in milliseconds
+ */
+#define LORA_BOOT_WAIT_MS 1000
+
+/**
+ * @brief Timeout of each AT probe while waiting for the module, in milliseconds
+ */
+#define LORA_PROBE_TIMEOUT_MS 100
+
+/**
+ * @brief Preamble length (symbols) sent with AT+PARAMETER
+ */
+#define LORA_PREAMBLE_LENGTH 8
+
+/**
+ * @brief Number of received +RCV frames buffered until the application reads them (power of two)
+ */
+#define LORA_RX_QUEUE_DEPTH 4
+
+/**
+ * @brief Received-message buffers shared by the inbound queue and the handlers (power of two)
+ *
+ * Covers the queued frames plus any a handler keeps with lora_message_keep().
+ */
+#ifndef LORA_MESSAGE_POOL_DEPTH
+#define LORA_MESSAGE_POOL_DEPTH 8
+#endif
+
+/**
+ * @brief Maximum number of asynchronous AT commands queued at once
+ */
+#define LORA_AT_QUEUE_DEPTH 8
+
+/**
+ * @brief Handle value returned when an asynchronous command could not be queued
+ */
+#define LORA_AT_INVALID_HANDLE (-1)
+
+/**
+ * @brief Reliable mode: frames that may wait for their acknowledgment at once
+ */
+#define LORA_RELIABLE_DEPTH 4
+
+/**
+ * @brief Reliable mode: peers whose sequence numbers and duplicate window are tracked
+ */
+#define LORA_RELIABLE_PEERS 4
+
+/**
+ * @brief Reliable mode: acknowledgment payload length assumed for the retransmit timeout
+ */
+#define LORA_RELIABLE_ACK_LENGTH 8
+
+/**
+ * @brief Reliable mode: peer time from receiving a frame to sending its acknowledgment (ms)
+ */
+#define LORA_RELIABLE_TURNAROUND_MS 150
+
+/**
+ * @brief Reliable mode: longest reply kept so a duplicate can be answered again
+ */
+#define LORA_RELIABLE_REPLY_MAX 16
+
 /**
  * @brief LoRa module status enumeration
  */
@@ -84,7 +162,9 @@ typedef enum
     LORA_STATUS_TIMEOUT,         ///< Command timeout
     LORA_STATUS_INVALID_PARAM,   ///< Invalid parameter
     LORA_STATUS_NOT_INITIALIZED, ///< Module not initialized
-    LORA_STATUS_UART_ERROR       ///< UART communication error
+    LORA_STATUS_UART_ERROR,      ///< UART communication error
+    LORA_STATUS_PENDING,         ///< Asynchronous command not finished yet
+    LORA_STATUS_BUSY             ///< Command queue full
 } lora_status_t;
 
 /**
@@ -138,6 +218,22 @@ typedef enum
     LORA_CR_4_8 = 4  ///< 4/8
 } lora_coding_rate_t;
 
+/**
+ * @brief Named radio-parameter profiles (both ends must use the same one)
+ */
+typedef enum
+{
+    LORA_PROFILE_LOW_LATENCY = 0, ///< SF7 / 500 kHz / 4/5 - shortest airtime
+    LORA_PROFILE_BALANCED,        ///< SF9 / 125 kHz / 4/5 - module default
+    LORA_PROFILE_LONG_RANGE,      ///< SF9 / 125 kHz / 4/8 - strongest the module allows at 125 kHz
+    LORA_PROFILE_COUNT
+} lora_profile_t;
+
+// Profile applied by lora_init_custom(), normally provided by CMake
+#ifndef LORA_DEFAULT_PROFILE
+#define LORA_DEFAULT_PROFILE LORA_PROFILE_BALANCED
+#endif
+
 /**
  * @brief LoRa module configuration structure
  */
@@ -162,20 +258,104 @@ typedef struct
  */
 typedef struct
 {
-    uint16_t sender_address;               ///< Sender address
-    uint8_t rssi;                          ///< Signal strength (RSSI)
-    uint8_t payload_length;                ///< Message payload length
-    char payload[LORA_MAX_MESSAGE_LENGTH]; ///< Message payload
+    uint16_t sender_address;                   ///< Sender address
+    uint8_t rssi;                              ///< Signal strength (RSSI magnitude, dBm)
+    int8_t snr;                                ///< Signal-to-noise ratio (dB)
+    uint8_t payload_length;                    ///< Message payload length
+    char payload[LORA_MAX_MESSAGE_LENGTH + 1]; ///< Message payload (NUL-terminated)
 } lora_message_t;
 
+/**
+ * @brief Parsed +RCV frame referring into the line it was parsed from
+ *
+ * The payload is not NUL-terminated and is only valid while the source line is.
+ */
+typedef struct
+{
+    const char *payload;     ///< First payload byte inside the source line
+    uint8_t payload_length;  ///< Declared payload length
+    uint16_t sender_address; ///< Sender address
+    int16_t rssi;            ///< Signal strength (dBm, negative)
+    int8_t snr;              ///< Signal-to-noise ratio (dB, 0 if not reported)
+} lora_frame_view_t;
+
+/**
+ * @brief Low-power receive counters kept by lora_wait_for_rx()
+ */
+typedef struct
+{
+    uint32_t sleeps;           ///< Times the core slept waiting for the radio
+    uint32_t rx_wakes;         ///< Sleeps ended by an edge on the RX pin
+    uint32_t measured;         ///< RX wakes that reached the message handler
+    uint32_t last_latency_us;  ///< Most recent RX edge to message handler latency
+    uint32_t max_latency_us;   ///< Worst RX edge to message handler latency
+    uint64_t total_latency_us; ///< Sum of measured latencies, for the average
+} lora_wake_stats_t;
+
+/**
+ * @brief Driver counters since lora_init_custom(), read with lora_get_stats()
+ */
+typedef struct
+{
+    uint32_t rx_bytes;        ///< Bytes received from the module
+    uint32_t rx_overflows;    ///< Times received bytes were lost to a full receive ring
+    uint32_t lines;           ///< Lines parsed out of the receive ring
+    uint32_t frames;          ///< +RCV frames parsed and queued
+    uint32_t malformed;       ///< +RCV lines that failed to parse
+    uint32_t inbound_dropped; ///< Frames lost to a full inbound queue
+    uint32_t at_timeouts;     ///< AT commands the module never answered
+    uint32_t at_retries;      ///< AT commands queued again after the queue was full
+    uint32_t retransmits;     ///< Reliable frames sent again after no acknowledgment
+    uint32_t duplicates;      ///< Reliable frames received again and not re-applied
+    int16_t rssi_min;         ///< Weakest RSSI of a parsed frame (dBm)
+    int16_t rssi_max;         ///< Strongest RSSI of a parsed frame (dBm)
+    int32_t rssi_total;       ///< Sum of frame RSSI, for the average
+    int8_t snr_min;           ///< Lowest SNR of a parsed frame (dB)
+    int8_t snr_max;           ///< Highest SNR of a parsed frame (dB)
+    int32_t snr_total;        ///< Sum of frame SNR, for the average
+} lora_stats_t;
+
+/**
+ * @brief Completion callback for a frame sent with lora_reliable_send()
+ *
+ * Called from lora_process_messages() once the peer acknowledged the frame
+ * or every retransmission went unanswered.
+ *
+ * @param status LORA_STATUS_OK if acknowledged, LORA_STATUS_TIMEOUT if not
+ * @param sequence Sequence number of the frame
+ * @param attempts Transmissions made, the first one included
+ * @param user_data User-defined data pointer
+ */
+typedef void (*lora_reliable_callback_t)(lora_status_t status, uint8_t sequence, uint8_t attempts, void *user_data);
+
 /**
  * @brief Message handler callback function type
  *
+ * The message is valid until the handler returns, unless the handler takes
+ * it over with lora_message_keep().
+ *
  * @param message Pointer to received message structure
  * @param user_data User-defined data pointer
  */
 typedef void (*lora_message_handler_t)(const lora_message_t *message, void *user_data);
 
+/**
+ * @brief Completion callback for asynchronous AT commands
+ *
+ * Called from lora_process_messages() once the module answered or the
+ * command timed out. Must not call the blocking (synchronous) AT functions.
+ *
+ * @param status LORA_STATUS_OK, LORA_STATUS_ERROR (+ERR reply) or LORA_STATUS_TIMEOUT
+ * @param response Response line from the module (empty on timeout)
+ * @param user_data User-defined data pointer
+ */
+typedef void (*lora_at_callback_t)(lora_status_t status, const char *response, void *user_data);
+
+/**
+ * @brief Handle identifying a queued asynchronous AT command
+ */
+typedef int16_t lora_at_handle_t;
+
 // Function declarations
 
 /**
@@ -207,6 +387,39 @@ lora_status_t lora_init_custom(lora_config_t *config, uart_inst_t *uart_inst,
                                uint16_t device_address, uint32_t frequency,
                                lora_power_t power);
 
+/**
+ * @brief Initialize the LoRa module at a known baud rate, skipping settings it already holds
+ *
+ * Same as lora_init_custom(), but opens the UART at baud_rate and, when
+ * module_hash equals lora_config_hash() of the requested settings, trusts
+ * the module's saved settings instead of sending them again. Either way it
+ * waits only until the module answers AT, at most LORA_BOOT_WAIT_MS.
+ *
+ * @param config Pointer to LoRa configuration structure
+ * @param uart_inst UART instance to use
+ * @param tx_pin GPIO pin for UART TX
+ * @param rx_pin GPIO pin for UART RX
+ * @param network_id Network ID
+ * @param device_address Device address
+ * @param frequency Frequency in Hz
+ * @param power Transmission power
+ * @param baud_rate UART baud rate the module last answered on
+ * @param module_hash lora_config_hash() of the settings last given to the module (0 = unknown)
+ * @return lora_status_t LORA_STATUS_OK, or LORA_STATUS_TIMEOUT if the module never answered
+ */
+lora_status_t lora_init_cached(lora_config_t *config, uart_inst_t *uart_inst,
+                               uint tx_pin, uint rx_pin, uint16_t network_id,
+                               uint16_t device_address, uint32_t frequency,
+                               lora_power_t power, uint baud_rate, uint32_t module_hash);
+
+/**
+ * @brief Hash of the radio settings the module holds (network, address, band, power, parameters)
+ *
+ * @param config Pointer to LoRa configuration structure
+ * @return uint32_t Non-zero FNV-1a hash
+ */
+uint32_t lora_config_hash(const lora_config_t *config);
+
 /**
  * @brief Test if LoRa module is responding
  *
@@ -240,11 +453,61 @@ lora_status_t lora_broadcast_message(lora_config_t *config, const char *message,
 /**
  * @brief Check for received messages (non-blocking)
  *
+ * Frames are taken from the inbound queue in arrival order. Frames that
+ * arrive while an AT command is in flight are queued, not discarded. The
+ * returned buffer comes from the message pool and is not copied; hand it
+ * back with lora_message_release() once done with it.
+ *
  * @param config Pointer to LoRa configuration structure
- * @param message Pointer to message structure to fill
- * @return lora_status_t Status of reception
+ * @param message Pointer to store the received message (owned by the caller)
+ * @return lora_status_t LORA_STATUS_OK if a message was returned, LORA_STATUS_ERROR if none is waiting
+ */
+lora_status_t lora_receive_message(lora_config_t *config, lora_message_t **message);
+
+/**
+ * @brief Take a free buffer from the message pool
+ *
+ * The receive path fills its frames from the same pool, so call this from
+ * core 0 (the radio side) only.
+ *
+ * @return lora_message_t* Buffer owned by the caller, or NULL if every buffer is in use
+ */
+lora_message_t *lora_message_acquire(void);
+
+/**
+ * @brief Return a buffer to the message pool
+ *
+ * Safe from either core, so a message handed to core 1 can be released there.
+ *
+ * @param message Buffer from lora_message_acquire(), lora_receive_message() or
+ *                lora_message_keep() (NULL is ignored)
  */
-lora_status_t lora_receive_message(lora_config_t *config, lora_message_t *message);
+void lora_message_release(lora_message_t *message);
+
+/**
+ * @brief Keep the message being handled after the handler returns
+ *
+ * Call only from inside the message handler. Without it the buffer goes
+ * back to the pool as soon as the handler returns.
+ *
+ * @param message Message passed to the handler
+ * @return lora_message_t* The same buffer, now owned by the caller, or NULL if
+ *         message is not the one being handled
+ */
+lora_message_t *lora_message_keep(const lora_message_t *message);
+
+/**
+ * @brief Parse a +RCV line in a single pass without copying the payload
+ *
+ * Format: +RCV=<address>,<length>,<data>,<rssi>,<snr>. The declared length
+ * is authoritative, so payloads may contain commas. The SNR field is optional.
+ *
+ * @param line Received line (need not be NUL-terminated)
+ * @param line_length Number of characters in the line
+ * @param view Pointer to the view to fill
+ * @return true if the line is a well-formed +RCV frame, false otherwise
+ */
+bool lora_parse_rcv(const char *line, uint16_t line_length, lora_frame_view_t *view);
 
 /**
  * @brief Set message handler callback for automatic message processing
@@ -259,6 +522,10 @@ lora_status_t lora_set_message_handler(lora_config_t *config, lora_message_handl
 /**
  * @brief Process incoming messages (call this regularly in main loop)
  *
+ * Routes every complete line from the UART: +RCV frames go to the inbound
+ * queue and are handed to the message handler, all other lines complete the
+ * AT command in flight.
+ *
  * @param config Pointer to LoRa configuration structure
  * @return lora_status_t Status of processing
  */
@@ -279,6 +546,78 @@ lora_status_t lora_configure(lora_config_t *config, uint32_t frequency,
                              lora_power_t power, lora_spreading_factor_t sf,
                              lora_bandwidth_t bandwidth, lora_coding_rate_t coding_rate);
 
+/**
+ * @brief Change the module's device address (AT+ADDRESS)
+ *
+ * Commands already queued, such as an acknowledgment, are sent from the
+ * old address first. Blocks for the reply.
+ *
+ * @param config Pointer to LoRa configuration structure
+ * @param address New device address (not LORA_BROADCAST_ADDRESS)
+ * @return lora_status_t Status of operation
+ */
+lora_status_t lora_set_address(lora_config_t *config, uint16_t address);
+
+/**
+ * @brief Switch the module and the UART to another baud rate
+ *
+ * Sends AT+IPR, retunes the UART once the module has answered at the old
+ * rate, then checks that AT is answered at the new one. If it is not, the
+ * UART goes back to the old rate. The module keeps the rate across power
+ * cycles.
+ *
+ * @param config Pointer to LoRa configuration structure
+ * @param baud_rate New rate (one the RYLR998 supports, see lora_is_valid_baud_rate())
+ * @return lora_status_t LORA_STATUS_OK if the module answers at the new rate
+ */
+lora_status_t lora_set_baud_rate(lora_config_t *config, uint baud_rate);
+
+/**
+ * @brief Check whether the RYLR998 supports a UART baud rate
+ *
+ * @param baud_rate Rate to check
+ * @return true if AT+IPR accepts it, false otherwise
+ */
+bool lora_is_valid_baud_rate(uint baud_rate);
+
+/**
+ * @brief Apply a named radio profile, keeping frequency and power
+ *
+ * @param config Pointer to LoRa configuration structure
+ * @param profile Profile to apply
+ * @return lora_status_t Status of configuration
+ */
+lora_status_t lora_apply_profile(lora_config_t *config, lora_profile_t profile);
+
+/**
+ * @brief Get the name of a radio profile
+ *
+ * @param profile Profile
+ * @return const char* Profile name (e.g. "LOW_LATENCY"), or "UNKNOWN"
+ */
+const char *lora_profile_name(lora_profile_t profile);
+
+/**
+ * @brief Look up a radio profile by name (case insensitive)
+ *
+ * @param name Profile name
+ * @param profile Pointer to store the profile
+ * @return true if the name matched a profile, false otherwise
+ */
+bool lora_profile_from_name(const char *name, lora_profile_t *profile);
+
+/**
+ * @brief Compute the airtime of one packet with the current radio parameters
+ *
+ * Uses the Semtech LoRa airtime formula with explicit header, CRC on, the
+ * configured preamble and low-data-rate optimization when symbols exceed 16 ms.
+ *
+ * @param config Pointer to LoRa configuration structure
+ * @param payload_len Payload length in bytes
+ * @return uint32_t Time on air in microseconds
+ */
+uint32_t lora_time_on_air_us(const lora_config_t *config, uint8_t payload_len);
+
 /**
  * @brief Reset the LoRa module
  *
@@ -308,6 +647,154 @@ lora_status_t lora_get_version(lora_config_t *config, char *version, uint8_t max
  */
 lora_status_t lora_send_at_command(lora_config_t *config, const char *command, char *response, uint8_t max_response_len);
 
+/**
+ * @brief Queue an AT command without waiting for the response
+ *
+ * Commands are sent one after another, in submission order, as soon as the
+ * previous one is answered. The queue is driven by lora_process_messages().
+ * With a callback the slot is released after the callback runs; without one
+ * the result is kept until lora_at_poll() collects it.
+ *
+ * @param config Pointer to LoRa configuration structure
+ * @param command AT command to send (without line ending)
+ * @param callback Completion callback, or NULL to poll the handle instead
+ * @param user_data User data to pass to callback
+ * @return lora_at_handle_t Handle for lora_at_poll(), or LORA_AT_INVALID_HANDLE if the queue is full
+ */
+lora_at_handle_t lora_send_at_command_async(lora_config_t *config, const char *command,
+                                            lora_at_callback_t callback, void *user_data);
+
+/**
+ * @brief Send a message without waiting for the module's acknowledgment
+ *
+ * @param config Pointer to LoRa configuration structure
+ * @param address Target device address
+ * @param message Message to send
+ * @param length Message length
+ * @param callback Completion callback, or NULL to poll the handle instead
+ * @param user_data User data to pass to callback
+ * @return lora_at_handle_t Handle for lora_at_poll(), or LORA_AT_INVALID_HANDLE on error
+ */
+lora_at_handle_t lora_send_message_async(lora_config_t *config, uint16_t address,
+                                         const char *message, uint8_t length,
+                                         lora_at_callback_t callback, void *user_data);
+
+#ifdef LORA_RELIABLE
+/**
+ * @brief Take the next sequence number for frames to a peer
+ *
+ * Each peer's numbers start at a random value, so a restarted sender is
+ * not mistaken for duplicates of its previous run.
+ *
+ * @param address Peer address
+ * @return uint8_t Sequence number to carry in the frame
+ */
+uint8_t lora_reliable_next_sequence(uint16_t address);
+
+/**
+ * @brief Send a frame and retransmit it until the peer acknowledges it
+ *
+ * The payload is copied. Once the module reports the frame on air, the
+ * driver waits the acknowledgment's airtime plus LORA_RELIABLE_TURNAROUND_MS,
+ * doubling the wait with random jitter on each of up to MAX_RETRY_COUNT
+ * retransmissions. Only unacknowledged frames are sent again. The owner
+ * matches replies with lora_reliable_ack(); lora_wait_for_rx() wakes when a
+ * retransmission falls due.
+ *
+ * @param config Pointer to LoRa configuration structure
+ * @param address Peer address (not the broadcast address)
+ * @param sequence Sequence number the frame carries, from lora_reliable_next_sequence()
+ * @param payload Frame to send
+ * @param length Frame length
+ * @param callback Completion callback (may be NULL)
+ * @param user_data User data to pass to callback
+ * @return lora_status_t LORA_STATUS_OK if accepted, LORA_STATUS_BUSY if LORA_RELIABLE_DEPTH frames are waiting
+ */
+lora_status_t lora_reliable_send(lora_config_t *config, uint16_t address, uint8_t sequence,
+                                 const char *payload, uint8_t length,
+                                 lora_reliable_callback_t callback, void *user_data);
+
+/**
+ * @brief Match an acknowledgment to a frame waiting for it
+ *
+ * @param address Peer that sent the acknowledgment
+ * @param sequence Sequence number it acknowledges
+ * @return bool True if a waiting frame was completed, false if none matched (late or repeated ack)
+ */
+bool lora_reliable_ack(uint16_t address, uint8_t sequence);
+
+/**
+ * @brief Check a received frame's sequence number against the peer's recent ones
+ *
+ * Keeps a window of the last 32 sequence numbers per peer, so frames that
+ * arrive out of order are still accepted once.
+ *
+ * @param address Peer that sent the frame
+ * @param sequence Sequence number the frame carries
+ * @return bool True the first time a sequence number is seen, false for a duplicate
+ */
+bool lora_reliable_accept(uint16_t address, uint8_t sequence);
+
+/**
+ * @brief Forget a peer's duplicate window and cached replies
+ *
+ * Call when the peer announces a restart.
+ *
+ * @param address Peer address
+ */
+void lora_reliable_reset_peer(uint16_t address);
+
+/**
+ * @brief Send the reply to a frame and keep it for answering a duplicate
+ *
+ * The last LORA_RELIABLE_DEPTH replies per peer are kept; longer than
+ * LORA_RELIABLE_REPLY_MAX bytes are sent but not kept.
+ *
+ * @param config Pointer to LoRa configuration structure
+ * @param address Peer address
+ * @param sequence Sequence number of the frame being answered
+ * @param payload Reply to send
+ * @param length Reply length
+ * @param callback Completion callback, as for lora_send_message_async()
+ * @param user_data User data to pass to callback
+ * @return lora_at_handle_t Handle of the queued send, or LORA_AT_INVALID_HANDLE on error
+ */
+lora_at_handle_t lora_reliable_reply(lora_config_t *config, uint16_t address, uint8_t sequence,
+                                     const char *payload, uint8_t length,
+                                     lora_at_callback_t callback, void *user_data);
+
+/**
+ * @brief Send the kept reply to a frame again
+ *
+ * @param config Pointer to LoRa configuration structure
+ * @param address Peer address
+ * @param sequence Sequence number of the duplicate frame
+ * @return bool True if the reply was kept and queued, false otherwise
+ */
+bool lora_reliable_repeat_reply(lora_config_t *config, uint16_t address, uint8_t sequence);
+#endif
+
+/**
+ * @brief Poll an asynchronous AT command queued without a callback
+ *
+ * Returns LORA_STATUS_PENDING until the command finished. The final status
+ * is returned exactly once; the handle is invalid afterwards.
+ *
+ * @param handle Handle returned by lora_send_at_command_async()
+ * @param response Buffer to store the response (may be NULL)
+ * @param max_response_len Maximum length of response buffer
+ * @return lora_status_t LORA_STATUS_PENDING, the command's final status, or LORA_STATUS_INVALID_PARAM
+ */
+lora_status_t lora_at_poll(lora_at_handle_t handle, char *response, uint8_t max_response_len);
+
+/**
+ * @brief Block until every queued asynchronous AT command has finished
+ *
+ * @param config Pointer to LoRa configuration structure
+ * @return lora_status_t Status of operation
+ */
+lora_status_t lora_at_flush(lora_config_t *config);
+
 /**
  * @brief Put LoRa module into sleep mode
  *
@@ -324,6 +811,62 @@ lora_status_t lora_sleep(lora_config_t *config);
  */
 lora_status_t lora_wake(lora_config_t *config);
 
+/**
+ * @brief Put the module into smart receiving power saving mode (AT+MODE=2)
+ *
+ * The module alternates rx_ms of listening with sleep_ms asleep, so a
+ * transmitter must repeat a command for longer than sleep_ms to be heard.
+ * lora_wake() returns it to continuous receive. Blocks for the reply.
+ *
+ * @param config Pointer to LoRa configuration structure
+ * @param rx_ms Listening window in milliseconds (30-60000)
+ * @param sleep_ms Sleep window in milliseconds (30-60000)
+ * @return lora_status_t Status of operation
+ */
+lora_status_t lora_set_smart_receive(lora_config_t *config, uint16_t rx_ms, uint16_t sleep_ms);
+
+/**
+ * @brief Check that the driver has nothing left to do until the radio talks
+ *
+ * True when no AT command is queued or in flight, no received bytes are
+ * waiting to be parsed and no frame is waiting for the message handler.
+ *
+ * @param config Pointer to LoRa configuration structure
+ * @return true if idle, false otherwise
+ */
+bool lora_is_idle(const lora_config_t *config);
+
+/**
+ * @brief Sleep the calling core until the radio sends something
+ *
+ * Waits in WFE with a falling-edge interrupt armed on the RX pin, so the
+ * start bit of the next byte wakes the core while the UART (and the DMA
+ * ring) keeps receiving; no byte is lost. Other interrupts, button presses
+ * and SEV also end the wait. Returns at once if the driver is not idle or
+ * a button press is queued. With LORA_RELIABLE the sleep also ends when a
+ * retransmission falls due. The time from the
+ * waking edge to the message handler is recorded in lora_wake_stats_t.
+ *
+ * @param config Pointer to LoRa configuration structure
+ * @param timeout_us Longest sleep in microseconds (0 = until an event)
+ * @return true if the RX pin ended the sleep, false otherwise
+ */
+bool lora_wait_for_rx(lora_config_t *config, uint32_t timeout_us);
+
+/**
+ * @brief Copy the low-power receive counters
+ *
+ * @param stats Pointer to store the counters
+ */
+void lora_get_wake_stats(lora_wake_stats_t *stats);
+
+/**
+ * @brief Copy the driver counters
+ *
+ * @param stats Pointer to store the counters
+ */
+void lora_get_stats(lora_stats_t *stats);
+
 /**
  * @brief Check if a message contains "ON" command
  *
@@ -342,16 +885,46 @@ bool lora_is_off_command(const char *message);
 
 // Button control functions for transmitter mode
 
+/**
+ * @brief Maximum number of buttons reporting presses by interrupt
+ */
+#define LORA_BUTTON_MAX_IRQ 4
+
+/**
+ * @brief Button presses the event queue holds (power of two)
+ */
+#define LORA_BUTTON_EVENT_DEPTH 8
+
+/**
+ * @brief How long a button must read released before it can fire again (ms)
+ */
+#define LORA_BUTTON_DEBOUNCE_MS 50
+
+/**
+ * @brief Debounce sampling period of a pressed button (ms)
+ */
+#define LORA_BUTTON_SAMPLE_MS 10
+
 /**
  * @brief Button configuration structure
  */
 typedef struct
 {
-    uint pin;           ///< GPIO pin number
-    bool last_state;    ///< Last button state
-    uint32_t last_time; ///< Last debounce time
+    uint pin;                      ///< GPIO pin number
+    bool last_state;               ///< Last button state
+    uint32_t last_time;            ///< Last debounce time
+    volatile uint8_t released_for; ///< Consecutive released samples while debouncing (IRQ mode)
 } button_t;
 
+/**
+ * @brief Button press reported by the edge interrupt
+ */
+typedef struct
+{
+    uint pin;         ///< GPIO pin of the pressed button
+    uint32_t time_us; ///< time_us_32() at the press edge
+} lora_button_event_t;
+
 /**
  * @brief Initialize button with internal pull-up resistor
  *
@@ -375,4 +948,65 @@ bool lora_button_pressed(button_t *button);
  */
 void lora_buttons_init_all(button_t buttons[2]);
 
+/**
+ * @brief Report a button's presses by interrupt instead of polling
+ *
+ * The falling edge queues a lora_button_event_t at once and disarms the
+ * pin; a timer re-arms it after the button has read released for
+ * LORA_BUTTON_DEBOUNCE_MS, so contact bounce on press and release is
+ * ignored. The edge also ends lora_wait_for_rx(), so the caller may sleep
+ * between presses. Do not mix with lora_button_pressed() on the same button.
+ *
+ * @param button Pointer to a button set up by lora_button_init()
+ * @return bool True if armed, false if LORA_BUTTON_MAX_IRQ buttons are already armed
+ */
+bool lora_button_enable_irq(button_t *button);
+
+/**
+ * @brief Take the oldest queued button press
+ *
+ * @param event Pointer to store the press
+ * @return bool True if a press was returned, false if none are queued
+ */
+bool lora_button_get_event(lora_button_event_t *event);
+
+#if defined(LORA_BENCH) && !defined(LORA_UART_DMA)
+/**
+ * @brief Empty the benchmark receive ring
+ *
+ * The lora_bench_ring_*() functions drive the interrupt-path ring code on
+ * a private ring, never the live one, so the LoRa_bench image can time it
+ * without a module attached. They share the line assembly buffer with the
+ * driver and must not be used after lora_init().
+ */
+void lora_bench_ring_reset(void);
+
+/**
+ * @brief Store bytes in the benchmark ring as the UART interrupt would
+ *
+ * @param data Bytes to store
+ * @param length Number of bytes
+ * @return uint16_t Bytes stored before the ring filled
+ */
+uint16_t lora_bench_ring_fill(const char *data, uint16_t length);
+
+/**
+ * @brief Take bytes from the benchmark ring one at a time
+ *
+ * @param out Buffer receiving the bytes
+ * @param max_len Size of the buffer
+ * @return uint16_t Bytes taken
+ */
+uint16_t lora_bench_ring_drain(char *out, uint16_t max_len);
+
+/**
+ * @brief Assemble the next line from the benchmark ring
+ *
+ * @param line Buffer receiving the NUL-terminated line
+ * @param max_len Size of the buffer
+ * @return bool True if a complete line was returned
+ */
+bool lora_bench_ring_get_line(char *line, uint16_t max_len);
+#endif
+
 #endif // LORA_H
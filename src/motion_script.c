@@ -0,0 +1,216 @@
+/**
+ * @file motion_script.c
+ * @brief On-device motion script player implementation
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This source file implements the motion script player. Each step is
+ * issued as absolute moves, so a paused step is resumed by issuing it
+ * again, and arrival is read from the step engine's queued step counts.
+ * With the blocking GPIO backend the moves complete while they are issued.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#include "motion_script.h"
+#include "log.h"
+
+// Forward declarations
+static void motion_script_issue(motion_script_player_t *player, const motion_script_step_t *step);
+static bool motion_script_arrived(const motion_script_player_t *player, uint8_t mask);
+static void motion_script_hold(motion_script_player_t *player);
+
+void motion_script_init(motion_script_player_t *player, stepper_motor_t *motors, uint num_motors)
+{
+    *player = (motion_script_player_t){.motors = motors, .num_motors = num_motors};
+}
+
+void motion_script_load(motion_script_player_t *player, const motion_script_t *script)
+{
+    motion_script_abort(player);
+    player->script = script;
+    LOG(RUN, INFO, "Motion: Script loaded (%d steps)\n", script ? script->count : 0);
+}
+
+bool motion_script_start(motion_script_player_t *player, uint8_t repeat)
+{
+    if (player->script == NULL || player->script->count == 0)
+    {
+        return false;
+    }
+
+    // A stop earlier on must not end the script before its first move
+    stepper_clear_interrupt();
+
+    if (player->state == MOTION_SCRIPT_PAUSED)
+    {
+        // A paused move is issued again; a paused dwell runs out its remainder
+        player->moving = false;
+        if (player->dwelling)
+        {
+            player->dwell_end = make_timeout_time_us(player->dwell_left_us);
+        }
+        player->state = MOTION_SCRIPT_RUNNING;
+        LOG(RUN, INFO, "Motion: Script resumed at step %d\n", player->step);
+        return true;
+    }
+
+    motion_script_hold(player);
+    player->step = 0;
+    player->forever = (repeat == 0);
+    player->repeat = (repeat > 0) ? (uint8_t)(repeat - 1) : 0;
+    player->moving = false;
+    player->dwelling = false;
+    player->state = MOTION_SCRIPT_RUNNING;
+    LOG(RUN, INFO, "Motion: Script started (%d steps, %s)\n", player->script->count,
+        player->forever ? "looping" : "counted passes");
+    return true;
+}
+
+void motion_script_pause(motion_script_player_t *player)
+{
+    if (player->state != MOTION_SCRIPT_RUNNING)
+    {
+        return;
+    }
+
+    motion_script_hold(player);
+    if (player->dwelling)
+    {
+        int64_t left_us = absolute_time_diff_us(get_absolute_time(), player->dwell_end);
+        player->dwell_left_us = (left_us > 0) ? (uint32_t)left_us : 0;
+    }
+    player->state = MOTION_SCRIPT_PAUSED;
+    LOG(RUN, INFO, "Motion: Script paused at step %d\n", player->step);
+}
+
+void motion_script_abort(motion_script_player_t *player)
+{
+    if (player->state == MOTION_SCRIPT_IDLE)
+    {
+        return;
+    }
+
+    motion_script_hold(player);
+    player->state = MOTION_SCRIPT_IDLE;
+    player->step = 0;
+    player->moving = false;
+    player->dwelling = false;
+    LOG(RUN, INFO, "Motion: Script aborted\n");
+}
+
+uint32_t motion_script_service(motion_script_player_t *player)
+{
+    if (player->state != MOTION_SCRIPT_RUNNING)
+    {
+        return 0;
+    }
+
+    // An emergency stop ends the script along with every move
+    if (stepper_is_interrupted())
+    {
+        motion_script_abort(player);
+        return 0;
+    }
+
+    while (true)
+    {
+        const motion_script_step_t *step = &player->script->steps[player->step];
+
+        if (!player->moving && !player->dwelling)
+        {
+            motion_script_issue(player, step);
+            player->moving = true;
+        }
+
+        if (player->moving)
+        {
+            if (!motion_script_arrived(player, step->motor_mask))
+            {
+                return MOTION_SCRIPT_POLL_US;
+            }
+            player->moving = false;
+            player->dwelling = true;
+            player->dwell_end = make_timeout_time_ms(step->dwell_ms);
+        }
+
+        int64_t wait_us = absolute_time_diff_us(get_absolute_time(), player->dwell_end);
+        if (wait_us > 0)
+        {
+            return (uint32_t)wait_us;
+        }
+        player->dwelling = false;
+
+        if (++player->step < player->script->count)
+        {
+            continue;
+        }
+
+        // End of a pass: loop, count down or finish
+        player->step = 0;
+        if (!player->forever && player->repeat == 0)
+        {
+            player->state = MOTION_SCRIPT_IDLE;
+            LOG(RUN, INFO, "Motion: Script finished\n");
+            return 0;
+        }
+        if (!player->forever)
+        {
+            player->repeat--;
+        }
+
+        // Give the rest of the loop a turn, even for a script of zero-length steps
+        return MOTION_SCRIPT_POLL_US;
+    }
+}
+
+// Internal helper functions
+
+static void motion_script_issue(motion_script_player_t *player, const motion_script_step_t *step)
+{
+    for (uint i = 0; i < player->num_motors; i++)
+    {
+        if (step->motor_mask & (1u << i))
+        {
+            stepper_motor_t *motor = &player->motors[i];
+            motor->enabled = true;
+            if (step->speed_ms > 0)
+            {
+                stepper_set_speed(motor, step->speed_ms);
+            }
+            stepper_move_to(motor, step->target);
+        }
+    }
+}
+
+static bool motion_script_arrived(const motion_script_player_t *player, uint8_t mask)
+{
+    for (uint i = 0; i < player->num_motors; i++)
+    {
+        if ((mask & (1u << i)) && stepper_is_busy(&player->motors[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void motion_script_hold(motion_script_player_t *player)
+{
+    if (player->script == NULL || !player->moving)
+    {
+        return;
+    }
+
+    // Drop the queued steps of the current move but keep the coils energized
+    uint8_t mask = player->script->steps[player->step].motor_mask;
+    for (uint i = 0; i < player->num_motors; i++)
+    {
+        if ((mask & (1u << i)) && stepper_is_busy(&player->motors[i]))
+        {
+            stepper_disable(&player->motors[i]);
+            stepper_enable(&player->motors[i]);
+        }
+    }
+}
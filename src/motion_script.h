@@ -0,0 +1,139 @@
+/**
+ * @file motion_script.h
+ * @brief On-device motion script player interface
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This header file provides a player for short motion programs kept in RAM.
+ * A script is a list of steps; each step moves a set of motors to absolute
+ * targets at a given speed, waits until they have all arrived and then
+ * dwells. The player is serviced from the motion loop and never blocks it,
+ * so one uploaded script replaces a stream of radio commands.
+ *
+ * Usage:
+ * - Call every function from the core that owns the steppers
+ * - motion_script_service() tells the caller when it next needs to run,
+ *   so the motion loop can sleep in between
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef MOTION_SCRIPT_H
+#define MOTION_SCRIPT_H
+
+#include "pico/stdlib.h"
+#include "stepper.h"
+
+/**
+ * @brief Maximum number of steps in one script
+ */
+#define MOTION_SCRIPT_MAX_STEPS 64
+
+/**
+ * @brief Arrival check interval while a step's motors are moving, in microseconds
+ */
+#define MOTION_SCRIPT_POLL_US 1000
+
+/**
+ * @brief One script step
+ */
+typedef struct
+{
+    int32_t target;     ///< Absolute position in steps
+    uint16_t speed_ms;  ///< Step delay (0 = unchanged)
+    uint16_t dwell_ms;  ///< Wait after arriving
+    uint8_t motor_mask; ///< Motors to move (bit n = motor n+1, 0 = dwell only)
+} motion_script_step_t;
+
+/**
+ * @brief A stored script
+ */
+typedef struct
+{
+    motion_script_step_t steps[MOTION_SCRIPT_MAX_STEPS]; ///< Steps in order
+    uint16_t count;                                      ///< Number of steps
+} motion_script_t;
+
+/**
+ * @brief Player states
+ */
+typedef enum
+{
+    MOTION_SCRIPT_IDLE = 0, ///< Not running (never started, finished or aborted)
+    MOTION_SCRIPT_RUNNING,  ///< Executing steps
+    MOTION_SCRIPT_PAUSED    ///< Stopped mid-step; start resumes it
+} motion_script_state_t;
+
+/**
+ * @brief Player state
+ */
+typedef struct
+{
+    stepper_motor_t *motors;       ///< Motors the steps address
+    uint num_motors;               ///< Number of motors
+    const motion_script_t *script; ///< Loaded script, NULL if none
+    motion_script_state_t state;   ///< Current state
+    uint16_t step;                 ///< Step being executed
+    uint8_t repeat;                ///< Passes left after the current one
+    bool forever;                  ///< Repeat until paused or aborted
+    bool moving;                   ///< The step's move was issued and has not arrived
+    bool dwelling;                 ///< The step's motors arrived and its dwell is running
+    absolute_time_t dwell_end;     ///< When the dwell ends
+    uint32_t dwell_left_us;        ///< Dwell still to run after a pause
+} motion_script_player_t;
+
+/**
+ * @brief Set up an idle player for a set of motors
+ *
+ * @param player Player to initialize
+ * @param motors Motors the steps address (bit n of a mask = motors[n])
+ * @param num_motors Number of motors
+ */
+void motion_script_init(motion_script_player_t *player, stepper_motor_t *motors, uint num_motors);
+
+/**
+ * @brief Make a script current, aborting the one that runs
+ *
+ * The script must stay unchanged while it is loaded.
+ *
+ * @param player Player
+ * @param script Script to load
+ */
+void motion_script_load(motion_script_player_t *player, const motion_script_t *script);
+
+/**
+ * @brief Start the loaded script from its first step, or resume it after a pause
+ *
+ * @param player Player
+ * @param repeat Number of passes (0 = until paused or aborted); ignored when resuming
+ * @return true if running, false if no script with steps is loaded
+ */
+bool motion_script_start(motion_script_player_t *player, uint8_t repeat);
+
+/**
+ * @brief Pause the running script, holding its motors where they are
+ *
+ * @param player Player
+ */
+void motion_script_pause(motion_script_player_t *player);
+
+/**
+ * @brief Stop the script, holding its motors where they are
+ *
+ * @param player Player
+ */
+void motion_script_abort(motion_script_player_t *player);
+
+/**
+ * @brief Advance the running script
+ *
+ * Issues the next step once the current one's motors have arrived and its
+ * dwell has passed. Call from the motion loop.
+ *
+ * @param player Player
+ * @return uint32_t Microseconds until the player needs servicing again (0 = not running)
+ */
+uint32_t motion_script_service(motion_script_player_t *player);
+
+#endif /* MOTION_SCRIPT_H */
@@ -0,0 +1,572 @@
+/**
+ * @file protocol.c
+ * @brief Compact binary command protocol implementation
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This source file implements frame encoding and decoding. Each opcode's
+ * argument list is described by one table row, so adding a command means
+ * adding a row rather than another parser branch. Single frames and batch
+ * entries share the same field packing, and batch and group frames share
+ * one command-list codec. Script chunks reuse the base64 framing with
+ * their own fixed-size step records.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#include <string.h>
+#include "protocol.h"
+
+#define PROTO_HEADER_BYTES 3
+#define PROTO_MAX_FIELDS 2
+
+// Argument fields, each with a fixed wire size
+typedef enum
+{
+    FIELD_STEPS,  // uint16_t
+    FIELD_SPEED,  // uint16_t
+    FIELD_STATUS, // uint8_t
+    FIELD_COUNT,  // uint8_t
+    FIELD_BITMAP, // uint16_t
+    FIELD_TARGET, // int32_t
+    FIELD_ACTION, // uint8_t
+    FIELD_REPEAT  // uint8_t
+} proto_field_t;
+
+// Argument layout of one opcode
+typedef struct
+{
+    proto_opcode_t opcode;
+    uint8_t num_fields;
+    proto_field_t fields[PROTO_MAX_FIELDS];
+} proto_layout_t;
+
+static const proto_layout_t layouts[] = {
+    {PROTO_OP_START, 0, {0}},
+    {PROTO_OP_STOP, 0, {0}},
+    {PROTO_OP_SPEED, 1, {FIELD_SPEED}},
+    {PROTO_OP_MOVE, 2, {FIELD_STEPS, FIELD_SPEED}},
+    {PROTO_OP_MOVE_TO, 2, {FIELD_TARGET, FIELD_SPEED}},
+    {PROTO_OP_ACK, 1, {FIELD_STATUS}},
+    {PROTO_OP_READY, 0, {0}},
+    {PROTO_OP_BATCH_ACK, 2, {FIELD_COUNT, FIELD_BITMAP}},
+    {PROTO_OP_SCRIPT_CTL, 2, {FIELD_ACTION, FIELD_REPEAT}},
+};
+
+// URL-safe base64 alphabet: printable, no comma, CR or LF
+static const char alphabet[64] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// Forward declarations
+static uint8_t proto_encode_commands(proto_opcode_t opcode, const proto_batch_t *batch, char *out, size_t out_size);
+static bool proto_decode_commands(proto_opcode_t opcode, const char *payload, uint8_t length, proto_batch_t *batch);
+static const proto_layout_t *proto_layout(proto_opcode_t opcode);
+static uint8_t proto_field_size(proto_field_t field);
+static uint8_t proto_args_size(const proto_layout_t *layout);
+static uint8_t proto_put_args(const proto_layout_t *layout, const proto_frame_t *frame, uint8_t *raw);
+static void proto_get_args(const proto_layout_t *layout, const uint8_t *raw, proto_frame_t *frame);
+static uint8_t proto_pack(const uint8_t *raw, uint8_t length, char *out, size_t out_size);
+static int proto_unpack(const char *payload, uint8_t length, uint8_t *raw, size_t raw_size);
+static int proto_digit_value(char c);
+static void proto_put_step(const proto_script_step_t *step, uint8_t *raw);
+static void proto_get_step(const uint8_t *raw, proto_script_step_t *step);
+
+uint8_t proto_encode(const proto_frame_t *frame, char *out, size_t out_size)
+{
+    if (!frame || !out)
+    {
+        return 0;
+    }
+
+    const proto_layout_t *layout = proto_layout(frame->opcode);
+    if (!layout)
+    {
+        return 0;
+    }
+
+    // Raw frame: header, then the opcode's fields in table order
+    uint8_t raw[PROTO_FRAME_MAX_BYTES];
+    raw[0] = (uint8_t)((PROTO_VERSION << 4) | (frame->opcode & 0x0F));
+    raw[1] = frame->sequence;
+    raw[2] = (uint8_t)((frame->motor_mask & ~PROTO_FLAG_REVERSE) | (frame->reverse ? PROTO_FLAG_REVERSE : 0));
+    uint8_t length = PROTO_HEADER_BYTES + proto_put_args(layout, frame, &raw[PROTO_HEADER_BYTES]);
+
+    return proto_pack(raw, length, out, out_size);
+}
+
+bool proto_is_frame(const char *payload, uint8_t length)
+{
+    return payload && length > 0 && payload[0] == PROTO_MARKER;
+}
+
+bool proto_decode(const char *payload, uint8_t length, proto_frame_t *frame)
+{
+    if (!frame || !proto_is_frame(payload, length))
+    {
+        return false;
+    }
+
+    uint8_t raw[PROTO_GROUP_MAX_BYTES];
+    int raw_length = proto_unpack(payload, length, raw, sizeof(raw));
+    if (raw_length < PROTO_HEADER_BYTES || (raw[0] >> 4) != PROTO_VERSION)
+    {
+        return false;
+    }
+
+    memset(frame, 0, sizeof(proto_frame_t));
+    frame->opcode = (proto_opcode_t)(raw[0] & 0x0F);
+    frame->sequence = raw[1];
+    frame->motor_mask = raw[2] & ~PROTO_FLAG_REVERSE;
+    frame->reverse = (raw[2] & PROTO_FLAG_REVERSE) != 0;
+
+    // Unknown to this build (or a batch or group, see proto_decode_batch) - let the caller decide by opcode
+    const proto_layout_t *layout = proto_layout(frame->opcode);
+    if (!layout)
+    {
+        return true;
+    }
+
+    // Known opcodes must carry exactly their fields
+    if (raw_length != PROTO_HEADER_BYTES + proto_args_size(layout))
+    {
+        return false;
+    }
+
+    proto_get_args(layout, &raw[PROTO_HEADER_BYTES], frame);
+    return true;
+}
+
+uint8_t proto_encode_batch(const proto_batch_t *batch, char *out, size_t out_size)
+{
+    return proto_encode_commands(PROTO_OP_BATCH, batch, out, out_size);
+}
+
+bool proto_decode_batch(const char *payload, uint8_t length, proto_batch_t *batch)
+{
+    return proto_decode_commands(PROTO_OP_BATCH, payload, length, batch);
+}
+
+uint8_t proto_encode_group(const proto_batch_t *batch, char *out, size_t out_size)
+{
+    return proto_encode_commands(PROTO_OP_GROUP, batch, out, out_size);
+}
+
+bool proto_decode_group(const char *payload, uint8_t length, proto_batch_t *batch)
+{
+    return proto_decode_commands(PROTO_OP_GROUP, payload, length, batch);
+}
+
+uint8_t proto_encode_script(const proto_script_chunk_t *chunk, char *out, size_t out_size)
+{
+    if (!chunk || !out || chunk->count == 0 || chunk->count > PROTO_SCRIPT_CHUNK_STEPS ||
+        chunk->index >= chunk->chunks)
+    {
+        return 0;
+    }
+
+    // Header: index, chunk count and the CRC of the whole script, then the steps
+    uint8_t raw[PROTO_SCRIPT_MAX_BYTES];
+    uint8_t length = 0;
+    raw[length++] = (uint8_t)((PROTO_VERSION << 4) | PROTO_OP_SCRIPT);
+    raw[length++] = chunk->sequence;
+    raw[length++] = chunk->index;
+    raw[length++] = chunk->chunks;
+    raw[length++] = (uint8_t)chunk->crc;
+    raw[length++] = (uint8_t)(chunk->crc >> 8);
+
+    for (uint8_t i = 0; i < chunk->count; i++)
+    {
+        proto_put_step(&chunk->steps[i], &raw[length]);
+        length += PROTO_SCRIPT_STEP_BYTES;
+    }
+
+    return proto_pack(raw, length, out, out_size);
+}
+
+bool proto_decode_script(const char *payload, uint8_t length, proto_script_chunk_t *chunk)
+{
+    if (!chunk || !proto_is_frame(payload, length))
+    {
+        return false;
+    }
+
+    uint8_t raw[PROTO_SCRIPT_MAX_BYTES];
+    int raw_length = proto_unpack(payload, length, raw, sizeof(raw));
+    int steps_length = raw_length - 6;
+    if (raw_length > (int)sizeof(raw) || steps_length < PROTO_SCRIPT_STEP_BYTES ||
+        steps_length % PROTO_SCRIPT_STEP_BYTES != 0 ||
+        raw[0] != ((PROTO_VERSION << 4) | PROTO_OP_SCRIPT) || raw[2] >= raw[3])
+    {
+        return false;
+    }
+
+    chunk->sequence = raw[1];
+    chunk->index = raw[2];
+    chunk->chunks = raw[3];
+    chunk->crc = (uint16_t)(raw[4] | (raw[5] << 8));
+    chunk->count = (uint8_t)(steps_length / PROTO_SCRIPT_STEP_BYTES);
+
+    for (uint8_t i = 0; i < chunk->count; i++)
+    {
+        proto_get_step(&raw[6 + i * PROTO_SCRIPT_STEP_BYTES], &chunk->steps[i]);
+    }
+    return true;
+}
+
+uint16_t proto_script_crc(const proto_script_step_t *steps, uint count, uint16_t crc)
+{
+    uint8_t raw[PROTO_SCRIPT_STEP_BYTES];
+
+    // CRC-16/CCITT-FALSE, bitwise: a few hundred bytes per upload do not need a table
+    for (uint i = 0; i < count; i++)
+    {
+        proto_put_step(&steps[i], raw);
+        for (uint b = 0; b < PROTO_SCRIPT_STEP_BYTES; b++)
+        {
+            crc ^= (uint16_t)raw[b] << 8;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+            }
+        }
+    }
+    return crc;
+}
+
+// Internal helper functions
+
+static uint8_t proto_encode_commands(proto_opcode_t opcode, const proto_batch_t *batch, char *out, size_t out_size)
+{
+    if (!batch || !out || batch->count == 0 || batch->count > PROTO_BATCH_MAX)
+    {
+        return 0;
+    }
+
+    // Header, the group byte of a group frame, then the command count
+    uint8_t raw[PROTO_GROUP_MAX_BYTES];
+    uint8_t length = 0;
+    raw[length++] = (uint8_t)((PROTO_VERSION << 4) | opcode);
+    raw[length++] = batch->sequence;
+    if (opcode == PROTO_OP_GROUP)
+    {
+        raw[length++] = batch->group;
+    }
+    raw[length++] = batch->count;
+
+    for (uint8_t i = 0; i < batch->count; i++)
+    {
+        const proto_frame_t *command = &batch->commands[i];
+        const proto_layout_t *layout = proto_layout(command->opcode);
+        if (!layout || command->opcode == PROTO_OP_ACK || command->opcode == PROTO_OP_BATCH_ACK)
+        {
+            return 0;
+        }
+
+        raw[length++] = (uint8_t)command->opcode;
+        raw[length++] = (uint8_t)((command->motor_mask & ~PROTO_FLAG_REVERSE) |
+                                  (command->reverse ? PROTO_FLAG_REVERSE : 0));
+        length += proto_put_args(layout, command, &raw[length]);
+    }
+
+    return proto_pack(raw, length, out, out_size);
+}
+
+static bool proto_decode_commands(proto_opcode_t opcode, const char *payload, uint8_t length, proto_batch_t *batch)
+{
+    if (!batch || !proto_is_frame(payload, length))
+    {
+        return false;
+    }
+
+    uint8_t raw[PROTO_GROUP_MAX_BYTES];
+    int header = (opcode == PROTO_OP_GROUP) ? PROTO_HEADER_BYTES + 1 : PROTO_HEADER_BYTES;
+    int raw_length = proto_unpack(payload, length, raw, sizeof(raw));
+    if (raw_length < header || raw_length > (int)sizeof(raw) ||
+        raw[0] != ((PROTO_VERSION << 4) | opcode) ||
+        raw[header - 1] == 0 || raw[header - 1] > PROTO_BATCH_MAX)
+    {
+        return false;
+    }
+
+    batch->sequence = raw[1];
+    batch->group = (opcode == PROTO_OP_GROUP) ? raw[2] : PROTO_GROUP_ALL;
+    batch->count = raw[header - 1];
+
+    // Walk the commands; each one's length follows from its opcode
+    int offset = header;
+    for (uint8_t i = 0; i < batch->count; i++)
+    {
+        if (raw_length - offset < 2)
+        {
+            return false;
+        }
+
+        proto_frame_t *command = &batch->commands[i];
+        memset(command, 0, sizeof(proto_frame_t));
+        command->opcode = (proto_opcode_t)(raw[offset] & 0x0F);
+        command->sequence = batch->sequence;
+        command->motor_mask = raw[offset + 1] & ~PROTO_FLAG_REVERSE;
+        command->reverse = (raw[offset + 1] & PROTO_FLAG_REVERSE) != 0;
+        offset += 2;
+
+        const proto_layout_t *layout = proto_layout(command->opcode);
+        if (!layout || command->opcode == PROTO_OP_ACK || command->opcode == PROTO_OP_BATCH_ACK ||
+            raw_length - offset < proto_args_size(layout))
+        {
+            return false;
+        }
+        proto_get_args(layout, &raw[offset], command);
+        offset += proto_args_size(layout);
+    }
+
+    return offset == raw_length;
+}
+
+static const proto_layout_t *proto_layout(proto_opcode_t opcode)
+{
+    for (uint i = 0; i < count_of(layouts); i++)
+    {
+        if (layouts[i].opcode == opcode)
+        {
+            return &layouts[i];
+        }
+    }
+    return NULL;
+}
+
+static uint8_t proto_field_size(proto_field_t field)
+{
+    switch (field)
+    {
+    case FIELD_STATUS:
+    case FIELD_COUNT:
+    case FIELD_ACTION:
+    case FIELD_REPEAT:
+        return 1;
+    case FIELD_TARGET:
+        return 4;
+    default:
+        return 2;
+    }
+}
+
+static uint8_t proto_args_size(const proto_layout_t *layout)
+{
+    uint8_t size = 0;
+    for (uint8_t i = 0; i < layout->num_fields; i++)
+    {
+        size += proto_field_size(layout->fields[i]);
+    }
+    return size;
+}
+
+static uint8_t proto_put_args(const proto_layout_t *layout, const proto_frame_t *frame, uint8_t *raw)
+{
+    uint8_t length = 0;
+
+    for (uint8_t i = 0; i < layout->num_fields; i++)
+    {
+        uint32_t value = 0;
+        switch (layout->fields[i])
+        {
+        case FIELD_STEPS:
+            value = frame->steps;
+            break;
+        case FIELD_SPEED:
+            value = frame->speed_ms;
+            break;
+        case FIELD_STATUS:
+            value = frame->status;
+            break;
+        case FIELD_COUNT:
+            value = frame->count;
+            break;
+        case FIELD_BITMAP:
+            value = frame->bitmap;
+            break;
+        case FIELD_TARGET:
+            value = (uint32_t)frame->target;
+            break;
+        case FIELD_ACTION:
+            value = frame->action;
+            break;
+        case FIELD_REPEAT:
+            value = frame->repeat;
+            break;
+        }
+
+        // Little-endian, as many bytes as the field is wide
+        for (uint8_t b = 0; b < proto_field_size(layout->fields[i]); b++)
+        {
+            raw[length++] = (uint8_t)(value >> (8 * b));
+        }
+    }
+
+    return length;
+}
+
+static void proto_get_args(const proto_layout_t *layout, const uint8_t *raw, proto_frame_t *frame)
+{
+    for (uint8_t i = 0; i < layout->num_fields; i++)
+    {
+        uint32_t value = 0;
+        for (uint8_t b = 0; b < proto_field_size(layout->fields[i]); b++)
+        {
+            value |= (uint32_t)raw[b] << (8 * b);
+        }
+        raw += proto_field_size(layout->fields[i]);
+
+        switch (layout->fields[i])
+        {
+        case FIELD_STEPS:
+            frame->steps = (uint16_t)value;
+            break;
+        case FIELD_SPEED:
+            frame->speed_ms = (uint16_t)value;
+            break;
+        case FIELD_STATUS:
+            frame->status = (uint8_t)value;
+            break;
+        case FIELD_COUNT:
+            frame->count = (uint8_t)value;
+            break;
+        case FIELD_BITMAP:
+            frame->bitmap = (uint16_t)value;
+            break;
+        case FIELD_TARGET:
+            frame->target = (int32_t)value;
+            break;
+        case FIELD_ACTION:
+            frame->action = (uint8_t)value;
+            break;
+        case FIELD_REPEAT:
+            frame->repeat = (uint8_t)value;
+            break;
+        }
+    }
+}
+
+static uint8_t proto_pack(const uint8_t *raw, uint8_t length, char *out, size_t out_size)
+{
+    // Marker plus 4 digits per 3 bytes, unpadded
+    size_t encoded = 1 + ((size_t)length * 4 + 2) / 3;
+    if (out_size < encoded + 1)
+    {
+        return 0;
+    }
+
+    char *p = out;
+    *p++ = PROTO_MARKER;
+    for (uint8_t i = 0; i < length; i += 3)
+    {
+        uint32_t block = (uint32_t)raw[i] << 16;
+        uint8_t remaining = length - i;
+        if (remaining > 1)
+        {
+            block |= (uint32_t)raw[i + 1] << 8;
+        }
+        if (remaining > 2)
+        {
+            block |= raw[i + 2];
+        }
+
+        *p++ = alphabet[(block >> 18) & 0x3F];
+        *p++ = alphabet[(block >> 12) & 0x3F];
+        if (remaining > 1)
+        {
+            *p++ = alphabet[(block >> 6) & 0x3F];
+        }
+        if (remaining > 2)
+        {
+            *p++ = alphabet[block & 0x3F];
+        }
+    }
+    *p = '\0';
+
+    return (uint8_t)encoded;
+}
+
+static int proto_unpack(const char *payload, uint8_t length, uint8_t *raw, size_t raw_size)
+{
+    // A single leftover digit cannot carry a whole byte
+    if ((length - 1) % 4 == 1)
+    {
+        return -1;
+    }
+
+    int raw_length = 0;
+    uint32_t block = 0;
+    uint8_t bits = 0;
+
+    for (uint8_t i = 1; i < length; i++)
+    {
+        int value = proto_digit_value(payload[i]);
+        if (value < 0)
+        {
+            return -1;
+        }
+
+        block = (block << 6) | (uint32_t)value;
+        bits += 6;
+        if (bits >= 8)
+        {
+            bits -= 8;
+            if ((size_t)raw_length < raw_size)
+            {
+                raw[raw_length] = (uint8_t)(block >> bits);
+            }
+            raw_length++; // Bytes past raw_size are counted, not stored
+        }
+    }
+
+    return raw_length;
+}
+
+static int proto_digit_value(char c)
+{
+    if (c >= 'A' && c <= 'Z')
+    {
+        return c - 'A';
+    }
+    if (c >= 'a' && c <= 'z')
+    {
+        return c - 'a' + 26;
+    }
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0' + 52;
+    }
+    if (c == '-')
+    {
+        return 62;
+    }
+    if (c == '_')
+    {
+        return 63;
+    }
+    return -1;
+}
+
+static void proto_put_step(const proto_script_step_t *step, uint8_t *raw)
+{
+    uint32_t target = (uint32_t)step->target;
+
+    raw[0] = step->motor_mask;
+    raw[1] = (uint8_t)target;
+    raw[2] = (uint8_t)(target >> 8);
+    raw[3] = (uint8_t)(target >> 16);
+    raw[4] = (uint8_t)(target >> 24);
+    raw[5] = (uint8_t)step->speed_ms;
+    raw[6] = (uint8_t)(step->speed_ms >> 8);
+    raw[7] = (uint8_t)step->dwell_ms;
+    raw[8] = (uint8_t)(step->dwell_ms >> 8);
+}
+
+static void proto_get_step(const uint8_t *raw, proto_script_step_t *step)
+{
+    step->motor_mask = raw[0];
+    step->target = (int32_t)((uint32_t)raw[1] | ((uint32_t)raw[2] << 8) | ((uint32_t)raw[3] << 16) |
+                             ((uint32_t)raw[4] << 24));
+    step->speed_ms = (uint16_t)(raw[5] | (raw[6] << 8));
+    step->dwell_ms = (uint16_t)(raw[7] | (raw[8] << 8));
+}
@@ -0,0 +1,350 @@
+/**
+ * @file protocol.h
+ * @brief Compact binary command protocol interface
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This header file provides a versioned binary frame format for remote
+ * commands and replies. One frame carries an opcode, a sequence number, a
+ * target motor mask and the opcode's argument fields, so a single short
+ * packet replaces several ASCII command strings.
+ *
+ * Wire format (before encoding):
+ * - Byte 0: protocol version (high nibble) | opcode (low nibble)
+ * - Byte 1: sequence number, echoed by the acknowledgment
+ * - Byte 2: motor mask (bit n = motor n+1), PROTO_FLAG_REVERSE in bit 7
+ * - Bytes 3..: opcode arguments, little-endian
+ *
+ * A PROTO_OP_BATCH frame replaces the motor mask byte with a command count
+ * and carries up to PROTO_BATCH_MAX commands, each as opcode byte, motor
+ * mask byte and that opcode's arguments. It is answered by one
+ * PROTO_OP_BATCH_ACK frame holding a bitmap of the accepted commands.
+ *
+ * A PROTO_OP_GROUP frame is a batch for every node in one group: byte 2
+ * holds the group number and byte 3 the command count. It is sent to the
+ * broadcast address, and each member answers with its own
+ * PROTO_OP_BATCH_ACK.
+ *
+ * A PROTO_OP_SCRIPT frame carries one chunk of a motion script upload:
+ * byte 2 is the chunk index, byte 3 the chunk count and bytes 4-5 the
+ * CRC-16 of the whole script, followed by up to PROTO_SCRIPT_CHUNK_STEPS
+ * steps of PROTO_SCRIPT_STEP_BYTES each (motor mask, target, speed_ms,
+ * dwell_ms). Chunks are sent in order, each one after the previous was
+ * acknowledged; the last one makes the script current if the CRC matches.
+ * PROTO_OP_SCRIPT_CTL starts, pauses or aborts it.
+ *
+ * The RYLR998 AT+SEND payload must stay printable and free of CR/LF, so
+ * frames travel as PROTO_MARKER followed by unpadded URL-safe base64.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include "pico/stdlib.h"
+
+/**
+ * @brief Protocol version carried in every frame
+ */
+#define PROTO_VERSION 1
+
+/**
+ * @brief First payload character of an encoded binary frame
+ */
+#define PROTO_MARKER '~'
+
+/**
+ * @brief Motor mask selecting every motor
+ */
+#define PROTO_MOTOR_ALL 0x0F
+
+/**
+ * @brief Motor mask flag: move counter-clockwise
+ */
+#define PROTO_FLAG_REVERSE 0x80
+
+/**
+ * @brief Largest raw frame (header plus the longest argument list)
+ */
+#define PROTO_FRAME_MAX_BYTES 9
+
+/**
+ * @brief Buffer size for an encoded frame, including marker and terminator
+ */
+#define PROTO_ENCODED_MAX (1 + (PROTO_FRAME_MAX_BYTES * 4 + 2) / 3 + 1)
+
+/**
+ * @brief Maximum number of commands in one batch frame (bits in the ack bitmap)
+ */
+#define PROTO_BATCH_MAX 16
+
+/**
+ * @brief Largest raw batch frame (header plus PROTO_BATCH_MAX longest commands)
+ */
+#define PROTO_BATCH_MAX_BYTES (3 + PROTO_BATCH_MAX * 8)
+
+/**
+ * @brief Buffer size for an encoded batch frame, including marker and terminator
+ */
+#define PROTO_BATCH_ENCODED_MAX (1 + (PROTO_BATCH_MAX_BYTES * 4 + 2) / 3 + 1)
+
+/**
+ * @brief Number of node groups (group n is bit n of a membership mask)
+ */
+#define PROTO_GROUP_COUNT 16
+
+/**
+ * @brief Group number that every node belongs to
+ */
+#define PROTO_GROUP_ALL 0xFF
+
+/**
+ * @brief Largest raw group frame (a batch plus the group byte)
+ */
+#define PROTO_GROUP_MAX_BYTES (PROTO_BATCH_MAX_BYTES + 1)
+
+/**
+ * @brief Encoded size of the largest group frame, including the terminator
+ */
+#define PROTO_GROUP_ENCODED_MAX (1 + (PROTO_GROUP_MAX_BYTES * 4 + 2) / 3 + 1)
+
+/**
+ * @brief Wire size of one motion script step
+ */
+#define PROTO_SCRIPT_STEP_BYTES 9
+
+/**
+ * @brief Maximum number of script steps in one upload chunk
+ */
+#define PROTO_SCRIPT_CHUNK_STEPS 12
+
+/**
+ * @brief Largest raw script chunk (header plus PROTO_SCRIPT_CHUNK_STEPS steps)
+ */
+#define PROTO_SCRIPT_MAX_BYTES (6 + PROTO_SCRIPT_CHUNK_STEPS * PROTO_SCRIPT_STEP_BYTES)
+
+/**
+ * @brief Buffer size for an encoded script chunk, including marker and terminator
+ */
+#define PROTO_SCRIPT_ENCODED_MAX (1 + (PROTO_SCRIPT_MAX_BYTES * 4 + 2) / 3 + 1)
+
+/**
+ * @brief Starting value of the script CRC (CRC-16/CCITT-FALSE)
+ */
+#define PROTO_SCRIPT_CRC_INIT 0xFFFF
+
+/**
+ * @brief Frame opcodes (4 bits)
+ */
+typedef enum
+{
+    PROTO_OP_START = 0x1, ///< Enable all motors and rotate continuously
+    PROTO_OP_STOP = 0x2,  ///< Emergency stop all motors
+    PROTO_OP_SPEED = 0x3, ///< Set step delay: speed_ms
+    PROTO_OP_MOVE = 0x4,  ///< Move masked motors: steps, speed_ms (0 = unchanged)
+    PROTO_OP_BATCH = 0x5, ///< Several commands applied together (see proto_batch_t)
+    PROTO_OP_MOVE_TO = 0x6, ///< Move masked motors to an absolute position: target, speed_ms (0 = unchanged)
+    PROTO_OP_GROUP = 0x7, ///< Batch for every node of one group (see proto_batch_t)
+    PROTO_OP_ACK = 0x8,   ///< Reply to the frame with the same sequence: status
+    PROTO_OP_READY = 0x9, ///< Node announces it is ready
+    PROTO_OP_BATCH_ACK = 0xA, ///< Reply to a batch: count, bitmap of accepted commands
+    PROTO_OP_SCRIPT = 0xB,   ///< One chunk of a motion script upload (see proto_script_chunk_t)
+    PROTO_OP_SCRIPT_CTL = 0xC ///< Control the stored motion script: action, repeat
+} proto_opcode_t;
+
+/**
+ * @brief Actions of a PROTO_OP_SCRIPT_CTL frame
+ */
+typedef enum
+{
+    PROTO_SCRIPT_START = 1, ///< Run from the first step (repeat passes, 0 = forever), or resume after a pause
+    PROTO_SCRIPT_PAUSE,     ///< Hold the motors where they are; START resumes
+    PROTO_SCRIPT_ABORT      ///< Stop the script and hold the motors where they are
+} proto_script_action_t;
+
+/**
+ * @brief Acknowledgment status codes
+ */
+typedef enum
+{
+    PROTO_ACK_OK = 0,         ///< Command accepted
+    PROTO_ACK_UNKNOWN_OPCODE, ///< Opcode not supported by this node
+    PROTO_ACK_BAD_ARGUMENT,   ///< Argument out of range
+    PROTO_ACK_BUSY            ///< Command could not be queued
+} proto_ack_status_t;
+
+/**
+ * @brief Decoded frame; fields an opcode does not use are zero
+ */
+typedef struct
+{
+    proto_opcode_t opcode; ///< Frame opcode
+    uint8_t sequence;      ///< Sequence number
+    uint8_t motor_mask;    ///< Target motors (bit n = motor n+1)
+    bool reverse;          ///< Counter-clockwise for PROTO_OP_MOVE
+    uint16_t steps;        ///< Step count for PROTO_OP_MOVE
+    uint16_t speed_ms;     ///< Step delay for PROTO_OP_SPEED / PROTO_OP_MOVE / PROTO_OP_MOVE_TO
+    int32_t target;        ///< Absolute position in steps for PROTO_OP_MOVE_TO
+    uint8_t status;        ///< proto_ack_status_t for PROTO_OP_ACK
+    uint8_t count;         ///< Commands in the batch for PROTO_OP_BATCH_ACK
+    uint16_t bitmap;       ///< Accepted commands (bit i = command i) for PROTO_OP_BATCH_ACK
+    uint8_t action;        ///< proto_script_action_t for PROTO_OP_SCRIPT_CTL
+    uint8_t repeat;        ///< Passes for PROTO_SCRIPT_START (0 = until paused or aborted)
+} proto_frame_t;
+
+/**
+ * @brief Decoded batch frame; commands carry no sequence of their own
+ */
+typedef struct
+{
+    uint8_t sequence;                         ///< Sequence number, echoed by the batch ack
+    uint8_t group;                            ///< Target group of a PROTO_OP_GROUP frame (or PROTO_GROUP_ALL)
+    uint8_t count;                            ///< Number of commands
+    proto_frame_t commands[PROTO_BATCH_MAX]; ///< Commands in order
+} proto_batch_t;
+
+/**
+ * @brief One step of a motion script
+ *
+ * Sets the speed of the masked motors, moves them to the target, waits
+ * until all of them have arrived, then waits dwell_ms more.
+ */
+typedef struct
+{
+    uint8_t motor_mask; ///< Motors to move (0 = dwell only)
+    int32_t target;     ///< Absolute position in steps
+    uint16_t speed_ms;  ///< Step delay (0 = unchanged)
+    uint16_t dwell_ms;  ///< Wait after arriving
+} proto_script_step_t;
+
+/**
+ * @brief Decoded script upload chunk
+ */
+typedef struct
+{
+    uint8_t sequence;                                     ///< Sequence number, echoed by the acknowledgment
+    uint8_t index;                                        ///< Chunk index, from 0
+    uint8_t chunks;                                       ///< Number of chunks in the upload
+    uint16_t crc;                                         ///< proto_script_crc() over every step of the script
+    uint8_t count;                                        ///< Steps in this chunk
+    proto_script_step_t steps[PROTO_SCRIPT_CHUNK_STEPS]; ///< Steps in order
+} proto_script_chunk_t;
+
+/**
+ * @brief Encode a frame into a printable LoRa payload
+ *
+ * @param frame Frame to encode
+ * @param out Output buffer (at least PROTO_ENCODED_MAX bytes)
+ * @param out_size Size of the output buffer
+ * @return uint8_t Encoded length without terminator, or 0 on an unknown opcode or short buffer
+ */
+uint8_t proto_encode(const proto_frame_t *frame, char *out, size_t out_size);
+
+/**
+ * @brief Check whether a payload carries a binary frame
+ *
+ * @param payload Received payload
+ * @param length Payload length
+ * @return true if the payload starts with PROTO_MARKER, false otherwise
+ */
+bool proto_is_frame(const char *payload, uint8_t length);
+
+/**
+ * @brief Decode a payload produced by proto_encode()
+ *
+ * Rejects bad encodings, wrong versions and argument lists whose length
+ * does not match a known opcode. Opcodes this build does not know decode
+ * with no arguments, so the receiver can still acknowledge them.
+ *
+ * @param payload Received payload
+ * @param length Payload length
+ * @param frame Pointer to the frame to fill
+ * @return true if the frame is valid, false otherwise
+ */
+bool proto_decode(const char *payload, uint8_t length, proto_frame_t *frame);
+
+/**
+ * @brief Encode a batch of commands into one printable LoRa payload
+ *
+ * Batches and acknowledgments cannot be nested inside a batch.
+ *
+ * @param batch Batch to encode (1..PROTO_BATCH_MAX commands)
+ * @param out Output buffer (at least PROTO_BATCH_ENCODED_MAX bytes)
+ * @param out_size Size of the output buffer
+ * @return uint8_t Encoded length without terminator, or 0 on error
+ */
+uint8_t proto_encode_batch(const proto_batch_t *batch, char *out, size_t out_size);
+
+/**
+ * @brief Decode a PROTO_OP_BATCH payload
+ *
+ * Every command must have a known opcode and exactly its arguments;
+ * otherwise the whole batch is rejected.
+ *
+ * @param payload Received payload
+ * @param length Payload length
+ * @param batch Pointer to the batch to fill
+ * @return true if the batch is valid, false otherwise
+ */
+bool proto_decode_batch(const char *payload, uint8_t length, proto_batch_t *batch);
+
+/**
+ * @brief Encode a batch of commands for every node of batch->group
+ *
+ * @param batch Batch to encode (1..PROTO_BATCH_MAX commands); group selects the nodes
+ * @param out Output buffer (at least PROTO_GROUP_ENCODED_MAX bytes)
+ * @param out_size Size of the output buffer
+ * @return uint8_t Encoded length without terminator, or 0 on error
+ */
+uint8_t proto_encode_group(const proto_batch_t *batch, char *out, size_t out_size);
+
+/**
+ * @brief Decode a PROTO_OP_GROUP payload
+ *
+ * Same rules as proto_decode_batch(); batch->group receives the group.
+ *
+ * @param payload Received payload
+ * @param length Payload length
+ * @param batch Pointer to the batch to fill
+ * @return true if the frame is valid, false otherwise
+ */
+bool proto_decode_group(const char *payload, uint8_t length, proto_batch_t *batch);
+
+/**
+ * @brief Encode one chunk of a motion script upload
+ *
+ * @param chunk Chunk to encode (1..PROTO_SCRIPT_CHUNK_STEPS steps)
+ * @param out Output buffer (at least PROTO_SCRIPT_ENCODED_MAX bytes)
+ * @param out_size Size of the output buffer
+ * @return uint8_t Encoded length without terminator, or 0 on error
+ */
+uint8_t proto_encode_script(const proto_script_chunk_t *chunk, char *out, size_t out_size);
+
+/**
+ * @brief Decode a PROTO_OP_SCRIPT payload
+ *
+ * The payload must hold a whole number of steps and an index below the
+ * chunk count.
+ *
+ * @param payload Received payload
+ * @param length Payload length
+ * @param chunk Pointer to the chunk to fill
+ * @return true if the chunk is valid, false otherwise
+ */
+bool proto_decode_script(const char *payload, uint8_t length, proto_script_chunk_t *chunk);
+
+/**
+ * @brief Extend a script CRC over steps in their wire format
+ *
+ * Start from PROTO_SCRIPT_CRC_INIT and feed every chunk's steps in order.
+ *
+ * @param steps Steps to add
+ * @param count Number of steps
+ * @param crc CRC so far
+ * @return uint16_t CRC including the steps
+ */
+uint16_t proto_script_crc(const proto_script_step_t *steps, uint count, uint16_t crc);
+
+#endif /* PROTOCOL_H */
@@ -14,11 +14,29 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stdatomic.h>
 #include "pico/stdlib.h"
 #include "hardware/uart.h"
 #include "hardware/gpio.h"
+#include "hardware/sync.h"
 #include "run.h"
+#include "log.h"
+#include "trace.h"
+#include "config_store.h"
+#ifndef LORA_TRANSMITTER_MODE
+#include "motion_script.h"
+#include "scheduler.h"
+#endif
+#ifdef LORA_BENCH
+#include "bench.h"
+#endif
+#ifdef LORA_DUAL_CORE
+#include "pico/multicore.h"
+#include "pico/flash.h"
+#include "intercore.h"
+#endif
 
 // Constants for LED configuration
 // LED only used for LoRa signal reception indication
@@ -38,6 +56,15 @@
 #define LORA_FREQUENCY 915000000 // 915 MHz (US ISM band)
 #define LORA_POWER LORA_POWER_10
 
+// UART rate the module is moved to after setup (0 = keep the detected rate), normally provided by CMake
+#ifndef LORA_UART_BAUD
+#define LORA_UART_BAUD 115200
+#endif
+
+// Baud probe: "AT\r\n" out and "+OK\r\n" back at 10 bits per byte, plus the module's turnaround
+#define BAUD_PROBE_BYTES 9
+#define BAUD_PROBE_TURNAROUND_US 20000
+
 #ifdef LORA_TRANSMITTER_MODE
 // Transmitter mode configuration
 #define LORA_DEVICE_ADDRESS 200        // Transmitter address
@@ -47,18 +74,175 @@
 #define BUTTON_ON_PIN 2
 #define BUTTON_OFF_PIN 3
 
+// Frames queued within this window share one transmission
+#define TX_BATCH_WINDOW_MS 20
+
+// Controller group addressed by one broadcast instead of the unicast target (-1 = unicast)
+#ifndef LORA_REMOTE_GROUP
+#define LORA_REMOTE_GROUP -1
+#endif
+
+// Script chunks are resent after this long without an acknowledgment (plus both frames' airtime)
+#define SCRIPT_TURNAROUND_MS 150
+#define SCRIPT_CHUNK_ATTEMPTS 3
+
+// Motion script upload, one chunk in flight at a time
+typedef struct
+{
+    const proto_script_step_t *steps; // Caller's steps, read until the upload ends
+    uint count;
+    uint8_t chunks;
+    uint8_t index;    // Chunk in flight
+    uint16_t crc;     // proto_script_crc() over every step
+    uint8_t sequence; // Sequence number of the chunk in flight
+    bool active;
+    bool acked;       // The chunk in flight was acknowledged; the loop sends the next one
+#ifndef LORA_RELIABLE
+    char payload[PROTO_SCRIPT_ENCODED_MAX]; // Chunk in flight, kept for resending
+    uint8_t length;
+    uint8_t attempts;
+    absolute_time_t deadline; // When the chunk is sent again
+#endif
+} script_sender_t;
+
 // Global variables for transmitter mode
 static button_t buttons[2];
+static proto_batch_t tx_batch;              // Commands waiting for the window to close
+static absolute_time_t tx_batch_deadline;   // When the pending commands must go out
+static script_sender_t script_sender;
 #else
 // Receiver mode configuration (default)
 #define LORA_DEVICE_ADDRESS 100 // Receiver address
+
+// Motion commands passed from the radio handler to the motion loop
+typedef enum
+{
+    MOTION_CMD_START = 1, // Re-enable motors and start continuous rotation
+    MOTION_CMD_STOP,      // Emergency stop all motors
+    MOTION_CMD_SPEED,     // Set step delay (argument in milliseconds)
+    MOTION_CMD_MOVE,      // Move masked motors by a step count (argument from MOTION_MOVE_ARG)
+    MOTION_CMD_HALT,      // Stop and release only the masked motors (argument is the motor mask)
+    MOTION_CMD_MOVE_TO,   // Move masked motors to an absolute position (argument from MOTION_TARGET_ARG)
+    MOTION_CMD_SCRIPT     // Load or control the motion script (argument from MOTION_SCRIPT_ARG)
+} motion_command_t;
+
+// Command word layout: opcode in the top byte, 24-bit argument below
+#define MOTION_CMD_WORD(cmd, arg) (((uint32_t)(cmd) << 24) | ((uint32_t)(arg) & 0x00FFFFFFu))
+
+// Longest step delay: stepper_set_speed() works in microseconds, and this still fits the 24-bit argument
+#define MOTION_SPEED_MAX_MS (UINT32_MAX / 1000u)
+
+// Move argument layout: motor mask in bits 20-23, reverse flag in bit 16, steps below
+#define MOTION_MOVE_ARG(mask, reverse, steps) \
+    ((((uint32_t)(mask) & 0x0Fu) << 20) | ((reverse) ? (1u << 16) : 0u) | ((uint32_t)(steps) & 0xFFFFu))
+
+// Move-to argument layout: motor mask in bits 20-23, signed 20-bit target below
+#define MOTION_TARGET_MIN (-(1 << 19))
+#define MOTION_TARGET_MAX ((1 << 19) - 1)
+#define MOTION_TARGET_ARG(mask, target) ((((uint32_t)(mask) & 0x0Fu) << 20) | ((uint32_t)(target) & 0xFFFFFu))
+#define MOTION_TARGET_OF(arg) (((int32_t)((arg) << 12)) >> 12)
+
+// Script argument layout: action in bits 0-7 (a proto_script_action_t or MOTION_SCRIPT_LOAD),
+// value in bits 8-15 (script slot for a load, passes for a start)
+#define MOTION_SCRIPT_LOAD 0
+#define MOTION_SCRIPT_ARG(action, value) (((uint32_t)(action) & 0xFFu) | (((uint32_t)(value) & 0xFFu) << 8))
+
+// A move with a speed change takes two words, so a full batch needs twice its command count
+#define MOTION_BATCH_MAX (2 * PROTO_BATCH_MAX)
+
+// Motion words translated from one frame or batch, handed over in a single publish
+typedef struct
+{
+    uint32_t words[MOTION_BATCH_MAX];
+    uint count;
+} motion_batch_t;
 #endif
 
 // Global variables for LoRa and stepper control
 static lora_config_t lora_config;
+static config_store_t settings; // Learned at runtime, kept in flash across resets
 static stepper_motor_t *global_steppers = NULL;
 static uint global_num_steppers = 0;
-static bool stepper_active = false;
+static atomic_bool stepper_active = false; // Read and written by both cores
+#ifndef LORA_TRANSMITTER_MODE
+static int pending_profile = -1; // Profile to apply once the acknowledgment is out
+static bool settings_dirty = false; // Group membership changed; saved from the main loop
+
+// Receiver rate window for STATS; loop passes are counted by the scheduler
+typedef struct
+{
+    uint64_t window_start_us;
+    uint32_t window_frames; // lora_stats_t.frames when the window opened
+} loop_stats_t;
+
+static loop_stats_t loop_stats;
+
+// Receiver main-loop tasks, highest priority first
+typedef enum
+{
+    TASK_STOP = 0, // Settle an emergency stop before any other work
+    TASK_RADIO,    // Drain the UART, dispatch frames and complete AT commands
+    TASK_MOTION,   // Continuous rotation, script steps and coil idle policy (core 1 in dual-core builds)
+    TASK_REPLIES,  // Group acknowledgments waiting for their slot
+    TASK_CONFIG    // Profile, address and flash changes, which block for a while
+} receiver_task_t;
+
+// Longest acceptable wait from ready to start, counted as a miss in TASKS when exceeded
+#define TASK_STOP_DEADLINE_US 1000
+#define TASK_RADIO_DEADLINE_US 5000
+#define TASK_MOTION_DEADLINE_US 20000
+#define TASK_REPLIES_DEADLINE_US 10000
+
+static scheduler_t scheduler;
+
+// Replies to a group frame are spread over this many slots, picked by node ID
+#define GROUP_ACK_SLOTS 8
+#define GROUP_ACK_GUARD_MS 40 // Module turnaround between neighbouring slots
+#define GROUP_ACK_DEPTH 4     // Group acknowledgments that can wait for their slot
+
+// Fleet identity, assigned at runtime over LoRa
+typedef struct
+{
+    uint16_t node_id; // Module address this controller answers on
+    uint16_t groups;  // Bit n set = member of group n
+} node_config_t;
+
+// Group acknowledgment waiting for this node's reply slot
+typedef struct
+{
+    uint16_t address;
+    absolute_time_t due;
+    proto_frame_t ack;
+} group_ack_t;
+
+static node_config_t node_config = {.node_id = LORA_DEVICE_ADDRESS, .groups = 0};
+static int32_t pending_node_id = -1; // Address to take once the acknowledgment is out
+static group_ack_t group_acks[GROUP_ACK_DEPTH];
+static uint group_ack_count = 0;
+
+// Script upload being received, one chunk at a time (core 0 only)
+typedef struct
+{
+    int slot;              // scripts[] entry being filled (-1 = no upload in progress)
+    uint16_t sender;       // Address the chunks come from
+    uint8_t chunks;        // Chunks announced by the first one
+    uint8_t next_chunk;    // Index expected next
+    uint16_t crc;          // CRC announced by the sender
+    uint16_t running_crc;  // CRC over the steps received so far
+    uint16_t last_sender;  // Sender of the last chunk answered, to answer a resend again
+    uint8_t last_sequence; // Its sequence number
+    proto_ack_status_t last_status;
+    bool answered;         // The last_* fields are valid
+} script_upload_t;
+
+// Two script slots: one may be loaded in the player while the next upload fills the other
+static motion_script_t scripts[2];
+static motion_script_player_t script_player;  // Owned by the motion loop
+static atomic_int script_loaded_slot = -1;    // Slot the player holds, set by the motion loop
+static atomic_uint script_status = 0;         // Player state << 16 | step, published by the motion loop
+static int script_committed_slot = -1;        // Last slot handed to the motion loop (core 0 only)
+static script_upload_t script_upload = {.slot = -1};
+#endif
 
 // GPIO pin assignments for stepper motors
 static const uint stepper_pins[NUM_STEPPERS][4] = {
@@ -68,129 +252,1677 @@ static const uint stepper_pins[NUM_STEPPERS][4] = {
     {22, 26, 27, 28}  // Stepper Motor 4
 };
 
-// LED blink function removed - LED only for signal reception
+// LED blink function removed - LED only for signal reception
+
+/**
+ * @brief Dump the latency histograms when 't' arrives on the stdio console
+ */
+static void trace_console_poll(void)
+{
+#ifdef LORA_TRACE
+    if (getchar_timeout_us(0) == 't')
+    {
+        trace_dump();
+    }
+#endif
+}
+
+void control_steppers(stepper_motor_t *steppers, uint num_steppers)
+{
+#ifdef STEPPER_ENGINE
+    // Keep a full ramp queued ahead so rotation cruises instead of braking between bursts
+    for (uint i = 0; i < num_steppers; i++)
+    {
+        if (steppers[i].enabled && steppers[i].pending_steps < STEPPER_RAMP_STEPS)
+        {
+            stepper_move_steps(&steppers[i], STEPPER_RAMP_STEPS, STEPPER_CW);
+        }
+    }
+#else
+    // Create array of pointers for bulk operations
+    stepper_motor_t *stepper_ptrs[NUM_STEPPERS];
+    for (uint i = 0; i < num_steppers; i++)
+    {
+        stepper_ptrs[i] = &steppers[i];
+    }
+
+    // Continuous clockwise rotation - tiny increments for maximum interrupt responsiveness
+    stepper_rotate_multiple_degrees(stepper_ptrs, num_steppers, 1.0f, STEPPER_CW);
+#endif
+
+    // No debug output - maximum speed for interrupt response
+}
+
+/**
+ * @brief Initialize all stepper motors with predefined GPIO pins
+ *
+ * @param steppers Array of stepper motor structures to initialize
+ * @param num_steppers Number of steppers to initialize
+ * @return true if all motors initialized successfully, false otherwise
+ */
+static bool init_all_steppers(stepper_motor_t *steppers, uint num_steppers)
+{
+    if (num_steppers > NUM_STEPPERS)
+    {
+        LOG(RUN, ERROR, "Error: Requested %d steppers, but only %d configurations available\n",
+            num_steppers, NUM_STEPPERS);
+        return false;
+    }
+
+    for (uint i = 0; i < num_steppers; i++)
+    {
+        if (!stepper_init(&steppers[i],
+                          stepper_pins[i][0], stepper_pins[i][1],
+                          stepper_pins[i][2], stepper_pins[i][3],
+                          STEPPER_DELAY_MS))
+        {
+            LOG(RUN, ERROR, "Failed to initialize stepper motor %d\n", i + 1);
+            return false;
+        }
+        LOG(RUN, INFO, "Stepper motor %d initialized on pins %d,%d,%d,%d\n",
+            i + 1, stepper_pins[i][0], stepper_pins[i][1],
+            stepper_pins[i][2], stepper_pins[i][3]);
+    }
+
+    return true;
+}
+
+#ifndef LORA_TRANSMITTER_MODE
+/**
+ * @brief Execute a motion command on the core that owns the steppers
+ *
+ * @param cmd Motion command to execute
+ * @param arg Command argument
+ */
+static void motion_execute(motion_command_t cmd, uint32_t arg)
+{
+    // Direct motion commands take the motors back from a running script
+    if (cmd != MOTION_CMD_SPEED && cmd != MOTION_CMD_SCRIPT)
+    {
+        motion_script_abort(&script_player);
+    }
+
+    switch (cmd)
+    {
+    case MOTION_CMD_START:
+        // Clear any previous interrupt flag
+        stepper_clear_interrupt();
+
+        // Re-enable all motors after emergency stop
+        if (global_steppers && global_num_steppers > 0)
+        {
+            for (uint i = 0; i < global_num_steppers; i++)
+            {
+                global_steppers[i].enabled = true;
+            }
+
+            // Execute stepper sequence
+            control_steppers(global_steppers, global_num_steppers);
+        }
+        atomic_store(&stepper_active, true);
+        break;
+
+    case MOTION_CMD_STOP:
+        atomic_store(&stepper_active, false);
+
+        // Set interrupt flag to immediately stop any running stepper operation
+        stepper_set_interrupt();
+
+        // IMMEDIATELY disable all motors - NO DELAYS!
+        if (global_steppers && global_num_steppers > 0)
+        {
+            stepper_emergency_stop_all(global_steppers, global_num_steppers);
+        }
+        break;
+
+    case MOTION_CMD_SPEED:
+        for (uint i = 0; i < global_num_steppers; i++)
+        {
+            stepper_set_speed(&global_steppers[i], (uint)arg);
+        }
+        break;
+
+    case MOTION_CMD_MOVE:
+        stepper_clear_interrupt();
+        for (uint i = 0; i < global_num_steppers; i++)
+        {
+            if (arg & (1u << (20 + i)))
+            {
+                global_steppers[i].enabled = true;
+                stepper_move_steps(&global_steppers[i], arg & 0xFFFFu,
+                                   (arg & (1u << 16)) ? STEPPER_CCW : STEPPER_CW);
+            }
+        }
+        break;
+
+    case MOTION_CMD_MOVE_TO:
+        stepper_clear_interrupt();
+        for (uint i = 0; i < global_num_steppers; i++)
+        {
+            if (arg & (1u << (20 + i)))
+            {
+                global_steppers[i].enabled = true;
+                stepper_move_to(&global_steppers[i], MOTION_TARGET_OF(arg));
+            }
+        }
+        break;
+
+    case MOTION_CMD_HALT:
+        for (uint i = 0; i < global_num_steppers; i++)
+        {
+            if (arg & (1u << i))
+            {
+                stepper_disable(&global_steppers[i]);
+            }
+        }
+        break;
+
+    case MOTION_CMD_SCRIPT:
+        switch (arg & 0xFFu)
+        {
+        case MOTION_SCRIPT_LOAD:
+            motion_script_load(&script_player, &scripts[(arg >> 8) & 0xFFu]);
+            atomic_store(&script_loaded_slot, (int)((arg >> 8) & 0xFFu));
+            break;
+        case PROTO_SCRIPT_START:
+            // The script owns the motors while it runs
+            atomic_store(&stepper_active, false);
+            motion_script_start(&script_player, (uint8_t)(arg >> 8));
+            break;
+        case PROTO_SCRIPT_PAUSE:
+            motion_script_pause(&script_player);
+            break;
+        case PROTO_SCRIPT_ABORT:
+            motion_script_abort(&script_player);
+            break;
+        }
+        break;
+
+    default:
+        LOG(RUN, WARN, "Motion: Unknown command %d\n", cmd);
+        break;
+    }
+}
+
+/**
+ * @brief Append a motion command to a batch
+ *
+ * @param batch Batch being built
+ * @param cmd Motion command
+ * @param arg Command argument
+ * @return true if appended, false if the batch is full
+ */
+static bool motion_append(motion_batch_t *batch, motion_command_t cmd, uint32_t arg)
+{
+    if (batch->count >= MOTION_BATCH_MAX)
+    {
+        return false;
+    }
+
+    batch->words[batch->count++] = MOTION_CMD_WORD(cmd, arg);
+    return true;
+}
+
+/**
+ * @brief Hand a batch of motion commands to the motion loop
+ *
+ * In dual-core builds the whole batch is published to core 1 at once, so it
+ * never runs half of a batch; a stop also raises the interrupt flag right
+ * away so a running move halts before core 1 even reads the queue.
+ * Single-core builds execute the commands directly, in order, and wake the
+ * motion task. A stop also posts the stop task in both builds.
+ *
+ * @param batch Commands to hand over
+ * @return true if every command was executed or queued, false if the channel is full (none queued)
+ */
+static bool motion_commit(const motion_batch_t *batch)
+{
+    for (uint i = 0; i < batch->count; i++)
+    {
+        if ((motion_command_t)(batch->words[i] >> 24) == MOTION_CMD_STOP)
+        {
+#ifdef LORA_DUAL_CORE
+            atomic_store(&stepper_active, false);
+            stepper_set_interrupt();
+#endif
+            scheduler_post(&scheduler, TASK_STOP);
+            break;
+        }
+    }
+
+#ifdef LORA_DUAL_CORE
+    if (!intercore_push_many(batch->words, batch->count))
+    {
+        LOG(RUN, ERROR, "Motion: ❌ Command channel full, dropped %d commands\n", batch->count);
+        return false;
+    }
+    return true;
+#else
+    for (uint i = 0; i < batch->count; i++)
+    {
+        motion_execute((motion_command_t)(batch->words[i] >> 24), batch->words[i] & 0x00FFFFFFu);
+    }
+
+    // New moves, a script or a speed change may need the motion loop sooner than it planned
+    scheduler_post(&scheduler, TASK_MOTION);
+    return true;
+#endif
+}
+
+/**
+ * @brief Hand a single motion command to the motion loop
+ *
+ * @param cmd Motion command to send
+ * @param arg Command argument
+ * @return true if the command was executed or queued, false if the channel is full
+ */
+static bool motion_request(motion_command_t cmd, uint32_t arg)
+{
+    motion_batch_t batch = {.count = 0};
+    motion_append(&batch, cmd, arg);
+    return motion_commit(&batch);
+}
+
+/**
+ * @brief Advance continuous rotation while the steppers are active
+ *
+ * @param steppers Array of stepper motor structures
+ * @param num_steppers Number of steppers in the array
+ */
+static void motion_update(stepper_motor_t *steppers, uint num_steppers)
+{
+    // A stop clears the flag before it raises the interrupt, so one check is enough
+    if (!atomic_load(&stepper_active))
+    {
+        return;
+    }
+
+    control_steppers(steppers, num_steppers);
+}
+
+/**
+ * @brief Pick the earlier of two wake-ups
+ *
+ * @param a Wake-up in microseconds (0 = none)
+ * @param b Wake-up in microseconds (0 = none)
+ * @return uint32_t The sooner one (0 = neither)
+ */
+static uint32_t sooner_us(uint32_t a, uint32_t b)
+{
+    if (a == 0 || (b != 0 && b < a))
+    {
+        return b;
+    }
+    return a;
+}
+
+/**
+ * @brief Advance the motion script and publish its progress for SCRIPT? queries
+ *
+ * @return uint32_t Microseconds until the script needs the motion loop again (0 = not running)
+ */
+static uint32_t script_service(void)
+{
+    uint32_t wake_us = motion_script_service(&script_player);
+    atomic_store(&script_status, ((uint32_t)script_player.state << 16) | script_player.step);
+    return wake_us;
+}
+
+#ifdef LORA_DUAL_CORE
+/**
+ * @brief Core 1 entry point: owns the stepper hardware and runs the motion loop
+ *
+ * Initializes the steppers on this core so the step engine interrupt is
+ * serviced here, reports the result to core 0 over the SIO FIFO, then
+ * executes queued commands, advances the motion script and keeps the
+ * motors stepping. Parks in WFE while idle; intercore_push() wakes it with
+ * SEV, and a timeout wakes it when a motor's coil idle policy or the next
+ * script step falls due.
+ */
+static void motion_core_entry(void)
+{
+    // Lets core 0 park this core while it writes the settings sector
+    flash_safe_execute_core_init();
+
+    bool ok = init_all_steppers(global_steppers, global_num_steppers);
+    motion_script_init(&script_player, global_steppers, global_num_steppers);
+    multicore_fifo_push_blocking(ok ? 1 : 0);
+
+    while (true)
+    {
+        uint32_t word;
+        while (intercore_pop(&word))
+        {
+            motion_execute((motion_command_t)(word >> 24), word & 0x00FFFFFFu);
+        }
+
+        // Release or reduce the coils of motors that have stood still
+        uint32_t idle_us = ok ? stepper_idle_service(global_steppers, global_num_steppers) : 0;
+        uint32_t wake_us = sooner_us(idle_us, script_service());
+
+        if (atomic_load(&stepper_active))
+        {
+            motion_update(global_steppers, global_num_steppers);
+        }
+        else if (ok)
+        {
+            if (wake_us > 0)
+            {
+                best_effort_wfe_or_timeout(make_timeout_time_us(wake_us));
+            }
+            else
+            {
+                __wfe();
+            }
+        }
+    }
+}
+#endif
+#endif
+
+/**
+ * @brief How long to wait for the reply to one baud probe
+ *
+ * @param baud_rate Rate being probed
+ * @return uint32_t Wire time of the probe and its reply plus the module turnaround, in microseconds
+ */
+static uint32_t baud_probe_timeout_us(uint baud_rate)
+{
+    return BAUD_PROBE_TURNAROUND_US + (BAUD_PROBE_BYTES * 10u * 1000000u) / baud_rate;
+}
+
+/**
+ * @brief Store the baud rate and module settings in use, plus the fleet identity
+ */
+static void settings_persist(void)
+{
+    settings.baud_rate = lora_config.baud_rate;
+    settings.radio_hash = lora_config_hash(&lora_config);
+#ifndef LORA_TRANSMITTER_MODE
+    settings.node_id = node_config.node_id;
+    settings.groups = node_config.groups;
+#endif
+    config_store_save(&settings);
+}
+
+/**
+ * @brief Bring up the radio, reusing what the previous boot learned
+ *
+ * Probes the stored baud rate first, so a warm start finds the module in one
+ * AT round trip, and leaves the module alone when it already holds the
+ * requested settings. Then moves the UART to LORA_UART_BAUD; the module
+ * keeps that rate, so later boots find it on the first probe.
+ *
+ * @param device_address Address the module should answer on
+ * @return lora_status_t Status of initialization
+ */
+static lora_status_t radio_start(uint16_t device_address)
+{
+    uint working_baud = detect_lora_baud_rate(settings.baud_rate);
+
+    lora_status_t status = lora_init_cached(&lora_config, LORA_UART_INST, LORA_TX_PIN, LORA_RX_PIN,
+                                            LORA_NETWORK_ID, device_address, LORA_FREQUENCY, LORA_POWER,
+                                            working_baud, settings.radio_hash);
+    if (status != LORA_STATUS_OK)
+    {
+        return status;
+    }
+
+#if LORA_UART_BAUD > 0
+    // A full AT+SEND takes ~280 ms on the wire at 9600 baud, ~24 ms at 115200
+    if (lora_config.baud_rate != LORA_UART_BAUD &&
+        lora_set_baud_rate(&lora_config, LORA_UART_BAUD) != LORA_STATUS_OK)
+    {
+        LOG(RUN, WARN, "LoRa: ⚠️  Staying at %d baud\n", lora_config.baud_rate);
+    }
+#endif
+
+    settings_persist();
+    return status;
+}
+
+/**
+ * @brief Log the result of a configuration query queued at startup
+ *
+ * @param status Final status of the query
+ * @param response Module reply
+ * @param user_data Name of the queried setting
+ */
+static void config_query_callback(lora_status_t status, const char *response, void *user_data)
+{
+    const char *name = (const char *)user_data;
+
+    if (status == LORA_STATUS_OK)
+    {
+        LOG(RUN, INFO, "LoRa: Current %s: %s\n", name, response);
+    }
+    else
+    {
+        LOG(RUN, ERROR, "LoRa: ❌ Failed to get %s (status: %d)\n", name, status);
+    }
+}
+
+/**
+ * @brief Report the outcome of an acknowledgment queued without waiting
+ *
+ * @param status Final status of the AT+SEND command
+ * @param response Module reply
+ * @param user_data Unused
+ */
+static void ack_sent_callback(lora_status_t status, const char *response, void *user_data)
+{
+    if (status == LORA_STATUS_OK)
+    {
+        TRACE_MARK(TRACE_ACK_SENT);
+    }
+    else
+    {
+        LOG(RUN, ERROR, "LoRa: ❌ Failed to send acknowledgment (status: %d, response: %s)\n",
+            status, response);
+    }
+}
+
+#ifndef LORA_TRANSMITTER_MODE
+/**
+ * @brief Encode a protocol frame and queue it for sending
+ *
+ * @param address Destination address
+ * @param frame Frame to send
+ */
+static void send_frame_async(uint16_t address, const proto_frame_t *frame)
+{
+    char payload[PROTO_ENCODED_MAX];
+    uint8_t length = proto_encode(frame, payload, sizeof(payload));
+
+    if (length > 0)
+    {
+#ifdef LORA_RELIABLE
+        // Kept so a retransmitted command is answered again without being applied again
+        lora_reliable_reply(&lora_config, address, frame->sequence, payload, length, ack_sent_callback, NULL);
+#else
+        lora_send_message_async(&lora_config, address, payload, length, ack_sent_callback, NULL);
+#endif
+    }
+}
+
+// Binary command handlers - each validates one command and appends its motion
+// words; nothing reaches the motors until the caller commits the batch
+
+static proto_ack_status_t frame_start(const proto_frame_t *frame, motion_batch_t *motion)
+{
+    return motion_append(motion, MOTION_CMD_START, 0) ? PROTO_ACK_OK : PROTO_ACK_BUSY;
+}
+
+static proto_ack_status_t frame_stop(const proto_frame_t *frame, motion_batch_t *motion)
+{
+    uint8_t mask = frame->motor_mask & PROTO_MOTOR_ALL;
+
+    // Stopping a subset leaves the other motors running
+    if (mask != 0 && mask != PROTO_MOTOR_ALL)
+    {
+        return motion_append(motion, MOTION_CMD_HALT, mask) ? PROTO_ACK_OK : PROTO_ACK_BUSY;
+    }
+    return motion_append(motion, MOTION_CMD_STOP, 0) ? PROTO_ACK_OK : PROTO_ACK_BUSY;
+}
+
+static proto_ack_status_t frame_speed(const proto_frame_t *frame, motion_batch_t *motion)
+{
+    if (frame->speed_ms == 0)
+    {
+        return PROTO_ACK_BAD_ARGUMENT;
+    }
+    return motion_append(motion, MOTION_CMD_SPEED, frame->speed_ms) ? PROTO_ACK_OK : PROTO_ACK_BUSY;
+}
+
+static proto_ack_status_t frame_move(const proto_frame_t *frame, motion_batch_t *motion)
+{
+    if ((frame->motor_mask & PROTO_MOTOR_ALL) == 0 || frame->steps == 0)
+    {
+        return PROTO_ACK_BAD_ARGUMENT;
+    }
+
+    // One frame carries speed and move together
+    if (frame->speed_ms > 0 && !motion_append(motion, MOTION_CMD_SPEED, frame->speed_ms))
+    {
+        return PROTO_ACK_BUSY;
+    }
+    return motion_append(motion, MOTION_CMD_MOVE, MOTION_MOVE_ARG(frame->motor_mask, frame->reverse, frame->steps))
+               ? PROTO_ACK_OK
+               : PROTO_ACK_BUSY;
+}
+
+static proto_ack_status_t frame_move_to(const proto_frame_t *frame, motion_batch_t *motion)
+{
+    if ((frame->motor_mask & PROTO_MOTOR_ALL) == 0 || frame->target < MOTION_TARGET_MIN ||
+        frame->target > MOTION_TARGET_MAX)
+    {
+        return PROTO_ACK_BAD_ARGUMENT;
+    }
+
+    if (frame->speed_ms > 0 && !motion_append(motion, MOTION_CMD_SPEED, frame->speed_ms))
+    {
+        return PROTO_ACK_BUSY;
+    }
+    return motion_append(motion, MOTION_CMD_MOVE_TO, MOTION_TARGET_ARG(frame->motor_mask, frame->target))
+               ? PROTO_ACK_OK
+               : PROTO_ACK_BUSY;
+}
+
+static proto_ack_status_t frame_ready(const proto_frame_t *frame, motion_batch_t *motion)
+{
+    LOG(RUN, INFO, "LoRa: Remote announced ready (seq %d)\n", frame->sequence);
+    return PROTO_ACK_OK;
+}
+
+static proto_ack_status_t frame_script_ctl(const proto_frame_t *frame, motion_batch_t *motion)
+{
+    if (frame->action < PROTO_SCRIPT_START || frame->action > PROTO_SCRIPT_ABORT ||
+        (frame->action == PROTO_SCRIPT_START && script_committed_slot < 0))
+    {
+        return PROTO_ACK_BAD_ARGUMENT;
+    }
+    return motion_append(motion, MOTION_CMD_SCRIPT, MOTION_SCRIPT_ARG(frame->action, frame->repeat))
+               ? PROTO_ACK_OK
+               : PROTO_ACK_BUSY;
+}
+
+// Opcode dispatch table
+static const struct
+{
+    proto_opcode_t opcode;
+    proto_ack_status_t (*handler)(const proto_frame_t *frame, motion_batch_t *motion);
+} frame_handlers[] = {
+    {PROTO_OP_START, frame_start},
+    {PROTO_OP_STOP, frame_stop},
+    {PROTO_OP_SPEED, frame_speed},
+    {PROTO_OP_MOVE, frame_move},
+    {PROTO_OP_MOVE_TO, frame_move_to},
+    {PROTO_OP_READY, frame_ready},
+    {PROTO_OP_SCRIPT_CTL, frame_script_ctl},
+};
+
+/**
+ * @brief Validate one command and translate it into motion words
+ *
+ * @param frame Decoded command
+ * @param motion Batch receiving the motion words
+ * @return proto_ack_status_t Status the acknowledgment will carry
+ */
+static proto_ack_status_t dispatch_frame(const proto_frame_t *frame, motion_batch_t *motion)
+{
+    for (uint i = 0; i < count_of(frame_handlers); i++)
+    {
+        if (frame_handlers[i].opcode == frame->opcode)
+        {
+            return frame_handlers[i].handler(frame, motion);
+        }
+    }
+    return PROTO_ACK_UNKNOWN_OPCODE;
+}
+
+/**
+ * @brief Apply a decoded batch atomically and build its bitmap acknowledgment
+ *
+ * Every command is validated before any is applied, and the batch is
+ * committed only if all of them pass. The acknowledgment bitmap marks the
+ * commands that passed; it is complete only when the batch was applied.
+ *
+ * @param batch Decoded batch or group frame
+ * @return proto_frame_t PROTO_OP_BATCH_ACK frame answering the batch
+ */
+static proto_frame_t apply_batch(const proto_batch_t *batch)
+{
+    motion_batch_t motion = {.count = 0};
+    uint16_t accepted = 0;
+    for (uint8_t i = 0; i < batch->count; i++)
+    {
+        if (dispatch_frame(&batch->commands[i], &motion) == PROTO_ACK_OK)
+        {
+            accepted |= (uint16_t)(1u << i);
+        }
+    }
+
+    // All or nothing: a partial batch is never handed to the motors
+    uint16_t complete = (uint16_t)((1u << batch->count) - 1);
+    if (accepted != complete)
+    {
+        LOG(RUN, WARN, "LoRa: Batch seq %d rejected (accepted 0x%04X of 0x%04X)\n",
+            batch->sequence, accepted, complete);
+    }
+    else if (!motion_commit(&motion))
+    {
+        accepted = 0;
+    }
+
+    LOG(RUN, DEBUG, "LoRa: Batch seq %d with %d commands -> bitmap 0x%04X\n",
+        batch->sequence, batch->count, accepted);
+
+    return (proto_frame_t){.opcode = PROTO_OP_BATCH_ACK,
+                           .sequence = batch->sequence,
+                           .count = batch->count,
+                           .bitmap = accepted};
+}
+
+/**
+ * @brief Decode a batch frame, apply it and send one bitmap acknowledgment
+ *
+ * @param message Received message carrying the batch
+ */
+static void handle_batch(const lora_message_t *message)
+{
+    proto_batch_t batch;
+    if (!proto_decode_batch(message->payload, message->payload_length, &batch))
+    {
+        LOG(RUN, WARN, "LoRa: Malformed batch from %d: %s\n", message->sender_address, message->payload);
+        return;
+    }
+
+    proto_frame_t ack = apply_batch(&batch);
+    send_frame_async(message->sender_address, &ack);
+}
+
+/**
+ * @brief Take one chunk of a script upload
+ *
+ * The first chunk opens an upload into the script slot the player is not
+ * holding; the rest must follow in order from the same sender. The last one
+ * hands the script to the motion loop if the CRC over all steps matches.
+ *
+ * @param chunk Decoded chunk
+ * @param sender Address the chunk came from
+ * @return proto_ack_status_t Status the acknowledgment will carry
+ */
+static proto_ack_status_t script_upload_chunk(const proto_script_chunk_t *chunk, uint16_t sender)
+{
+    script_upload_t *upload = &script_upload;
+
+    if (chunk->index == 0)
+    {
+        // The slot handed over last must reach the player before the other one is reused
+        if (script_committed_slot >= 0 && atomic_load(&script_loaded_slot) != script_committed_slot)
+        {
+            return PROTO_ACK_BUSY;
+        }
+
+        upload->slot = (script_committed_slot == 0) ? 1 : 0;
+        upload->sender = sender;
+        upload->chunks = chunk->chunks;
+        upload->next_chunk = 0;
+        upload->crc = chunk->crc;
+        upload->running_crc = PROTO_SCRIPT_CRC_INIT;
+        scripts[upload->slot].count = 0;
+    }
+    else if (upload->slot < 0 || sender != upload->sender || chunk->index != upload->next_chunk ||
+             chunk->chunks != upload->chunks || chunk->crc != upload->crc)
+    {
+        return PROTO_ACK_BAD_ARGUMENT;
+    }
+
+    motion_script_t *script = &scripts[upload->slot];
+    if (script->count + chunk->count > MOTION_SCRIPT_MAX_STEPS)
+    {
+        LOG(RUN, WARN, "LoRa: Script from %d exceeds %d steps, upload abandoned\n", sender, MOTION_SCRIPT_MAX_STEPS);
+        upload->slot = -1;
+        return PROTO_ACK_BAD_ARGUMENT;
+    }
+
+    for (uint8_t i = 0; i < chunk->count; i++)
+    {
+        const proto_script_step_t *step = &chunk->steps[i];
+        script->steps[script->count++] = (motion_script_step_t){.target = step->target,
+                                                                .speed_ms = step->speed_ms,
+                                                                .dwell_ms = step->dwell_ms,
+                                                                .motor_mask = step->motor_mask & PROTO_MOTOR_ALL};
+    }
+    upload->running_crc = proto_script_crc(chunk->steps, chunk->count, upload->running_crc);
+
+    if (++upload->next_chunk < upload->chunks)
+    {
+        return PROTO_ACK_OK;
+    }
+
+    // Last chunk: the script is complete
+    int slot = upload->slot;
+    upload->slot = -1;
+    if (upload->running_crc != upload->crc)
+    {
+        LOG(RUN, WARN, "LoRa: Script from %d failed its CRC (0x%04X, expected 0x%04X)\n",
+            sender, upload->running_crc, upload->crc);
+        return PROTO_ACK_BAD_ARGUMENT;
+    }
+
+    if (!motion_request(MOTION_CMD_SCRIPT, MOTION_SCRIPT_ARG(MOTION_SCRIPT_LOAD, slot)))
+    {
+        return PROTO_ACK_BUSY;
+    }
+    script_committed_slot = slot;
+
+    LOG(RUN, INFO, "LoRa: ✅ Script of %d steps received from %d in %d chunks\n",
+        script->count, sender, upload->chunks);
+    return PROTO_ACK_OK;
+}
+
+/**
+ * @brief Decode a script chunk, take it and acknowledge it
+ *
+ * A resent chunk is answered with the status it got the first time and
+ * not applied again; with LORA_RELIABLE, duplicates never get this far.
+ *
+ * @param message Received message carrying the chunk
+ */
+static void handle_script(const lora_message_t *message)
+{
+    proto_script_chunk_t chunk;
+    if (!proto_decode_script(message->payload, message->payload_length, &chunk))
+    {
+        LOG(RUN, WARN, "LoRa: Malformed script chunk from %d: %s\n", message->sender_address, message->payload);
+        return;
+    }
+
+    script_upload_t *upload = &script_upload;
+    proto_ack_status_t status;
+    if (upload->answered && upload->last_sender == message->sender_address && upload->last_sequence == chunk.sequence)
+    {
+        status = upload->last_status;
+    }
+    else
+    {
+        status = script_upload_chunk(&chunk, message->sender_address);
+        upload->last_sender = message->sender_address;
+        upload->last_sequence = chunk.sequence;
+        upload->last_status = status;
+        upload->answered = true;
+    }
+
+    LOG(RUN, DEBUG, "LoRa: Script chunk %d/%d seq %d with %d steps -> status %d\n",
+        chunk.index + 1, chunk.chunks, chunk.sequence, chunk.count, status);
+
+    proto_frame_t ack = {.opcode = PROTO_OP_ACK, .sequence = chunk.sequence, .status = (uint8_t)status};
+    send_frame_async(message->sender_address, &ack);
+}
+
+/**
+ * @brief Check whether this node belongs to a group
+ *
+ * @param group Group number, or PROTO_GROUP_ALL
+ * @return true if a member, false otherwise
+ */
+static bool node_in_group(uint8_t group)
+{
+    return group == PROTO_GROUP_ALL ||
+           (group < PROTO_GROUP_COUNT && (node_config.groups & (1u << group)) != 0);
+}
+
+/**
+ * @brief Decode a group frame and, if this node is a member, apply it
+ *
+ * Every member answers the same broadcast, so the acknowledgment waits for
+ * this node's slot: node ID modulo GROUP_ACK_SLOTS, each slot one ACK's
+ * airtime plus a turnaround guard wide. Nodes whose IDs differ within the
+ * slot count never answer at the same time.
+ *
+ * @param message Received message carrying the group frame
+ */
+static void handle_group(const lora_message_t *message)
+{
+    proto_batch_t batch;
+    if (!proto_decode_group(message->payload, message->payload_length, &batch))
+    {
+        LOG(RUN, WARN, "LoRa: Malformed group frame from %d: %s\n", message->sender_address, message->payload);
+        return;
+    }
+
+    if (!node_in_group(batch.group))
+    {
+        LOG(RUN, DEBUG, "LoRa: Group %d seq %d is not for this node\n", batch.group, batch.sequence);
+        return;
+    }
+
+    proto_frame_t ack = apply_batch(&batch);
+    if (group_ack_count >= GROUP_ACK_DEPTH)
+    {
+        LOG(RUN, WARN, "LoRa: Group seq %d applied, acknowledgment dropped (%d waiting)\n",
+            batch.sequence, group_ack_count);
+        return;
+    }
+
+    uint32_t slot_us = lora_time_on_air_us(&lora_config, PROTO_ENCODED_MAX) + GROUP_ACK_GUARD_MS * 1000u;
+    uint32_t delay_us = (uint32_t)(node_config.node_id % GROUP_ACK_SLOTS) * slot_us;
+    group_acks[group_ack_count++] = (group_ack_t){.address = message->sender_address,
+                                                  .due = make_timeout_time_us(delay_us),
+                                                  .ack = ack};
+    scheduler_post(&scheduler, TASK_REPLIES);
+}
+
+/**
+ * @brief Send the group acknowledgments whose slot has come
+ *
+ * Sent plainly rather than through send_frame_async(): group frames are
+ * never retransmitted, so there is nothing to keep a reply for.
+ *
+ * @param timeout_us Wake-up the caller already needs, in microseconds (0 = none)
+ * @return uint32_t Sooner of timeout_us and the next waiting slot (0 = neither)
+ */
+static uint32_t group_ack_service(uint32_t timeout_us)
+{
+    uint32_t next_us = timeout_us;
+    uint i = 0;
+
+    while (i < group_ack_count)
+    {
+        int64_t wait_us = absolute_time_diff_us(get_absolute_time(), group_acks[i].due);
+        if (wait_us > 0)
+        {
+            if (next_us == 0 || (uint32_t)wait_us < next_us)
+            {
+                next_us = (uint32_t)wait_us;
+            }
+            i++;
+            continue;
+        }
+
+        char payload[PROTO_ENCODED_MAX];
+        uint8_t length = proto_encode(&group_acks[i].ack, payload, sizeof(payload));
+        if (length > 0)
+        {
+            lora_send_message_async(&lora_config, group_acks[i].address, payload, length, ack_sent_callback, NULL);
+        }
+
+        // Keep the rest in arrival order
+        group_ack_count--;
+        memmove(&group_acks[i], &group_acks[i + 1], (group_ack_count - i) * sizeof(group_ack_t));
+    }
+
+    return next_us;
+}
+
+/**
+ * @brief Decode a binary frame, dispatch it and acknowledge it
+ *
+ * @param message Received message carrying the frame
+ */
+static void handle_frame(const lora_message_t *message)
+{
+    proto_frame_t frame;
+    if (!proto_decode(message->payload, message->payload_length, &frame))
+    {
+        LOG(RUN, WARN, "LoRa: Malformed frame from %d: %s\n", message->sender_address, message->payload);
+        return;
+    }
+
+    // Group frames bypass duplicate filtering: they are broadcast once and never retransmitted
+    if (frame.opcode == PROTO_OP_GROUP)
+    {
+        handle_group(message);
+        return;
+    }
+
+#ifdef LORA_RELIABLE
+    // Announcements and acknowledgments are never answered, so they are never retransmitted
+    bool is_command = frame.opcode != PROTO_OP_READY && frame.opcode != PROTO_OP_ACK &&
+                      frame.opcode != PROTO_OP_BATCH_ACK;
+
+    if (frame.opcode == PROTO_OP_READY)
+    {
+        lora_reliable_reset_peer(message->sender_address);
+    }
+    else if (is_command && !lora_reliable_accept(message->sender_address, frame.sequence))
+    {
+        // The acknowledgment was lost: answer again, but a repeated STOP must not stop twice
+        bool repeated = lora_reliable_repeat_reply(&lora_config, message->sender_address, frame.sequence);
+        LOG(RUN, DEBUG, "LoRa: Duplicate seq %d from %d ignored (%s)\n", frame.sequence,
+            message->sender_address, repeated ? "acknowledged again" : "no kept acknowledgment");
+        return;
+    }
+#endif
+
+    if (frame.opcode == PROTO_OP_BATCH)
+    {
+        handle_batch(message);
+        return;
+    }
+
+    if (frame.opcode == PROTO_OP_SCRIPT)
+    {
+        handle_script(message);
+        return;
+    }
+
+    motion_batch_t motion = {.count = 0};
+    proto_ack_status_t status = dispatch_frame(&frame, &motion);
+    if (status == PROTO_ACK_OK && !motion_commit(&motion))
+    {
+        status = PROTO_ACK_BUSY;
+    }
+
+    LOG(RUN, DEBUG, "LoRa: Frame op %d seq %d mask 0x%02X -> status %d\n",
+        frame.opcode, frame.sequence, frame.motor_mask, status);
+
+    // Announcements and acknowledgments are never answered
+    if (frame.opcode == PROTO_OP_READY || frame.opcode == PROTO_OP_ACK || frame.opcode == PROTO_OP_BATCH_ACK)
+    {
+        return;
+    }
+
+    proto_frame_t ack = {.opcode = PROTO_OP_ACK,
+                         .sequence = frame.sequence,
+                         .motor_mask = frame.motor_mask,
+                         .status = (uint8_t)status};
+    send_frame_async(message->sender_address, &ack);
+}
+
+/**
+ * @brief Format the STATS reply and open a new rate window
+ *
+ * Counters are cumulative; message and loop rates and the worst loop pass
+ * cover the time since the previous STATS request. The text has no commas.
+ *
+ * @param buffer Output buffer
+ * @param size Output buffer size in bytes
+ * @return Length of the text written
+ */
+static uint8_t format_stats(char *buffer, size_t size)
+{
+    lora_stats_t stats;
+    lora_get_stats(&stats);
+
+    uint64_t now_us = time_us_64();
+    uint64_t window_us = now_us - loop_stats.window_start_us;
+    if (window_us == 0)
+    {
+        window_us = 1;
+    }
+
+    // Messages per second with one decimal, loops per second as an integer
+    uint32_t mps_x10 = (uint32_t)(((uint64_t)(stats.frames - loop_stats.window_frames) * 10000000u) / window_us);
+    uint32_t lps = (uint32_t)(((uint64_t)scheduler.passes * 1000000u) / window_us);
+    int32_t frames = (stats.frames > 0) ? (int32_t)stats.frames : 1;
+
+    int length = snprintf(buffer, size,
+                          "STATS up=%lu rx=%lu ovf=%lu ln=%lu rcv=%lu bad=%lu drop=%lu to=%lu rt=%lu dup=%lu "
+                          "mps=%lu.%lu lps=%lu wl=%lu rssi=%d/%ld/%d snr=%d/%ld/%d",
+                          (unsigned long)(now_us / 1000000u), (unsigned long)stats.rx_bytes,
+                          (unsigned long)stats.rx_overflows, (unsigned long)stats.lines,
+                          (unsigned long)stats.frames, (unsigned long)stats.malformed,
+                          (unsigned long)stats.inbound_dropped, (unsigned long)stats.at_timeouts,
+                          (unsigned long)stats.at_retries, (unsigned long)stats.duplicates,
+                          (unsigned long)(mps_x10 / 10),
+                          (unsigned long)(mps_x10 % 10), (unsigned long)lps, (unsigned long)scheduler.worst_pass_us,
+                          stats.rssi_min, (long)(stats.rssi_total / frames), stats.rssi_max,
+                          stats.snr_min, (long)(stats.snr_total / frames), stats.snr_max);
+
+    loop_stats.window_start_us = now_us;
+    loop_stats.window_frames = stats.frames;
+    scheduler.passes = 0;
+    scheduler.worst_pass_us = 0;
+
+    if (length < 0)
+    {
+        return 0;
+    }
+    return (uint8_t)MIN((size_t)length, MIN(size - 1, (size_t)LORA_MAX_MESSAGE_LENGTH));
+}
+
+/**
+ * @brief Format the TASKS reply and clear the task counters
+ *
+ * One runs/worst run/worst wait/deadline misses entry per task, times in
+ * microseconds, over the time since the previous TASKS request.
+ *
+ * @param buffer Output buffer
+ * @param size Output buffer size in bytes
+ * @return Length of the text written
+ */
+static uint8_t format_tasks(char *buffer, size_t size)
+{
+    size_t length = (size_t)snprintf(buffer, size, "TASKS");
+
+    for (uint i = 0; i < SCHEDULER_MAX_TASKS && length < size; i++)
+    {
+        scheduler_task_stats_t stats;
+        if (scheduler_get_task_stats(&scheduler, i, &stats))
+        {
+            length += (size_t)snprintf(buffer + length, size - length, " %s=%lu/%lu/%lu/%lu",
+                                       scheduler.tasks[i].name, (unsigned long)stats.runs,
+                                       (unsigned long)stats.worst_run_us, (unsigned long)stats.worst_wait_us,
+                                       (unsigned long)stats.deadline_misses);
+        }
+    }
+
+    scheduler_reset_stats(&scheduler);
+    return (uint8_t)MIN(length, MIN(size - 1, (size_t)LORA_MAX_MESSAGE_LENGTH));
+}
+
+// Receiver tasks, run by the scheduler in receiver_task_t order
+
+static uint32_t task_stop(void *user_data)
+{
+    // The stop already cleared stepper_active where it was committed; clearing it again here
+    // would cancel a START that followed it in the same radio pass
+    LOG(RUN, DEBUG, "Motion: Stop settled\n");
+    return SCHEDULER_WAIT_EVENT;
+}
+
+static bool radio_ready(void *user_data)
+{
+    return !lora_is_idle(&lora_config);
+}
+
+static uint32_t task_radio(void *user_data)
+{
+    if (lora_process_messages(&lora_config) == LORA_STATUS_OK)
+    {
+        // ONLY LED usage: Flash when receiving a LoRa signal
+        gpio_put(PICO_DEFAULT_LED_PIN, 1);
+        // Immediate turn-off - no delay
+        gpio_put(PICO_DEFAULT_LED_PIN, 0);
+    }
+    return SCHEDULER_WAIT_EVENT;
+}
+
+#ifndef LORA_DUAL_CORE
+static uint32_t task_motion(void *user_data)
+{
+    motion_update(global_steppers, global_num_steppers);
+    uint32_t idle_us = stepper_idle_service(global_steppers, global_num_steppers);
+    uint32_t wake_us = sooner_us(idle_us, script_service());
+
+    // Continuous rotation is topped up once per pass, after everything more urgent
+    if (atomic_load(&stepper_active))
+    {
+        return 0;
+    }
+    return (wake_us > 0) ? wake_us : SCHEDULER_WAIT_EVENT;
+}
+#endif
+
+static uint32_t task_replies(void *user_data)
+{
+    uint32_t next_us = group_ack_service(0);
+    return (next_us > 0) ? next_us : SCHEDULER_WAIT_EVENT;
+}
+
+static bool config_ready(void *user_data)
+{
+    return pending_profile >= 0 || pending_node_id >= 0 || settings_dirty;
+}
+
+static uint32_t task_config(void *user_data)
+{
+    // Blocking by design: lora_configure() waits for the queued acknowledgment first
+    if (pending_profile >= 0)
+    {
+        lora_apply_profile(&lora_config, (lora_profile_t)pending_profile);
+        pending_profile = -1;
+        settings_dirty = true;
+    }
+
+    // Same for the address: the acknowledgment leaves from the old one
+    if (pending_node_id >= 0)
+    {
+        if (lora_set_address(&lora_config, (uint16_t)pending_node_id) == LORA_STATUS_OK)
+        {
+            node_config.node_id = (uint16_t)pending_node_id;
+            settings_dirty = true;
+        }
+        pending_node_id = -1;
+    }
+
+    // Flush replies first: the flash write holds off interrupts for tens of milliseconds
+    if (settings_dirty)
+    {
+        lora_at_flush(&lora_config);
+        settings_persist();
+        settings_dirty = false;
+    }
+    return SCHEDULER_WAIT_EVENT;
+}
+
+/**
+ * @brief Idle hook: print logs, then sleep until the radio or the next timed task needs the core
+ *
+ * Logging is the lowest priority, so it only runs when no task is ready.
+ * Without LORA_LOW_POWER the hook returns at once, and the radio is polled
+ * on every pass as before.
+ *
+ * @param timeout_us Microseconds until the next timed task (0 = none)
+ * @param user_data Unused
+ */
+static void receiver_idle(uint32_t timeout_us, void *user_data)
+{
+    log_flush();
+    trace_console_poll();
+
+#ifdef LORA_LOW_POWER
+    // Post only for a start bit: the SEV of a post sets this core's event register too,
+    // so posting after every sleep would end the next WFE at once. radio_ready() covers the rest
+    if (lora_wait_for_rx(&lora_config, timeout_us))
+    {
+        scheduler_post(&scheduler, TASK_RADIO);
+    }
+#else
+    // Whatever ended the idle time may have been the radio
+    scheduler_post(&scheduler, TASK_RADIO);
+#endif
+}
+#endif
+
+void lora_message_handler(const lora_message_t *message, void *user_data)
+{
+    if (!message || !message->payload)
+    {
+        LOG(RUN, WARN, "LoRa: Received invalid message\n");
+        return;
+    }
+
+    LOG(RUN, DEBUG, "LoRa: Processing message from address %d: '%s'\n",
+        message->sender_address, message->payload);
+
+#ifndef LORA_TRANSMITTER_MODE
+    // Binary frames go through the opcode table; ASCII words remain for serial terminals
+    if (proto_is_frame(message->payload, message->payload_length))
+    {
+        handle_frame(message);
+    }
+    // Check for ON commands
+    else if (lora_is_on_command(message->payload))
+    {
+        motion_request(MOTION_CMD_START, 0);
+
+        // Send acknowledgment
+        char ack_msg[] = "STEPPERS_ON";
+        lora_send_message_async(&lora_config, message->sender_address, ack_msg, strlen(ack_msg),
+                                ack_sent_callback, NULL);
+    }
+    // Check for OFF commands
+    else if (lora_is_off_command(message->payload))
+    {
+        motion_request(MOTION_CMD_STOP, 0);
+
+        // Send acknowledgment
+        char ack_msg[] = "STEPPERS_OFF";
+        lora_send_message_async(&lora_config, message->sender_address, ack_msg, strlen(ack_msg),
+                                ack_sent_callback, NULL);
+    }
+    // Check for SPEED=<ms> commands
+    else if (strncasecmp(message->payload, "SPEED=", 6) == 0)
+    {
+        unsigned long speed_ms = strtoul(message->payload + 6, NULL, 10);
+        bool valid = speed_ms > 0 && speed_ms <= MOTION_SPEED_MAX_MS &&
+                     motion_request(MOTION_CMD_SPEED, (uint32_t)speed_ms);
+
+        // Send acknowledgment
+        const char *ack_msg = valid ? "SPEED_SET" : "BAD_SPEED";
+        lora_send_message_async(&lora_config, message->sender_address, ack_msg, strlen(ack_msg),
+                                ack_sent_callback, NULL);
+    }
+    // Check for GOTO=<steps> commands (absolute position, all motors)
+    else if (strncasecmp(message->payload, "GOTO=", 5) == 0)
+    {
+        long target = strtol(message->payload + 5, NULL, 10);
+        bool valid = target >= MOTION_TARGET_MIN && target <= MOTION_TARGET_MAX &&
+                     motion_request(MOTION_CMD_MOVE_TO, MOTION_TARGET_ARG(PROTO_MOTOR_ALL, target));
+
+        // Send acknowledgment
+        const char *ack_msg = valid ? "GOTO_SET" : "BAD_POSITION";
+        lora_send_message_async(&lora_config, message->sender_address, ack_msg, strlen(ack_msg),
+                                ack_sent_callback, NULL);
+    }
+    // Check for TRACE commands (latency histograms: summary over LoRa, full dump on stdio)
+    else if (strcasecmp(message->payload, "TRACE") == 0)
+    {
+        char summary[LORA_MAX_MESSAGE_LENGTH + 1] = "TRACE ";
+        size_t length = strlen(summary);
+        length += trace_format_summary(summary + length, sizeof(summary) - length);
+        lora_send_message_async(&lora_config, message->sender_address, summary, (uint8_t)length,
+                                ack_sent_callback, NULL);
+        trace_dump();
+    }
+    // Check for TASKS requests (per-task runs, worst run and wait times, deadline misses)
+    else if (strcasecmp(message->payload, "TASKS") == 0)
+    {
+        char tasks_msg[LORA_MAX_MESSAGE_LENGTH + 1];
+        uint8_t length = format_tasks(tasks_msg, sizeof(tasks_msg));
+        lora_send_message_async(&lora_config, message->sender_address, tasks_msg, length,
+                                ack_sent_callback, NULL);
+    }
+    // Check for STATS requests (compact counters for fleet monitoring)
+    else if (strcasecmp(message->payload, "STATS") == 0)
+    {
+        char stats_msg[LORA_MAX_MESSAGE_LENGTH + 1];
+        uint8_t length = format_stats(stats_msg, sizeof(stats_msg));
+        lora_send_message_async(&lora_config, message->sender_address, stats_msg, length,
+                                ack_sent_callback, NULL);
+    }
+    // Check for PROFILE=<name> commands
+    else if (strncasecmp(message->payload, "PROFILE=", 8) == 0)
+    {
+        lora_profile_t profile;
+        bool known = lora_profile_from_name(message->payload + 8, &profile);
+
+        // Acknowledge on the current parameters; the switch happens from the main loop
+        const char *ack_msg = known ? "PROFILE_SET" : "UNKNOWN_PROFILE";
+        lora_send_message_async(&lora_config, message->sender_address, ack_msg, strlen(ack_msg),
+                                ack_sent_callback, NULL);
+        if (known)
+        {
+            pending_profile = (int)profile;
+        }
+    }
+    // Check for NODE=<id> commands (new module address, taken after the acknowledgment)
+    else if (strncasecmp(message->payload, "NODE=", 5) == 0)
+    {
+        unsigned long id = strtoul(message->payload + 5, NULL, 10);
+        bool valid = id > 0 && id < LORA_BROADCAST_ADDRESS;
+
+        const char *ack_msg = valid ? "NODE_SET" : "BAD_NODE";
+        lora_send_message_async(&lora_config, message->sender_address, ack_msg, strlen(ack_msg),
+                                ack_sent_callback, NULL);
+        if (valid)
+        {
+            pending_node_id = (int32_t)id;
+        }
+    }
+    // Check for JOIN=<group> and LEAVE=<group> commands
+    else if (strncasecmp(message->payload, "JOIN=", 5) == 0 || strncasecmp(message->payload, "LEAVE=", 6) == 0)
+    {
+        bool join = (strncasecmp(message->payload, "JOIN=", 5) == 0);
+        unsigned long group = strtoul(message->payload + (join ? 5 : 6), NULL, 10);
+        bool valid = group < PROTO_GROUP_COUNT;
+
+        if (valid && join)
+        {
+            node_config.groups |= (uint16_t)(1u << group);
+        }
+        else if (valid)
+        {
+            node_config.groups &= (uint16_t)~(1u << group);
+        }
+
+        // A bad group must not cancel a save still pending from an earlier frame
+        settings_dirty |= valid;
+
+        const char *ack_msg = valid ? "GROUP_SET" : "BAD_GROUP";
+        lora_send_message_async(&lora_config, message->sender_address, ack_msg, strlen(ack_msg),
+                                ack_sent_callback, NULL);
+    }
+    // Check for SCRIPT=START/LOOP/PAUSE/ABORT commands (START runs one pass, LOOP until paused or aborted)
+    else if (strncasecmp(message->payload, "SCRIPT=", 7) == 0)
+    {
+        const char *action_name = message->payload + 7;
+        uint32_t arg = 0;
+        if (strcasecmp(action_name, "START") == 0 || strcasecmp(action_name, "LOOP") == 0)
+        {
+            uint8_t repeat = (strcasecmp(action_name, "START") == 0) ? 1 : 0;
+            arg = (script_committed_slot >= 0) ? MOTION_SCRIPT_ARG(PROTO_SCRIPT_START, repeat) : 0;
+        }
+        else if (strcasecmp(action_name, "PAUSE") == 0)
+        {
+            arg = MOTION_SCRIPT_ARG(PROTO_SCRIPT_PAUSE, 0);
+        }
+        else if (strcasecmp(action_name, "ABORT") == 0)
+        {
+            arg = MOTION_SCRIPT_ARG(PROTO_SCRIPT_ABORT, 0);
+        }
+
+        // Zero is MOTION_SCRIPT_LOAD, never a valid request from here
+        bool valid = arg != 0 && motion_request(MOTION_CMD_SCRIPT, arg);
+
+        const char *ack_msg = valid ? "SCRIPT_SET" : "BAD_SCRIPT";
+        lora_send_message_async(&lora_config, message->sender_address, ack_msg, strlen(ack_msg),
+                                ack_sent_callback, NULL);
+    }
+    // Check for SCRIPT? queries (stored step count, player state and current step)
+    else if (strcasecmp(message->payload, "SCRIPT?") == 0)
+    {
+        static const char *const state_names[] = {"IDLE", "RUNNING", "PAUSED"};
+        uint32_t status = atomic_load(&script_status);
+        uint steps = (script_committed_slot >= 0) ? scripts[script_committed_slot].count : 0;
+
+        char script_msg[48];
+        int length = snprintf(script_msg, sizeof(script_msg), "SCRIPT steps=%u state=%s step=%u", steps,
+                              state_names[MIN(status >> 16, count_of(state_names) - 1)],
+                              (unsigned)(status & 0xFFFFu));
+        lora_send_message_async(&lora_config, message->sender_address, script_msg, (uint8_t)length,
+                                ack_sent_callback, NULL);
+    }
+    // Check for NODE? queries (node ID and group membership mask)
+    else if (strcasecmp(message->payload, "NODE?") == 0)
+    {
+        char node_msg[32];
+        int length = snprintf(node_msg, sizeof(node_msg), "NODE id=%u groups=0x%04X",
+                              node_config.node_id, node_config.groups);
+        lora_send_message_async(&lora_config, message->sender_address, node_msg, (uint8_t)length,
+                                ack_sent_callback, NULL);
+    }
+    else
+#endif
+    {
+        LOG(RUN, WARN, "LoRa: Unknown command: %s\n", message->payload);
+
+        // Send error response
+        char error_msg[] = "UNKNOWN_COMMAND";
+        lora_send_message_async(&lora_config, message->sender_address, error_msg, strlen(error_msg),
+                                ack_sent_callback, NULL);
+    }
+}
+
+#ifdef LORA_TRANSMITTER_MODE
+// Transmitter mode functions
+
+#ifdef LORA_RELIABLE
+/**
+ * @brief Report whether the controller acknowledged a command
+ *
+ * @param status LORA_STATUS_OK if acknowledged, LORA_STATUS_TIMEOUT if every attempt went unanswered
+ * @param sequence Sequence number of the command
+ * @param attempts Transmissions made
+ * @param user_data Unused
+ */
+static void delivery_callback(lora_status_t status, uint8_t sequence, uint8_t attempts, void *user_data)
+{
+    if (status == LORA_STATUS_OK)
+    {
+        LOG(RUN, INFO, "Remote: ✅ Seq %d delivered (%d %s)\n", sequence, attempts,
+            attempts == 1 ? "transmission" : "transmissions");
+    }
+    else
+    {
+        LOG(RUN, ERROR, "Remote: ❌ Seq %d not acknowledged after %d transmissions\n", sequence, attempts);
+    }
+}
+#endif
+
+/**
+ * @brief Take the next sequence number for a frame to the controller
+ *
+ * @return uint8_t Sequence number to carry in the frame
+ */
+static uint8_t tx_next_sequence(void)
+{
+#ifdef LORA_RELIABLE
+    return lora_reliable_next_sequence(STEPPER_CONTROLLER_ADDRESS);
+#else
+    static uint8_t sequence = 0;
+    return sequence++;
+#endif
+}
+
+/**
+ * @brief Add a command to the aggregation window
+ *
+ * @param frame Command to queue; its sequence number is assigned when the window is sent
+ */
+static void queue_lora_frame(const proto_frame_t *frame)
+{
+    // The first command opens the window; later ones ride along
+    if (tx_batch.count == 0)
+    {
+        tx_batch_deadline = make_timeout_time_ms(TX_BATCH_WINDOW_MS);
+    }
+
+    tx_batch.commands[tx_batch.count++] = *frame;
 
-void control_steppers(stepper_motor_t *steppers, uint num_steppers)
-{
-    // Create array of pointers for bulk operations
-    stepper_motor_t *stepper_ptrs[NUM_STEPPERS];
-    for (uint i = 0; i < num_steppers; i++)
+    if (tx_batch.count >= PROTO_BATCH_MAX)
     {
-        stepper_ptrs[i] = &steppers[i];
+        flush_lora_frames();
     }
+}
 
-    // Continuous clockwise rotation - tiny increments for maximum interrupt responsiveness
-    stepper_rotate_multiple_degrees(stepper_ptrs, num_steppers, 1.0f, STEPPER_CW);
+void send_lora_frame(proto_opcode_t opcode, uint8_t motor_mask, uint16_t steps, uint16_t speed_ms)
+{
+    queue_lora_frame(&(proto_frame_t){.opcode = opcode,
+                                      .motor_mask = motor_mask,
+                                      .steps = steps,
+                                      .speed_ms = speed_ms});
+}
 
-    // No debug output - maximum speed for interrupt response
+void send_lora_script_control(proto_script_action_t action, uint8_t repeat)
+{
+    queue_lora_frame(&(proto_frame_t){.opcode = PROTO_OP_SCRIPT_CTL, .action = (uint8_t)action, .repeat = repeat});
 }
 
-/**
- * @brief Initialize all stepper motors with predefined GPIO pins
- *
- * @param steppers Array of stepper motor structures to initialize
- * @param num_steppers Number of steppers to initialize
- * @return true if all motors initialized successfully, false otherwise
- */
-static bool init_all_steppers(stepper_motor_t *steppers, uint num_steppers)
+void flush_lora_frames(void)
 {
-    if (num_steppers > NUM_STEPPERS)
+    char payload[PROTO_GROUP_ENCODED_MAX];
+    uint8_t length;
+
+    if (tx_batch.count == 0)
     {
-        printf("Error: Requested %d steppers, but only %d configurations available\n",
-               num_steppers, NUM_STEPPERS);
-        return false;
+        return;
     }
 
-    for (uint i = 0; i < num_steppers; i++)
+#if LORA_REMOTE_GROUP >= 0
+    // One broadcast moves every controller in the group; each answers in its own slot
+    static uint8_t group_sequence = 0;
+    tx_batch.sequence = group_sequence++;
+    tx_batch.group = (uint8_t)LORA_REMOTE_GROUP;
+    length = proto_encode_group(&tx_batch, payload, sizeof(payload));
+    if (length == 0)
     {
-        if (!stepper_init(&steppers[i],
-                          stepper_pins[i][0], stepper_pins[i][1],
-                          stepper_pins[i][2], stepper_pins[i][3],
-                          STEPPER_DELAY_MS))
+        LOG(RUN, ERROR, "Remote: Cannot encode %d queued commands\n", tx_batch.count);
+    }
+    else
+    {
+        LOG(RUN, DEBUG, "Remote: %d commands for group %d seq %d encoded as '%s'\n",
+            tx_batch.count, LORA_REMOTE_GROUP, tx_batch.sequence, payload);
+        lora_status_t status = lora_broadcast_message(&lora_config, payload, length);
+        if (status != LORA_STATUS_OK)
         {
-            printf("Failed to initialize stepper motor %d\n", i + 1);
-            return false;
+            LOG(RUN, ERROR, "Remote: Failed to broadcast group frame (status: %d)\n", status);
         }
-        printf("Stepper motor %d initialized on pins %d,%d,%d,%d\n",
-               i + 1, stepper_pins[i][0], stepper_pins[i][1],
-               stepper_pins[i][2], stepper_pins[i][3]);
     }
+#else
+    uint8_t sequence = tx_next_sequence();
 
-    return true;
+    // A lone command goes out as a plain frame, answered by a plain ACK
+    if (tx_batch.count == 1)
+    {
+        tx_batch.commands[0].sequence = sequence;
+        length = proto_encode(&tx_batch.commands[0], payload, sizeof(payload));
+    }
+    else
+    {
+        tx_batch.sequence = sequence;
+        length = proto_encode_batch(&tx_batch, payload, sizeof(payload));
+    }
+
+    if (length == 0)
+    {
+        LOG(RUN, ERROR, "Remote: Cannot encode %d queued commands\n", tx_batch.count);
+    }
+    else
+    {
+        LOG(RUN, DEBUG, "Remote: %d commands seq %d encoded as '%s'\n", tx_batch.count, sequence, payload);
+#ifdef LORA_RELIABLE
+        // The controller never answers an announcement, so only commands wait for an acknowledgment
+        if (tx_batch.count == 1 && tx_batch.commands[0].opcode == PROTO_OP_READY)
+        {
+            send_lora_command(payload);
+        }
+        else if (lora_reliable_send(&lora_config, STEPPER_CONTROLLER_ADDRESS, sequence, payload, length,
+                                    delivery_callback, NULL) != LORA_STATUS_OK)
+        {
+            LOG(RUN, ERROR, "Remote: ❌ Seq %d not sent, too many commands waiting for acknowledgment\n", sequence);
+        }
+#else
+        send_lora_command(payload);
+#endif
+    }
+#endif
+
+    tx_batch.count = 0;
 }
 
-void lora_message_handler(const lora_message_t *message, void *user_data)
+#ifdef LORA_RELIABLE
+/**
+ * @brief Report a script chunk's delivery and end the upload if it was lost
+ *
+ * @param status LORA_STATUS_OK if acknowledged, LORA_STATUS_TIMEOUT if every attempt went unanswered
+ * @param sequence Sequence number of the chunk
+ * @param attempts Transmissions made
+ * @param user_data Unused
+ */
+static void script_delivery_callback(lora_status_t status, uint8_t sequence, uint8_t attempts, void *user_data)
 {
-    if (!message || !message->payload)
+    delivery_callback(status, sequence, attempts, user_data);
+    if (status != LORA_STATUS_OK && script_sender.active && sequence == script_sender.sequence)
+    {
+        LOG(RUN, ERROR, "Remote: ❌ Script upload abandoned at chunk %d\n", script_sender.index + 1);
+        script_sender.active = false;
+    }
+}
+#endif
+
+/**
+ * @brief Encode the script chunk at the current index and send it
+ */
+static void script_sender_transmit(void)
+{
+    script_sender_t *sender = &script_sender;
+    uint first = (uint)sender->index * PROTO_SCRIPT_CHUNK_STEPS;
+    proto_script_chunk_t chunk = {.sequence = tx_next_sequence(),
+                                  .index = sender->index,
+                                  .chunks = sender->chunks,
+                                  .crc = sender->crc,
+                                  .count = (uint8_t)MIN(sender->count - first, (uint)PROTO_SCRIPT_CHUNK_STEPS)};
+    memcpy(chunk.steps, &sender->steps[first], chunk.count * sizeof(proto_script_step_t));
+
+#ifdef LORA_RELIABLE
+    char payload[PROTO_SCRIPT_ENCODED_MAX];
+#else
+    char *payload = sender->payload;
+#endif
+    uint8_t length = proto_encode_script(&chunk, payload, PROTO_SCRIPT_ENCODED_MAX);
+    if (length == 0)
     {
-        printf("LoRa: Received invalid message\n");
+        LOG(RUN, ERROR, "Remote: Cannot encode script chunk %d\n", chunk.index + 1);
+        sender->active = false;
         return;
     }
 
-    printf("LoRa: Processing message from address %d: '%s'\n",
-           message->sender_address, message->payload);
+    sender->sequence = chunk.sequence;
+    LOG(RUN, DEBUG, "Remote: Script chunk %d/%d seq %d with %d steps\n",
+        chunk.index + 1, chunk.chunks, chunk.sequence, chunk.count);
 
-    // Check for ON commands
-    if (lora_is_on_command(message->payload))
+#ifdef LORA_RELIABLE
+    if (lora_reliable_send(&lora_config, STEPPER_CONTROLLER_ADDRESS, chunk.sequence, payload, length,
+                           script_delivery_callback, NULL) != LORA_STATUS_OK)
     {
-        stepper_active = true;
+        LOG(RUN, ERROR, "Remote: ❌ Script chunk not sent, too many commands waiting for acknowledgment\n");
+        sender->active = false;
+    }
+#else
+    sender->length = length;
+    sender->attempts = 0;
+    sender->deadline = get_absolute_time(); // Sent by script_sender_service() right away
+#endif
+}
 
-        // Clear any previous interrupt flag
-        stepper_clear_interrupt();
+bool send_lora_script(const proto_script_step_t *steps, uint count)
+{
+    uint chunks = (count + PROTO_SCRIPT_CHUNK_STEPS - 1) / PROTO_SCRIPT_CHUNK_STEPS;
+    if (steps == NULL || count == 0 || chunks > UINT8_MAX || script_sender.active)
+    {
+        return false;
+    }
 
-        // Re-enable all motors after emergency stop
-        if (global_steppers && global_num_steppers > 0)
-        {
-            for (uint i = 0; i < global_num_steppers; i++)
-            {
-                global_steppers[i].enabled = true;
-            }
-        }
+    script_sender = (script_sender_t){.steps = steps,
+                                      .count = count,
+                                      .chunks = (uint8_t)chunks,
+                                      .crc = proto_script_crc(steps, count, PROTO_SCRIPT_CRC_INIT),
+                                      .active = true};
+    LOG(RUN, INFO, "Remote: Uploading script of %d steps in %d chunks\n", count, chunks);
+    script_sender_transmit();
+    return script_sender.active;
+}
 
-        // Execute stepper sequence
-        if (global_steppers && global_num_steppers > 0)
-        {
-            control_steppers(global_steppers, global_num_steppers);
-        }
+/**
+ * @brief Note the controller's answer to the script chunk in flight
+ *
+ * @param frame Decoded PROTO_OP_ACK frame
+ */
+static void script_sender_ack(const proto_frame_t *frame)
+{
+    if (!script_sender.active || frame->sequence != script_sender.sequence)
+    {
+        return;
+    }
 
-        // Send acknowledgment
-        char ack_msg[] = "STEPPERS_ON";
-        lora_send_message(&lora_config, message->sender_address, ack_msg, strlen(ack_msg));
+    if (frame->status == PROTO_ACK_OK)
+    {
+        script_sender.acked = true;
     }
-    // Check for OFF commands
-    else if (lora_is_off_command(message->payload))
+    else
     {
-        stepper_active = false;
+        LOG(RUN, ERROR, "Remote: ❌ Script chunk %d rejected (status %d), upload abandoned\n",
+            script_sender.index + 1, frame->status);
+        script_sender.active = false;
+    }
+}
 
-        // Set interrupt flag to immediately stop any running stepper operation
-        stepper_set_interrupt();
+/**
+ * @brief Move the script upload on: next chunk after an acknowledgment, resend after a timeout
+ *
+ * @return uint32_t Microseconds until the upload needs the loop again (0 = only on a reply)
+ */
+static uint32_t script_sender_service(void)
+{
+    script_sender_t *sender = &script_sender;
+    if (!sender->active)
+    {
+        return 0;
+    }
 
-        // IMMEDIATELY disable all motors - NO DELAYS!
-        if (global_steppers && global_num_steppers > 0)
+    if (sender->acked)
+    {
+        sender->acked = false;
+        if (++sender->index >= sender->chunks)
         {
-            stepper_emergency_stop_all(global_steppers, global_num_steppers);
+            sender->active = false;
+            LOG(RUN, INFO, "Remote: ✅ Script of %d steps uploaded\n", sender->count);
+            return 0;
         }
+        script_sender_transmit();
+    }
 
-        // Send acknowledgment
-        char ack_msg[] = "STEPPERS_OFF";
-        lora_send_message(&lora_config, message->sender_address, ack_msg, strlen(ack_msg));
+#ifdef LORA_RELIABLE
+    // The driver retransmits; script_delivery_callback() ends a lost upload
+    return 0;
+#else
+    if (!sender->active)
+    {
+        return 0;
     }
-    else
+
+    int64_t wait_us = absolute_time_diff_us(get_absolute_time(), sender->deadline);
+    if (wait_us > 0)
     {
-        printf("LoRa: Unknown command: %s\n", message->payload);
+        return (uint32_t)wait_us;
+    }
 
-        // Send error response
-        char error_msg[] = "UNKNOWN_COMMAND";
-        lora_send_message(&lora_config, message->sender_address, error_msg, strlen(error_msg));
+    if (sender->attempts >= SCRIPT_CHUNK_ATTEMPTS)
+    {
+        LOG(RUN, ERROR, "Remote: ❌ Script chunk %d not acknowledged after %d transmissions, upload abandoned\n",
+            sender->index + 1, sender->attempts);
+        sender->active = false;
+        return 0;
     }
-}
 
-#ifdef LORA_TRANSMITTER_MODE
-// Transmitter mode functions
+    // A resend keeps its sequence number, so the controller answers it without applying it twice
+    sender->attempts++;
+    lora_send_message(&lora_config, STEPPER_CONTROLLER_ADDRESS, sender->payload, sender->length);
+
+    uint32_t timeout_us = lora_time_on_air_us(&lora_config, sender->length) +
+                          lora_time_on_air_us(&lora_config, PROTO_ENCODED_MAX) + SCRIPT_TURNAROUND_MS * 1000u;
+    sender->deadline = make_timeout_time_us(timeout_us);
+    return timeout_us;
+#endif
+}
 
 void send_lora_command(const char *command)
 {
-    printf("Remote: Sending command '%s' to controller...\n", command);
+    LOG(RUN, DEBUG, "Remote: Sending command '%s' to controller...\n", command);
 
     lora_status_t status = lora_send_message(&lora_config,
                                              STEPPER_CONTROLLER_ADDRESS,
@@ -199,50 +1931,96 @@ void send_lora_command(const char *command)
 
     if (status == LORA_STATUS_OK)
     {
-        printf("Remote: Command sent successfully\n");
+        LOG(RUN, DEBUG, "Remote: Command sent successfully\n");
 
         // NO LED feedback - LED only for signal reception
     }
     else
     {
-        printf("Remote: Failed to send command (status: %d)\n", status);
+        LOG(RUN, ERROR, "Remote: Failed to send command (status: %d)\n", status);
+    }
+}
+
+/**
+ * @brief Log replies received from the stepper controller
+ *
+ * @param message Received message
+ * @param user_data Unused
+ */
+static void transmitter_reply_handler(const lora_message_t *message, void *user_data)
+{
+    proto_frame_t frame;
+    bool is_frame = proto_decode(message->payload, message->payload_length, &frame);
+
+#ifdef LORA_RELIABLE
+    // Stop retransmitting the command this answers
+    if (is_frame && (frame.opcode == PROTO_OP_ACK || frame.opcode == PROTO_OP_BATCH_ACK))
+    {
+        lora_reliable_ack(message->sender_address, frame.sequence);
+    }
+#endif
+
+    if (is_frame && frame.opcode == PROTO_OP_ACK)
+    {
+        LOG(RUN, INFO, "Remote: ACK from %d for seq %d: status %d\n",
+            message->sender_address, frame.sequence, frame.status);
+        script_sender_ack(&frame);
+    }
+    else if (is_frame && frame.opcode == PROTO_OP_BATCH_ACK)
+    {
+        uint16_t complete = (uint16_t)((1u << frame.count) - 1);
+        if (frame.bitmap == complete)
+        {
+            LOG(RUN, INFO, "Remote: Batch seq %d applied by %d (%d commands)\n",
+                frame.sequence, message->sender_address, frame.count);
+        }
+        else
+        {
+            LOG(RUN, WARN, "Remote: Batch seq %d rejected by %d, accepted bitmap 0x%04X of %d commands\n",
+                frame.sequence, message->sender_address, frame.bitmap, frame.count);
+        }
+    }
+    else if (is_frame && frame.opcode == PROTO_OP_READY)
+    {
+        LOG(RUN, INFO, "Remote: Controller %d is ready\n", message->sender_address);
+    }
+    else
+    {
+        LOG(RUN, INFO, "Remote: Reply from %d: '%s'\n", message->sender_address, message->payload);
     }
 }
 
 void run_transmitter_mode()
 {
-    // Give USB serial time to initialize
-    sleep_ms(3000);
+    // Give USB serial time to initialize, unless nothing will be printed
+    if (LOG_ANY_ENABLED)
+    {
+        sleep_ms(3000);
+    }
 
-    printf("\n=== LoRa Remote Control Transmitter ===\n");
-    printf("Remote: System starting up...\n");
+    LOG(RUN, INFO, "\n=== LoRa Remote Control Transmitter ===\n");
+    LOG(RUN, INFO, "Remote: System starting up...\n");
 
-    // Initialize buttons with internal pull-ups
+    // Initialize buttons with internal pull-ups; presses arrive by edge interrupt
     lora_buttons_init_all(buttons);
+    lora_button_enable_irq(&buttons[0]);
+    lora_button_enable_irq(&buttons[1]);
 
     // Initialize LoRa
-    printf("Remote: Initializing LoRa module...\n");
-    printf("Remote: UART1 TX=GPIO%d, RX=GPIO%d\n", LORA_TX_PIN, LORA_RX_PIN);
-    printf("Remote: Network ID=%d, Address=%d, Frequency=%d MHz\n",
-           LORA_NETWORK_ID, LORA_DEVICE_ADDRESS, LORA_FREQUENCY / 1000000);
-
-    // Auto-detect LoRa module baud rate
-    uint working_baud = detect_lora_baud_rate();
-
-    lora_status_t status = lora_init_custom(&lora_config,
-                                            LORA_UART_INST,
-                                            LORA_TX_PIN,
-                                            LORA_RX_PIN,
-                                            LORA_NETWORK_ID,
-                                            LORA_DEVICE_ADDRESS,
-                                            LORA_FREQUENCY,
-                                            LORA_POWER);
+    LOG(RUN, INFO, "Remote: Initializing LoRa module...\n");
+    LOG(RUN, INFO, "Remote: UART1 TX=GPIO%d, RX=GPIO%d\n", LORA_TX_PIN, LORA_RX_PIN);
+    LOG(RUN, INFO, "Remote: Network ID=%d, Address=%d, Frequency=%d MHz\n",
+        LORA_NETWORK_ID, LORA_DEVICE_ADDRESS, LORA_FREQUENCY / 1000000);
+
+    // Reuse the baud rate and module settings from the last boot when they still work
+    config_store_load(&settings);
+    lora_status_t status = radio_start(LORA_DEVICE_ADDRESS);
 
     if (status != LORA_STATUS_OK)
     {
-        printf("Remote: LoRa initialization failed! Status code: %d\n", status);
-        printf("Remote: Check wiring - VCC=3.3V, GND=GND, TXD=GPIO5, RXD=GPIO4\n");
-        printf("Remote: LoRa module issue - check serial output!\n");
+        LOG(RUN, ERROR, "Remote: LoRa initialization failed! Status code: %d\n", status);
+        LOG(RUN, ERROR, "Remote: Check wiring - VCC=3.3V, GND=GND, TXD=GPIO5, RXD=GPIO4\n");
+        LOG(RUN, ERROR, "Remote: LoRa module issue - check serial output!\n");
         while (1)
         {
             // NO LED blinking - LED only for signal reception
@@ -250,32 +2028,75 @@ void run_transmitter_mode()
         }
     }
 
-    printf("Remote: LoRa initialized successfully!\n");
-    printf("Remote: Network ID: %d, Address: %d\n", LORA_NETWORK_ID, LORA_DEVICE_ADDRESS);
-    printf("Remote: Target controller address: %d\n", STEPPER_CONTROLLER_ADDRESS);
-    printf("\nRemote: Button Controls:\n");
-    printf("  - Button 1 (GPIO 2): Send 'ON' command\n");
-    printf("  - Button 2 (GPIO 3): Send 'OFF' command\n");
-    printf("\nRemote: Ready for commands!\n");
+    LOG(RUN, INFO, "Remote: LoRa initialized successfully!\n");
+    LOG(RUN, INFO, "Remote: Network ID: %d, Address: %d\n", LORA_NETWORK_ID, LORA_DEVICE_ADDRESS);
+#if LORA_REMOTE_GROUP >= 0
+    LOG(RUN, INFO, "Remote: Target controller group: %d (broadcast)\n", LORA_REMOTE_GROUP);
+#else
+    LOG(RUN, INFO, "Remote: Target controller address: %d\n", STEPPER_CONTROLLER_ADDRESS);
+#endif
+    LOG(RUN, INFO, "\nRemote: Button Controls:\n");
+    LOG(RUN, INFO, "  - Button 1 (GPIO 2): Send START frame\n");
+    LOG(RUN, INFO, "  - Button 2 (GPIO 3): Send STOP frame\n");
+    LOG(RUN, INFO, "\nRemote: Ready for commands!\n");
+
+    // Controller acknowledgments are queued on receive and drained in the loop
+    lora_set_message_handler(&lora_config, transmitter_reply_handler, NULL);
 
     // Send startup announcement
-    send_lora_command("REMOTE_READY");
+    send_lora_frame(PROTO_OP_READY, 0, 0, 0);
 
     // Main transmitter loop
     while (1)
     {
-        // Check for button presses
-        if (lora_button_pressed(&buttons[0]))
+        // Handle queued button presses
+        lora_button_event_t press;
+        while (lora_button_get_event(&press))
         {
-            send_lora_command("ON");
+            LOG(RUN, DEBUG, "Remote: Button GPIO%u pressed %lu us ago\n",
+                press.pin, (unsigned long)(time_us_32() - press.time_us));
+
+            if (press.pin == BUTTON_ON_PIN)
+            {
+                send_lora_frame(PROTO_OP_START, PROTO_MOTOR_ALL, 0, 0);
+            }
+            else if (press.pin == BUTTON_OFF_PIN)
+            {
+                send_lora_frame(PROTO_OP_STOP, PROTO_MOTOR_ALL, 0, 0);
+            }
         }
 
-        if (lora_button_pressed(&buttons[1]))
+        // Send whatever the aggregation window collected
+        if (tx_batch.count > 0 && time_reached(tx_batch_deadline))
         {
-            send_lora_command("OFF");
+            flush_lora_frames();
         }
 
-        sleep_ms(10); // Small delay to prevent excessive CPU usage
+        // Drain controller replies so the inbound queue never backs up
+        lora_process_messages(&lora_config);
+
+        // Next script chunk once the previous one was acknowledged
+        uint32_t script_us = script_sender_service();
+
+        // Print deferred ISR log records while idle
+        log_flush();
+        trace_console_poll();
+
+        // Sleep until a button, the radio, the batch window or a script resend needs the core
+        uint32_t sleep_us = script_us;
+        if (tx_batch.count > 0)
+        {
+            int64_t window_us = absolute_time_diff_us(get_absolute_time(), tx_batch_deadline);
+            if (window_us <= 0)
+            {
+                continue;
+            }
+            if (sleep_us == 0 || (uint32_t)window_us < sleep_us)
+            {
+                sleep_us = (uint32_t)window_us;
+            }
+        }
+        lora_wait_for_rx(&lora_config, sleep_us);
     }
 }
 #endif
@@ -283,18 +2104,23 @@ void run_transmitter_mode()
 // Multi-baud-rate test function for LoRa module
 bool test_lora_baud_rate(uint baud_rate)
 {
-    printf("Testing baud rate %d...\n", baud_rate);
+    LOG(RUN, DEBUG, "Testing baud rate %d...\n", baud_rate);
 
-    // Reinitialize UART with new baud rate
-    uart_deinit(LORA_UART_INST);
-    uart_init(LORA_UART_INST, baud_rate);
-    gpio_set_function(LORA_TX_PIN, GPIO_FUNC_UART);
-    gpio_set_function(LORA_RX_PIN, GPIO_FUNC_UART);
-    uart_set_hw_flow(LORA_UART_INST, false, false);
-    uart_set_format(LORA_UART_INST, 8, 1, UART_PARITY_NONE);
-    uart_set_fifo_enabled(LORA_UART_INST, true);
-
-    sleep_ms(500); // Let UART stabilize
+    // Retune in place once the UART is up, so the TX line never glitches between rates
+    if (uart_is_enabled(LORA_UART_INST))
+    {
+        uart_tx_wait_blocking(LORA_UART_INST);
+        uart_set_baudrate(LORA_UART_INST, baud_rate);
+    }
+    else
+    {
+        uart_init(LORA_UART_INST, baud_rate);
+        gpio_set_function(LORA_TX_PIN, GPIO_FUNC_UART);
+        gpio_set_function(LORA_RX_PIN, GPIO_FUNC_UART);
+        uart_set_hw_flow(LORA_UART_INST, false, false);
+        uart_set_format(LORA_UART_INST, 8, 1, UART_PARITY_NONE);
+        uart_set_fifo_enabled(LORA_UART_INST, true);
+    }
 
     // Clear any pending data
     while (uart_is_readable(LORA_UART_INST))
@@ -302,29 +2128,40 @@ bool test_lora_baud_rate(uint baud_rate)
         uart_getc(LORA_UART_INST);
     }
 
-    // Send AT command
+    // Send AT command and read the reply as it arrives
     uart_puts(LORA_UART_INST, "AT\r\n");
-    sleep_ms(1000);
+    absolute_time_t deadline = make_timeout_time_us(baud_probe_timeout_us(baud_rate));
 
-    if (uart_is_readable(LORA_UART_INST))
+    char buffer[32];
+    int i = 0;
+    buffer[0] = '\0';
+    while (!time_reached(deadline))
     {
-        char buffer[32];
-        int i = 0;
-        while (uart_is_readable(LORA_UART_INST) && i < 31)
+        if (!uart_is_readable(LORA_UART_INST))
         {
-            buffer[i] = uart_getc(LORA_UART_INST);
-            i++;
+            tight_loop_contents();
+            continue;
         }
-        buffer[i] = '\0';
 
-        printf("Response at %d baud: '%s'\n", baud_rate, buffer);
+        char c = uart_getc(LORA_UART_INST);
+        if (i < (int)sizeof(buffer) - 1)
+        {
+            buffer[i++] = c;
+            buffer[i] = '\0';
+        }
 
-        // Check if response contains "+OK" (good response)
-        if (strstr(buffer, "+OK") != NULL)
+        // A whole line that starts like a module reply means the rate is right;
+        // +ERR only says a stray byte from the retune reached the module first
+        if (c == '\n' && (strstr(buffer, "+OK") != NULL || strstr(buffer, "+ERR") != NULL))
         {
-            printf("✅ Found working baud rate: %d\n", baud_rate);
+            LOG(RUN, INFO, "✅ Found working baud rate: %d\n", baud_rate);
             return true;
         }
+    }
+
+    if (i > 0)
+    {
+        LOG(RUN, DEBUG, "Response at %d baud: '%s'\n", baud_rate, buffer);
 
         // Check if response has printable characters (partial success)
         bool has_printable = false;
@@ -339,51 +2176,70 @@ bool test_lora_baud_rate(uint baud_rate)
 
         if (has_printable)
         {
-            printf("⚠️  Got readable response, but not +OK\n");
+            LOG(RUN, DEBUG, "⚠️  Got readable response, but not +OK\n");
         }
         else
         {
-            printf("❌ Got garbled response\n");
+            LOG(RUN, DEBUG, "❌ Got garbled response\n");
         }
     }
     else
     {
-        printf("❌ No response at %d baud\n", baud_rate);
+        LOG(RUN, DEBUG, "❌ No response at %d baud\n", baud_rate);
     }
 
     return false;
 }
 
 // Auto-detect LoRa module baud rate
-uint detect_lora_baud_rate(void)
+uint detect_lora_baud_rate(uint preferred)
 {
-    printf("\n=== Auto-detecting LoRa module baud rate ===\n");
-    printf("This will test common baud rates for RYLR998 module\n");
+    LOG(RUN, INFO, "\n=== Auto-detecting LoRa module baud rate ===\n");
+    LOG(RUN, INFO, "This will test common baud rates for RYLR998 module\n");
 
-    // Common baud rates for RYLR998 modules
-    uint baud_rates[] = {9600, 115200, 57600, 38400, 19200, 4800, 2400};
-    uint num_rates = sizeof(baud_rates) / sizeof(baud_rates[0]);
+    // AT+IPR rates, most likely first: this firmware's default, then the module's factory rate
+    static const uint baud_rates[] = {LORA_DEFAULT_BAUD_RATE, 115200, 57600, 38400, 28800, 19200, 4800};
+    uint num_rates = count_of(baud_rates);
 
-    for (uint i = 0; i < num_rates; i++)
+    // Keep sweeping while the module may still be starting up
+    absolute_time_t deadline = make_timeout_time_ms(LORA_BOOT_WAIT_MS);
+    do
     {
-        if (test_lora_baud_rate(baud_rates[i]))
+        if (preferred != 0 && test_lora_baud_rate(preferred))
         {
-            printf("✅ Successfully detected baud rate: %d\n", baud_rates[i]);
-            return baud_rates[i];
+            LOG(RUN, INFO, "✅ Successfully detected baud rate: %d\n", preferred);
+            return preferred;
         }
-        sleep_ms(200); // Small delay between tests
-    }
 
-    printf("❌ Could not detect working baud rate!\n");
-    printf("Troubleshooting:\n");
-    printf("1. Check power: LoRa module needs 3.3V (NOT 5V!)\n");
-    printf("2. Check wiring: TXD->GPIO5, RXD->GPIO4, VCC->3.3V, GND->GND\n");
-    printf("3. Try swapping TX/RX pins if still not working\n");
-    printf("4. Check if module is getting power (LED should be on)\n");
-    printf("5. Try a different LoRa module if available\n");
+        for (uint i = 0; i < num_rates; i++)
+        {
+            if (baud_rates[i] != preferred && test_lora_baud_rate(baud_rates[i]))
+            {
+                LOG(RUN, INFO, "✅ Successfully detected baud rate: %d\n", baud_rates[i]);
+                return baud_rates[i];
+            }
+        }
+    } while (!time_reached(deadline));
+
+    LOG(RUN, ERROR, "❌ Could not detect working baud rate!\n");
+    LOG(RUN, ERROR, "Troubleshooting:\n");
+    LOG(RUN, ERROR, "1. Check power: LoRa module needs 3.3V (NOT 5V!)\n");
+    LOG(RUN, ERROR, "2. Check wiring: TXD->GPIO5, RXD->GPIO4, VCC->3.3V, GND->GND\n");
+    LOG(RUN, ERROR, "3. Try swapping TX/RX pins if still not working\n");
+    LOG(RUN, ERROR, "4. Check if module is getting power (LED should be on)\n");
+    LOG(RUN, ERROR, "5. Try a different LoRa module if available\n");
+
+    return LORA_DEFAULT_BAUD_RATE; // Default fallback
+}
 
-    return 9600; // Default fallback
+#ifdef LORA_BENCH
+void run_bench(void)
+{
+    // Measure before the radio and motors start
+    bench_init();
+    bench_run_all(stepper_pins, NUM_STEPPERS);
 }
+#endif
 
 void run(void)
 {
@@ -391,157 +2247,121 @@ void run(void)
     gpio_init(PICO_DEFAULT_LED_PIN);
     gpio_set_dir(PICO_DEFAULT_LED_PIN, GPIO_OUT);
 
-    // Add startup delay for serial output to stabilize
-    sleep_ms(2000);
+    // Add startup delay for serial output to stabilize, unless nothing will be printed
+    if (LOG_ANY_ENABLED)
+    {
+        sleep_ms(2000);
+    }
 
 #ifdef LORA_TRANSMITTER_MODE
-    printf("\n🔴 TRANSMITTER MODE ACTIVE 🔴\n");
-    printf("This device is configured as REMOTE CONTROL\n");
+    LOG(RUN, INFO, "\n🔴 TRANSMITTER MODE ACTIVE 🔴\n");
+    LOG(RUN, INFO, "This device is configured as REMOTE CONTROL\n");
     // Run in transmitter mode
     run_transmitter_mode();
 #else
-    printf("\n🔵 RECEIVER MODE ACTIVE 🔵\n");
-    printf("This device is configured as STEPPER CONTROLLER\n");
+    LOG(RUN, INFO, "\n🔵 RECEIVER MODE ACTIVE 🔵\n");
+    LOG(RUN, INFO, "This device is configured as STEPPER CONTROLLER\n");
     // Run in receiver mode (default)
-    printf("\n=== LoRa Stepper Motor Controller ===\n");
+    LOG(RUN, INFO, "\n=== LoRa Stepper Motor Controller ===\n");
+
+    // Set up before anything can post to it; tasks are added once the radio is up
+    scheduler_init(&scheduler, receiver_idle, NULL);
 
     // Initialize 4 stepper motors with GPIO pins avoiding UART pins
     stepper_motor_t steppers[NUM_STEPPERS];
 
-    if (!init_all_steppers(steppers, NUM_STEPPERS))
+    // Set global references for LoRa message handler and motion loop
+    global_steppers = steppers;
+    global_num_steppers = NUM_STEPPERS;
+
+#ifdef LORA_DUAL_CORE
+    // Motion control runs on core 1, which initializes the steppers itself
+    LOG(RUN, INFO, "Launching motion control on core 1...\n");
+    multicore_launch_core1(motion_core_entry);
+    bool steppers_ok = (multicore_fifo_pop_blocking() != 0);
+#else
+    bool steppers_ok = init_all_steppers(steppers, NUM_STEPPERS);
+    motion_script_init(&script_player, steppers, NUM_STEPPERS);
+#endif
+
+    if (!steppers_ok)
     {
-        printf("Stepper motor initialization failed. Exiting...\n");
+        LOG(RUN, ERROR, "Stepper motor initialization failed. Exiting...\n");
         return;
     }
 
-    // Set global references for LoRa message handler
-    global_steppers = steppers;
-    global_num_steppers = NUM_STEPPERS;
-
-    printf("All stepper motors initialized successfully!\n");
+    LOG(RUN, INFO, "All stepper motors initialized successfully!\n");
 
     // Initialize LoRa module
-    printf("Initializing LoRa module...\n");
+    LOG(RUN, INFO, "Initializing LoRa module...\n");
 
-    // Auto-detect LoRa module baud rate
-    uint working_baud = detect_lora_baud_rate();
+    // Node ID and groups assigned over LoRa survive the reset
+    if (config_store_load(&settings) && settings.node_id != 0)
+    {
+        node_config.node_id = settings.node_id;
+        node_config.groups = settings.groups;
+        LOG(RUN, INFO, "LoRa: Stored node ID %d, groups 0x%04X\n", node_config.node_id, node_config.groups);
+    }
 
-    lora_status_t lora_status = lora_init_custom(&lora_config, LORA_UART_INST,
-                                                 LORA_TX_PIN, LORA_RX_PIN,
-                                                 LORA_NETWORK_ID, LORA_DEVICE_ADDRESS,
-                                                 LORA_FREQUENCY, LORA_POWER);
+    // Reuse the baud rate and module settings from the last boot when they still work
+    lora_status_t lora_status = radio_start(node_config.node_id);
 
     if (lora_status != LORA_STATUS_OK)
     {
-        printf("LoRa initialization failed (status: %d). SAFETY MODE ACTIVE.\n", lora_status);
-        printf("Safety: Steppers are DISABLED until LoRa is working properly\n");
-        printf("Safety: Fix LoRa configuration issues before motors will activate\n");
+        LOG(RUN, ERROR, "LoRa initialization failed (status: %d). SAFETY MODE ACTIVE.\n", lora_status);
+        LOG(RUN, ERROR, "Safety: Steppers are DISABLED until LoRa is working properly\n");
+        LOG(RUN, ERROR, "Safety: Fix LoRa configuration issues before motors will activate\n");
     }
     else
     {
-        printf("LoRa module initialized successfully!\n");
-        printf("LoRa: Network ID: %d, Address: %d, Freq: %ld Hz\n",
-               LORA_NETWORK_ID, LORA_DEVICE_ADDRESS, LORA_FREQUENCY);
-        printf("LoRa: Steppers will ONLY run when commanded via LoRa\n");
+        LOG(RUN, INFO, "LoRa module initialized successfully!\n");
+        LOG(RUN, INFO, "LoRa: Network ID: %d, Address: %d, Freq: %ld Hz\n",
+            LORA_NETWORK_ID, node_config.node_id, LORA_FREQUENCY);
+        LOG(RUN, INFO, "LoRa: Steppers will ONLY run when commanded via LoRa\n");
 
         // Verify LoRa configuration by querying the module
-        printf("LoRa: Verifying module configuration...\n");
-        char response[64];
-
-        // Check network ID
-        lora_status_t status = lora_send_at_command(&lora_config, "AT+NETWORKID?", response, sizeof(response));
-        if (status == LORA_STATUS_OK)
-        {
-            printf("LoRa: Current Network ID: %s\n", response);
-        }
-        else
-        {
-            printf("LoRa: ❌ Failed to get Network ID (status: %d)\n", status);
-        }
-
-        // Check device address
-        status = lora_send_at_command(&lora_config, "AT+ADDRESS?", response, sizeof(response));
-        if (status == LORA_STATUS_OK)
-        {
-            printf("LoRa: Current Address: %s\n", response);
-        }
-        else
-        {
-            printf("LoRa: ❌ Failed to get Address (status: %d)\n", status);
-        }
-
-        // Check frequency
-        status = lora_send_at_command(&lora_config, "AT+BAND?", response, sizeof(response));
-        if (status == LORA_STATUS_OK)
-        {
-            printf("LoRa: Current Frequency: %s MHz\n", response);
-        }
-        else
-        {
-            printf("LoRa: ❌ Failed to get Frequency (status: %d)\n", status);
-        }
+        LOG(RUN, INFO, "LoRa: Verifying module configuration...\n");
+        // Queue the queries; they complete from lora_process_messages() in the main loop
+        lora_send_at_command_async(&lora_config, "AT+NETWORKID?", config_query_callback, "Network ID");
+        lora_send_at_command_async(&lora_config, "AT+ADDRESS?", config_query_callback, "Address");
+        lora_send_at_command_async(&lora_config, "AT+BAND?", config_query_callback, "Frequency");
 
         // Set up LoRa message handler
         lora_set_message_handler(&lora_config, lora_message_handler, steppers);
 
-        // Send startup message to announce receiver is ready
-        char startup_msg[] = "STEPPER_CONTROLLER_READY";
-        lora_broadcast_message(&lora_config, startup_msg, strlen(startup_msg));
+        // Send startup frame to announce receiver is ready
+        proto_frame_t ready = {.opcode = PROTO_OP_READY, .motor_mask = PROTO_MOTOR_ALL};
+        char startup_msg[PROTO_ENCODED_MAX];
+        uint8_t startup_len = proto_encode(&ready, startup_msg, sizeof(startup_msg));
+        lora_broadcast_message(&lora_config, startup_msg, startup_len);
+
+#if defined(LORA_LOW_POWER) && LORA_SMART_RX_MS > 0
+        // The module duty-cycles its receiver too; transmitters must repeat across its sleep window
+        lora_at_flush(&lora_config);
+        lora_set_smart_receive(&lora_config, LORA_SMART_RX_MS, LORA_SMART_SLEEP_MS);
+#endif
     }
 
-    printf("Starting LED blink, stepper motor control, and LoRa communication loop...\n");
-    printf("LoRa Commands: ON/START/MOVE/1 to activate, OFF/STOP/HALT/0 to deactivate\n");
+    LOG(RUN, INFO, "Starting LED blink, stepper motor control, and LoRa communication loop...\n");
+    LOG(RUN, INFO, "LoRa Commands: ON/START/MOVE/1 to activate, OFF/STOP/HALT/0 to deactivate\n");
 
-    uint cycle_count = 0;
     bool lora_initialized = (lora_status == LORA_STATUS_OK);
+    loop_stats.window_start_us = time_us_64();
 
-    // Main receiver loop
-    while (true)
+    // Main receiver loop: run-to-completion tasks by priority, the idle hook when none is ready.
+    // Safety mode adds no task, so without a working radio NO motor is ever activated
+    if (lora_initialized)
     {
-        // NO LED blinking - LED only for signal reception
-
-        // Process LoRa messages if initialized
-        if (lora_initialized)
-        {
-            lora_status_t msg_status = lora_process_messages(&lora_config);
-            if (msg_status == LORA_STATUS_OK)
-            {
-                // ONLY LED usage: Flash when receiving a LoRa signal
-                gpio_put(PICO_DEFAULT_LED_PIN, 1);
-                // Immediate turn-off - no delay
-                gpio_put(PICO_DEFAULT_LED_PIN, 0);
-            }
-
-            // Run steppers continuously when active
-            if (stepper_active)
-            {
-                // Check if steppers were interrupted
-                if (stepper_is_interrupted())
-                {
-                    stepper_active = false;
-                }
-                else
-                {
-                    control_steppers(steppers, NUM_STEPPERS);
-
-                    // Check again after stepper operation in case it was interrupted
-                    if (stepper_is_interrupted())
-                    {
-                        stepper_active = false;
-                    }
-                }
-            }
-        }
-        else
-        {
-            // Safety mode: NO motor activation without proper LoRa
-            // Remove periodic messaging to maximize LoRa processing speed
-        }
-
-        cycle_count++;
-
-        // Remove periodic status updates to maximize LoRa processing speed
-        // Status updates would add delays to the main loop
+        scheduler_add(&scheduler, TASK_STOP, "stop", task_stop, NULL, NULL, TASK_STOP_DEADLINE_US);
+        scheduler_add(&scheduler, TASK_RADIO, "radio", task_radio, radio_ready, NULL, TASK_RADIO_DEADLINE_US);
+#ifndef LORA_DUAL_CORE
+        // Core 1 runs the motion loop in dual-core builds
+        scheduler_add(&scheduler, TASK_MOTION, "motion", task_motion, NULL, NULL, TASK_MOTION_DEADLINE_US);
+#endif
+        scheduler_add(&scheduler, TASK_REPLIES, "replies", task_replies, NULL, NULL, TASK_REPLIES_DEADLINE_US);
+        scheduler_add(&scheduler, TASK_CONFIG, "config", task_config, config_ready, NULL, 0);
     }
+
+    scheduler_run(&scheduler);
 #endif
 }
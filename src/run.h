@@ -34,6 +34,7 @@
 #include "pico/stdlib.h"
 #include "stepper.h"
 #include "lora.h"
+#include "protocol.h"
 
 /**
  * @brief Main application function
@@ -73,6 +74,18 @@
  */
 void run(void);
 
+#ifdef LORA_BENCH
+/**
+ * @brief Run the on-target benchmarks on this board's stepper pins
+ *
+ * Entry point of the LoRa_bench image. Call instead of run(): the radio and
+ * the motors are never initialized, so nothing transmits or moves.
+ *
+ * @pre stdio_init_all() must be called before this function
+ */
+void run_bench(void);
+#endif
+
 /**
  * @brief Execute one LED blink cycle
  *
@@ -140,6 +153,19 @@ void control_steppers(stepper_motor_t *steppers, uint num_steppers);
  * Supported commands (case insensitive):
  * - ON, START, MOVE, 1: Activate stepper motor sequence
  * - OFF, STOP, HALT, 0: Stop stepper motor operation
+ * - SPEED=<ms>: Set the delay between steps
+ * - GOTO=<steps>: Move every motor to an absolute position
+ * - Binary protocol frames (protocol.h) are dispatched by opcode and
+ *   answered with a PROTO_OP_ACK frame carrying the same sequence number;
+ *   a PROTO_OP_BATCH frame is applied all-or-nothing and answered with one
+ *   PROTO_OP_BATCH_ACK bitmap
+ * - PROFILE=<name>: Switch radio profile (LOW_LATENCY, BALANCED, LONG_RANGE)
+ *   after acknowledging; the sender must switch to the same profile
+ * - SCRIPT=START|LOOP|PAUSE|ABORT and SCRIPT?: Control and query the motion
+ *   script uploaded in PROTO_OP_SCRIPT chunks
+ *
+ * In dual-core builds (LORA_DUAL_CORE) the handler runs on core 0 and only
+ * queues the motion command for core 1, so acknowledgements never stall motion.
  *
  * @note This function is called automatically when LoRa messages are received
  * @warning Stepper operations are blocking and may affect LoRa response timing
@@ -162,7 +188,9 @@ void lora_message_handler(const lora_message_t *message, void *user_data);
  * @brief Test LoRa module communication at specific baud rate
  *
  * Tests communication with the LoRa module at a specific baud rate by
- * sending an AT command and checking for a valid response.
+ * sending an AT command and polling the RX FIFO for the reply. Returns as
+ * soon as a reply line arrives; otherwise gives up after the wire time of
+ * the exchange plus the module's turnaround.
  *
  * @param baud_rate The baud rate to test (e.g., 9600, 115200)
  * @return true if communication successful, false otherwise
@@ -173,13 +201,68 @@ bool test_lora_baud_rate(uint baud_rate);
  * @brief Auto-detect LoRa module baud rate
  *
  * Automatically detects the correct baud rate for the LoRa module by
- * testing common baud rates and checking for valid responses.
+ * testing the preferred rate, then the rates AT+IPR supports in order of
+ * likelihood. Sweeps repeat until LORA_BOOT_WAIT_MS has passed, in case the
+ * module is still starting up.
  *
- * @return The detected working baud rate, or 9600 as fallback
+ * @param preferred Rate to try first, e.g. the last one that worked (0 = none)
+ * @return The detected working baud rate, or LORA_DEFAULT_BAUD_RATE as fallback
  */
-uint detect_lora_baud_rate(void);
+uint detect_lora_baud_rate(uint preferred);
 
 #ifdef LORA_TRANSMITTER_MODE
+/**
+ * @brief Queue a binary protocol command for the stepper controller
+ *
+ * Commands queued within TX_BATCH_WINDOW_MS of the first one are sent
+ * together by flush_lora_frames(): a lone command as a plain frame, several
+ * as one batch frame applied atomically and answered by one bitmap ack.
+ * The batch is flushed at once when it holds PROTO_BATCH_MAX commands.
+ *
+ * @param opcode Frame opcode
+ * @param motor_mask Target motors (bit n = motor n+1)
+ * @param steps Step count (PROTO_OP_MOVE only)
+ * @param speed_ms Step delay in milliseconds (PROTO_OP_SPEED / PROTO_OP_MOVE)
+ * @return void
+ */
+void send_lora_frame(proto_opcode_t opcode, uint8_t motor_mask, uint16_t steps, uint16_t speed_ms);
+
+/**
+ * @brief Queue a command for the controller's stored motion script
+ *
+ * Goes out with the other commands of the aggregation window, so it can be
+ * batched or broadcast to a group like any other command.
+ *
+ * @param action PROTO_SCRIPT_START, PROTO_SCRIPT_PAUSE or PROTO_SCRIPT_ABORT
+ * @param repeat Passes for PROTO_SCRIPT_START (0 = until paused or aborted)
+ * @return void
+ */
+void send_lora_script_control(proto_script_action_t action, uint8_t repeat);
+
+/**
+ * @brief Upload a motion script to the stepper controller
+ *
+ * The steps are sent in chunks of PROTO_SCRIPT_CHUNK_STEPS, one at a time:
+ * each chunk goes out once the controller acknowledged the previous one,
+ * and the upload is abandoned if a chunk is rejected or never acknowledged.
+ * The controller makes the script current after the last chunk passes the
+ * CRC check; send_lora_script_control() then runs it.
+ *
+ * @param steps Steps in order; must stay valid until the upload ends
+ * @param count Number of steps (the controller stores up to MOTION_SCRIPT_MAX_STEPS)
+ * @return true if the upload started, false if the arguments are invalid or an upload is in progress
+ */
+bool send_lora_script(const proto_script_step_t *steps, uint count);
+
+/**
+ * @brief Send the queued commands now, using the next sequence number
+ *
+ * The controller's acknowledgment echoes the sequence number.
+ *
+ * @return void
+ */
+void flush_lora_frames(void);
+
 /**
  * @brief Send LoRa command to stepper controller
  *
@@ -0,0 +1,229 @@
+/**
+ * @file scheduler.c
+ * @brief Cooperative priority scheduler implementation
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This source file implements the priority scheduler. Ready tasks are kept
+ * as a bitmask indexed by priority, so picking the next one is a count of
+ * trailing zeros. Posts set bits under a hardware spin lock and send SEV,
+ * so an idle hook waiting in WFE wakes for them.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#include <string.h>
+#include "scheduler.h"
+
+// Forward declarations
+static uint32_t scheduler_take_posted(scheduler_t *scheduler);
+static void scheduler_dispatch(scheduler_task_t *task);
+
+void scheduler_init(scheduler_t *scheduler, scheduler_idle_fn_t idle, void *idle_data)
+{
+    memset(scheduler, 0, sizeof(scheduler_t));
+    scheduler->lock = spin_lock_instance((uint)spin_lock_claim_unused(true));
+    scheduler->idle = idle;
+    scheduler->idle_data = idle_data;
+}
+
+bool scheduler_add(scheduler_t *scheduler, uint priority, const char *name, scheduler_task_fn_t run,
+                   scheduler_ready_fn_t ready, void *user_data, uint32_t deadline_us)
+{
+    if (priority >= SCHEDULER_MAX_TASKS || name == NULL || run == NULL || scheduler->tasks[priority].name != NULL)
+    {
+        return false;
+    }
+
+    scheduler->tasks[priority] = (scheduler_task_t){.name = name,
+                                                    .run = run,
+                                                    .ready = ready,
+                                                    .user_data = user_data,
+                                                    .deadline_us = deadline_us};
+    return true;
+}
+
+void scheduler_post(scheduler_t *scheduler, uint priority)
+{
+    if (priority >= SCHEDULER_MAX_TASKS || scheduler->lock == NULL)
+    {
+        return; // scheduler_init() not called yet
+    }
+
+    uint32_t save = spin_lock_blocking(scheduler->lock);
+    if ((scheduler->posted & (1u << priority)) == 0)
+    {
+        scheduler->tasks[priority].ready_us = time_us_32();
+        scheduler->posted |= 1u << priority;
+    }
+    spin_unlock(scheduler->lock, save);
+
+    // Wake an idle hook waiting in WFE, on either core
+    __sev();
+}
+
+bool scheduler_run_pass(scheduler_t *scheduler)
+{
+    uint32_t pass_start_us = time_us_32();
+    absolute_time_t now = get_absolute_time();
+    uint32_t batch = 0;
+
+    // Timers and ready checks join the pass once, at its start
+    for (uint i = 0; i < SCHEDULER_MAX_TASKS; i++)
+    {
+        scheduler_task_t *task = &scheduler->tasks[i];
+        if (task->name == NULL)
+        {
+            continue;
+        }
+
+        bool posted = (scheduler->posted & (1u << i)) != 0;
+        if (task->timed && absolute_time_diff_us(now, task->due) <= 0)
+        {
+            batch |= 1u << i;
+            if (!posted)
+            {
+                task->ready_us = (uint32_t)to_us_since_boot(task->due);
+            }
+        }
+        else if (task->ready != NULL && task->ready(task->user_data))
+        {
+            batch |= 1u << i;
+            if (!posted)
+            {
+                task->ready_us = pass_start_us;
+            }
+        }
+    }
+
+    bool ran = false;
+    while (true)
+    {
+        // A post from the task that just ran, an interrupt or the other core is picked up here
+        batch |= scheduler_take_posted(scheduler);
+        if (batch == 0)
+        {
+            break;
+        }
+
+        uint priority = (uint)__builtin_ctz(batch);
+        batch &= ~(1u << priority);
+        if (scheduler->tasks[priority].name != NULL)
+        {
+            scheduler_dispatch(&scheduler->tasks[priority]);
+            ran = true;
+        }
+    }
+
+    if (ran)
+    {
+        uint32_t pass_us = time_us_32() - pass_start_us;
+        scheduler->passes++;
+        if (pass_us > scheduler->worst_pass_us)
+        {
+            scheduler->worst_pass_us = pass_us;
+        }
+    }
+    return ran;
+}
+
+void scheduler_run(scheduler_t *scheduler)
+{
+    while (true)
+    {
+        if (scheduler_run_pass(scheduler) || scheduler->posted != 0 || scheduler->idle == NULL)
+        {
+            continue;
+        }
+        scheduler->idle(scheduler_next_due_us(scheduler), scheduler->idle_data);
+    }
+}
+
+uint32_t scheduler_next_due_us(const scheduler_t *scheduler)
+{
+    absolute_time_t now = get_absolute_time();
+    uint32_t next_us = 0;
+
+    for (uint i = 0; i < SCHEDULER_MAX_TASKS; i++)
+    {
+        const scheduler_task_t *task = &scheduler->tasks[i];
+        if (task->name == NULL || !task->timed)
+        {
+            continue;
+        }
+
+        int64_t wait_us = absolute_time_diff_us(now, task->due);
+        uint32_t due_us = (wait_us < 1) ? 1u : (uint32_t)MIN(wait_us, (int64_t)(UINT32_MAX - 1));
+        if (next_us == 0 || due_us < next_us)
+        {
+            next_us = due_us;
+        }
+    }
+    return next_us;
+}
+
+bool scheduler_get_task_stats(const scheduler_t *scheduler, uint priority, scheduler_task_stats_t *stats)
+{
+    if (priority >= SCHEDULER_MAX_TASKS || scheduler->tasks[priority].name == NULL || stats == NULL)
+    {
+        return false;
+    }
+
+    *stats = scheduler->tasks[priority].stats;
+    return true;
+}
+
+void scheduler_reset_stats(scheduler_t *scheduler)
+{
+    for (uint i = 0; i < SCHEDULER_MAX_TASKS; i++)
+    {
+        memset(&scheduler->tasks[i].stats, 0, sizeof(scheduler_task_stats_t));
+    }
+}
+
+// Internal helper functions
+
+static uint32_t scheduler_take_posted(scheduler_t *scheduler)
+{
+    if (scheduler->posted == 0)
+    {
+        return 0;
+    }
+
+    uint32_t save = spin_lock_blocking(scheduler->lock);
+    uint32_t posted = scheduler->posted;
+    scheduler->posted = 0;
+    spin_unlock(scheduler->lock, save);
+    return posted;
+}
+
+static void scheduler_dispatch(scheduler_task_t *task)
+{
+    uint32_t start_us = time_us_32();
+    uint32_t wait_us = start_us - task->ready_us;
+
+    uint32_t next_us = task->run(task->user_data);
+    uint32_t run_us = time_us_32() - start_us;
+
+    // The task's answer replaces any timer it had
+    task->timed = (next_us != SCHEDULER_WAIT_EVENT);
+    if (task->timed)
+    {
+        task->due = make_timeout_time_us(next_us);
+    }
+
+    task->stats.runs++;
+    if (run_us > task->stats.worst_run_us)
+    {
+        task->stats.worst_run_us = run_us;
+    }
+    if (wait_us > task->stats.worst_wait_us)
+    {
+        task->stats.worst_wait_us = wait_us;
+    }
+    if (task->deadline_us > 0 && wait_us > task->deadline_us)
+    {
+        task->stats.deadline_misses++;
+    }
+}
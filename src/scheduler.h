@@ -0,0 +1,192 @@
+/**
+ * @file scheduler.h
+ * @brief Cooperative priority scheduler interface
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This header file provides a small run-to-completion scheduler for the
+ * main loop. Each task has a fixed priority slot (0 = highest) and becomes
+ * ready when it is posted, when its ready check passes or when the time it
+ * asked for comes. A pass runs the ready tasks in priority order, one at a
+ * time; a task posted during the pass runs next if its priority is higher
+ * than the rest, so urgent work waits for at most the task that is running.
+ * When nothing is ready, the idle hook runs with the time until the next
+ * timed task.
+ *
+ * Each task records its run count, worst execution time and worst wait
+ * from ready to start, and counts the starts that came later than its
+ * deadline.
+ *
+ * Usage:
+ * - scheduler_add(), scheduler_run_pass() and scheduler_run() belong to the
+ *   core that owns the scheduler
+ * - scheduler_post() is safe from interrupt handlers and the other core
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+/**
+ * @brief Number of priority slots
+ */
+#define SCHEDULER_MAX_TASKS 8
+
+/**
+ * @brief Returned by a task that only needs to run again when posted or when its ready check passes
+ */
+#define SCHEDULER_WAIT_EVENT UINT32_MAX
+
+/**
+ * @brief Task body
+ *
+ * @param user_data User-defined data pointer
+ * @return uint32_t Microseconds until the task is due again (0 = next pass, SCHEDULER_WAIT_EVENT = not timed)
+ */
+typedef uint32_t (*scheduler_task_fn_t)(void *user_data);
+
+/**
+ * @brief Ready check, sampled at the start of every pass
+ *
+ * @param user_data User-defined data pointer
+ * @return true if the task has work, false otherwise
+ */
+typedef bool (*scheduler_ready_fn_t)(void *user_data);
+
+/**
+ * @brief Idle hook, run when no task is ready
+ *
+ * May sleep; a post from an interrupt handler should end the sleep.
+ *
+ * @param timeout_us Microseconds until the next timed task (0 = none)
+ * @param user_data User-defined data pointer
+ */
+typedef void (*scheduler_idle_fn_t)(uint32_t timeout_us, void *user_data);
+
+/**
+ * @brief Per-task counters
+ */
+typedef struct
+{
+    uint32_t runs;            ///< Times the task ran
+    uint32_t worst_run_us;    ///< Longest single run
+    uint32_t worst_wait_us;   ///< Longest time from ready to start
+    uint32_t deadline_misses; ///< Starts later than the task's deadline
+} scheduler_task_stats_t;
+
+/**
+ * @brief One task slot
+ */
+typedef struct
+{
+    const char *name;             ///< Short name for reports (NULL = slot unused)
+    scheduler_task_fn_t run;      ///< Task body
+    scheduler_ready_fn_t ready;   ///< Ready check (NULL = none)
+    void *user_data;              ///< Passed to run and ready
+    uint32_t deadline_us;         ///< Longest acceptable wait from ready to start (0 = none)
+    bool timed;                   ///< due is valid
+    absolute_time_t due;          ///< When the task is due again
+    uint32_t ready_us;            ///< time_us_32() when the task last became ready
+    scheduler_task_stats_t stats; ///< Counters
+} scheduler_task_t;
+
+/**
+ * @brief Scheduler state
+ */
+typedef struct
+{
+    scheduler_task_t tasks[SCHEDULER_MAX_TASKS]; ///< Indexed by priority (0 = highest)
+    volatile uint32_t posted;                    ///< Bit n set = task n posted, guarded by lock
+    spin_lock_t *lock;                           ///< Guards posted and the post times
+    scheduler_idle_fn_t idle;                    ///< Idle hook (NULL = spin)
+    void *idle_data;                             ///< Passed to the idle hook
+    uint32_t passes;                             ///< Passes that ran at least one task (cleared by the owner)
+    uint32_t worst_pass_us;                      ///< Longest such pass (cleared by the owner)
+} scheduler_t;
+
+/**
+ * @brief Set up an empty scheduler
+ *
+ * Claims a hardware spin lock for scheduler_post().
+ *
+ * @param scheduler Scheduler to initialize
+ * @param idle Idle hook (NULL = none)
+ * @param idle_data User data for the idle hook
+ */
+void scheduler_init(scheduler_t *scheduler, scheduler_idle_fn_t idle, void *idle_data);
+
+/**
+ * @brief Register a task in a priority slot
+ *
+ * @param scheduler Scheduler
+ * @param priority Slot (0 = highest, below SCHEDULER_MAX_TASKS)
+ * @param name Short name for reports
+ * @param run Task body
+ * @param ready Ready check (NULL = none)
+ * @param user_data Passed to run and ready
+ * @param deadline_us Longest acceptable wait from ready to start (0 = none)
+ * @return true if registered, false if the slot is taken or out of range
+ */
+bool scheduler_add(scheduler_t *scheduler, uint priority, const char *name, scheduler_task_fn_t run,
+                   scheduler_ready_fn_t ready, void *user_data, uint32_t deadline_us);
+
+/**
+ * @brief Mark a task ready (safe from interrupt handlers and either core)
+ *
+ * Posting a task that is already posted has no further effect.
+ *
+ * @param scheduler Scheduler
+ * @param priority Slot of the task
+ */
+void scheduler_post(scheduler_t *scheduler, uint priority);
+
+/**
+ * @brief Run every task that is ready, highest priority first
+ *
+ * Posts that arrive during the pass join it; timers and ready checks are
+ * sampled once at its start, so a task that is always ready cannot keep
+ * lower priorities from running.
+ *
+ * @param scheduler Scheduler
+ * @return true if at least one task ran, false if nothing was ready
+ */
+bool scheduler_run_pass(scheduler_t *scheduler);
+
+/**
+ * @brief Run passes forever, calling the idle hook whenever nothing is ready
+ *
+ * @param scheduler Scheduler
+ */
+void scheduler_run(scheduler_t *scheduler);
+
+/**
+ * @brief Time until the next timed task
+ *
+ * @param scheduler Scheduler
+ * @return uint32_t Microseconds, at least 1 if a task is due already (0 = no timed task)
+ */
+uint32_t scheduler_next_due_us(const scheduler_t *scheduler);
+
+/**
+ * @brief Copy a task's counters
+ *
+ * @param scheduler Scheduler
+ * @param priority Slot of the task
+ * @param stats Pointer to store the counters
+ * @return true if the slot holds a task, false otherwise
+ */
+bool scheduler_get_task_stats(const scheduler_t *scheduler, uint priority, scheduler_task_stats_t *stats);
+
+/**
+ * @brief Clear every task's counters
+ *
+ * @param scheduler Scheduler
+ */
+void scheduler_reset_stats(scheduler_t *scheduler);
+
+#endif /* SCHEDULER_H */
@@ -0,0 +1,269 @@
+/**
+ * @file spsc_ring.c
+ * @brief Lock-free single-producer/single-consumer ring buffer implementation
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This source file implements the SPSC ring. The producer reads the tail
+ * before it overwrites a slot and publishes the head after the slot is
+ * written; the consumer reads the head before it reads a slot and releases
+ * the tail after. Bulk copies split at the end of the storage into at most
+ * two memcpy() calls, and single-byte rings skip memcpy() entirely.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#include <string.h>
+#include "spsc_ring.h"
+#include "hardware/sync.h"
+
+// Forward declarations
+static uint8_t *ring_slot(const spsc_ring_t *ring, uint32_t index);
+static void ring_copy_in(spsc_ring_t *ring, uint32_t index, const uint8_t *elements, uint32_t count);
+static void ring_copy_out(const spsc_ring_t *ring, uint32_t index, uint8_t *elements, uint32_t count);
+
+bool spsc_ring_init(spsc_ring_t *ring, void *storage, uint32_t capacity, uint32_t element_size)
+{
+    if (ring == NULL || storage == NULL || capacity == 0 || (capacity & (capacity - 1)) != 0 || element_size == 0)
+    {
+        return false;
+    }
+
+    ring->storage = (uint8_t *)storage;
+    ring->capacity = capacity;
+    ring->mask = capacity - 1;
+    ring->element_size = element_size;
+    ring->head = 0;
+    ring->tail = 0;
+    return true;
+}
+
+uint32_t spsc_ring_count(const spsc_ring_t *ring)
+{
+    return ring->head - ring->tail;
+}
+
+uint32_t spsc_ring_space(const spsc_ring_t *ring)
+{
+    return ring->capacity - (ring->head - ring->tail);
+}
+
+bool spsc_ring_is_empty(const spsc_ring_t *ring)
+{
+    return ring->head == ring->tail;
+}
+
+// Producer side
+
+bool spsc_ring_push(spsc_ring_t *ring, const void *element)
+{
+    uint32_t head = ring->head;
+
+    if (head - ring->tail >= ring->capacity)
+    {
+        return false; // Ring full
+    }
+
+    // Overwrite the slot only after observing the tail that freed it
+    __mem_fence_acquire();
+    if (ring->element_size == 1)
+    {
+        ring->storage[head & ring->mask] = *(const uint8_t *)element;
+    }
+    else
+    {
+        memcpy(ring_slot(ring, head), element, ring->element_size);
+    }
+
+    // Publish the slot before the new head becomes visible
+    __mem_fence_release();
+    ring->head = head + 1;
+    return true;
+}
+
+bool spsc_ring_push_all(spsc_ring_t *ring, const void *elements, uint32_t count)
+{
+    if (count > spsc_ring_space(ring))
+    {
+        return false; // Not enough room for the whole group
+    }
+    return spsc_ring_write(ring, elements, count) == count;
+}
+
+uint32_t spsc_ring_write(spsc_ring_t *ring, const void *elements, uint32_t count)
+{
+    uint32_t head = ring->head;
+
+    count = MIN(count, ring->capacity - (head - ring->tail));
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    __mem_fence_acquire();
+    ring_copy_in(ring, head, (const uint8_t *)elements, count);
+
+    __mem_fence_release();
+    ring->head = head + count;
+    return count;
+}
+
+void *spsc_ring_claim(spsc_ring_t *ring)
+{
+    uint32_t head = ring->head;
+
+    if (head - ring->tail >= ring->capacity)
+    {
+        return NULL;
+    }
+
+    __mem_fence_acquire();
+    return ring_slot(ring, head);
+}
+
+void spsc_ring_publish(spsc_ring_t *ring, uint32_t count)
+{
+    __mem_fence_release();
+    ring->head += count;
+}
+
+// Consumer side
+
+bool spsc_ring_pop(spsc_ring_t *ring, void *element)
+{
+    uint32_t tail = ring->tail;
+
+    if (ring->head == tail)
+    {
+        return false; // Ring empty
+    }
+
+    // Read the slot only after observing the head that published it
+    __mem_fence_acquire();
+    if (ring->element_size == 1)
+    {
+        *(uint8_t *)element = ring->storage[tail & ring->mask];
+    }
+    else
+    {
+        memcpy(element, ring_slot(ring, tail), ring->element_size);
+    }
+
+    // Finish reading the slot before the producer may reuse it
+    __mem_fence_release();
+    ring->tail = tail + 1;
+    return true;
+}
+
+uint32_t spsc_ring_read(spsc_ring_t *ring, void *elements, uint32_t max_count)
+{
+    uint32_t tail = ring->tail;
+    uint32_t count = MIN(max_count, ring->head - tail);
+
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    __mem_fence_acquire();
+    ring_copy_out(ring, tail, (uint8_t *)elements, count);
+
+    __mem_fence_release();
+    ring->tail = tail + count;
+    return count;
+}
+
+uint32_t spsc_ring_read_span(const spsc_ring_t *ring, const void **span)
+{
+    uint32_t tail = ring->tail;
+    uint32_t available = ring->head - tail;
+
+    if (available == 0)
+    {
+        *span = NULL;
+        return 0;
+    }
+
+    __mem_fence_acquire();
+    uint32_t offset = tail & ring->mask;
+    *span = ring->storage + offset * ring->element_size;
+    return MIN(available, ring->capacity - offset);
+}
+
+const void *spsc_ring_peek(const spsc_ring_t *ring)
+{
+    uint32_t tail = ring->tail;
+
+    if (ring->head == tail)
+    {
+        return NULL;
+    }
+
+    __mem_fence_acquire();
+    return ring_slot(ring, tail);
+}
+
+void spsc_ring_consume(spsc_ring_t *ring, uint32_t count)
+{
+    __mem_fence_release();
+    ring->tail += count;
+}
+
+uint32_t spsc_ring_peek_until(const spsc_ring_t *ring, uint8_t value, uint32_t *scanned)
+{
+    uint32_t tail = ring->tail;
+    uint32_t available = ring->head - tail;
+    uint32_t offset = MIN(*scanned, available);
+
+    __mem_fence_acquire();
+
+    // At most two runs: up to the end of the storage, then from its start
+    while (offset < available)
+    {
+        uint32_t start = (tail + offset) & ring->mask;
+        uint32_t run = MIN(available - offset, ring->capacity - start);
+        const uint8_t *found = memchr(&ring->storage[start], value, run);
+
+        if (found != NULL)
+        {
+            *scanned = 0;
+            return offset + (uint32_t)(found - &ring->storage[start]) + 1;
+        }
+        offset += run;
+    }
+
+    *scanned = offset;
+    return 0;
+}
+
+// Internal helper functions
+
+static uint8_t *ring_slot(const spsc_ring_t *ring, uint32_t index)
+{
+    return ring->storage + (index & ring->mask) * ring->element_size;
+}
+
+static void ring_copy_in(spsc_ring_t *ring, uint32_t index, const uint8_t *elements, uint32_t count)
+{
+    uint32_t offset = index & ring->mask;
+    uint32_t first = MIN(count, ring->capacity - offset);
+
+    memcpy(ring_slot(ring, index), elements, first * ring->element_size);
+    if (count > first)
+    {
+        memcpy(ring->storage, elements + first * ring->element_size, (count - first) * ring->element_size);
+    }
+}
+
+static void ring_copy_out(const spsc_ring_t *ring, uint32_t index, uint8_t *elements, uint32_t count)
+{
+    uint32_t offset = index & ring->mask;
+    uint32_t first = MIN(count, ring->capacity - offset);
+
+    memcpy(elements, ring_slot(ring, index), first * ring->element_size);
+    if (count > first)
+    {
+        memcpy(elements + first * ring->element_size, ring->storage, (count - first) * ring->element_size);
+    }
+}
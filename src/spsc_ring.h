@@ -0,0 +1,207 @@
+/**
+ * @file spsc_ring.h
+ * @brief Lock-free single-producer/single-consumer ring buffer interface
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This header file provides one ring buffer shared by every queue that has
+ * exactly one writer and one reader: interrupt handler to main loop, main
+ * loop to interrupt handler, or core 0 to core 1. The caller supplies the
+ * storage; the ring holds a power-of-two number of fixed-size elements.
+ *
+ * Indices run freely and are masked on access, so a full ring uses every
+ * slot and no modulo is ever computed. Each index is written by one side
+ * only, and memory barriers order slot accesses against the index updates,
+ * which keeps the ring correct across cores as well as against interrupts.
+ *
+ * Usage:
+ * - Only the producer calls push, push_all, write, claim and publish
+ * - Only the consumer calls pop, read, read_span, peek, consume and peek_until
+ * - count, space and is_empty may be called from either side
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include "pico/stdlib.h"
+
+/**
+ * @brief Ring state; storage is owned by the caller
+ */
+typedef struct
+{
+    uint8_t *storage;       ///< capacity * element_size bytes
+    uint32_t capacity;      ///< Number of elements (power of two)
+    uint32_t mask;          ///< capacity - 1
+    uint32_t element_size;  ///< Bytes per element
+    volatile uint32_t head; ///< Written by the producer only (free-running)
+    volatile uint32_t tail; ///< Written by the consumer only (free-running)
+} spsc_ring_t;
+
+/**
+ * @brief Static initializer for a ring over an array of elements
+ *
+ * The array length must be a power of two.
+ */
+#define SPSC_RING_INIT(array)                                          \
+    {                                                                  \
+        .storage = (uint8_t *)(array),                                 \
+        .capacity = sizeof(array) / sizeof((array)[0]),                \
+        .mask = sizeof(array) / sizeof((array)[0]) - 1,                \
+        .element_size = sizeof((array)[0]),                            \
+        .head = 0,                                                     \
+        .tail = 0,                                                     \
+    }
+
+/**
+ * @brief Set up an empty ring over caller-owned storage
+ *
+ * Not safe while either side is using the ring.
+ *
+ * @param ring Ring to initialize
+ * @param storage capacity * element_size bytes
+ * @param capacity Number of elements (power of two)
+ * @param element_size Bytes per element
+ * @return true if initialized, false if the capacity is not a power of two
+ */
+bool spsc_ring_init(spsc_ring_t *ring, void *storage, uint32_t capacity, uint32_t element_size);
+
+/**
+ * @brief Number of elements waiting to be consumed
+ *
+ * @param ring Ring to query
+ * @return uint32_t Element count
+ */
+uint32_t spsc_ring_count(const spsc_ring_t *ring);
+
+/**
+ * @brief Number of elements that can be produced without overwriting
+ *
+ * @param ring Ring to query
+ * @return uint32_t Free slots
+ */
+uint32_t spsc_ring_space(const spsc_ring_t *ring);
+
+/**
+ * @brief Check if there is nothing to consume
+ *
+ * @param ring Ring to query
+ * @return true if empty, false otherwise
+ */
+bool spsc_ring_is_empty(const spsc_ring_t *ring);
+
+/**
+ * @brief Append one element
+ *
+ * @param ring Ring to append to
+ * @param element Element to copy in
+ * @return true if stored, false if the ring is full
+ */
+bool spsc_ring_push(spsc_ring_t *ring, const void *element);
+
+/**
+ * @brief Append a group of elements with a single publish
+ *
+ * The consumer sees either none or all of them.
+ *
+ * @param ring Ring to append to
+ * @param elements Elements to copy in, in order
+ * @param count Number of elements
+ * @return true if all were stored, false if the ring lacks room (nothing stored)
+ */
+bool spsc_ring_push_all(spsc_ring_t *ring, const void *elements, uint32_t count);
+
+/**
+ * @brief Append as many elements as fit, with a single publish
+ *
+ * @param ring Ring to append to
+ * @param elements Elements to copy in, in order
+ * @param count Number of elements offered
+ * @return uint32_t Number of elements stored
+ */
+uint32_t spsc_ring_write(spsc_ring_t *ring, const void *elements, uint32_t count);
+
+/**
+ * @brief Get the free slot at the head to build an element in place
+ *
+ * The element becomes visible to the consumer only after spsc_ring_publish().
+ *
+ * @param ring Ring to append to
+ * @return void* Slot to fill, or NULL if the ring is full
+ */
+void *spsc_ring_claim(spsc_ring_t *ring);
+
+/**
+ * @brief Make elements filled in place visible to the consumer
+ *
+ * @param ring Ring to append to
+ * @param count Number of claimed slots to publish
+ */
+void spsc_ring_publish(spsc_ring_t *ring, uint32_t count);
+
+/**
+ * @brief Remove the oldest element
+ *
+ * @param ring Ring to take from
+ * @param element Pointer to store the element
+ * @return true if an element was returned, false if the ring is empty
+ */
+bool spsc_ring_pop(spsc_ring_t *ring, void *element);
+
+/**
+ * @brief Remove up to max_count elements in order
+ *
+ * @param ring Ring to take from
+ * @param elements Buffer for at least max_count elements
+ * @param max_count Maximum number of elements to take
+ * @return uint32_t Number of elements taken
+ */
+uint32_t spsc_ring_read(spsc_ring_t *ring, void *elements, uint32_t max_count);
+
+/**
+ * @brief Get the longest contiguous run of unconsumed elements at the tail
+ *
+ * The run ends at the head or at the end of the storage, whichever is first;
+ * a second call after spsc_ring_consume() returns the part after the seam.
+ *
+ * @param ring Ring to look into
+ * @param span Pointer to store the address of the run (NULL if empty)
+ * @return uint32_t Number of elements in the run
+ */
+uint32_t spsc_ring_read_span(const spsc_ring_t *ring, const void **span);
+
+/**
+ * @brief Get the oldest element without removing it
+ *
+ * @param ring Ring to look into
+ * @return const void* Oldest element, or NULL if the ring is empty
+ */
+const void *spsc_ring_peek(const spsc_ring_t *ring);
+
+/**
+ * @brief Release elements already read through peek or read_span
+ *
+ * @param ring Ring to release from
+ * @param count Number of elements (at most spsc_ring_count())
+ */
+void spsc_ring_consume(spsc_ring_t *ring, uint32_t count);
+
+/**
+ * @brief Find a byte value in a ring of single-byte elements
+ *
+ * Searches the unconsumed bytes, starting after the ones already searched
+ * by an earlier call, so data that arrives over several polls is only
+ * looked at once. *scanned is reset to 0 when the value is found; reset it
+ * to 0 after consuming anything without a match.
+ *
+ * @param ring Ring of single-byte elements
+ * @param value Byte to find (typically a line terminator)
+ * @param scanned Bytes already searched by earlier calls, updated in place
+ * @return uint32_t Bytes up to and including the value, or 0 if not found
+ */
+uint32_t spsc_ring_peek_until(const spsc_ring_t *ring, uint8_t value, uint32_t *scanned);
+
+#endif /* SPSC_RING_H */
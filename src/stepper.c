@@ -14,10 +14,33 @@
  */
 
 #include <stdio.h>
+#include <stdatomic.h>
 #include "stepper.h"
-
-// Global interrupt flag to stop stepper operations immediately
-static volatile bool stepper_interrupt_flag = false;
+#include "stepper_planner.h"
+#include "log.h"
+#include "trace.h"
+#include "hardware/sync.h"
+#include "hardware/pwm.h"
+#if defined(STEPPER_USE_PIO)
+#include "stepper_pio.h"
+#define stepper_engine_attach stepper_pio_attach
+#define stepper_engine_queue stepper_pio_queue
+#define stepper_engine_write stepper_pio_write
+#define stepper_engine_flush stepper_pio_flush
+#define STEPPER_COIL_GPIO_FUNC GPIO_FUNC_PIO0
+#elif defined(STEPPER_USE_TIMER)
+#include "stepper_timer.h"
+#define stepper_engine_attach stepper_timer_attach
+#define stepper_engine_queue stepper_timer_queue
+#define stepper_engine_write stepper_timer_write
+#define stepper_engine_flush stepper_timer_flush
+#define STEPPER_COIL_GPIO_FUNC GPIO_FUNC_SIO
+#else
+#define STEPPER_COIL_GPIO_FUNC GPIO_FUNC_SIO
+#endif
+
+// Global interrupt flag to stop stepper operations immediately (set from either core)
+static atomic_bool stepper_interrupt_flag = false;
 
 // 4-phase stepping sequence for smooth motor operation (half-stepping)
 static const bool step_sequence[8][4] = {
@@ -38,12 +61,117 @@ static void stepper_apply_step(stepper_motor_t *motor, int step)
         return;
     }
 
-    gpio_put(motor->pin1, step_sequence[step][0]);
-    gpio_put(motor->pin2, step_sequence[step][1]);
-    gpio_put(motor->pin3, step_sequence[step][2]);
-    gpio_put(motor->pin4, step_sequence[step][3]);
+#ifdef STEPPER_ENGINE
+    motor->current_step = step;
+    stepper_engine_write(motor);
+#else
+    // All four coils change in one SIO write, with no invalid intermediate pattern
+    gpio_put_masked(motor->coil_mask, motor->phase_masks[step]);
 
     motor->current_step = step;
+#endif
+}
+
+void stepper_build_phase_masks(stepper_motor_t *motor)
+{
+    const uint pins[4] = {motor->pin1, motor->pin2, motor->pin3, motor->pin4};
+
+    motor->coil_mask = 0;
+    for (uint phase = 0; phase < 4; phase++)
+    {
+        motor->coil_mask |= 1u << pins[phase];
+    }
+
+    for (uint step = 0; step < 8; step++)
+    {
+        motor->phase_masks[step] = 0;
+        for (uint phase = 0; phase < 4; phase++)
+        {
+            if (step_sequence[step][phase])
+            {
+                motor->phase_masks[step] |= 1u << pins[phase];
+            }
+        }
+    }
+}
+
+/**
+ * @brief Put a motor's coils into its idle policy, keeping the phase in current_step
+ *
+ * @param motor Pointer to the stepper motor structure
+ */
+static void stepper_idle_enter(stepper_motor_t *motor)
+{
+    if (motor->idle_mode == STEPPER_IDLE_REDUCE)
+    {
+        // The held pins leave the step engine for a PWM slice at the hold duty
+        const uint pins[4] = {motor->pin1, motor->pin2, motor->pin3, motor->pin4};
+        uint32_t held = motor->phase_masks[motor->current_step];
+        uint16_t level = (uint16_t)(((STEPPER_HOLD_PWM_WRAP + 1u) * STEPPER_HOLD_DUTY_PERCENT) / 100u);
+
+        for (uint phase = 0; phase < 4; phase++)
+        {
+            if (held & (1u << pins[phase]))
+            {
+                // Slices may be shared between motors; every hold uses the same settings
+                uint slice = pwm_gpio_to_slice_num(pins[phase]);
+                pwm_set_wrap(slice, STEPPER_HOLD_PWM_WRAP);
+                pwm_set_gpio_level(pins[phase], level);
+                pwm_set_enabled(slice, true);
+                gpio_set_function(pins[phase], GPIO_FUNC_PWM);
+            }
+        }
+    }
+
+    // An idle motor contributes nothing to the coil pattern
+    motor->coils_idle = true;
+#ifdef STEPPER_ENGINE
+    stepper_engine_write(motor);
+#else
+    gpio_clr_mask(motor->coil_mask);
+#endif
+}
+
+/**
+ * @brief Re-energize the remembered phase of an idle motor at full current
+ *
+ * @param motor Pointer to the stepper motor structure
+ */
+static void stepper_idle_exit(stepper_motor_t *motor)
+{
+    if (!motor->coils_idle)
+    {
+        return;
+    }
+
+    // Restore the phase first so the pins carry it the moment they change hands
+    motor->coils_idle = false;
+    stepper_apply_step(motor, motor->current_step);
+
+    if (motor->idle_mode == STEPPER_IDLE_REDUCE)
+    {
+        gpio_set_function(motor->pin1, STEPPER_COIL_GPIO_FUNC);
+        gpio_set_function(motor->pin2, STEPPER_COIL_GPIO_FUNC);
+        gpio_set_function(motor->pin3, STEPPER_COIL_GPIO_FUNC);
+        gpio_set_function(motor->pin4, STEPPER_COIL_GPIO_FUNC);
+    }
+}
+
+/**
+ * @brief Block until none of the motors have queued steps (or an interrupt)
+ *
+ * @param motors Array of pointers to stepper motor structures
+ * @param num_motors Number of motors in the array
+ */
+static void stepper_wait_idle(stepper_motor_t *motors[], uint num_motors)
+{
+    for (uint i = 0; i < num_motors; i++)
+    {
+        while (stepper_is_busy(motors[i]) && !atomic_load(&stepper_interrupt_flag))
+        {
+            sleep_ms(1);
+        }
+    }
 }
 
 bool stepper_init(stepper_motor_t *motor, uint pin1, uint pin2, uint pin3, uint pin4, uint step_delay)
@@ -57,9 +185,19 @@ bool stepper_init(stepper_motor_t *motor, uint pin1, uint pin2, uint pin3, uint
     motor->pin2 = pin2;
     motor->pin3 = pin3;
     motor->pin4 = pin4;
-    motor->step_delay = step_delay;
+    motor->step_delay_us = step_delay * 1000u;
     motor->current_step = 0;
+    motor->position = 0;
     motor->enabled = true;
+    motor->pending_steps = 0;
+    motor->idle_mode = STEPPER_DEFAULT_IDLE_MODE;
+    motor->idle_timeout_ms = STEPPER_IDLE_TIMEOUT_MS;
+    motor->last_step_us = time_us_32();
+    motor->coils_idle = false;
+    stepper_build_phase_masks(motor);
+    motor->acceleration = STEPPER_DEFAULT_ACCEL;
+    stepper_planner_reset(motor);
+    stepper_planner_configure(motor);
 
     gpio_init(pin1);
     gpio_init(pin2);
@@ -71,6 +209,14 @@ bool stepper_init(stepper_motor_t *motor, uint pin1, uint pin2, uint pin3, uint
     gpio_set_dir(pin3, GPIO_OUT);
     gpio_set_dir(pin4, GPIO_OUT);
 
+#ifdef STEPPER_ENGINE
+    // The step engine drives the coils from here on (the PIO takes the pins over from SIO)
+    if (!stepper_engine_attach(motor))
+    {
+        return false;
+    }
+#endif
+
     stepper_apply_step(motor, 0);
 
     return true;
@@ -83,10 +229,21 @@ void stepper_move_steps(stepper_motor_t *motor, uint steps, stepper_direction_t
         return;
     }
 
+    // Full current on the remembered phase before the first step
+    stepper_idle_exit(motor);
+
+#ifdef STEPPER_ENGINE
+    // Queue only - the step engine paces the steps from its interrupt
+    if (!atomic_load(&stepper_interrupt_flag))
+    {
+        stepper_engine_queue(motor, (direction == STEPPER_CW) ? (int32_t)steps : -(int32_t)steps);
+    }
+#else
+
     for (uint i = 0; i < steps; i++)
     {
         // Check for interrupt flag before each step
-        if (stepper_interrupt_flag)
+        if (atomic_load(&stepper_interrupt_flag))
         {
             return;
         }
@@ -94,29 +251,37 @@ void stepper_move_steps(stepper_motor_t *motor, uint steps, stepper_direction_t
         if (direction == STEPPER_CW)
         {
             motor->current_step = (motor->current_step + 1) % 8;
+            motor->position++;
         }
         else
         {
             motor->current_step = (motor->current_step - 1 + 8) % 8;
+            motor->position--;
         }
 
         stepper_apply_step(motor, motor->current_step);
+        motor->last_step_us = time_us_32();
+        if (i == 0)
+        {
+            TRACE_MARK(TRACE_FIRST_STEP);
+        }
 
         // Essential delay for stepper motor timing - but make it interruptible
-        uint remaining_delay = motor->step_delay;
-        while (remaining_delay > 0 && !stepper_interrupt_flag)
+        uint remaining_delay = motor->step_delay_us;
+        while (remaining_delay > 0 && !atomic_load(&stepper_interrupt_flag))
         {
-            uint chunk_delay = (remaining_delay > 1) ? 1 : remaining_delay;
-            sleep_ms(chunk_delay);
+            uint chunk_delay = (remaining_delay > 1000) ? 1000 : remaining_delay;
+            sleep_us(chunk_delay);
             remaining_delay -= chunk_delay;
         }
 
         // Exit immediately if interrupted during delay
-        if (stepper_interrupt_flag)
+        if (atomic_load(&stepper_interrupt_flag))
         {
             return;
         }
     }
+#endif
 }
 
 void stepper_rotate_degrees(stepper_motor_t *motor, float degrees, stepper_direction_t direction)
@@ -138,11 +303,15 @@ void stepper_disable(stepper_motor_t *motor)
     }
 
     motor->enabled = false;
-
-    gpio_put(motor->pin1, 0);
-    gpio_put(motor->pin2, 0);
-    gpio_put(motor->pin3, 0);
-    gpio_put(motor->pin4, 0);
+    stepper_idle_exit(motor);
+
+#ifdef STEPPER_ENGINE
+    motor->pending_steps = 0;
+    stepper_planner_reset(motor);
+    stepper_engine_write(motor);
+#else
+    gpio_clr_mask(motor->coil_mask);
+#endif
 }
 
 void stepper_enable(stepper_motor_t *motor)
@@ -153,27 +322,149 @@ void stepper_enable(stepper_motor_t *motor)
     }
 
     motor->enabled = true;
+    motor->last_step_us = time_us_32();
+    stepper_idle_exit(motor);
     stepper_apply_step(motor, motor->current_step);
 }
 
 void stepper_set_speed(stepper_motor_t *motor, uint step_delay)
+{
+    stepper_set_speed_us(motor, step_delay * 1000u);
+}
+
+void stepper_set_speed_us(stepper_motor_t *motor, uint step_delay_us)
+{
+    if (motor == NULL || step_delay_us == 0)
+    {
+        return;
+    }
+
+    motor->step_delay_us = step_delay_us;
+
+    // The cruise rate is the end of the ramp
+    stepper_planner_configure(motor);
+}
+
+void stepper_set_acceleration(stepper_motor_t *motor, uint acceleration)
 {
     if (motor == NULL)
     {
         return;
     }
 
-    motor->step_delay = step_delay;
+    motor->acceleration = acceleration;
+    stepper_planner_configure(motor);
 }
 
-int stepper_get_position(stepper_motor_t *motor)
+void stepper_set_idle_policy(stepper_motor_t *motor, stepper_idle_mode_t mode, uint32_t timeout_ms)
 {
     if (motor == NULL)
     {
-        return -1;
+        return;
+    }
+
+    // Leave the old policy before its pins change meaning; the timeout restarts
+    stepper_idle_exit(motor);
+    motor->idle_mode = mode;
+    motor->idle_timeout_ms = timeout_ms;
+    motor->last_step_us = time_us_32();
+}
+
+uint32_t stepper_idle_service(stepper_motor_t *motors, uint num_motors)
+{
+    if (motors == NULL)
+    {
+        return 0;
+    }
+
+    uint32_t now_us = time_us_32();
+    uint32_t wait_us = 0;
+
+    for (uint i = 0; i < num_motors; i++)
+    {
+        stepper_motor_t *motor = &motors[i];
+        if (motor->idle_mode == STEPPER_IDLE_HOLD || motor->coils_idle || !motor->enabled)
+        {
+            continue;
+        }
+
+        // A moving motor is looked at again a full timeout later
+        uint32_t timeout_us = motor->idle_timeout_ms * 1000u;
+        uint32_t remaining_us = timeout_us;
+        if (!stepper_is_busy(motor))
+        {
+            uint32_t idle_us = now_us - motor->last_step_us;
+            if (idle_us >= timeout_us)
+            {
+                stepper_idle_enter(motor);
+                continue;
+            }
+            remaining_us = timeout_us - idle_us;
+        }
+
+        if (wait_us == 0 || remaining_us < wait_us)
+        {
+            wait_us = remaining_us;
+        }
+    }
+
+    return wait_us;
+}
+
+int32_t stepper_get_position(const stepper_motor_t *motor)
+{
+    if (motor == NULL)
+    {
+        return 0;
+    }
+
+    return motor->position;
+}
+
+void stepper_set_position(stepper_motor_t *motor, int32_t position)
+{
+    if (motor == NULL)
+    {
+        return;
+    }
+
+    // The step interrupt also writes position; queued steps stay relative
+    uint32_t save = save_and_disable_interrupts();
+    motor->position = position;
+    restore_interrupts(save);
+}
+
+void stepper_move_to(stepper_motor_t *motor, int32_t target)
+{
+    if (motor == NULL || !motor->enabled)
+    {
+        return;
+    }
+
+    // Stepping moves a step from pending_steps to position, so their sum is the queued target
+    uint32_t save = save_and_disable_interrupts();
+    int32_t delta = target - (motor->position + motor->pending_steps);
+    restore_interrupts(save);
+
+    if (delta != 0)
+    {
+        stepper_move_steps(motor, (uint)((delta > 0) ? delta : -delta), (delta > 0) ? STEPPER_CW : STEPPER_CCW);
+    }
+}
+
+bool stepper_is_busy(const stepper_motor_t *motor)
+{
+    if (motor == NULL)
+    {
+        return false;
     }
 
-    return motor->current_step;
+    return motor->pending_steps != 0;
+}
+
+uint32_t stepper_phase_mask(const stepper_motor_t *motor, int step)
+{
+    return motor->phase_masks[step & 7];
 }
 
 void stepper_rotate_multiple_degrees(stepper_motor_t *motors[], uint num_motors,
@@ -187,15 +478,34 @@ void stepper_rotate_multiple_degrees(stepper_motor_t *motors[], uint num_motors,
     // Calculate steps needed for all motors
     uint steps = (uint)((degrees / 360.0f) * STEPS_PER_REVOLUTION);
 
+#ifdef STEPPER_ENGINE
+    // Each motor runs its own profile; with equal settings they stay together
+    for (uint i = 0; i < num_motors; i++)
+    {
+        stepper_move_steps(motors[i], steps, direction);
+    }
+#else
+
+    for (uint i = 0; i < num_motors; i++)
+    {
+        if (motors[i] != NULL && motors[i]->enabled)
+        {
+            stepper_idle_exit(motors[i]);
+        }
+    }
+
     // Rotate all motors simultaneously step by step
     for (uint step = 0; step < steps; step++)
     {
         // Check for interrupt flag before each step
-        if (stepper_interrupt_flag)
+        if (atomic_load(&stepper_interrupt_flag))
         {
             return;
         }
 
+        // Compose every motor's next phase, then drive them all in one write
+        uint32_t mask = 0;
+        uint32_t value = 0;
         for (uint i = 0; i < num_motors; i++)
         {
             stepper_motor_t *motor = motors[i];
@@ -204,14 +514,23 @@ void stepper_rotate_multiple_degrees(stepper_motor_t *motors[], uint num_motors,
                 if (direction == STEPPER_CW)
                 {
                     motor->current_step = (motor->current_step + 1) % 8;
+                    motor->position++;
                 }
                 else
                 {
                     motor->current_step = (motor->current_step - 1 + 8) % 8;
+                    motor->position--;
                 }
-                stepper_apply_step(motor, motor->current_step);
+                mask |= motor->coil_mask;
+                value |= motor->phase_masks[motor->current_step];
+                motor->last_step_us = time_us_32();
             }
         }
+        gpio_put_masked(mask, value);
+        if (step == 0)
+        {
+            TRACE_MARK(TRACE_FIRST_STEP);
+        }
 
         // Essential delay for stepper motor timing - but make it interruptible
         // Use the delay from the first valid motor
@@ -219,11 +538,11 @@ void stepper_rotate_multiple_degrees(stepper_motor_t *motors[], uint num_motors,
         {
             if (motors[i] != NULL && motors[i]->enabled)
             {
-                uint remaining_delay = motors[i]->step_delay;
-                while (remaining_delay > 0 && !stepper_interrupt_flag)
+                uint remaining_delay = motors[i]->step_delay_us;
+                while (remaining_delay > 0 && !atomic_load(&stepper_interrupt_flag))
                 {
-                    uint chunk_delay = (remaining_delay > 1) ? 1 : remaining_delay;
-                    sleep_ms(chunk_delay);
+                    uint chunk_delay = (remaining_delay > 1000) ? 1000 : remaining_delay;
+                    sleep_us(chunk_delay);
                     remaining_delay -= chunk_delay;
                 }
                 break; // Only use delay from first motor
@@ -231,11 +550,12 @@ void stepper_rotate_multiple_degrees(stepper_motor_t *motors[], uint num_motors,
         }
 
         // Exit immediately if interrupted during delay
-        if (stepper_interrupt_flag)
+        if (atomic_load(&stepper_interrupt_flag))
         {
             return;
         }
     }
+#endif
 }
 
 void stepper_demo_sequence(stepper_motor_t *motors[], uint num_motors,
@@ -248,22 +568,23 @@ void stepper_demo_sequence(stepper_motor_t *motors[], uint num_motors,
 
     uint remaining_ms; // For interruptible delays
 
-    printf("Running stepper motor demonstration sequence...\n");
+    LOG(STEPPER, INFO, "Running stepper motor demonstration sequence...\n");
 
     // Clockwise rotation for all motors
-    printf("Rotating all motors clockwise %.1f degrees\n", degrees);
+    LOG(STEPPER, INFO, "Rotating all motors clockwise %.1f degrees\n", degrees);
     stepper_rotate_multiple_degrees(motors, num_motors, degrees, STEPPER_CW);
+    stepper_wait_idle(motors, num_motors);
 
     // Check for interrupt after clockwise rotation
-    if (stepper_interrupt_flag)
+    if (atomic_load(&stepper_interrupt_flag))
     {
-        printf("Stepper: Demo sequence interrupted after clockwise rotation\n");
+        LOG(STEPPER, INFO, "Stepper: Demo sequence interrupted after clockwise rotation\n");
         return;
     }
 
     // Use interruptible delay - break pause into smaller chunks
     remaining_ms = pause_ms;
-    while (remaining_ms > 0 && !stepper_interrupt_flag)
+    while (remaining_ms > 0 && !atomic_load(&stepper_interrupt_flag))
     {
         uint chunk_ms = (remaining_ms > 10) ? 10 : remaining_ms;
         sleep_ms(chunk_ms);
@@ -271,38 +592,39 @@ void stepper_demo_sequence(stepper_motor_t *motors[], uint num_motors,
     }
 
     // Check for interrupt after pause
-    if (stepper_interrupt_flag)
+    if (atomic_load(&stepper_interrupt_flag))
     {
-        printf("Stepper: Demo sequence interrupted during pause\n");
+        LOG(STEPPER, INFO, "Stepper: Demo sequence interrupted during pause\n");
         return;
     }
 
     // Counter-clockwise rotation for all motors
-    printf("Rotating all motors counter-clockwise %.1f degrees\n", degrees);
+    LOG(STEPPER, INFO, "Rotating all motors counter-clockwise %.1f degrees\n", degrees);
     stepper_rotate_multiple_degrees(motors, num_motors, degrees, STEPPER_CCW);
+    stepper_wait_idle(motors, num_motors);
 
     // Check for interrupt after counter-clockwise rotation
-    if (stepper_interrupt_flag)
+    if (atomic_load(&stepper_interrupt_flag))
     {
-        printf("Stepper: Demo sequence interrupted after counter-clockwise rotation\n");
+        LOG(STEPPER, INFO, "Stepper: Demo sequence interrupted after counter-clockwise rotation\n");
         return;
     }
 
     // Use interruptible delay - break pause into smaller chunks
     remaining_ms = pause_ms;
-    while (remaining_ms > 0 && !stepper_interrupt_flag)
+    while (remaining_ms > 0 && !atomic_load(&stepper_interrupt_flag))
     {
         uint chunk_ms = (remaining_ms > 10) ? 10 : remaining_ms;
         sleep_ms(chunk_ms);
         remaining_ms -= chunk_ms;
     }
 
-    printf("Demonstration sequence complete\n");
+    LOG(STEPPER, INFO, "Demonstration sequence complete\n");
 }
 
 void stepper_set_interrupt(void)
 {
-    stepper_interrupt_flag = true;
+    atomic_store(&stepper_interrupt_flag, true);
 }
 
 void stepper_emergency_stop_all(stepper_motor_t *motors, uint num_motors)
@@ -313,27 +635,34 @@ void stepper_emergency_stop_all(stepper_motor_t *motors, uint num_motors)
     }
 
     // Immediately disable all motor outputs - NO DELAYS
+    uint32_t coils = 0;
     for (uint i = 0; i < num_motors; i++)
     {
         stepper_motor_t *motor = &motors[i];
+        coils |= motor->coil_mask;
 
-        // Turn off all GPIO pins immediately
-        gpio_put(motor->pin1, 0);
-        gpio_put(motor->pin2, 0);
-        gpio_put(motor->pin3, 0);
-        gpio_put(motor->pin4, 0);
-
-        // Mark motor as disabled
+        // Mark motor as disabled and hand any held pins back (the engine pattern is then all off)
         motor->enabled = false;
+        stepper_idle_exit(motor);
     }
+
+#ifndef STEPPER_ENGINE
+    // Turn off every coil pin in one write
+    gpio_clr_mask(coils);
+#endif
+
+#ifdef STEPPER_ENGINE
+    // Drop the queued steps and apply the all-off pattern at once
+    stepper_engine_flush();
+#endif
 }
 
 void stepper_clear_interrupt(void)
 {
-    stepper_interrupt_flag = false;
+    atomic_store(&stepper_interrupt_flag, false);
 }
 
 bool stepper_is_interrupted(void)
 {
-    return stepper_interrupt_flag;
+    return atomic_load(&stepper_interrupt_flag);
 }
@@ -57,6 +57,49 @@
  */
 #define STEPPER_PHASES 4
 
+/**
+ * @brief Entries in a motor's acceleration ramp table (longest ramp in steps)
+ */
+#define STEPPER_RAMP_STEPS 256
+
+/**
+ * @brief Acceleration applied by stepper_init() in steps/s^2
+ * Reaches the default 1000 steps/s cruise rate in 125 steps
+ */
+#define STEPPER_DEFAULT_ACCEL 4000
+
+/**
+ * @brief Lowest usable acceleration in steps/s^2 (first ramp interval fits 16 bits)
+ */
+#define STEPPER_MIN_ACCEL 250
+
+/**
+ * @brief Time without a step before a motor's idle policy applies (ms)
+ */
+#ifndef STEPPER_IDLE_TIMEOUT_MS
+#define STEPPER_IDLE_TIMEOUT_MS 500
+#endif
+
+/**
+ * @brief PWM duty of the held coils in STEPPER_IDLE_REDUCE (percent)
+ */
+#ifndef STEPPER_HOLD_DUTY_PERCENT
+#define STEPPER_HOLD_DUTY_PERCENT 30
+#endif
+
+/**
+ * @brief PWM counter wrap for the reduced hold (20 kHz at the 125 MHz system clock)
+ */
+#define STEPPER_HOLD_PWM_WRAP 6249
+
+/**
+ * @brief Defined when moves are queued to an interrupt-driven step engine
+ * (STEPPER_USE_PIO or STEPPER_USE_TIMER) instead of stepped inline
+ */
+#if defined(STEPPER_USE_PIO) || defined(STEPPER_USE_TIMER)
+#define STEPPER_ENGINE
+#endif
+
 /**
  * @brief Stepper motor rotation direction
  */
@@ -66,18 +109,50 @@ typedef enum
     STEPPER_CCW = 1 /*!< Counter-clockwise rotation */
 } stepper_direction_t;
 
+/**
+ * @brief What a motor's coils do once it has been idle for its timeout
+ */
+typedef enum
+{
+    STEPPER_IDLE_HOLD = 0,    /*!< Keep the phase fully energized (full holding torque) */
+    STEPPER_IDLE_RELEASE = 1, /*!< De-energize the coils (no holding current) */
+    STEPPER_IDLE_REDUCE = 2   /*!< Chop the energized coils to STEPPER_HOLD_DUTY_PERCENT with PWM */
+} stepper_idle_mode_t;
+
+/**
+ * @brief Idle policy applied by stepper_init(), normally provided by CMake
+ */
+#ifndef STEPPER_DEFAULT_IDLE_MODE
+#define STEPPER_DEFAULT_IDLE_MODE STEPPER_IDLE_REDUCE
+#endif
+
 /**
  * @brief Stepper motor configuration structure
  */
 typedef struct
 {
-    uint pin1;        /*!< GPIO pin for phase 1 (IN1) */
-    uint pin2;        /*!< GPIO pin for phase 2 (IN2) */
-    uint pin3;        /*!< GPIO pin for phase 3 (IN3) */
-    uint pin4;        /*!< GPIO pin for phase 4 (IN4) */
-    uint step_delay;  /*!< Delay between steps in milliseconds */
-    int current_step; /*!< Current step position (0-7) */
-    bool enabled;     /*!< Motor enable state */
+    uint pin1;                      /*!< GPIO pin for phase 1 (IN1) */
+    uint pin2;                      /*!< GPIO pin for phase 2 (IN2) */
+    uint pin3;                      /*!< GPIO pin for phase 3 (IN3) */
+    uint pin4;                      /*!< GPIO pin for phase 4 (IN4) */
+    uint32_t coil_mask;             /*!< GPIO mask of all four coil pins */
+    uint32_t phase_masks[8];        /*!< Coil pins energized at each step of the sequence */
+    uint step_delay_us;             /*!< Delay between steps at cruise speed in microseconds */
+    int current_step;               /*!< Current step position (0-7) */
+    volatile int32_t position;      /*!< Absolute position in steps since init (CW = positive) */
+    bool enabled;                   /*!< Motor enable state */
+    volatile int32_t pending_steps; /*!< Steps queued for the step engine (sign = direction) */
+    uint acceleration;              /*!< Ramp acceleration in steps/s^2 (0 = start at full speed) */
+    uint16_t ramp_us[STEPPER_RAMP_STEPS]; /*!< Step interval at each ramp position in microseconds */
+    uint16_t ramp_length;           /*!< Ramp position at which the cruise speed is reached */
+    uint32_t cruise_us;             /*!< Step interval at cruise speed in microseconds */
+    uint16_t ramp_index;            /*!< Current ramp position (0 = standing start) */
+    int8_t direction;               /*!< Direction of the move in progress (+1, -1, 0 = stopped) */
+    int32_t countdown_us;           /*!< Time left until the step engine steps this motor */
+    stepper_idle_mode_t idle_mode;  /*!< Coil policy once idle for idle_timeout_ms */
+    uint32_t idle_timeout_ms;       /*!< Time without a step before idle_mode applies */
+    volatile uint32_t last_step_us; /*!< time_us_32() at the most recent step */
+    bool coils_idle;                /*!< idle_mode is in effect (phase remembered in current_step) */
 } stepper_motor_t;
 
 /**
@@ -97,11 +172,26 @@ typedef struct
  */
 bool stepper_init(stepper_motor_t *motor, uint pin1, uint pin2, uint pin3, uint pin4, uint step_delay);
 
+/**
+ * @brief Compile a motor's pins into its coil mask and phase mask table
+ *
+ * Called by stepper_init(); after it, each step is one masked GPIO write.
+ *
+ * @param motor Pointer to a stepper motor structure with its pins set
+ */
+void stepper_build_phase_masks(stepper_motor_t *motor);
+
 /**
  * @brief Move stepper motor by specified number of steps
  *
  * This function moves the stepper motor by the specified number of steps
- * in the given direction using 4-phase stepping sequence.
+ * in the given direction using 4-phase stepping sequence. With a step
+ * engine (STEPPER_USE_PIO or STEPPER_USE_TIMER) the steps are only queued
+ * and the call returns immediately; use stepper_is_busy() to find out when
+ * the move has drained. Queued moves follow the motor's own trapezoidal
+ * profile (acceleration, then step_delay_us cruise, then deceleration onto
+ * the target), independently of the other motors; steps queued during a
+ * move extend it seamlessly.
  *
  * @param motor Pointer to the stepper motor structure
  * @param steps Number of steps to move
@@ -152,14 +242,104 @@ void stepper_enable(stepper_motor_t *motor);
 void stepper_set_speed(stepper_motor_t *motor, uint step_delay);
 
 /**
- * @brief Get current step position
+ * @brief Set stepper motor speed with microsecond resolution
+ *
+ * The PIO engine rounds the step timing to its STEPPER_PIO_TICK_US tick;
+ * the timer engine (STEPPER_USE_TIMER) keeps the full resolution.
+ *
+ * @param motor Pointer to the stepper motor structure
+ * @param step_delay_us Delay between steps in microseconds (non-zero)
+ */
+void stepper_set_speed_us(stepper_motor_t *motor, uint step_delay_us);
+
+/**
+ * @brief Set stepper motor acceleration
+ *
+ * Moves ramp up to the step_delay_us cruise rate and back down at this
+ * rate, so the motor reaches speeds it could not start at without stalling.
+ * Only the step engines ramp; the blocking GPIO backend steps at step_delay_us.
  *
- * This function returns the current step position in the stepping sequence.
+ * @param motor Pointer to the stepper motor structure
+ * @param acceleration Acceleration in steps/s^2 (0 = no ramp, minimum STEPPER_MIN_ACCEL)
+ */
+void stepper_set_acceleration(stepper_motor_t *motor, uint acceleration);
+
+/**
+ * @brief Set what the coils do while the motor stands still
+ *
+ * After timeout_ms without a step the coils are released or dropped to a
+ * PWM-reduced hold (see stepper_idle_service()). The phase stays in
+ * current_step and is re-energized by the next move before its first step,
+ * so no position is lost and the move starts without delay.
+ *
+ * @param motor Pointer to the stepper motor structure
+ * @param mode Idle policy (STEPPER_IDLE_HOLD keeps the coils on)
+ * @param timeout_ms Time without a step before the policy applies (below 4294967 ms)
+ */
+void stepper_set_idle_policy(stepper_motor_t *motor, stepper_idle_mode_t mode, uint32_t timeout_ms);
+
+/**
+ * @brief Apply the idle policy to motors that have stood still long enough
+ *
+ * Call periodically from the core that owns the motors, e.g. its main loop.
+ *
+ * @param motors Array of stepper motor structures
+ * @param num_motors Number of motors in the array
+ * @return Microseconds until another motor's policy may fall due (0 = none pending)
+ */
+uint32_t stepper_idle_service(stepper_motor_t *motors, uint num_motors);
+
+/**
+ * @brief Get the absolute shaft position
+ *
+ * Counts every step taken since stepper_init() or stepper_set_position(),
+ * clockwise positive. With a step engine this is where the shaft is now,
+ * not where the queued move will end.
+ *
+ * @param motor Pointer to the stepper motor structure
+ * @return Absolute position in steps
+ */
+int32_t stepper_get_position(const stepper_motor_t *motor);
+
+/**
+ * @brief Redefine the current shaft position (e.g. 0 at a home mark)
+ *
+ * @param motor Pointer to the stepper motor structure
+ * @param position New absolute position of the shaft in steps
+ */
+void stepper_set_position(stepper_motor_t *motor, int32_t position);
+
+/**
+ * @brief Move to an absolute position
+ *
+ * Queues the difference between the target and where already queued steps
+ * will leave the motor, so a new target during a move retargets it instead
+ * of adding to it.
+ *
+ * @param motor Pointer to the stepper motor structure
+ * @param target Absolute target position in steps
+ */
+void stepper_move_to(stepper_motor_t *motor, int32_t target);
+
+/**
+ * @brief Check if a stepper motor still has queued steps
+ *
+ * Always false for the blocking GPIO backend, where moves complete before
+ * stepper_move_steps() returns.
+ *
+ * @param motor Pointer to the stepper motor structure
+ * @return true if steps are still queued, false otherwise
+ */
+bool stepper_is_busy(const stepper_motor_t *motor);
+
+/**
+ * @brief Get the GPIO output mask for a step in the phase sequence
  *
  * @param motor Pointer to the stepper motor structure
- * @return Current step position (0-7)
+ * @param step Step index in the phase sequence (0-7)
+ * @return Mask with a bit set for every coil pin energized in that step
  */
-int stepper_get_position(stepper_motor_t *motor);
+uint32_t stepper_phase_mask(const stepper_motor_t *motor, int step);
 
 /**
  * @brief Rotate multiple stepper motors simultaneously by degrees
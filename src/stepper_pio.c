@@ -0,0 +1,267 @@
+/**
+ * @file stepper_pio.c
+ * @brief PIO-driven stepper motor engine implementation
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This source file implements the PIO stepper backend. One state machine on
+ * PIO0 owns the coil pins of every attached motor and holds each pushed coil
+ * pattern for one STEPPER_PIO_TICK_US tick. Queued steps are kept as signed
+ * per-motor counters; the PIO TX-FIFO-not-full interrupt counts down each
+ * busy motor's planner interval, steps the motors that are due, composes the
+ * combined coil pattern and pushes it, so every motor runs its own ramp while
+ * the hardware keeps time and the main loop keeps running.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#include <stdio.h>
+#include "stepper_pio.h"
+#include "stepper_planner.h"
+#include "log.h"
+#include "trace.h"
+#include "hardware/pio.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/clocks.h"
+#include "stepper.pio.h"
+
+// Internal engine state
+typedef struct
+{
+    PIO pio;
+    uint sm;
+    uint offset;
+    bool started;
+    stepper_motor_t *motors[MAX_STEPPERS];
+    uint num_motors;
+    uint32_t coil_mask; // Every pin owned by the engine
+    uint32_t pattern;   // Coil pattern most recently queued
+} stepper_pio_state_t;
+
+static stepper_pio_state_t engine = {0};
+
+// Forward declarations
+static bool stepper_pio_start(void);
+static float stepper_pio_clkdiv(void);
+static uint32_t stepper_pio_motor_mask(const stepper_motor_t *motor);
+static uint32_t stepper_pio_motor_bits(const stepper_motor_t *motor);
+static bool stepper_pio_advance(void);
+static void stepper_pio_irq_handler(void);
+
+bool stepper_pio_attach(stepper_motor_t *motor)
+{
+    if (motor == NULL || engine.num_motors >= MAX_STEPPERS)
+    {
+        return false;
+    }
+
+    if (!engine.started && !stepper_pio_start())
+    {
+        return false;
+    }
+
+    // Hand the coil pins over to the PIO
+    uint32_t mask = stepper_pio_motor_mask(motor);
+    pio_gpio_init(engine.pio, motor->pin1);
+    pio_gpio_init(engine.pio, motor->pin2);
+    pio_gpio_init(engine.pio, motor->pin3);
+    pio_gpio_init(engine.pio, motor->pin4);
+    pio_sm_set_pindirs_with_mask(engine.pio, engine.sm, mask, mask);
+
+    uint32_t save = save_and_disable_interrupts();
+    motor->pending_steps = 0;
+    stepper_planner_reset(motor);
+    engine.motors[engine.num_motors++] = motor;
+    engine.coil_mask |= mask;
+    restore_interrupts(save);
+
+    return true;
+}
+
+void stepper_pio_queue(stepper_motor_t *motor, int32_t steps)
+{
+    if (motor == NULL || steps == 0)
+    {
+        return;
+    }
+
+    uint32_t save = save_and_disable_interrupts();
+    motor->pending_steps += steps;
+    restore_interrupts(save);
+
+    // The refill interrupt fires straight away while the FIFO has room
+    pio_set_irq0_source_enabled(engine.pio, pis_sm0_tx_fifo_not_full + engine.sm, true);
+}
+
+void stepper_pio_write(stepper_motor_t *motor)
+{
+    if (motor == NULL || !engine.started)
+    {
+        return;
+    }
+
+    uint32_t save = save_and_disable_interrupts();
+    engine.pattern = (engine.pattern & ~stepper_pio_motor_mask(motor)) | stepper_pio_motor_bits(motor);
+
+    // When stepping, the next queued step carries the new state anyway
+    if (!pio_sm_is_tx_fifo_full(engine.pio, engine.sm))
+    {
+        pio_sm_put(engine.pio, engine.sm, engine.pattern);
+    }
+    restore_interrupts(save);
+}
+
+void stepper_pio_flush(void)
+{
+    if (!engine.started)
+    {
+        return;
+    }
+
+    uint32_t save = save_and_disable_interrupts();
+    pio_set_irq0_source_enabled(engine.pio, pis_sm0_tx_fifo_not_full + engine.sm, false);
+
+    engine.pattern = 0;
+    for (uint i = 0; i < engine.num_motors; i++)
+    {
+        engine.motors[i]->pending_steps = 0;
+        stepper_planner_reset(engine.motors[i]);
+        engine.pattern |= stepper_pio_motor_bits(engine.motors[i]);
+    }
+
+    // Drop queued patterns and restart at the pull so the new one lands now
+    pio_sm_set_enabled(engine.pio, engine.sm, false);
+    pio_sm_clear_fifos(engine.pio, engine.sm);
+    pio_sm_restart(engine.pio, engine.sm);
+    pio_sm_exec(engine.pio, engine.sm, pio_encode_jmp(engine.offset));
+    pio_sm_put(engine.pio, engine.sm, engine.pattern);
+    pio_sm_set_enabled(engine.pio, engine.sm, true);
+    restore_interrupts(save);
+}
+
+// Internal helper functions
+
+static bool stepper_pio_start(void)
+{
+    engine.pio = pio0;
+
+    if (!pio_can_add_program(engine.pio, &stepper_program))
+    {
+        LOG(STEPPER, ERROR, "Stepper: ❌ No PIO instruction memory for step engine\n");
+        return false;
+    }
+
+    int sm = pio_claim_unused_sm(engine.pio, false);
+    if (sm < 0)
+    {
+        LOG(STEPPER, ERROR, "Stepper: ❌ No free PIO state machine for step engine\n");
+        return false;
+    }
+
+    engine.sm = (uint)sm;
+    engine.offset = pio_add_program(engine.pio, &stepper_program);
+    stepper_program_init(engine.pio, engine.sm, engine.offset, stepper_pio_clkdiv());
+
+    irq_set_exclusive_handler(PIO0_IRQ_0, stepper_pio_irq_handler);
+    irq_set_enabled(PIO0_IRQ_0, true);
+
+    engine.started = true;
+    LOG(STEPPER, INFO, "Stepper: PIO step engine running on PIO0 SM%d\n", engine.sm);
+    return true;
+}
+
+static float stepper_pio_clkdiv(void)
+{
+    // Cycles needed per tick at the system clock, spread over the PIO program
+    float div = ((float)clock_get_hz(clk_sys) * (float)STEPPER_PIO_TICK_US / 1000000.0f) /
+                (float)STEPPER_PIO_CYCLES_PER_STEP;
+
+    if (div < 1.0f)
+    {
+        div = 1.0f;
+    }
+    else if (div > 65535.0f)
+    {
+        div = 65535.0f;
+    }
+    return div;
+}
+
+static uint32_t stepper_pio_motor_mask(const stepper_motor_t *motor)
+{
+    return motor->coil_mask;
+}
+
+static uint32_t stepper_pio_motor_bits(const stepper_motor_t *motor)
+{
+    if (!motor->enabled || motor->coils_idle)
+    {
+        return 0;
+    }
+    return stepper_phase_mask(motor, motor->current_step);
+}
+
+static bool stepper_pio_advance(void)
+{
+    bool active = false;
+
+    if (stepper_is_interrupted())
+    {
+        return false;
+    }
+
+    for (uint i = 0; i < engine.num_motors; i++)
+    {
+        stepper_motor_t *motor = engine.motors[i];
+        if (!motor->enabled || (motor->pending_steps == 0 && motor->ramp_index == 0 && motor->countdown_us <= 0))
+        {
+            motor->countdown_us = 0;
+            continue;
+        }
+
+        // Busy until the interval after its last step has elapsed
+        active = true;
+        motor->countdown_us -= STEPPER_PIO_TICK_US;
+        if (motor->countdown_us > 0)
+        {
+            continue;
+        }
+
+        uint32_t interval_us;
+        bool standstill = (motor->ramp_index == 0);
+        int direction = stepper_planner_next_step(motor, &interval_us);
+        if (direction == 0)
+        {
+            continue;
+        }
+
+        motor->current_step = (motor->current_step + direction + 8) % 8;
+        motor->position += direction;
+        motor->last_step_us = time_us_32();
+        motor->countdown_us += (int32_t)interval_us;
+        engine.pattern = (engine.pattern & ~stepper_pio_motor_mask(motor)) | stepper_pio_motor_bits(motor);
+        if (standstill)
+        {
+            TRACE_MARK(TRACE_FIRST_STEP);
+        }
+    }
+
+    return active;
+}
+
+// PIO TX FIFO refill interrupt handler
+static void stepper_pio_irq_handler(void)
+{
+    while (!pio_sm_is_tx_fifo_full(engine.pio, engine.sm))
+    {
+        if (!stepper_pio_advance())
+        {
+            // No motor moving or waiting out an interval - stop refilling until more work is queued
+            pio_set_irq0_source_enabled(engine.pio, pis_sm0_tx_fifo_not_full + engine.sm, false);
+            return;
+        }
+        pio_sm_put(engine.pio, engine.sm, engine.pattern);
+    }
+}
@@ -0,0 +1,67 @@
+/**
+ * @file stepper_pio.h
+ * @brief PIO-driven stepper motor engine interface
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This header file provides the interface for the PIO stepper backend. All
+ * attached motors share one PIO state machine that clocks complete coil
+ * patterns out of its TX FIFO at a fixed, hardware-timed tick. The CPU only
+ * queues step counts; a FIFO-not-full interrupt turns them into coil
+ * patterns in the background, stepping each motor along its own
+ * acceleration profile (stepper_planner.h), so the stepper API no longer
+ * blocks on sleep_ms.
+ *
+ * Compile-time Configuration:
+ * - Define STEPPER_USE_PIO to route stepper.c through this engine
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef STEPPER_PIO_H
+#define STEPPER_PIO_H
+
+#include "pico/stdlib.h"
+#include "stepper.h"
+
+/**
+ * @brief Length of one engine tick in microseconds (step timing resolution)
+ */
+#define STEPPER_PIO_TICK_US 50
+
+/**
+ * @brief Attach a stepper motor to the PIO engine
+ *
+ * Hands the motor's four coil pins over to the PIO and starts the state
+ * machine on first use.
+ *
+ * @param motor Pointer to an initialized stepper motor structure
+ * @return true if the motor was attached, false if the engine is full or unavailable
+ */
+bool stepper_pio_attach(stepper_motor_t *motor);
+
+/**
+ * @brief Queue relative steps for a motor and return immediately
+ *
+ * @param motor Pointer to an attached stepper motor structure
+ * @param steps Signed step count (positive = clockwise, negative = counter-clockwise)
+ */
+void stepper_pio_queue(stepper_motor_t *motor, int32_t steps);
+
+/**
+ * @brief Drive a motor's coils to its current phase (or off if disabled)
+ *
+ * @param motor Pointer to an attached stepper motor structure
+ */
+void stepper_pio_write(stepper_motor_t *motor);
+
+/**
+ * @brief Cancel all queued steps and apply the current coil state at once
+ *
+ * Discards the FIFO contents and restarts the state machine so the new
+ * pattern is on the pins within a few cycles instead of after the pending steps.
+ */
+void stepper_pio_flush(void);
+
+#endif /* STEPPER_PIO_H */
@@ -0,0 +1,133 @@
+/**
+ * @file stepper_planner.c
+ * @brief Per-motor trapezoidal step planner implementation
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This source file implements the acceleration planner. Ramp tables are
+ * built once per speed or acceleration change with the AVR446 integer
+ * recurrence c(n) = c(n-1) - 2c(n-1)/(4n+1), carrying the division
+ * remainder so no error builds up; stepping then only indexes the table.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#include <math.h>
+#include <string.h>
+#include "stepper_planner.h"
+#include "hardware/sync.h"
+
+void stepper_planner_configure(stepper_motor_t *motor)
+{
+    if (motor == NULL)
+    {
+        return;
+    }
+
+    uint32_t cruise_us = motor->step_delay_us;
+    uint16_t ramp_us[STEPPER_RAMP_STEPS];
+    uint16_t ramp_length = 0;
+
+    if (motor->acceleration == 0)
+    {
+        // No ramp; a move already past position 0 finishes at the cruise rate
+        for (uint n = 0; n < STEPPER_RAMP_STEPS; n++)
+        {
+            ramp_us[n] = (cruise_us > UINT16_MAX) ? UINT16_MAX : (uint16_t)cruise_us;
+        }
+    }
+    else
+    {
+        uint accel = (motor->acceleration < STEPPER_MIN_ACCEL) ? STEPPER_MIN_ACCEL : motor->acceleration;
+
+        // First interval 0.676 * sqrt(2 / a), the AVR446 start correction included
+        uint32_t c = (uint32_t)(676000.0f * sqrtf(2.0f / (float)accel));
+        uint32_t rest = 0;
+
+        ramp_length = STEPPER_RAMP_STEPS;
+        for (uint n = 0; n < STEPPER_RAMP_STEPS; n++)
+        {
+            ramp_us[n] = (uint16_t)c;
+            if (c <= cruise_us && ramp_length == STEPPER_RAMP_STEPS)
+            {
+                ramp_length = (uint16_t)n;
+            }
+
+            uint32_t numerator = 2 * c + rest;
+            uint32_t denominator = 4 * (n + 1) + 1;
+            c -= numerator / denominator;
+            rest = numerator % denominator;
+        }
+
+        // A cruise rate beyond the table is capped at the end of the ramp
+        if (cruise_us < ramp_us[STEPPER_RAMP_STEPS - 1])
+        {
+            cruise_us = ramp_us[STEPPER_RAMP_STEPS - 1];
+        }
+    }
+
+    // Swap the new profile in while the step engine cannot run
+    uint32_t save = save_and_disable_interrupts();
+    memcpy(motor->ramp_us, ramp_us, sizeof(ramp_us));
+    motor->ramp_length = ramp_length;
+    motor->cruise_us = cruise_us;
+    restore_interrupts(save);
+}
+
+void stepper_planner_reset(stepper_motor_t *motor)
+{
+    if (motor == NULL)
+    {
+        return;
+    }
+
+    motor->ramp_index = 0;
+    motor->direction = 0;
+    motor->countdown_us = 0;
+}
+
+int stepper_planner_next_step(stepper_motor_t *motor, uint32_t *interval_us)
+{
+    int32_t pending = motor->pending_steps;
+
+    if (pending == 0 && motor->ramp_index == 0)
+    {
+        motor->direction = 0;
+        return 0;
+    }
+
+    // A moving motor keeps its direction until it has slowed to a standstill
+    if (motor->ramp_index == 0 || motor->direction == 0)
+    {
+        motor->direction = (pending > 0) ? 1 : -1;
+    }
+    pending -= motor->direction;
+    motor->pending_steps = pending;
+
+    // Steps left in the current direction; negative while reversing
+    int32_t remaining = pending * motor->direction;
+    int32_t target = (remaining > 0) ? remaining : 0;
+    int32_t index = motor->ramp_index;
+
+    if (index < motor->ramp_length)
+    {
+        index++; // Accelerate
+    }
+    else if (index > motor->ramp_length)
+    {
+        index--; // Cruise rate was lowered mid-move
+    }
+
+    // Stopping from ramp position n takes n steps - brake as late as possible
+    if (index > target)
+    {
+        index = (target > (int32_t)motor->ramp_index - 1) ? target : (int32_t)motor->ramp_index - 1;
+    }
+    motor->ramp_index = (uint16_t)index;
+
+    // Above the ramp length only while slowing to a lowered cruise rate
+    *interval_us = (index == motor->ramp_length || index >= STEPPER_RAMP_STEPS) ? motor->cruise_us
+                                                                                : motor->ramp_us[index];
+    return motor->direction;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file stepper_planner.h
+ * @brief Per-motor trapezoidal step planner interface
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This header file provides the acceleration planner used by the step
+ * engines. Each motor gets a precomputed table of step intervals for its
+ * acceleration (AVR446 integer recurrence), and a step engine asks the
+ * planner for the next step and the time until the following one. The
+ * motor ramps up from a standing start, cruises at its step_delay_us and ramps
+ * down so it stops on its target, independently of the other motors.
+ *
+ * The planner keeps only a ramp position per motor: reaching ramp position
+ * n takes n steps and stopping from it takes n steps, so a motor starts
+ * decelerating as soon as its remaining steps fall to its ramp position.
+ * Steps queued during a move extend it without a stop in between, and a
+ * reversal decelerates to a standstill before turning around.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef STEPPER_PLANNER_H
+#define STEPPER_PLANNER_H
+
+#include "pico/stdlib.h"
+#include "stepper.h"
+
+/**
+ * @brief Rebuild a motor's ramp table from its acceleration and step_delay_us
+ *
+ * Call whenever acceleration or step_delay_us changes. Safe while the motor
+ * moves: the table is built aside and swapped in with interrupts disabled.
+ *
+ * @param motor Pointer to the stepper motor structure
+ */
+void stepper_planner_configure(stepper_motor_t *motor);
+
+/**
+ * @brief Forget any motion in progress (the next step starts a new ramp)
+ *
+ * @param motor Pointer to the stepper motor structure
+ */
+void stepper_planner_reset(stepper_motor_t *motor);
+
+/**
+ * @brief Take the next step of a motor's queued move
+ *
+ * Updates pending_steps and the ramp position. Call from the step engine
+ * each time the previous interval has elapsed.
+ *
+ * @param motor Pointer to the stepper motor structure
+ * @param interval_us Pointer to store the time until the following step
+ * @return int Step direction: +1 clockwise, -1 counter-clockwise, 0 if idle
+ */
+int stepper_planner_next_step(stepper_motor_t *motor, uint32_t *interval_us);
+
+#endif /* STEPPER_PLANNER_H */
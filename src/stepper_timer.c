@@ -0,0 +1,244 @@
+/**
+ * @file stepper_timer.c
+ * @brief Hardware-alarm-driven stepper motor engine implementation
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This source file implements the timer stepper backend. Each busy motor
+ * has an absolute due time for its next step. The alarm interrupt steps the
+ * motors that are due, composes their new coil states into one pattern,
+ * writes it with one gpio_put_masked() and re-arms the alarm for the next
+ * due time. A motor advances at most one phase per interrupt, so coils
+ * never skip a phase; a due time already in the past re-fires the alarm at
+ * once, so a late interrupt delays steps without losing any.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#include <stdio.h>
+#include "stepper_timer.h"
+#include "stepper_planner.h"
+#include "log.h"
+#include "trace.h"
+#include "hardware/timer.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+
+// Internal engine state
+typedef struct
+{
+    int alarm;
+    bool armed;
+    uint64_t target_us; // Time the alarm is armed for
+    stepper_motor_t *motors[MAX_STEPPERS];
+    uint64_t due_us[MAX_STEPPERS]; // Next step time of each motor
+    uint num_motors;
+    uint32_t coil_mask; // Every pin owned by the engine
+    uint32_t pattern;   // Coil pattern most recently written
+} stepper_timer_state_t;
+
+static stepper_timer_state_t engine = {.alarm = -1};
+
+// Forward declarations
+static uint32_t stepper_timer_motor_mask(const stepper_motor_t *motor);
+static uint32_t stepper_timer_motor_bits(const stepper_motor_t *motor);
+static bool stepper_timer_is_moving(const stepper_motor_t *motor);
+static void stepper_timer_arm(uint64_t due_us);
+static void stepper_timer_alarm_handler(uint alarm_num);
+
+bool stepper_timer_attach(stepper_motor_t *motor)
+{
+    if (motor == NULL || engine.num_motors >= MAX_STEPPERS)
+    {
+        return false;
+    }
+
+    if (engine.alarm < 0)
+    {
+        engine.alarm = hardware_alarm_claim_unused(false);
+        if (engine.alarm < 0)
+        {
+            LOG(STEPPER, ERROR, "Stepper: ❌ No free hardware alarm for step engine\n");
+            return false;
+        }
+        hardware_alarm_set_callback((uint)engine.alarm, stepper_timer_alarm_handler);
+        LOG(STEPPER, INFO, "Stepper: Timer step engine running on alarm %d\n", engine.alarm);
+    }
+
+    uint32_t save = save_and_disable_interrupts();
+    motor->pending_steps = 0;
+    stepper_planner_reset(motor);
+    engine.due_us[engine.num_motors] = 0;
+    engine.motors[engine.num_motors++] = motor;
+    engine.coil_mask |= stepper_timer_motor_mask(motor);
+    restore_interrupts(save);
+
+    return true;
+}
+
+void stepper_timer_queue(stepper_motor_t *motor, int32_t steps)
+{
+    if (motor == NULL || steps == 0 || engine.alarm < 0)
+    {
+        return;
+    }
+
+    uint32_t save = save_and_disable_interrupts();
+    for (uint i = 0; i < engine.num_motors; i++)
+    {
+        if (engine.motors[i] != motor)
+        {
+            continue;
+        }
+
+        // A motor at rest steps now, or once the interval after its last step is over
+        if (!stepper_timer_is_moving(motor))
+        {
+            uint64_t now = time_us_64();
+            if (engine.due_us[i] < now)
+            {
+                engine.due_us[i] = now;
+            }
+        }
+
+        motor->pending_steps += steps;
+        if (!engine.armed || engine.due_us[i] < engine.target_us)
+        {
+            stepper_timer_arm(engine.due_us[i]);
+        }
+        break;
+    }
+    restore_interrupts(save);
+}
+
+void stepper_timer_write(stepper_motor_t *motor)
+{
+    if (motor == NULL)
+    {
+        return;
+    }
+
+    uint32_t mask = stepper_timer_motor_mask(motor);
+    uint32_t save = save_and_disable_interrupts();
+    engine.pattern = (engine.pattern & ~mask) | stepper_timer_motor_bits(motor);
+    gpio_put_masked(mask, engine.pattern);
+    restore_interrupts(save);
+}
+
+void stepper_timer_flush(void)
+{
+    if (engine.alarm < 0)
+    {
+        return;
+    }
+
+    uint32_t save = save_and_disable_interrupts();
+    hardware_alarm_cancel((uint)engine.alarm);
+    engine.armed = false;
+
+    engine.pattern = 0;
+    for (uint i = 0; i < engine.num_motors; i++)
+    {
+        engine.motors[i]->pending_steps = 0;
+        stepper_planner_reset(engine.motors[i]);
+        engine.pattern |= stepper_timer_motor_bits(engine.motors[i]);
+    }
+    gpio_put_masked(engine.coil_mask, engine.pattern);
+    restore_interrupts(save);
+}
+
+// Internal helper functions
+
+static uint32_t stepper_timer_motor_mask(const stepper_motor_t *motor)
+{
+    return motor->coil_mask;
+}
+
+static uint32_t stepper_timer_motor_bits(const stepper_motor_t *motor)
+{
+    if (!motor->enabled || motor->coils_idle)
+    {
+        return 0;
+    }
+    return stepper_phase_mask(motor, motor->current_step);
+}
+
+static bool stepper_timer_is_moving(const stepper_motor_t *motor)
+{
+    return motor->enabled && (motor->pending_steps != 0 || motor->ramp_index != 0);
+}
+
+static void stepper_timer_arm(uint64_t due_us)
+{
+    engine.target_us = due_us;
+    engine.armed = true;
+
+    // Already due - take it straight away instead of waiting a full timer wrap
+    if (hardware_alarm_set_target((uint)engine.alarm, from_us_since_boot(due_us)))
+    {
+        hardware_alarm_force_irq((uint)engine.alarm);
+    }
+}
+
+// Hardware alarm interrupt handler
+static void stepper_timer_alarm_handler(uint alarm_num)
+{
+    engine.armed = false;
+
+    if (stepper_is_interrupted())
+    {
+        return;
+    }
+
+    uint64_t now = time_us_64();
+    uint64_t next_us = UINT64_MAX;
+    uint32_t changed = 0;
+    bool started = false;
+
+    for (uint i = 0; i < engine.num_motors; i++)
+    {
+        stepper_motor_t *motor = engine.motors[i];
+        if (!stepper_timer_is_moving(motor))
+        {
+            continue;
+        }
+
+        if (engine.due_us[i] <= now)
+        {
+            uint32_t interval_us;
+            bool standstill = (motor->ramp_index == 0);
+            int direction = stepper_planner_next_step(motor, &interval_us);
+            if (direction != 0)
+            {
+                started |= standstill;
+                motor->current_step = (motor->current_step + direction + 8) % 8;
+                motor->position += direction;
+                motor->last_step_us = (uint32_t)now;
+                engine.due_us[i] += interval_us;
+                changed |= stepper_timer_motor_mask(motor);
+            }
+        }
+
+        engine.pattern = (engine.pattern & ~stepper_timer_motor_mask(motor)) | stepper_timer_motor_bits(motor);
+        if (stepper_timer_is_moving(motor) && engine.due_us[i] < next_us)
+        {
+            next_us = engine.due_us[i];
+        }
+    }
+
+    // One register write updates every motor that stepped
+    if (changed != 0)
+    {
+        gpio_put_masked(changed, engine.pattern);
+        if (started)
+        {
+            TRACE_MARK(TRACE_FIRST_STEP);
+        }
+    }
+
+    if (next_us != UINT64_MAX)
+    {
+        stepper_timer_arm(next_us);
+    }
+}
@@ -0,0 +1,62 @@
+/**
+ * @file stepper_timer.h
+ * @brief Hardware-alarm-driven stepper motor engine interface
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This header file provides the interface for the timer stepper backend.
+ * One RP2040 hardware alarm is kept armed for the earliest step due among
+ * the attached motors; its interrupt steps every motor that is due along
+ * its acceleration profile (stepper_planner.h) and updates all their coils
+ * with a single masked GPIO write. Step timing has microsecond resolution
+ * and the CPU is free between steps.
+ *
+ * Compile-time Configuration:
+ * - Define STEPPER_USE_TIMER (without STEPPER_USE_PIO) to route stepper.c
+ *   through this engine
+ *
+ * The alarm interrupt is taken on the core that attaches the first motor,
+ * which must be the core that drives the stepper API.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef STEPPER_TIMER_H
+#define STEPPER_TIMER_H
+
+#include "pico/stdlib.h"
+#include "stepper.h"
+
+/**
+ * @brief Attach a stepper motor to the timer engine
+ *
+ * Claims a hardware alarm on first use. The motor's pins must already be
+ * SIO outputs.
+ *
+ * @param motor Pointer to an initialized stepper motor structure
+ * @return true if the motor was attached, false if the engine is full or no alarm is free
+ */
+bool stepper_timer_attach(stepper_motor_t *motor);
+
+/**
+ * @brief Queue relative steps for a motor and return immediately
+ *
+ * @param motor Pointer to an attached stepper motor structure
+ * @param steps Signed step count (positive = clockwise, negative = counter-clockwise)
+ */
+void stepper_timer_queue(stepper_motor_t *motor, int32_t steps);
+
+/**
+ * @brief Drive a motor's coils to its current phase (or off if disabled)
+ *
+ * @param motor Pointer to an attached stepper motor structure
+ */
+void stepper_timer_write(stepper_motor_t *motor);
+
+/**
+ * @brief Cancel all queued steps and apply the current coil state at once
+ */
+void stepper_timer_flush(void);
+
+#endif /* STEPPER_TIMER_H */
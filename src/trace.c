@@ -0,0 +1,199 @@
+/**
+ * @file trace.c
+ * @brief Command latency trace points and histograms implementation
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This source file implements the latency trace. Every stage keeps the
+ * timestamp of its most recent mark and a histogram of its latency since
+ * the stage before it. Marks come from thread and interrupt context on both
+ * cores, so updates happen under a hardware spin lock; printing works from
+ * a copy taken under the lock.
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "trace.h"
+#include "hardware/sync.h"
+
+// Stage names and the stage each one is timed from (itself = start of a chain)
+static const struct
+{
+    const char *name;
+    trace_stage_t from;
+} stages[TRACE_STAGE_COUNT] = {
+    [TRACE_BUTTON] = {"BTN", TRACE_BUTTON},
+    [TRACE_AT_SEND] = {"TX", TRACE_BUTTON},
+    [TRACE_SEND_OK] = {"AIR", TRACE_AT_SEND},
+    [TRACE_RCV_LINE] = {"RCV", TRACE_RCV_LINE},
+    [TRACE_PARSE] = {"PARSE", TRACE_RCV_LINE},
+    [TRACE_DISPATCH] = {"DISP", TRACE_PARSE},
+    [TRACE_FIRST_STEP] = {"STEP", TRACE_DISPATCH},
+    [TRACE_ACK_SENT] = {"ACK", TRACE_DISPATCH},
+};
+
+// Trace state
+static trace_histogram_t histograms[TRACE_STAGE_COUNT];
+static uint64_t marked_us[TRACE_STAGE_COUNT];   // Most recent mark of each stage (0 = never)
+static uint64_t consumed_us[TRACE_STAGE_COUNT]; // Mark of the from-stage each stage last timed against
+static spin_lock_t *trace_lock = NULL;
+
+// Forward declarations
+static uint trace_bucket(uint32_t latency_us);
+
+void trace_init(void)
+{
+    if (trace_lock == NULL)
+    {
+        trace_lock = spin_lock_instance((uint)spin_lock_claim_unused(true));
+    }
+}
+
+void trace_mark(trace_stage_t stage)
+{
+    spin_lock_t *lock = trace_lock;
+    if (lock == NULL || stage >= TRACE_STAGE_COUNT)
+    {
+        return; // trace_init() not called yet
+    }
+
+    uint32_t save = spin_lock_blocking(lock);
+    uint64_t now_us = time_us_64();
+    marked_us[stage] = now_us;
+
+    // Time against each occurrence of the previous stage once
+    trace_stage_t from = stages[stage].from;
+    uint64_t from_us = marked_us[from];
+    if (from != stage && from_us != 0 && from_us != consumed_us[stage] && from_us <= now_us)
+    {
+        uint64_t elapsed_us = now_us - from_us;
+        uint32_t latency_us = (elapsed_us > UINT32_MAX) ? UINT32_MAX : (uint32_t)elapsed_us;
+        trace_histogram_t *histogram = &histograms[stage];
+
+        consumed_us[stage] = from_us;
+        histogram->count++;
+        histogram->total_us += latency_us;
+        histogram->buckets[trace_bucket(latency_us)]++;
+        if (latency_us > histogram->max_us)
+        {
+            histogram->max_us = latency_us;
+        }
+    }
+
+    spin_unlock(lock, save);
+}
+
+void trace_reset(void)
+{
+    spin_lock_t *lock = trace_lock;
+    if (lock == NULL)
+    {
+        return;
+    }
+
+    uint32_t save = spin_lock_blocking(lock);
+    memset(histograms, 0, sizeof(histograms));
+    memset(marked_us, 0, sizeof(marked_us));
+    memset(consumed_us, 0, sizeof(consumed_us));
+    spin_unlock(lock, save);
+}
+
+bool trace_get_histogram(trace_stage_t stage, trace_histogram_t *histogram)
+{
+    spin_lock_t *lock = trace_lock;
+    if (histogram == NULL || stage >= TRACE_STAGE_COUNT)
+    {
+        return false;
+    }
+
+    if (lock == NULL)
+    {
+        memset(histogram, 0, sizeof(*histogram));
+        return true;
+    }
+
+    uint32_t save = spin_lock_blocking(lock);
+    *histogram = histograms[stage];
+    spin_unlock(lock, save);
+    return true;
+}
+
+void trace_dump(void)
+{
+    printf("Trace: latency per stage (us, since the previous stage)\n");
+
+    for (uint stage = 0; stage < TRACE_STAGE_COUNT; stage++)
+    {
+        trace_histogram_t histogram;
+        trace_get_histogram((trace_stage_t)stage, &histogram);
+        if (histogram.count == 0)
+        {
+            continue;
+        }
+
+        printf("  %-5s <- %-5s n=%lu avg=%lu max=%lu\n", stages[stage].name, stages[stages[stage].from].name,
+               (unsigned long)histogram.count, (unsigned long)(histogram.total_us / histogram.count),
+               (unsigned long)histogram.max_us);
+
+        // One line per non-empty bucket: [low, high) count
+        for (uint bucket = 0; bucket < TRACE_BUCKETS; bucket++)
+        {
+            if (histogram.buckets[bucket] > 0)
+            {
+                printf("    [%lu, %lu) %lu\n", (bucket == 0) ? 0ul : (1ul << bucket),
+                       (1ul << (bucket + 1)), (unsigned long)histogram.buckets[bucket]);
+            }
+        }
+    }
+}
+
+size_t trace_format_summary(char *buffer, size_t size)
+{
+    if (buffer == NULL || size == 0)
+    {
+        return 0;
+    }
+
+    size_t length = 0;
+    buffer[0] = '\0';
+
+    for (uint stage = 0; stage < TRACE_STAGE_COUNT; stage++)
+    {
+        trace_histogram_t histogram;
+        trace_get_histogram((trace_stage_t)stage, &histogram);
+        if (histogram.count == 0)
+        {
+            continue;
+        }
+
+        int written = snprintf(buffer + length, size - length, "%s%s=%lu/%lu/%lu",
+                               (length > 0) ? ";" : "", stages[stage].name,
+                               (unsigned long)histogram.count,
+                               (unsigned long)(histogram.total_us / histogram.count),
+                               (unsigned long)histogram.max_us);
+        if (written < 0 || (size_t)written >= size - length)
+        {
+            buffer[length] = '\0'; // Keep whole entries only
+            break;
+        }
+        length += (size_t)written;
+    }
+
+    return length;
+}
+
+// Internal helper functions
+
+static uint trace_bucket(uint32_t latency_us)
+{
+    if (latency_us < 2)
+    {
+        return 0;
+    }
+
+    uint bucket = 31u - (uint)__builtin_clz(latency_us);
+    return (bucket < TRACE_BUCKETS) ? bucket : TRACE_BUCKETS - 1;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file trace.h
+ * @brief Command latency trace points and histograms interface
+ * @version 1.0
+ * @date 2025-06-15
+ * @author Kevin Thomas
+ *
+ * This header file provides timestamped trace points along the path of a
+ * command, from the remote's button edge to the controller's first step and
+ * acknowledgment. Each stage records the time since the stage before it into
+ * a fixed power-of-two bucket histogram in RAM, so airtime, AT overhead and
+ * the motor loop show up separately.
+ *
+ * Stage chains (each device times only its own half):
+ * - Transmitter: BUTTON -> AT_SEND -> SEND_OK
+ * - Receiver: RCV_LINE -> PARSE -> DISPATCH -> FIRST_STEP, DISPATCH -> ACK_SENT
+ *
+ * Compile-time Configuration:
+ * - LORA_TRACE: TRACE_MARK() records; without it every trace point compiles to nothing
+ *
+ * Usage:
+ * - TRACE_MARK(TRACE_RCV_LINE) from thread or interrupt context, either core
+ * - trace_dump() prints every histogram over stdio
+ * - trace_format_summary() builds a one-line summary small enough for a LoRa reply
+ *
+ * @copyright Copyright (c) 2025 Kevin Thomas
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include "pico/stdlib.h"
+
+/**
+ * @brief Histogram buckets per stage; bucket i counts latencies of [2^i, 2^(i+1)) us
+ * (bucket 0 also holds 0 us, the last bucket everything longer)
+ */
+#define TRACE_BUCKETS 24
+
+/**
+ * @brief Trace points along a command's path
+ */
+typedef enum
+{
+    TRACE_BUTTON = 0,     /*!< Transmitter: button edge interrupt */
+    TRACE_AT_SEND = 1,    /*!< AT+SEND written to the module */
+    TRACE_SEND_OK = 2,    /*!< +OK for the AT+SEND received (packet on air) */
+    TRACE_RCV_LINE = 3,   /*!< Receiver: +RCV line complete in the UART ring */
+    TRACE_PARSE = 4,      /*!< +RCV line parsed and queued */
+    TRACE_DISPATCH = 5,   /*!< Frame handed to the message handler */
+    TRACE_FIRST_STEP = 6, /*!< First coil step of a move from standstill applied */
+    TRACE_ACK_SENT = 7,   /*!< +OK for the acknowledgment received */
+    TRACE_STAGE_COUNT
+} trace_stage_t;
+
+/**
+ * @brief Record a trace point (compiles to nothing unless LORA_TRACE is defined)
+ */
+#ifdef LORA_TRACE
+#define TRACE_MARK(stage) trace_mark(stage)
+#else
+#define TRACE_MARK(stage) \
+    do                    \
+    {                     \
+    } while (0)
+#endif
+
+/**
+ * @brief Latency histogram of one stage
+ */
+typedef struct
+{
+    uint32_t count;                  /*!< Latencies recorded */
+    uint32_t max_us;                 /*!< Largest latency */
+    uint64_t total_us;               /*!< Sum of latencies, for the average */
+    uint32_t buckets[TRACE_BUCKETS]; /*!< Counts per power-of-two bucket */
+} trace_histogram_t;
+
+/**
+ * @brief Claim the spin lock guarding the histograms
+ *
+ * Call once at startup, before any interrupt that records trace points is enabled.
+ */
+void trace_init(void);
+
+/**
+ * @brief Timestamp a stage and record its latency since the previous stage
+ *
+ * A stage records once per occurrence of the stage before it, so repeated
+ * marks (e.g. many steps after one command) do not inflate its histogram.
+ * Safe from interrupt handlers on either core.
+ *
+ * @param stage Stage reached
+ */
+void trace_mark(trace_stage_t stage);
+
+/**
+ * @brief Clear every histogram and timestamp
+ */
+void trace_reset(void);
+
+/**
+ * @brief Copy one stage's histogram
+ *
+ * @param stage Stage to read
+ * @param histogram Pointer to store the copy
+ * @return true if copied, false if the stage is invalid
+ */
+bool trace_get_histogram(trace_stage_t stage, trace_histogram_t *histogram);
+
+/**
+ * @brief Print every stage's histogram over stdio (call from idle time only)
+ */
+void trace_dump(void);
+
+/**
+ * @brief Format "<stage>=<count>/<avg us>/<max us>" for every recorded stage
+ *
+ * The text has no commas, so it can travel as a LoRa payload.
+ *
+ * @param buffer Output buffer
+ * @param size Output buffer size in bytes
+ * @return Length of the text written (excluding the terminator)
+ */
+size_t trace_format_summary(char *buffer, size_t size);
+
+#endif /* TRACE_H */